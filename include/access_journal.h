@@ -0,0 +1,95 @@
+#ifndef ACCESS_JOURNAL_H
+#define ACCESS_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ЖУРНАЛ ПРОХОДОВ НА ФЛЕШЕ
+// ==========================================
+// Кольцевой журнал в разделе "journal" (на хосте - файл MOUNT_POINT
+// "/journal.img"). Раздел делится на секторы по 4 КБ:
+// | заголовок (номер сектора) | 252 записи по 16 байт | фильтр карт сектора |
+// Запись - время (мс), карта, считыватель, решение, CRC8. Сектор
+// заполняется по порядку, следующий стирается перед записью (уходят самые
+// старые события), фильтр карт (256 бит) пишется при закрытии сектора.
+//
+// access_journal_append() только кладет событие в кольцо в RAM; задача
+// журнала пишет накопленное одной записью на флеш (групповая фиксация),
+// когда набралось ACCESS_JOURNAL_GROUP событий или прошло
+// ACCESS_JOURNAL_COMMIT_MS. Кольцо полно - событие отбрасывается (счетчик).
+//
+// Индекс в RAM: номер, время первой записи и фильтр карт каждого сектора.
+// При загрузке читаются заголовки и фильтры секторов, а записи - только
+// в последнем, открытом секторе: первая стертая ячейка (двоичный поиск) -
+// конец журнала, оборванная запись перед ней пропускается.
+//
+// Время - часы журнала в мс: системное время плюс поправка, чтобы после
+// перезагрузки без синхронизации часов время шло от последней записи.
+// Время записей не убывает - на этом держится поиск по интервалу.
+
+enum AccessDecision {
+    ACCESS_GRANTED = 0,
+    ACCESS_DENIED,        // карта заблокирована
+    ACCESS_UNKNOWN,       // карты нет в базе
+    ACCESS_ERROR          // ошибка чтения базы
+};
+
+struct AccessEvent {
+    uint64_t time_ms;     // часы журнала
+    uint64_t card_hex;
+    uint8_t reader;
+    uint8_t decision;     // AccessDecision
+};
+
+struct AccessJournalStats {
+    uint32_t appended;
+    uint32_t dropped;         // кольцо в RAM было полно
+    uint32_t committed;
+    uint32_t commits;         // записей на флеш (групп)
+    uint64_t bytes_written;   // записи, заголовки и фильтры секторов
+    uint32_t sectors_erased;
+    uint32_t max_commit_us;
+    uint32_t max_pending;     // наибольшая очередь в RAM
+    uint32_t recovered;       // записей найдено при загрузке
+    uint32_t torn;            // оборванных записей при загрузке
+    uint32_t recover_us;
+};
+
+// Открыть раздел, восстановить конец журнала и запустить задачу записи
+void access_journal_init(void);
+bool access_journal_ready(void);
+
+// Не блокирует: событие в кольцо RAM. false - журнал не готов или кольцо полно.
+bool access_journal_append(uint64_t card_hex, uint8_t reader, uint8_t decision);
+
+// Записать накопленное на флеш сейчас (синхронно)
+void access_journal_sync(void);
+
+// Текущее время часов журнала, мс
+uint64_t access_journal_now(void);
+
+// События с from_ms <= время <= to_ms, от старых к новым (включая еще не
+// записанные). Возвращает число событий в out (не больше max).
+size_t access_journal_query_range(uint64_t from_ms, uint64_t to_ms, struct AccessEvent* out, size_t max);
+
+// Последние max событий карты, от новых к старым
+size_t access_journal_query_card(uint64_t card_hex, struct AccessEvent* out, size_t max);
+
+// Емкость журнала в событиях и сколько их сейчас
+uint32_t access_journal_capacity(void);
+uint32_t access_journal_count(void);
+
+void get_access_journal_stats(struct AccessJournalStats* out);
+void print_access_journal_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACCESS_JOURNAL_H
@@ -0,0 +1,101 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Замеры производительности (запускаются из app_main при RUN_BENCHMARKS)
+void run_benchmarks(void);
+
+// Ядра упаковки/распаковки записей: побитовые vs пословные
+void bench_bit_kernels(void);
+
+// Поиск: чтение файла целиком vs один блок по разреженному индексу
+void bench_block_index(void);
+
+// Промахи с фильтром Блума и без него, фактическая доля ложных срабатываний
+void bench_card_filter(void);
+
+// Повторные предъявления с кешем последних решений и без него
+void bench_card_cache(void);
+
+// Поиск через fopen/fread на SPIFFS vs прямо по отображенному разделу
+void bench_storage_backends(void);
+
+// Запись в журнал изменений, поиск во время уплотнения, усиление записи
+void bench_delta_log(void);
+
+// Счетчики использования: байт на флеш на 1000 предъявлений (usage.log и
+// слияние в шарды), обращения поиска к флешу с накопленными счетчиками и без
+void bench_usage_counters(void);
+
+// Поиск с другого ядра во время перезаписи всех шардов: закрепление
+// поколения vs прежний поиск под db_lock (поисков в секунду, max, ошибки)
+void bench_generation_swap(void);
+
+// Пакетный поиск: пропускная способность при пакетах из 1, 4, 16 и 64 карт
+void bench_batch_lookup(void);
+
+// Попадания, промахи и ключи вне диапазона: p50/p99/max, поисков в секунду, байт на поиск
+void bench_lookup_suite(void);
+
+// Стоимость двухуровневого индекса на синтетических базах 10k/100k/1M записей
+void bench_index_scaling(void);
+
+// База целиком в RAM: память, время загрузки и поиск vs SPIFFS/раздел;
+// спуск Эйтцингера vs блоки шардов на синтетических 10k/100k карт
+void bench_ram_table(void);
+
+// Хеш-индекс на флеше vs границы блоков в RAM: попадания и промахи,
+// байт и чтений с флеша на поиск, размер индекса и время построения
+void bench_hash_index(void);
+
+// Обход всей базы: карт в секунду по бэкендам против чтения шардов целиком,
+// сверка счетчиков с эталоном, задержка поиска во время фонового обхода
+void bench_card_scan(void);
+
+// Время загрузки индекса: манифест (одно чтение) vs обход всех файлов данных
+void bench_manifest_boot(void);
+
+// Формат файла шарда: размер базы и емкость spiffs при 86 битах на запись и
+// с дельтами ключей; разбор блока в RAM и чтение блока с флеша в обоих форматах
+void bench_block_format(void);
+
+// Импорт несортированного списка 10k/50k строк в пределах IMPORT_MEMORY_BYTES:
+// записей в секунду, число прогонов и проходов слияния, запись на флеш
+void bench_bulk_import(void);
+
+// Поток импульсов Wiegand с реальными интервалами: кольцо фронтов + декодер
+// без потерь бит vs прежний опрос раз в 5 мс и чтение по INT расширителя
+void bench_wiegand_replay(void);
+
+// Реестр форматов: эталонные кадры разбираются, кадры со сбоем одного бита
+// и чужой длины отбрасываются; время разбора кадра
+void bench_wiegand_formats(void);
+
+// 1-4 считывателя на одном расширителе и 8 на двух: стоимость опроса и
+// разбора фронтов при одном чтении порта на расширитель
+void bench_multi_reader(void);
+
+// Чтение расширителей: список команд в куче на каждое чтение vs
+// статический проход шины; доля бит, которую увидит опрос с такой частотой
+void bench_i2c_poll(void);
+
+// Задержка от записи до чтения события: канал без блокировок vs xQueueSend
+// при 1000 соб/с, 20000 соб/с и пачкой
+void bench_read_channel(void);
+
+// Задержка search_card: printf в задаче поиска vs отложенный журнал vs без вывода
+void bench_event_log(void);
+
+// Журнал проходов: добавление (не ждет флеша), событий в секунду при
+// групповой фиксации vs файл SPIFFS по событию и группой; запросы
+// "интервал времени" и "последние события карты" vs просмотр файла
+void bench_access_journal(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCHMARK_H
@@ -0,0 +1,91 @@
+#ifndef CARD_BLOCK_H
+#define CARD_BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ФАЙЛ ШАРДА ВЕРСИИ 2 (блоки с дельтами ключей)
+// ==========================================
+// | CardFileHeader | блок 0 | блок 1 | ... |
+//
+// Блок - INDEX_BLOCK_RECORDS записей (последний может быть короче):
+// | first_id:56 | count:8 | width:8 | дельты | атрибуты |
+// Ключ первой записи хранится целиком (точка рестарта), для остальных -
+// разность с предыдущим ключом шириной width бит (по наибольшей разности
+// в блоке). Следом атрибуты всех записей по CARD_ATTR_BITS бит (поля -
+// CARD_ATTR_FIELDS в card_types.h, сейчас status:2 | count:4 | zones:8 |
+// link:16 = 30). Биты MSB-first, блок начинается с границы байта, размер
+// блока следует из заголовка.
+//
+// Поиск по блокам - бинарный по первым ключам (границы блоков в манифесте,
+// там же смещения блоков), внутри блока - суммирование дельт до ключа.
+// При шаге ключей 1..50 запись занимает 36 бит вместо 86.
+
+#define CARD_FILE_MAGIC 0x32424443  // "CDB2"
+#define CARD_FILE_VERSION 2
+
+struct CardFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_records;  // INDEX_BLOCK_RECORDS на момент записи
+    uint32_t records;
+    uint32_t blocks;
+};
+
+#define CARD_FILE_HEADER_BYTES sizeof(struct CardFileHeader)
+#define CARD_BLOCK_HEADER_BYTES 9
+
+// Худший случай: разности во все 56 бит
+#define CARD_BLOCK_MAX_BYTES \
+    (CARD_BLOCK_HEADER_BYTES + ((INDEX_BLOCK_RECORDS - 1) * CARD_KEY_BITS + INDEX_BLOCK_RECORDS * CARD_ATTR_BITS + 7) / 8)
+
+// Буферы декодера: за последним байтом блока или файла нужно
+// RECORD_READ_PAD доступных байт (см. card_record.h).
+
+// Размер блока по его заголовку; 0 - заголовок поврежден
+size_t card_block_size(const uint8_t* block);
+
+// Поиск ключа в блоке. Возвращает номер записи в блоке или -1.
+int card_block_find(const uint8_t* block, uint64_t target_hex, struct CardInfo* out);
+
+// Распаковка всех записей блока. Возвращает их число (0 - блок поврежден).
+int card_block_decode(const uint8_t* block, struct CardInfo* out);
+
+// Упаковка n (1..INDEX_BLOCK_RECORDS) карт с возрастающими ключами.
+// Возвращает размер блока, 0 - ключи не возрастают.
+size_t card_block_encode(const struct CardInfo* cards, int n, uint8_t* out);
+
+// Верхняя граница размера файла из records записей
+size_t card_file_max_bytes(uint32_t records);
+
+// Файл целиком: карты строго по возрастанию ключей. out - не меньше
+// card_file_max_bytes(records) + RECORD_READ_PAD байт. Возвращает размер
+// файла, 0 - ключи не возрастают.
+size_t card_file_encode(const struct CardInfo* cards, uint32_t records, uint8_t* out);
+
+// Только заголовок файла из records записей (блоки вслед за ним пишет
+// card_block_encode, по INDEX_BLOCK_RECORDS записей, последний - остаток)
+void card_file_init_header(uint8_t* out, uint32_t records);
+
+// Заголовок файла (len - размер файла). false - не файл версии 2.
+bool card_file_header(const uint8_t* data, size_t len, uint32_t* records);
+
+// Обход всех блоков файла: смещения и первые ключи блоков, последний ключ
+// файла. Заодно проверяет, что ключи строго возрастают. false - файл поврежден.
+bool card_file_index(const uint8_t* data, size_t len, uint32_t* offsets, uint64_t* fences, uint64_t* last_id);
+
+// Распаковка всех записей файла в out (места на records записей)
+bool card_file_decode(const uint8_t* data, size_t len, struct CardInfo* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_BLOCK_H
@@ -0,0 +1,56 @@
+#ifndef CARD_CACHE_H
+#define CARD_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "search.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Кеш последних решений по 56-битному ID: для найденных карт хранит
+// CardInfo, для ненайденных - "надгробие". Фиксированный размер, без
+// выделения памяти, вытеснение CLOCK внутри 4-way наборов.
+#define CARD_CACHE_WAYS 4
+#define CARD_CACHE_SETS 16
+#define CARD_CACHE_ENTRIES (CARD_CACHE_SETS * CARD_CACHE_WAYS)
+
+enum CardCacheResult {
+    CARD_CACHE_MISS = 0,
+    CARD_CACHE_HIT,       // карта есть, out заполнен
+    CARD_CACHE_NEGATIVE   // недавно искали - карты нет
+};
+
+struct CardCacheStats {
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t misses;
+    uint32_t expired;
+    uint32_t evictions;
+    uint32_t invalidations;
+    uint32_t stale_puts;   // ответ устарел, пока его искали, - не записан
+};
+
+enum CardCacheResult card_cache_lookup(uint64_t hex_id, struct CardInfo* out);
+
+// Эпоха набора ключа: снимается ДО чтения журнала изменений и файлов.
+// Запись с эпохой, которую успела сменить инвалидация, отбрасывается -
+// ответ, прочитанный до изменения карты, не попадет в кеш после него.
+uint32_t card_cache_epoch(uint64_t hex_id);
+void card_cache_put(uint64_t hex_id, const struct CardInfo* ci, uint32_t epoch);
+void card_cache_put_negative(uint64_t hex_id, uint32_t epoch);
+
+// Вызывать при любом изменении базы (изменение карты - под тем же
+// мьютексом, под которым оно становится видно поиску)
+void card_cache_invalidate(uint64_t hex_id);
+void card_cache_invalidate_all(void);
+
+void card_cache_set_enabled(bool enable);
+void get_card_cache_stats(struct CardCacheStats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_CACHE_H
@@ -0,0 +1,65 @@
+#ifndef CARD_DB_H
+#define CARD_DB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "search.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ИЗМЕНЕНИЕ БАЗЫ КАРТ
+// ==========================================
+// Изменения не трогают файлы данных: они попадают в небольшой
+// отсортированный журнал изменений (RAM + MOUNT_POINT "/delta.log"),
+// который поиск сливает с базой. Фоновая задача уплотнения переписывает
+// затронутые шарды в новые файлы и атомарно подменяет манифест.
+
+bool card_db_put(const struct CardInfo* ci);               // добавить/заменить карту
+bool card_db_delete(uint64_t hex_id);                      // отозвать карту
+bool card_db_set_status(uint64_t hex_id, uint8_t status);
+bool card_db_set_zones(uint64_t hex_id, uint8_t zones);
+
+// Проверка журнала изменений при поиске
+enum DeltaLookupResult {
+    DELTA_MISS = 0,   // в журнале нет - искать в файлах
+    DELTA_FOUND,      // out заполнен
+    DELTA_DELETED     // карта отозвана
+};
+enum DeltaLookupResult card_delta_lookup(uint64_t hex_id, struct CardInfo* out);
+uint32_t card_delta_count(void);
+// Для обхода базы (card_scan.h): изменения с ключами >= from_id по
+// возрастанию, не больше max; deleted[i] - карта отозвана
+uint32_t card_delta_collect(uint64_t from_id, struct CardInfo* out, bool* deleted, uint32_t max);
+
+// Загрузить журнал изменений и запустить задачу уплотнения (после load_indices())
+void card_db_init(void);
+
+// Уплотнение: синхронно (из задачи уплотнения или замеров) и по запросу
+bool card_db_compact(void);
+void card_db_request_compaction(void);
+bool card_db_compaction_running(void);
+
+// Заменить базу готовыми шардами (card_import.h): атомарная подмена
+// манифеста, журнал изменений сбрасывается. Файлы шардов уже записаны,
+// при ошибке они остаются вызывающему.
+bool card_db_replace(const struct ShardInfo* table, int count);
+
+struct CompactionStats {
+    uint32_t mutations;           // вызовы put/delete/set_*
+    uint64_t log_bytes;           // записано в delta.log
+    uint32_t runs;
+    uint64_t compaction_bytes;    // записано уплотнением (файлы данных + журнал)
+    uint32_t last_duration_ms;
+    uint32_t last_records;
+};
+void get_compaction_stats(struct CompactionStats* out);
+void print_compaction_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_DB_H
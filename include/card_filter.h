@@ -0,0 +1,60 @@
+#ifndef CARD_FILTER_H
+#define CARD_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Фильтр Блума по всем hex_id базы. Отвечает "точно нет" без обращения
+// к флешу; "возможно да" проверяется обычным поиском.
+// Хранится рядом с данными в MOUNT_POINT "/filter.bin".
+
+// Загрузить фильтр с флеша, а если файла нет или он не подходит -
+// построить заново по файлам данных и сохранить.
+void card_filter_load_or_build(void);
+
+// Построить фильтр по файлам данных и сохранить на флеш.
+bool card_filter_rebuild(void);
+
+// Сбросить фильтр (и удалить файл). Вызывать ПЕРЕД изменением файлов
+// данных: пока фильтр не готов, все карты идут в обычный поиск.
+void card_filter_invalidate(void);
+
+// Добавить ключ в готовый фильтр (без сохранения на флеш).
+void card_filter_add(uint64_t hex_id);
+
+// Сохранить живой фильтр (с добавленными ключами) на флеш. При ошибке
+// файл удаляется - при загрузке фильтр построится заново.
+bool card_filter_save(void);
+
+// Удалить файл фильтра, не трогая фильтр в RAM (он перестраивается, а
+// до того отвечает по прежним ключам).
+void card_filter_remove_file(void);
+
+// Добавленные ключи подняли оценку ложных срабатываний выше
+// CARD_FILTER_FP_RATE x CARD_FILTER_SATURATION - пора перестраивать.
+bool card_filter_saturated(void);
+
+// false - карты точно нет в базе. Если фильтр не готов - всегда true.
+bool card_filter_may_contain(uint64_t hex_id);
+
+// Включение/выключение проверки (для замеров)
+void card_filter_set_enabled(bool enable);
+
+// Целевая вероятность ложного срабатывания для следующей перестройки
+void card_filter_set_fp_rate(float fp_rate);
+
+bool card_filter_ready(void);
+size_t card_filter_memory_bytes(void);
+uint32_t card_filter_key_count(void);
+void print_card_filter_info(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_FILTER_H
@@ -0,0 +1,62 @@
+#ifndef CARD_HASH_H
+#define CARD_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ХЕШ-ИНДЕКС НА ФЛЕШЕ
+// ==========================================
+// Альтернатива поиску по границам блоков: файл MOUNT_POINT "/hash_<поколение>.bin"
+// рядом с шардами, открытая адресация по корзинам. Корзина - CARD_HASH_BUCKET_BYTES
+// (одно чтение с флеша), в ней 4-байтовые ячейки:
+// | отпечаток ключа:16 | шард:8 | блок шарда:8 |  (0 - пустая ячейка)
+// Поиск: чтение корзины по хешу ключа, затем чтение блока каждого совпавшего
+// отпечатка. Полная корзина продолжается в следующей; корзина с пустой
+// ячейкой - конец цепочки (промах без чтения данных).
+// Нулевая корзина - заголовок (поколение, число корзин и подпись списка
+// шардов): файл строится заново, если не подходит к поколению.
+#define CARD_HASH_BUCKET_BYTES 256
+#define CARD_HASH_BUCKET_SLOTS (CARD_HASH_BUCKET_BYTES / 4)
+
+struct CardHashIndex {
+    uint32_t generation;
+    uint32_t bucket_count;
+    uint32_t records;
+    size_t bytes;        // размер файла
+    uint32_t build_us;   // 0 - файл уже был на флеше
+    char path[32];
+};
+
+// Где лежит запись с совпавшим отпечатком
+struct CardHashRef {
+    uint8_t file_idx;    // позиция шарда в манифесте поколения
+    uint8_t block_idx;
+};
+
+// Открыть индекс поколения, при необходимости построить по шардам.
+// NULL - не хватило памяти или места на флеше (поиск идет по границам блоков).
+struct CardHashIndex* card_hash_open(const struct ShardInfo* shards, int count, uint32_t generation);
+
+// Закрыть индекс (remove_file - удалить файл поколения)
+void card_hash_close(struct CardHashIndex* idx, bool remove_file);
+
+// Кандидаты для ключа: не больше max, *bytes_read - прочитано с флеша.
+// Возвращает их число, -1 - ошибка чтения.
+int card_hash_probe(const struct CardHashIndex* idx, uint64_t hex_id, struct CardHashRef* out, int max,
+                    uint32_t* bytes_read);
+
+// Имя файла индекса поколения
+void card_hash_file_name(uint32_t generation, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_HASH_H
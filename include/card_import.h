@@ -0,0 +1,87 @@
+#ifndef CARD_IMPORT_H
+#define CARD_IMPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// МАССОВЫЙ ИМПОРТ СПИСКА КАРТ
+// ==========================================
+// Вход - текст, строка на карту (выгрузка отдела кадров, порядок любой):
+//   <hex_id>[,<status>[,<zones>[,<link>]]]
+// Разделители: запятая, точка с запятой, табуляция, пробел. hex_id - до
+// 14 шестнадцатеричных цифр (можно с 0x), по умолчанию status = 1,
+// zones = 0xFF, link = 0. Пустые строки и строки с '#' пропускаются,
+// нераспознанные (например, заголовок CSV) считаются отброшенными.
+//
+// Сортировка внешняя, в пределах IMPORT_MEMORY_BYTES (config.h):
+//   1. Прогоны: записи копятся в буфере, сортируются, повторы убираются,
+//      прогон пишется во временный файл <dir>/run_<n>.tmp блоками card_block.h.
+//   2. k-путевое слияние прогонов через кучу (по блоку на прогон в RAM).
+//      Прогонов больше, чем помещается в буфер, - сначала промежуточные
+//      слияния соседних групп.
+//   3. Последнее слияние пишет шарды по RECORDS_PER_FILE записей.
+// Повтор ключа: побеждает строка, встреченная позже.
+//
+// Тот же конвейер без FreeRTOS собирается на ПК (CARD_IMPORT_OFFLINE,
+// tools/card_import_host.cpp) - готовые файлы шардов для образа SPIFFS.
+
+// Источник данных: читает до len байт, 0 - конец потока
+typedef size_t (*CardImportRead)(void* ctx, char* buf, size_t len);
+
+struct CardImportStats {
+    uint32_t lines;
+    uint32_t records_in;      // распознанные строки
+    uint32_t rejected;        // нераспознанные строки
+    uint32_t duplicates;      // повторы ключей (остался последний)
+    uint32_t records_out;     // карт в новой базе
+    uint32_t runs;
+    uint32_t merge_passes;    // включая последнее слияние
+    uint32_t shards;
+    uint64_t bytes_in;
+    uint64_t bytes_written;   // прогоны, промежуточные слияния и шарды
+    uint32_t memory_bytes;    // потолок рабочей памяти
+    uint32_t run_us;          // разбор и сортировка прогонов
+    uint32_t merge_us;
+    uint32_t total_us;
+    uint32_t records_per_s;   // распознанных строк в секунду, весь конвейер
+};
+
+// Собрать файлы шардов в каталоге dir (имена - SHARD_FILE_PATTERN, номера
+// выдает next_id). table - место на MAX_SHARDS шардов, count - сколько
+// получилось. При ошибке созданные файлы удаляются.
+bool card_import_build(CardImportRead read, void* ctx, const char* dir,
+                       uint32_t (*next_id)(void), struct ShardInfo* table, int* count,
+                       struct CardImportStats* stats);
+
+void print_card_import_stats(const struct CardImportStats* stats);
+
+#ifndef CARD_IMPORT_OFFLINE
+
+// Импорт с заменой живой базы (card_db_replace): старая база работает,
+// пока новые шарды не готовы. Пустой результат базу не заменяет.
+bool card_import_stream(CardImportRead read, void* ctx, struct CardImportStats* stats);
+bool card_import_file(const char* path, struct CardImportStats* stats);
+
+// Файл MOUNT_POINT "/import.csv", положенный на SPIFFS, импортируется при
+// загрузке (после card_db_init). Успех - файл удаляется, ошибка -
+// переименовывается в import.err.
+void card_import_boot_file(void);
+
+// Прием списка по UART (IMPORT_UART_* в config.h): передача начинается с
+// первого байта и заканчивается паузой IMPORT_UART_IDLE_MS.
+void card_import_uart_start(void);
+
+#endif // CARD_IMPORT_OFFLINE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_IMPORT_H
@@ -0,0 +1,160 @@
+#ifndef CARD_RECORD_H
+#define CARD_RECORD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+// ==========================================
+// ФОРМАТ ЗАПИСИ КАРТЫ (86 бит, MSB-first)
+// ==========================================
+// | hex_id:56 | status:2 | count:4 | zones:8 | link:16 |
+//
+// Записи идут в файле подряд без выравнивания. Бит 0 потока - старший
+// бит байта 0. Так устроены файлы шардов версии 1 (их читает только
+// конвертер в search.cpp, поля - CARD_V1_ATTR_FIELDS); текущий формат с
+// дельтами ключей - card_block.h, его атрибуты - CARD_ATTR_FIELDS
+// (card_types.h). Оба используют те же ядра чтения/записи битов.
+
+#define RECORD_BITS (CARD_KEY_BITS + CARD_V1_ATTR_BITS)
+
+static_assert(RECORD_BITS == 86, "Формат версии 1 заморожен");
+static_assert(CARD_KEY_BITS <= 57, "Ключ читается одним словом");
+static_assert(CARD_ATTR_BITS <= 64, "Атрибуты упаковываются в одно 64-битное слово");
+
+// Ядра читают/пишут целыми 64-битными словами, поэтому за последним
+// значимым байтом буфера должно быть ещё RECORD_READ_PAD доступных байт.
+#define RECORD_READ_PAD 8
+
+// ==========================================
+// ЗАГРУЗКА/ВЫГРУЗКА СЛОВ (big-endian, без выравнивания)
+// ==========================================
+
+static inline uint64_t load_be64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return __builtin_bswap64(v);
+}
+
+static inline void store_be64(uint8_t* p, uint64_t v) {
+    v = __builtin_bswap64(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+// Читает до 57 бит начиная с bit_pos одним словом.
+static inline uint64_t read_bits57(const uint8_t* buffer, uint64_t bit_pos, int width) {
+    uint64_t w = load_be64(buffer + (bit_pos >> 3)) << (bit_pos & 7);
+    return w >> (64 - width);
+}
+
+// Записывает до 57 бит начиная с bit_pos (read-modify-write одного слова).
+static inline void write_bits57(uint8_t* buffer, uint64_t bit_pos, uint64_t value, int width) {
+    uint8_t* p = buffer + (bit_pos >> 3);
+    int shift = 64 - (int)(bit_pos & 7) - width;
+    uint64_t mask = ((1ULL << width) - 1) << shift;
+    uint64_t w = load_be64(p);
+    store_be64(p, (w & ~mask) | ((value << shift) & mask));
+}
+
+// ==========================================
+// ПРОИЗВОЛЬНЫЕ ПОЛЯ (1..64 бит)
+// ==========================================
+
+static inline uint64_t extract_bits_from_ram(const uint8_t* buffer, uint64_t global_bit_start, int bit_count) {
+    if (bit_count <= 57) {
+        return read_bits57(buffer, global_bit_start, bit_count);
+    }
+    int low = bit_count - 32;
+    uint64_t hi = read_bits57(buffer, global_bit_start, 32);
+    return (hi << low) | read_bits57(buffer, global_bit_start + 32, low);
+}
+
+static inline void push_bits(uint8_t* buffer, int* bit_cursor, uint64_t value, int width) {
+    if (width > 57) {
+        int low = width - 32;
+        write_bits57(buffer, (uint64_t)*bit_cursor, value >> low, 32);
+        write_bits57(buffer, (uint64_t)*bit_cursor + 32, value, low);
+    } else {
+        write_bits57(buffer, (uint64_t)*bit_cursor, value, width);
+    }
+    *bit_cursor += width;
+}
+
+// ==========================================
+// АТРИБУТЫ ПО СХЕМЕ (card_types.h)
+// ==========================================
+// Упаковка и распаковка разворачиваются из списка полей на этапе
+// компиляции: каждое поле - один сдвиг и одна маска с константами,
+// как в написанном вручную коде.
+
+#define CARD_FIELD_MASK(width) ((1ULL << (width)) - 1)
+#define CARD_FIELD_SHIFT(P, name) (P##_BITS - 1 - P##_HI_##name)
+#define CARD_FIELD_CHECK(P, name, type, width) \
+    static_assert((width) > 0 && (width) <= 8 * sizeof(type), "Поле " #name " не помещается в свой тип");
+#define CARD_FIELD_PACK(P, name, type, width) \
+    a |= ((uint64_t)ci->name & CARD_FIELD_MASK(width)) << CARD_FIELD_SHIFT(P, name);
+#define CARD_FIELD_UNPACK(P, name, type, width) \
+    out->name = (type)((a >> CARD_FIELD_SHIFT(P, name)) & CARD_FIELD_MASK(width));
+#define CARD_FIELD_EQUAL(P, name, type, width) && a->name == b->name
+
+CARD_ATTR_FIELDS(CARD_FIELD_CHECK, CARD_ATTR)
+
+static inline uint64_t card_pack_attrs(const CardInfo* ci) {
+    uint64_t a = 0;
+    CARD_ATTR_FIELDS(CARD_FIELD_PACK, CARD_ATTR)
+    return a;
+}
+
+static inline void card_unpack_attrs(uint64_t a, CardInfo* out) {
+    CARD_ATTR_FIELDS(CARD_FIELD_UNPACK, CARD_ATTR)
+}
+
+static inline uint64_t card_pack_attrs_v1(const CardInfo* ci) {
+    uint64_t a = 0;
+    CARD_V1_ATTR_FIELDS(CARD_FIELD_PACK, CARD_V1_ATTR)
+    return a;
+}
+
+// Поля, которых нет в версии 1, обнуляются
+static inline void card_unpack_attrs_v1(uint64_t a, CardInfo* out) {
+    if ((int)CARD_ATTR_BITS != (int)CARD_V1_ATTR_BITS) memset(out, 0, sizeof(*out));
+    CARD_V1_ATTR_FIELDS(CARD_FIELD_UNPACK, CARD_V1_ATTR)
+}
+
+static inline bool card_info_equal(const CardInfo* a, const CardInfo* b) {
+    return a->hex_id == b->hex_id CARD_ATTR_FIELDS(CARD_FIELD_EQUAL, CARD_ATTR);
+}
+
+// ==========================================
+// ЗАПИСЬ ЦЕЛИКОМ
+// ==========================================
+
+// Ключ записи index - одна загрузка слова.
+static inline uint64_t get_card_id_from_buffer(const uint8_t* buffer, int index) {
+    return read_bits57(buffer, (uint64_t)index * RECORD_BITS, CARD_KEY_BITS);
+}
+
+// Распаковка всей записи двумя загрузками: a - биты 0..63 записи,
+// b - биты 64..85 (в старших разрядах).
+static inline void get_card_from_buffer(const uint8_t* buffer, int index, CardInfo* out) {
+    uint64_t start_bit = (uint64_t)index * RECORD_BITS;
+    const uint8_t* p = buffer + (start_bit >> 3);
+    unsigned sh = (unsigned)(start_bit & 7);
+    uint64_t w0 = load_be64(p);
+    uint64_t w1 = load_be64(p + 8);
+    uint64_t a = sh ? (w0 << sh) | (w1 >> (64 - sh)) : w0;
+    uint64_t b = w1 << sh;
+
+    card_unpack_attrs_v1(((a << CARD_KEY_BITS) | (b >> (64 - CARD_KEY_BITS))) >> (64 - CARD_V1_ATTR_BITS), out);
+    out->hex_id = a >> (64 - CARD_KEY_BITS);
+}
+
+// Упаковка всей записи: ключ и атрибуты - две записи слова.
+static inline void put_card_to_buffer(uint8_t* buffer, int index, const CardInfo* ci) {
+    uint64_t start_bit = (uint64_t)index * RECORD_BITS;
+    write_bits57(buffer, start_bit, ci->hex_id, CARD_KEY_BITS);
+    write_bits57(buffer, start_bit + CARD_KEY_BITS, card_pack_attrs_v1(ci), CARD_V1_ATTR_BITS);
+}
+
+#endif // CARD_RECORD_H
@@ -0,0 +1,64 @@
+#ifndef CARD_SCAN_H
+#define CARD_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ОБХОД ВСЕЙ БАЗЫ (ОТЧЕТЫ И МАССОВЫЕ ИЗМЕНЕНИЯ)
+// ==========================================
+// Все карты по возрастанию ключей: шарды читаются порциями через один
+// буфер CARD_SCAN_BUFFER_BYTES (до CARD_SCAN_BLOCKS блоков за чтение),
+// блоки распаковываются целиком, поверх - журнал изменений (card_db.h).
+// Для каждой карты проверяется условие, подошедшие суммируются.
+//
+// Фоновый обход идет в задаче с приоритетом ниже поиска и не начинает
+// новое чтение, пока в канале поиска есть события: проход не ждет его
+// дольше одного чтения порции. Поколение базы закрепляется на порцию, так
+// что карта, измененная во время обхода, попадает в отчет в прежнем или
+// новом виде.
+
+struct CardScanQuery {
+    uint32_t status_mask;   // биты 1 << status допустимых статусов, 0 - любой
+    uint32_t zones_any;     // открывает хотя бы одну из зон, 0 - любые
+    bool match_link;
+    uint16_t link;
+    // Каждая подошедшая карта (count - с накопленным, как у lookup_card), в
+    // задаче обхода. NULL - только счетчики.
+    void (*on_card)(const struct CardInfo* ci, void* arg);
+    void* arg;
+};
+
+struct CardScanResult {
+    uint32_t scanned;                                 // карт в базе
+    uint32_t matched;
+    uint32_t by_status[CARD_ATTR_MAX(status) + 1];    // подошедшие по статусу
+    uint32_t by_zone[CARD_ATTR_WIDTH(zones)];         // подошедшие, открывающие зону i
+    uint32_t chunks;                                  // порций (чтений с флеша или раздела)
+    uint64_t bytes_read;                              // прочитано с SPIFFS
+    uint32_t yields;                                  // пропусков тика ради поиска
+    uint32_t duration_us;
+    bool ok;                                          // false - ошибка чтения, отчет неполный
+};
+
+// Обход в вызывающей задаче
+bool card_scan_run(const struct CardScanQuery* query, struct CardScanResult* out);
+
+// Обход в фоновой задаче. false - предыдущий еще идет.
+bool card_scan_start(const struct CardScanQuery* query);
+bool card_scan_running(void);
+// Итог последнего фонового обхода. false - обход еще идет или не запускался.
+bool card_scan_result(struct CardScanResult* out);
+
+void print_card_scan_result(const struct CardScanResult* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_SCAN_H
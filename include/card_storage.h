@@ -0,0 +1,61 @@
+#ifndef CARD_STORAGE_H
+#define CARD_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Хранилище шардов для поиска. Источник истины - файлы шардов на SPIFFS
+// и манифест (их пишут генератор и уплотнение). Бэкенд PARTITION -
+// копия тех же шардов в отдельном сыром разделе "carddb", отображенная в
+// память: бинарный поиск идет прямо по флешу, без VFS и без копирования.
+
+enum CardStorageBackend {
+    CARD_STORAGE_SPIFFS = 0,
+    CARD_STORAGE_PARTITION = 1
+};
+
+struct CardStorage {
+    const char* name;
+    enum CardStorageBackend backend;
+    // Прочитать len байт шарда shard (file_idx - его позиция в манифесте
+    // поколения) со смещения offset. Возвращает число прочитанных байт.
+    size_t (*read)(const struct ShardInfo* shard, int file_idx, uint32_t offset, uint8_t* dst, size_t len);
+    // Прямой указатель на данные файла (len - размер), либо NULL, если
+    // бэкенд не умеет отображать. За концом файла доступно RECORD_READ_PAD байт.
+    const uint8_t* (*map)(int file_idx, size_t* len);
+};
+
+// Выбрать бэкенд при старте. PARTITION без готового образа откатывается на SPIFFS
+// до первого card_storage_sync().
+void card_storage_init(enum CardStorageBackend preferred);
+
+// Текущий бэкенд (никогда не NULL)
+const struct CardStorage* card_storage(void);
+
+// Бэкенд для поиска по поколению базы generation: раздел - только если
+// образ снят с этого поколения, иначе SPIFFS (файлы поколения живы, пока
+// оно закреплено). Образ переписывается, когда прежнее поколение отпущено.
+const struct CardStorage* card_storage_for(uint32_t generation);
+
+// Обновить образ в разделе после изменения файлов на SPIFFS.
+// Для бэкенда SPIFFS ничего не делает.
+bool card_storage_sync(void);
+
+// Поколение манифеста, с которого снят образ в разделе (0 - образа нет).
+// Для бэкенда SPIFFS совпадает с текущим поколением манифеста.
+uint32_t card_storage_generation(void);
+
+// Переключить бэкенд на лету (для замеров). false - бэкенд недоступен.
+bool card_storage_select(enum CardStorageBackend backend);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_STORAGE_H
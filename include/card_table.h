@@ -0,0 +1,53 @@
+#ifndef CARD_TABLE_H
+#define CARD_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// БАЗА ЦЕЛИКОМ В RAM (РАСПАКОВАННАЯ)
+// ==========================================
+// Все шарды поколения распаковываются один раз в параллельные массивы:
+// ключи (uint64_t) отдельно, атрибуты - каждый своим массивом. Массивы
+// лежат в порядке Эйтцингера (дерево поиска в массиве: потомки узла k -
+// 2k и 2k+1, корень - 1), так что поиск - спуск без ветвлений, а первые
+// уровни дерева всегда в кеше. Элемент 0 не используется.
+// Колонки атрибутов - по схеме записи (CARD_ATTR_FIELDS, card_types.h),
+// сейчас 13 байт на запись; память - из PSRAM, если она есть.
+
+#define CARD_TABLE_COLUMN(P, name, type, width) type* name;
+
+struct CardTable {
+    uint32_t records;
+    uint64_t* ids;       // records + 1 элементов, как и колонки
+    CARD_ATTR_FIELDS(CARD_TABLE_COLUMN, CARD_ATTR)
+    size_t bytes;        // вся память таблицы
+    uint32_t load_us;    // чтение и распаковка шардов
+};
+
+// Распаковать шарды (по возрастанию ключей, как в манифесте).
+// NULL - нет памяти или ошибка чтения.
+struct CardTable* card_table_load(const struct ShardInfo* shards, int count);
+
+// То же из отсортированного массива (для замеров)
+struct CardTable* card_table_build(const struct CardInfo* cards, uint32_t records);
+
+void card_table_free(struct CardTable* table);
+
+// Позиция ключа в таблице, 0 - нет
+uint32_t card_table_find(const struct CardTable* table, uint64_t hex_id);
+
+// Запись карты. false - карты нет.
+bool card_table_lookup(const struct CardTable* table, uint64_t hex_id, struct CardInfo* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_TABLE_H
@@ -0,0 +1,91 @@
+#ifndef CARD_TYPES_H
+#define CARD_TYPES_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Типы базы карт без зависимостей от FreeRTOS: их разделяют прошивка и
+// офлайн-сборка базы на ПК (tools/card_import_host.cpp)
+
+// ==========================================
+// СХЕМА ЗАПИСИ КАРТЫ
+// ==========================================
+// Ключ - CARD_KEY_BITS бит, за ним атрибуты - поля CARD_ATTR_FIELDS по
+// порядку, старшие биты первыми: X(P, поле CardInfo, тип, ширина в битах).
+// Из этого списка собираются CardInfo, смещения полей (CardAttrLayout),
+// упаковка и распаковка (card_record.h) и колонки базы в RAM (card_table.h).
+// Новое поле - одна строка здесь; файлы данных при этом меняют формат
+// (см. CARD_FILE_VERSION в card_block.h).
+#define CARD_KEY_BITS 56
+
+#define CARD_ATTR_FIELDS(X, P)      \
+    X(P, status, uint8_t, 2)        \
+    X(P, count, uint8_t, 4)         \
+    X(P, zones, uint8_t, 8)         \
+    X(P, link, uint16_t, 16)
+
+// Формат файлов версии 1 заморожен: его читает только конвертер
+#define CARD_V1_ATTR_FIELDS(X, P)   \
+    X(P, status, uint8_t, 2)        \
+    X(P, count, uint8_t, 4)         \
+    X(P, zones, uint8_t, 8)         \
+    X(P, link, uint16_t, 16)
+
+// Диапазон битов поля (от старшего бита атрибутов): P_LO_<поле>..P_HI_<поле>.
+// Следующее перечисление продолжает счет, поэтому последний элемент -
+// общая ширина.
+#define CARD_FIELD_RANGE(P, name, type, width) P##_LO_##name, P##_HI_##name = P##_LO_##name + (width) - 1,
+
+enum CardAttrLayout {
+    CARD_ATTR_FIELDS(CARD_FIELD_RANGE, CARD_ATTR)
+    CARD_ATTR_BITS
+};
+
+enum CardV1AttrLayout {
+    CARD_V1_ATTR_FIELDS(CARD_FIELD_RANGE, CARD_V1_ATTR)
+    CARD_V1_ATTR_BITS
+};
+
+#define CARD_ATTR_WIDTH(name) (CARD_ATTR_HI_##name - CARD_ATTR_LO_##name + 1)
+#define CARD_ATTR_MAX(name) ((1ULL << CARD_ATTR_WIDTH(name)) - 1)
+
+#define CARD_FIELD_MEMBER(P, name, type, width) type name;
+
+// Структура для хранения информации о карте
+struct CardInfo {
+    uint64_t hex_id;
+    CARD_ATTR_FIELDS(CARD_FIELD_MEMBER, CARD_ATTR)
+};
+
+// Параметры базы данных
+#define TOTAL_FILES 10          // шардов при первичной генерации базы
+#define RECORDS_PER_FILE 1000   // записей в шарде (уплотнение делит шарды больше 2x)
+// Сборка под хост (tools/host) переопределяет предел шардов и каталог базы
+#ifndef MAX_SHARDS
+#define MAX_SHARDS 128
+#endif
+#define INDEX_BLOCK_RECORDS 32  // записей в блоке файла шарда (одно чтение, см. card_block.h)
+#ifndef MOUNT_POINT
+#define MOUNT_POINT "/spiffs"
+#endif
+#define SHARD_FILE_PATTERN "%s/data_%lu.bin"  // каталог, file_id
+
+// Шард - отсортированный файл MOUNT_POINT "/data_<file_id>.bin" (формат - card_block.h).
+// Список шардов и разреженный индекс хранятся в манифесте MOUNT_POINT "/manifest.bin".
+struct ShardInfo {
+    uint64_t first_id;
+    uint64_t last_id;
+    uint32_t records;
+    uint32_t file_id;
+    uint32_t bytes;     // размер файла
+    uint32_t reserved;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_TYPES_H
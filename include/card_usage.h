@@ -0,0 +1,87 @@
+#ifndef CARD_USAGE_H
+#define CARD_USAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "card_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// СЧЕТЧИКИ ИСПОЛЬЗОВАНИЯ КАРТ
+// ==========================================
+// CardInfo::count (4 бита, насыщается на 15) растет с каждым предъявлением
+// найденной карты. Файлы данных при этом не трогаются:
+//   1. Приращения копятся в RAM (таблица по hex_id).
+//   2. Раз в USAGE_FLUSH_INTERVAL_MS (или при USAGE_FLUSH_THRESHOLD
+//      карт с новыми приращениями) они одной записью дописываются в
+//      MOUNT_POINT "/usage.log" - по 8 байт на карту (id:56 | delta:4 | crc:4).
+//   3. Уплотнение (card_db.h) вписывает накопленное в шарды, которые
+//      переписывает все равно; отдельно ради счетчиков - только когда
+//      журнал дорос до USAGE_MERGE_LOG_BYTES или таблица почти полна.
+//      Влитое помечается в журнале блоком с номером поколения до его
+//      публикации: после сбоя оно не прибавится к шардам второй раз.
+// Поиск (lookup_card) возвращает базу плюс накопленное - без обращений к
+// флешу. Приращения сверх насыщения не пишутся вовсе.
+#define USAGE_COUNT_MAX ((int)CARD_ATTR_MAX(count))
+
+struct CardUsageDelta {
+    uint64_t hex_id;
+    uint16_t pending;   // не влито в файлы данных
+};
+
+struct CardUsageStats {
+    uint32_t swipes;          // вызовы card_usage_record
+    uint32_t saturated;       // счетчик уже 15 - приращение не нужно
+    uint32_t dropped;         // таблица полна - приращение потеряно
+    uint32_t flushes;
+    uint32_t records_written; // записей в usage.log
+    uint64_t log_bytes;       // дописано в usage.log (и его перезаписи после слияния)
+    uint32_t merges;          // уплотнений, вливших счетчики
+    uint32_t merged_cards;
+};
+
+// Загрузить usage.log и запустить задачу сброса (после card_db_init())
+void card_usage_init(void);
+
+// Предъявление найденной карты; ci - ответ lookup_card (с накопленным)
+void card_usage_record(const struct CardInfo* ci);
+
+// Добавить к ci->count накопленное в RAM (только RAM)
+void card_usage_apply(struct CardInfo* ci);
+
+// Дописать новые приращения в usage.log (синхронно)
+bool card_usage_flush(void);
+
+// Для уплотнения: все накопленные приращения по возрастанию hex_id
+// (malloc, освобождает вызывающий; NULL при *count == 0 или без памяти)
+struct CardUsageDelta* card_usage_collect(uint32_t* count);
+
+// Перед публикацией поколения generation: дописать в usage.log несброшенное
+// и блок влитых приращений (pending = 0 - запись не влита). Сбой до
+// card_usage_merged() не приведет к двойному счету: при загрузке блок
+// опубликованного поколения вычитается. false - блок не записан, вливать
+// счетчики нельзя.
+bool card_usage_prepare_merge(const struct CardUsageDelta* merged, uint32_t count, uint32_t generation);
+
+// Приращения влиты в новое поколение базы: вычесть их из таблицы
+// и переписать usage.log остатком
+void card_usage_merged(const struct CardUsageDelta* merged, uint32_t count);
+
+// Поколение не опубликовано: переписать usage.log без блока слияния
+void card_usage_merge_failed(void);
+
+// Пора вливать счетчики, даже если уплотнять больше нечего
+bool card_usage_merge_due(void);
+void card_usage_request_merge(void);
+
+void get_card_usage_stats(struct CardUsageStats* out);
+void print_card_usage_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CARD_USAGE_H
@@ -5,6 +5,8 @@
 #define I2C_MASTER_SCL_IO 10
 #define I2C_MASTER_SDA_IO 9
 #define I2C_MASTER_FREQ_HZ 100000
+#define I2C_MASTER_FAST_FREQ_HZ 400000   // used only if the boot self-test passes
+#define I2C_FAST_MODE_SELFTEST 1
 #define I2C_MASTER_NUM I2C_NUM_0
 
 // PCF8574 Address
@@ -15,4 +17,125 @@
 #define WIEGAND_D1 6
 #define WIEGAND_TIMEOUT_MS 25
 
+// Card formats (see wiegand_formats.cpp). 37-bit frames are either H10302
+// (35-bit card number) or H10304 (16-bit facility + 19-bit card); both use
+// the same parity, so the site picks one.
+#define WIEGAND_37BIT_H10304 0
+// 58-bit readers: even parity over the first 29 bits, odd over the last 29.
+// Set to 0 for readers that use another layout (frame is then accepted as is).
+#define WIEGAND_58BIT_PARITY 1
+
+// Readers on the I2C bus: expander addresses, then one entry per reader
+// {expander index, D0 input, D1 input} (inputs 1..8). Reader id = position.
+// Up to 4 readers per expander, WIEGAND_MAX_EXPANDERS expanders.
+// Example for entry + exit doors on one expander:
+//   { {0, WIEGAND_D0, WIEGAND_D1}, {0, 7, 8} }
+#define WIEGAND_EXPANDERS { CONFIG_I2C_INPUTS1_ADDRESS }
+#define WIEGAND_READERS { {0, WIEGAND_D0, WIEGAND_D1} }
+
+// Wiegand edge capture source (see wiegand_capture.h):
+// WIEGAND_CAPTURE_GPIO, WIEGAND_CAPTURE_PCF8574_INT or WIEGAND_CAPTURE_POLL.
+// The default keeps the readers on the PCF8574 inputs above. The PCF8574
+// does not latch inputs: in PCF8574_INT mode the port is sampled ~115 us
+// after an edge at 100 kHz (~40 us at 400 kHz), so it needs a
+// pulse-stretching front end (e.g. a monostable per line holding the
+// pulse > 150 us); without one every bit is reported as lost.
+// WIEGAND_CAPTURE_GPIO sees every 20-100 us pulse without extra parts, but
+// the D0/D1 lines must be rewired from the expander to WIEGAND_D0_GPIO /
+// WIEGAND_D1_GPIO.
+#define WIEGAND_CAPTURE_MODE WIEGAND_CAPTURE_PCF8574_INT
+#define WIEGAND_INT_GPIO 8          // PCF8574 INT (open drain, active low)
+#define WIEGAND_D0_GPIO 11          // WIEGAND_CAPTURE_GPIO only: reader 0 lines
+#define WIEGAND_D1_GPIO 12
+// WIEGAND_CAPTURE_GPIO only: {D0 GPIO, D1 GPIO} per reader, in the order of
+// WIEGAND_READERS; every reader in that table needs an entry here.
+#define WIEGAND_GPIO_READERS { {WIEGAND_D0_GPIO, WIEGAND_D1_GPIO} }
+#define WIEGAND_POLL_INTERVAL_MS 0  // WIEGAND_CAPTURE_POLL only; 0 = back-to-back sweeps
+#define WIEGAND_EDGE_RING_SIZE 256  // edges, power of two
+
+// How long sensor_task waits for room in the search channel before
+// dropping a read (the edge ring keeps buffering meanwhile)
+#define SEARCH_BACKPRESSURE_MS 50
+
+// Deferred console log (see event_log.h): records per core ring (power of
+// two, 32 bytes each), verbosity EVLOG_OFF..EVLOG_DEBUG, and how often the
+// idle log task looks for new records. EVLOG_DEFERRED 0 prints in the
+// calling task like plain printf.
+#define EVLOG_RING_SIZE 128
+#define EVLOG_DEFAULT_LEVEL EVLOG_DEBUG
+#define EVLOG_DEFERRED 1
+#define EVLOG_DRAIN_INTERVAL_MS 20
+
+// Latency trace (see latency_trace.h): stats_task prints a machine-readable
+// "LATENCY {json}" line every N reports (10 s each); 0 = never
+#define LATENCY_DUMP_EVERY 6
+
+// Card database: target false-positive rate of the negative-lookup filter
+#define CARD_FILTER_FP_RATE 0.01f
+// Compaction adds new keys to the live filter in place; it is rebuilt once
+// their estimated false-positive rate exceeds CARD_FILTER_FP_RATE x this
+#define CARD_FILTER_SATURATION 2.0f
+
+// Recent-decision cache TTL (found / not found)
+#define CARD_CACHE_TTL_MS 60000
+#define CARD_CACHE_NEGATIVE_TTL_MS 10000
+
+// Card database storage backend for lookups:
+// CARD_STORAGE_SPIFFS or CARD_STORAGE_PARTITION (memory-mapped "carddb" partition)
+#define CARD_STORAGE_BACKEND CARD_STORAGE_PARTITION
+
+// Decode the whole card database into RAM at boot (see card_table.h):
+// lookups never touch flash. ~13 bytes per card (PSRAM if present), twice
+// that while a compaction swaps generations.
+#define CARD_RAM_TABLE 0
+
+// Single-card lookups through the on-flash hash index (see card_hash.h):
+// one bucket read plus one block read instead of the in-RAM block fences.
+// The index file is rebuilt with every new database generation.
+#define CARD_HASH_INDEX 0
+
+// Full-database scans for reports (see card_scan.h): read buffer size and
+// the most shard blocks decoded per flash read. Live lookups wait for at
+// most one such read.
+#define CARD_SCAN_BUFFER_BYTES 2048
+#define CARD_SCAN_BLOCKS 8
+
+// Card database delta log: capacity (entries in RAM), size that triggers
+// background compaction, and idle compaction period
+#define DELTA_LOG_CAPACITY 256
+#define DELTA_COMPACT_THRESHOLD 64
+#define DELTA_COMPACT_INTERVAL_MS 300000
+
+// Card usage counters (see card_usage.h): cards tracked in RAM between
+// merges, flush to usage.log after this many dirty cards or this period,
+// and the log size that makes compaction merge the counters into shards
+#define USAGE_TABLE_CAPACITY 256
+#define USAGE_FLUSH_THRESHOLD 64
+#define USAGE_FLUSH_INTERVAL_MS 60000
+#define USAGE_MERGE_LOG_BYTES (8 * 1024)
+
+// Access-event journal (see access_journal.h) in the "journal" partition:
+// events buffered in RAM (power of two), events per flash write, and the
+// longest an event waits in RAM before it is written anyway
+#define ACCESS_JOURNAL_RING 256
+#define ACCESS_JOURNAL_GROUP 16
+#define ACCESS_JOURNAL_COMMIT_MS 500
+
+// Bulk card import (see card_import.h): working memory ceiling for the
+// external sort. A file dropped as /spiffs/import.csv is imported at boot;
+// the UART importer starts on the first byte and ends the stream after
+// IMPORT_UART_IDLE_MS of silence. The RX buffer rides out SPIFFS writes
+// between runs (16 KB is ~1.4 s at 115200 baud).
+#define IMPORT_MEMORY_BYTES (48 * 1024)
+#define IMPORT_UART_ENABLE 0
+#define IMPORT_UART_NUM 1
+#define IMPORT_UART_TX_GPIO 17
+#define IMPORT_UART_RX_GPIO 18
+#define IMPORT_UART_BAUD 115200
+#define IMPORT_UART_RX_BUFFER (16 * 1024)
+#define IMPORT_UART_IDLE_MS 2000
+
+// Benchmarks (1 = run once at boot, see benchmark.h)
+#define RUN_BENCHMARKS 0
+
 #endif // CONFIG_H
\ No newline at end of file
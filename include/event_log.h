@@ -0,0 +1,78 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ОТЛОЖЕННЫЙ ЖУРНАЛ СОБЫТИЙ
+// ==========================================
+// Вместо printf горячий путь пишет запись фиксированного размера в кольцо
+// своего ядра: проверка уровня, захват места и несколько сохранений.
+// Текст собирает и печатает фоновая задача с низким приоритетом; формат
+// сообщений знает модуль-источник (evlog_register). Кольцо полно - запись
+// отбрасывается и считается, вызывающий никогда не ждет консоль.
+#define EVLOG_OFF   0
+#define EVLOG_ERROR 1
+#define EVLOG_WARN  2
+#define EVLOG_INFO  3
+#define EVLOG_DEBUG 4
+
+enum EventLogSource {
+    EVLOG_SRC_WIEGAND = 0,   // wiegand_processor.h: WiegandLogEvent
+    EVLOG_SRC_SEARCH,        // search.h: SearchLogEvent
+    EVLOG_SOURCES
+};
+
+struct EventLogRecord {
+    uint32_t time_us;        // младшие 32 бита esp_timer_get_time()
+    uint8_t source;
+    uint8_t id;              // событие внутри источника
+    uint8_t level;
+    uint8_t core;
+    uint32_t a;              // аргументы: смысл задает источник
+    uint32_t b;
+    uint64_t x;
+    uint64_t y;
+};
+
+typedef void (*EventLogFormatter)(const struct EventLogRecord* r);
+void evlog_register(uint8_t source, EventLogFormatter fmt);
+
+// Запуск задачи вывода. До запуска записи печатаются сразу в вызывающей задаче.
+bool evlog_start(void);
+
+extern volatile uint8_t evlog_level;
+void evlog_set_level(uint8_t level);
+// false - печатать в вызывающей задаче, как прежний printf (для сравнения)
+void evlog_set_deferred(bool deferred);
+// Вывести все накопленное из текущей задачи
+void evlog_flush(void);
+
+void evlog_write(uint8_t level, uint8_t source, uint8_t id,
+                 uint32_t a, uint32_t b, uint64_t x, uint64_t y);
+
+static inline void evlog(uint8_t level, uint8_t source, uint8_t id,
+                         uint32_t a, uint32_t b, uint64_t x, uint64_t y) {
+    if (level > evlog_level) return;
+    evlog_write(level, source, id, a, b, x, y);
+}
+
+struct EventLogStats {
+    uint32_t written;        // записей в кольцах
+    uint32_t dropped;        // отброшено: кольцо полно
+    uint32_t printed;        // выведено задачей журнала
+    uint32_t max_depth;      // наибольшее заполнение кольца
+};
+void get_event_log_stats(struct EventLogStats* out);
+void print_event_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_LOG_H
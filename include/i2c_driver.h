@@ -4,16 +4,45 @@
 #include <driver/i2c.h>
 #include <esp_err.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Расширителей в одном проходе шины (pcf8574_sweep)
+#define I2C_SWEEP_MAX_DEVICES 4
+
 esp_err_t i2c_master_init(void);
 esp_err_t pcf8574_read(uint8_t addr, uint8_t *data);
 
+// ==========================================
+// ОПРОС РАСШИРИТЕЛЕЙ БЕЗ ВЫДЕЛЕНИЯ ПАМЯТИ
+// ==========================================
+// Список команд собирается один раз в статическом буфере: START, адрес,
+// байт порта для каждого расширителя (повторный START), затем STOP.
+// Проход шины - одна транзакция i2c_master_cmd_begin на все расширители.
+esp_err_t pcf8574_sweep_init(const uint8_t* addrs, int count);
+// ports[i] - порт addrs[i]; при ошибке непрочитанные порты не меняются
+esp_err_t pcf8574_sweep(uint8_t* ports);
+
+// Частота шины. i2c_bus_try_fast_mode() переключает на I2C_MASTER_FAST_FREQ_HZ
+// и проверяет опрос; при ошибках возвращает I2C_MASTER_FREQ_HZ.
+uint32_t i2c_bus_freq_hz(void);
+bool i2c_bus_try_fast_mode(void);
+
+struct I2cPollStats {
+    uint32_t sweeps;
+    uint32_t errors;
+    uint64_t total_us;       // суммарное время транзакций
+    uint32_t max_us;
+    uint32_t last_us;
+};
+void get_i2c_poll_stats(struct I2cPollStats* out);
+void print_i2c_poll_stats(void);   // частота опроса с прошлого вызова
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // I2C_DRIVER_H
\ No newline at end of file
+#endif // I2C_DRIVER_H
@@ -0,0 +1,59 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ЗАДЕРЖКИ ОТ ПОСЛЕДНЕГО БИТА ДО РЕШЕНИЯ
+// ==========================================
+// Точки трассы (esp_timer, мкс): первый и последний фронт кадра, кадр
+// готов, событие в канале, событие забрано поиском, кеш/журнал/фильтр
+// пройдены, блок прочитан, решение принято. Разность соседних точек -
+// этап; каждый этап копит гистограмму с логарифмическими корзинами
+// (4 корзины на каждую степень двойки, ошибка квантиля не больше 25%).
+enum LatencyStage {
+    LAT_BITS = 0,     // первый -> последний фронт (передача кадра)
+    LAT_TIMEOUT,      // последний фронт -> кадр готов (пауза WIEGAND_TIMEOUT_MS)
+    LAT_DECODE,       // кадр готов -> событие в канале (разбор, sensor_task)
+    LAT_QUEUE,        // в канале -> забрано задачей поиска
+    LAT_CHECK,        // забрано -> тестовые карты, кеш, журнал, фильтр
+    LAT_FLASH,        // чтение блока (только если дошли до флеша)
+    LAT_DECISION,     // поиск в блоке и вывод решения
+    LAT_TOTAL,        // последний фронт -> решение
+    LAT_STAGES
+};
+
+#define LAT_BUCKETS 100   // до 2^26 мкс (67 с), дальше - последняя корзина
+
+struct LatencyHistogram {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[LAT_BUCKETS];
+};
+
+// Один писатель на этап: этапы кадра пишет sensor_task, остальные -
+// задача поиска. Читать можно из любой задачи (значения - оценка).
+void latency_record(enum LatencyStage stage, uint32_t us);
+void latency_reset(void);
+
+const char* latency_stage_name(enum LatencyStage stage);
+void get_latency_histogram(enum LatencyStage stage, struct LatencyHistogram* out);
+// Верхняя граница корзины, в которую попал квантиль pct (0..100)
+uint32_t latency_percentile(enum LatencyStage stage, uint32_t pct);
+
+// p50/p95/p99/max по этапам (stats_task)
+void print_latency_stats(void);
+// Одна строка "LATENCY {json}" со всеми непустыми корзинами для разбора на ПК
+void dump_latency_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_TRACE_H
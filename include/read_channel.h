@@ -0,0 +1,78 @@
+#ifndef READ_CHANNEL_H
+#define READ_CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// КАНАЛ СОБЫТИЙ ЧТЕНИЯ КАРТ (sensor_task -> поиск)
+// ==========================================
+// Кольцо на одного писателя и одного читателя без блокировок. Запись и
+// чтение - только атомарные загрузки/сохранения; к планировщику канал
+// обращается, лишь когда читатель уснул на пустом канале.
+#define READ_CHANNEL_SIZE 32       // событий, степень двойки
+#define READ_CHANNEL_ALIGN 64      // индексы писателя и читателя - в разных строках кеша
+
+// Событие чтения: все, что известно о карте к моменту постановки в очередь
+struct CardReadEvent {
+    uint64_t card_hex;        // ключ поиска
+    uint64_t raw_data;        // кадр Wiegand как есть
+    uint32_t first_edge_us;   // первый фронт кадра (esp_timer, мкс)
+    uint32_t last_edge_us;    // последний фронт
+    uint32_t enqueue_us;      // постановка в канал
+    uint8_t bits;
+    uint8_t reader_id;
+    uint16_t seq;             // номер события у писателя (пропуски = потери)
+};
+
+struct ReadChannelStats {
+    uint32_t pushed;
+    uint32_t popped;
+    uint32_t full;            // попыток записи в полный канал
+    uint32_t dropped;         // событий отброшено после ожидания
+    uint32_t wakeups;         // пробуждений спящего читателя
+    uint32_t max_depth;
+};
+
+struct ReadChannel {
+    // Писатель
+    uint32_t head __attribute__((aligned(READ_CHANNEL_ALIGN)));
+    uint16_t seq;
+    uint32_t pushed;
+    uint32_t full;
+    uint32_t dropped;
+    uint32_t wakeups;
+    uint32_t max_depth;
+    // Читатель
+    uint32_t tail __attribute__((aligned(READ_CHANNEL_ALIGN)));
+    uint32_t popped;
+    uint32_t consumer_waiting;
+    TaskHandle_t consumer;
+    struct CardReadEvent slots[READ_CHANNEL_SIZE] __attribute__((aligned(READ_CHANNEL_ALIGN)));
+};
+
+void read_channel_init(struct ReadChannel* ch);
+
+// Писатель. false - канал полон (событие не записано, счетчик full)
+bool read_channel_push(struct ReadChannel* ch, struct CardReadEvent* ev);
+// С ожиданием места до wait_ms; не дождались - событие отброшено (dropped)
+bool read_channel_send(struct ReadChannel* ch, struct CardReadEvent* ev, uint32_t wait_ms);
+
+// Читатель
+bool read_channel_pop(struct ReadChannel* ch, struct CardReadEvent* out);
+void read_channel_wait(struct ReadChannel* ch, uint32_t timeout_ms);   // 0xFFFFFFFF - бесконечно
+uint32_t read_channel_depth(const struct ReadChannel* ch);
+
+void get_read_channel_stats(const struct ReadChannel* ch, struct ReadChannelStats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // READ_CHANNEL_H
@@ -2,37 +2,160 @@
 #define SEARCH_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "read_channel.h"
+#include "card_types.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Структура для хранения информации о карте
-struct CardInfo {
-    uint64_t hex_id;
-    uint8_t status;
-    uint8_t count;
-    uint8_t zones;
-    uint16_t link;
+// Результат поиска карты в базе
+enum LookupResult {
+    LOOKUP_FOUND = 0,
+    LOOKUP_NOT_FOUND,
+    LOOKUP_OUT_OF_RANGE,
+    LOOKUP_IO_ERROR
 };
 
-// Объявляем очередь как extern чтобы была доступна из других файлов
-extern QueueHandle_t search_queue;
+// Где нашлась карта и во что это обошлось
+struct LookupInfo {
+    int file_idx;
+    int record_idx;
+    uint32_t bytes_read;
+    bool cache_hit;
+    bool from_delta;   // ответ из журнала изменений (card_db.h)
+    // Трасса задержек (esp_timer, мкс): кеш, журнал и фильтр пройдены;
+    // блок прочитан (0 - до флеша не дошли)
+    uint32_t checked_us;
+    uint32_t read_us;
+};
+
+// Накопленная статистика поиска по базе
+struct SearchStats {
+    uint32_t lookups;
+    uint32_t filter_rejects;
+    uint64_t bytes_read;
+    uint32_t flash_reads;            // обращения к SPIFFS (без отображенного раздела)
+    uint32_t requests;               // вызовы lookup_card (включая кеш)
+    uint64_t request_us;
+    uint32_t compaction_requests;    // из них во время уплотнения
+    uint64_t compaction_request_us;
+    uint32_t generations;            // опубликованных поколений базы
+    uint32_t reclaim_waits;          // подмен, ждавших читателей прежнего поколения
+    uint32_t reclaim_wait_max_us;
+};
 
 // Функции для работы с системой поиска карт
 void init_spiffs(void);
 void generate_data_if_needed(void);
+// Записать records случайных карт шардами по RECORDS_PER_FILE (file_id с 0).
+// Манифест не трогает: его строит load_indices() обходом файлов.
+void generate_database(uint32_t records);
 void load_indices(void);
 void print_storage_info(void);
 void show_random_cards(int count);
 void print_index_table(void);
 void search_card(uint64_t target_hex);
+enum LookupResult lookup_card(uint64_t target_hex, struct CardInfo* out, struct LookupInfo* info);
+// То же без несброшенных счетчиков использования (card_usage.h): запись,
+// как она лежит в базе, - для ее изменения
+enum LookupResult lookup_card_record(uint64_t target_hex, struct CardInfo* out, struct LookupInfo* info);
+void get_search_stats(struct SearchStats* out);
+
+// Пакетный поиск: карты сортируются и группируются по файлам и блокам,
+// соседние блоки читаются одним обращением. results[i] - исход поиска
+// ids[i], как у lookup_card (ошибка чтения окна - LOOKUP_IO_ERROR),
+// out[i] - ее запись при LOOKUP_FOUND, info[i] (если не NULL) - трасса
+// поиска этой карты. Возвращает число найденных. Буферы поиска выделены
+// заранее на SEARCH_BATCH_MAX карт (столько рабочая задача забирает из
+// канала за раз), больший пакет ищется частями.
+#define SEARCH_BATCH_MAX 16
+size_t search_cards_batch(const uint64_t* ids, size_t n, struct CardInfo* out, enum LookupResult* results,
+                          struct LookupInfo* info);
+
+// Поиск только по файлам данных, минуя кеш и журнал изменений
+enum LookupResult lookup_card_base(uint64_t target_hex, struct CardInfo* out, struct LookupInfo* info);
+
+// Поиск закрепляет текущее поколение базы (индекс + файлы шардов) и не
+// блокируется. db_lock() выстраивает в очередь только тех, кто подменяет
+// поколения: уплотнение, импорт, перестройку индексов.
+void db_lock(void);
+void db_unlock(void);
+
+// Шарды (номер шарда - позиция в манифесте, по возрастанию ключей)
+int get_shard_count(void);
+bool get_shard_info(int shard, struct ShardInfo* out);
+int find_shard_for_card(uint64_t target_hex);  // -1 - вне диапазона базы
+void shard_file_name(uint32_t file_id, char* buf, size_t len);
+uint32_t allocate_shard_file_id(void);
+uint32_t get_manifest_generation(void);
+
+// База целиком в RAM (card_table.h): при старте - CARD_RAM_TABLE, здесь -
+// на лету для текущего и следующих поколений. false - не хватило памяти.
+bool set_ram_table_enabled(bool enable);
+// Размер базы в RAM текущего поколения и время ее загрузки. false - ее нет.
+bool get_ram_table_info(uint32_t* records, size_t* bytes, uint32_t* load_us);
+
+// Хеш-индекс на флеше (card_hash.h) вместо границ блоков: при старте -
+// CARD_HASH_INDEX, здесь - на лету. false - индекс не построился.
+bool set_hash_index_enabled(bool enable);
+bool get_hash_index_info(uint32_t* buckets, size_t* bytes, uint32_t* build_us);
+
+// Все записи шарда (malloc, освобождает вызывающий), NULL - ошибка чтения
+struct CardInfo* read_shard_cards(const struct ShardInfo* shard);
+
+// Порция обхода базы (card_scan.h): записи текущего поколения с ключами
+// >= from_id по возрастанию. Подряд идущие блоки одного шарда - одно чтение
+// в buf (не больше buf_len байт вместе с RECORD_READ_PAD) и не больше
+// max_blocks блоков; out - на max_blocks * INDEX_BLOCK_RECORDS записей.
+// *next_id - первый ключ следующего блока (с него - следующая порция):
+// ключей от последней записи до него в базе нет.
+// Возвращает число записей: 0 - ключей >= from_id нет, -1 - ошибка чтения.
+int read_cards_from(uint64_t from_id, uint8_t* buf, size_t buf_len, int max_blocks,
+                    struct CardInfo* out, uint64_t* next_id, uint32_t* bytes_read);
+
+// Заменить список шардов новым поколением: файлы новых шардов уже записаны
+// (sync_file), пишется манифест, поколение публикуется; файлы выбывших
+// шардов удаляются после того, как прежнее поколение отпустят все поиски.
+// Вызывать под db_lock().
+bool commit_shards(const struct ShardInfo* new_shards, int count);
+
+// fflush + fsync: данные на флеше до того, как на файл сошлется манифест
+bool sync_file(FILE* fd);
+
+// Перестроить манифест сканированием файлов данных (медленный путь загрузки)
+void rebuild_manifest(void);
 
 // Функции для многопоточности
 void start_search_task(void);
-void add_card_to_search_queue(uint64_t card_hex);
+// Событие чтения в канал поиска. Канал полон - ждем до
+// SEARCH_BACKPRESSURE_MS, затем событие отбрасывается (false)
+bool add_card_to_search_queue(struct CardReadEvent* ev);
+uint32_t search_queue_depth(void);
+void get_search_channel_stats(struct ReadChannelStats* out);
+
+// События отложенного журнала (event_log.h, источник EVLOG_SRC_SEARCH),
+// текст - search_log_format()
+enum SearchLogEvent {
+    SLOG_NO_SPIFFS = 0,
+    SLOG_TEST_CARD,         // a - номер тестовой карты, b - мкс, x - ключ
+    SLOG_OUT_OF_RANGE,      // x - ключ
+    SLOG_IO_ERROR,          // a - файл, x - ключ
+    SLOG_FOUND,             // a - мкс, b - байт с флеша, x - ключ, y - запись и место
+    SLOG_NOT_FOUND,         // x - ключ
+    SLOG_EVENT,             // a - номер события, b - считыватель << 8 | бит, x - мкс в канале
+    SLOG_BATCH_BEGIN,       // a - карт, b - мкс
+    SLOG_BATCH_ITEM,        // a - 0 не найдена / 1 разрешена / 2 заблокирована, b - зоны, x - ключ
+    SLOG_BATCH_END,
+    SLOG_QUEUE_NOT_READY,
+    SLOG_QUEUE_FULL,        // x - ключ
+};
+struct EventLogRecord;
+void search_log_format(const struct EventLogRecord* r);
 
 // Функции для тестовых карт
 void add_test_cards_to_database(void);
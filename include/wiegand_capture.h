@@ -0,0 +1,88 @@
+#ifndef WIEGAND_CAPTURE_H
+#define WIEGAND_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// ЗАХВАТ ФРОНТОВ WIEGAND
+// ==========================================
+// Спадающие фронты D0/D1 со временем (мкс) попадают в кольцевой буфер
+// без блокировок (один писатель - прерывание или задача захвата, один
+// читатель - sensor_task). Источник задается WIEGAND_CAPTURE_MODE:
+//   WIEGAND_CAPTURE_GPIO        - D0/D1 заведены на GPIO, фронт ловит ISR
+//   WIEGAND_CAPTURE_PCF8574_INT - по линии INT расширителя: ISR ставит
+//                                 метку времени, задача захвата читает порт
+//   WIEGAND_CAPTURE_POLL        - задача опроса проходит шину по расписанию
+#define WIEGAND_CAPTURE_GPIO        0
+#define WIEGAND_CAPTURE_PCF8574_INT 1
+#define WIEGAND_CAPTURE_POLL        2
+
+// Считыватели: до 4 на расширитель (8 входов = 4 пары D0/D1), несколько
+// расширителей на шине. Номер считывателя - позиция в таблице WIEGAND_READERS.
+#define WIEGAND_MAX_READERS 16
+#define WIEGAND_MAX_EXPANDERS 4
+#define WIEGAND_READER_UNKNOWN 0xFF
+
+struct WiegandReaderPins {
+    uint8_t expander;   // индекс в WIEGAND_EXPANDERS
+    uint8_t d0_input;   // входы расширителя 1..8, как WIEGAND_D0/WIEGAND_D1
+    uint8_t d1_input;
+};
+
+// bit == WIEGAND_EDGE_LOST: расширитель сообщил об изменении, но импульс
+// закончился до чтения порта - какая линия сработала, неизвестно. Если
+// считывателей несколько, неизвестен и считыватель: WIEGAND_READER_UNKNOWN
+#define WIEGAND_EDGE_LOST 0xFF
+
+struct WiegandEdge {
+    uint32_t time_us;   // младшие 32 бита esp_timer_get_time()
+    uint8_t bit;        // 0 (D0), 1 (D1) или WIEGAND_EDGE_LOST
+    uint8_t reader;
+};
+
+// Запуск захвата. Вызывать из задачи-читателя: ее будят новые фронты,
+// прерывания GPIO регистрируются на ее ядре.
+bool wiegand_capture_start(void);
+
+// Кольцо: запись (из ISR/задачи захвата) и чтение (из sensor_task)
+bool wiegand_edge_push(uint32_t time_us, uint8_t reader, uint8_t bit);
+bool wiegand_edge_pop(struct WiegandEdge* out);
+uint32_t wiegand_edge_pending(void);
+
+// Ждать новых фронтов не дольше timeout_ms (0xFFFFFFFF - бесконечно)
+void wiegand_capture_wait(uint32_t timeout_ms);
+
+// Таблица считывателей. NULL - по умолчанию из config.h (WIEGAND_EXPANDERS,
+// WIEGAND_READERS). Менять только при остановленном захвате.
+bool wiegand_set_readers(const struct WiegandReaderPins* readers, int count,
+                         const uint8_t* expander_addrs, int expander_count);
+int wiegand_reader_count(void);
+int wiegand_expander_count(void);
+
+// Байты портов всех расширителей (по одному чтению на расширитель) ->
+// фронты всех считывателей. changed_hint - чтение по INT.
+void wiegand_capture_feed_ports(const uint8_t* ports, uint32_t time_us, bool changed_hint);
+
+// Один проход шины по всем расширителям (задача опроса)
+void wiegand_capture_poll(void);
+
+struct WiegandCaptureStats {
+    uint32_t edges;         // фронтов записано в кольцо
+    uint32_t overflows;     // фронтов потеряно: кольцо заполнено
+    uint32_t lost_edges;    // импульсов, не увиденных при чтении порта
+    uint32_t interrupts;    // срабатываний INT / GPIO
+    uint32_t max_depth;     // наибольшее заполнение кольца
+    uint32_t reader_edges[WIEGAND_MAX_READERS];
+};
+void get_wiegand_capture_stats(struct WiegandCaptureStats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WIEGAND_CAPTURE_H
@@ -0,0 +1,84 @@
+#ifndef WIEGAND_FORMATS_H
+#define WIEGAND_FORMATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================================
+// РЕЕСТР ФОРМАТОВ WIEGAND
+// ==========================================
+// Формат - описание, а не код: длина кадра, поля (смещение и ширина) и
+// маски четности. Таблица собирается при компиляции, выбор формата по
+// числу бит - одно обращение к массиву, четность - popcount по маске.
+// Биты нумеруются от младшего: кадр в WiegandFrame.data прижат вправо,
+// первый принятый бит - старший.
+#define WIEGAND_FORMAT_FIELDS 3
+#define WIEGAND_FORMAT_PARITIES 3
+#define WIEGAND_MAX_FORMATS 16
+
+struct WiegandField {
+    const char* name;     // NULL - поля нет
+    uint8_t offset;       // младший бит поля
+    uint8_t width;
+};
+
+// Бит четности входит в маску: четная проверка - popcount(data & mask)
+// четный, нечетная - нечетный
+struct WiegandParity {
+    uint64_t mask;        // 0 - проверки нет
+    bool odd;
+};
+
+struct WiegandFormat {
+    const char* name;
+    uint8_t bits;
+    struct WiegandParity parity[WIEGAND_FORMAT_PARITIES];
+    struct WiegandField key;      // ключ поиска в базе карт
+    struct WiegandField fields[WIEGAND_FORMAT_FIELDS];
+};
+
+enum WiegandDecodeResult {
+    WIEGAND_DECODE_OK = 0,
+    WIEGAND_DECODE_UNKNOWN_LENGTH,
+    WIEGAND_DECODE_BAD_PARITY,
+    WIEGAND_DECODE_LOST_BITS,     // кадр с потерянными фронтами, до разбора не дошел
+};
+
+struct WiegandCredential {
+    const struct WiegandFormat* format;   // NULL - длина не зарегистрирована
+    uint64_t key;
+    uint64_t fields[WIEGAND_FORMAT_FIELDS];
+};
+
+// Формат для длины кадра, NULL - не зарегистрирован
+const struct WiegandFormat* wiegand_format_for_bits(uint8_t bits);
+
+// Разбор кадра: поиск формата, проверка четности, выделение полей.
+// Ничего не печатает и не читает глобальных переменных.
+enum WiegandDecodeResult wiegand_decode(uint64_t data, uint8_t bits, struct WiegandCredential* out);
+const char* wiegand_decode_result_name(enum WiegandDecodeResult r);
+// Только выделение ключа и полей кадра, уже принятого wiegand_decode
+void wiegand_extract(const struct WiegandFormat* f, uint64_t data, struct WiegandCredential* out);
+
+// Перечисление зарегистрированных форматов (index от 0)
+const struct WiegandFormat* wiegand_format_at(int index);
+int wiegand_format_count(void);
+
+struct WiegandFormatStats {
+    uint32_t decoded;             // всего кадров через wiegand_decode
+    uint32_t unknown_length;
+    uint32_t bad_parity;
+    uint32_t accepted[WIEGAND_MAX_FORMATS];   // по индексу wiegand_format_at()
+};
+void get_wiegand_format_stats(struct WiegandFormatStats* out);
+void print_wiegand_format_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WIEGAND_FORMATS_H
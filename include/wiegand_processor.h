@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "wiegand_formats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,20 +16,70 @@ extern uint32_t wiegand_last_bit_time;
 extern bool wiegand_data_ready;
 extern uint32_t total_bits_received;
 extern uint32_t card_read_count;
+extern uint8_t wiegand_lost_bits;     // фронтов кадра с неизвестным битом
+
+// ==========================================
+// ДЕКОДЕР WIEGAND (чистый автомат состояний)
+// ==========================================
+// Не читает часы и не печатает: время фронтов приходит извне, поэтому
+// декодер можно прогонять записанными или синтетическими импульсами.
+// Кадр завершается паузой длиннее WIEGAND_TIMEOUT_MS.
+struct WiegandFrame {
+    uint64_t data;            // последние 64 бита, первый бит - старший
+    uint8_t bits;             // число фронтов (до 255)
+    uint8_t lost_bits;        // из них с неизвестным значением
+    uint32_t first_edge_us;
+    uint32_t last_edge_us;
+    uint8_t reader_id;        // заполняет check_wiegand(), декодеру не нужен
+    uint32_t complete_us;     // кадр передан дальше (check_wiegand), для трассы задержек
+};
+
+// Последний готовый кадр целиком (вместе со временем фронтов)
+extern struct WiegandFrame wiegand_frame;
+
+struct WiegandDecoder {
+    struct WiegandFrame frame;   // собираемый кадр, bits == 0 - простой
+};
+
+void wiegand_decoder_reset(struct WiegandDecoder* d);
+// Очередной фронт (bit 0/1 или WIEGAND_EDGE_LOST). true - фронт пришел
+// после паузы и завершил предыдущий кадр, он в out
+bool wiegand_decoder_feed(struct WiegandDecoder* d, uint8_t bit, uint32_t time_us, struct WiegandFrame* out);
+// true - к моменту now_us пауза истекла, кадр в out
+bool wiegand_decoder_poll(struct WiegandDecoder* d, uint32_t now_us, struct WiegandFrame* out);
+// Мс до завершения собираемого кадра по паузе, 0xFFFFFFFF - кадра нет
+uint32_t wiegand_decoder_timeout_ms(const struct WiegandDecoder* d, uint32_t now_us);
 
 // Function declarations
+// Разбор фронтов из кольца захвата (wiegand_capture.h) декодерами
+// считывателей до первого готового кадра
 void check_wiegand(void);
-void handle_wiegand_bit(uint8_t bit);
-void process_wiegand_data(void);
+// Сколько ждать новых фронтов, прежде чем снова вызвать check_wiegand()
+uint32_t wiegand_wait_ms(void);
+void handle_wiegand_bit(uint8_t bit);   // фронт считывателя 0 (текущее время)
+// Печать и разбор готового кадра по реестру форматов, сброс флага ready.
+// WIEGAND_DECODE_OK - ключ поиска в out->key; иначе кадр в поиск не идет
+enum WiegandDecodeResult process_wiegand_data(struct WiegandCredential* out);
 void reset_wiegand(void);
 void speed_test(void);
 void set_wiegand_debug(bool enable);  // Добавляем эту функцию
 
-// Format-specific processors
-void process_26bit_wiegand(void);
-void process_34bit_wiegand(void);
-void process_37bit_wiegand(void);
-void process_56bit_wiegand(void);
+// События отложенного журнала (event_log.h, источник EVLOG_SRC_WIEGAND),
+// текст - wiegand_log_format()
+enum WiegandLogEvent {
+    WLOG_BIT = 0,           // a - считыватель, b - бит, x - бит в кадре
+    WLOG_TIMEOUT,           // a - считыватель, b - бит в кадре
+    WLOG_FRAME,             // a - считыватель, b - бит, x - кадр
+    WLOG_LOST_BITS,         // a - потеряно фронтов
+    WLOG_UNKNOWN_LENGTH,    // a - бит
+    WLOG_BAD_PARITY,        // a - бит
+    WLOG_DECODED,           // a - бит, x - кадр
+    WLOG_FRAME_END,         // a - карт, b - бит всего
+    WLOG_EMPTY,             // a - бит (sensor_task)
+    WLOG_SENT,              // a - бит, b - считыватель, x - ключ (sensor_task)
+};
+struct EventLogRecord;
+void wiegand_log_format(const struct EventLogRecord* r);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,636 @@
+#include "access_journal.h"
+#include "card_types.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#endif
+
+#define JOURNAL_PARTITION_LABEL "journal"
+#define JOURNAL_PARTITION_SUBTYPE 0x41
+#define JOURNAL_HOST_FILE MOUNT_POINT "/journal.img"
+#define JOURNAL_HOST_SIZE (256 * 1024)
+#define JOURNAL_SECTOR_SIZE 4096
+#define JOURNAL_RECORD_BYTES 16
+#define JOURNAL_SECTOR_RECORDS 252  // ячейка 0 - заголовок, 253..255 - фильтр
+#define JOURNAL_BLOOM_BYTES 32
+#define JOURNAL_FOOTER_BYTES (JOURNAL_BLOOM_BYTES + 16)
+#define JOURNAL_FOOTER_OFFSET (JOURNAL_SECTOR_SIZE - JOURNAL_FOOTER_BYTES)
+#define JOURNAL_SECTOR_MAGIC 0x31534A41  // "AJS1"
+#define JOURNAL_FOOTER_MAGIC 0x46534A41  // "AJSF"
+
+static_assert(JOURNAL_RECORD_BYTES * (JOURNAL_SECTOR_RECORDS + 1) <= JOURNAL_FOOTER_OFFSET,
+              "Записи сектора налезают на фильтр");
+
+#if (ACCESS_JOURNAL_RING & (ACCESS_JOURNAL_RING - 1)) != 0
+#error "ACCESS_JOURNAL_RING must be a power of two"
+#endif
+
+// Сектор в индексе RAM
+struct JournalSector {
+    uint32_t seq;          // 0 - сектор пуст или устарел
+    uint16_t records;      // записанных ячеек
+    uint64_t first_ms;     // время первой записи
+    uint8_t bloom[JOURNAL_BLOOM_BYTES];
+};
+
+static JournalSector* sectors = NULL;
+static uint32_t sector_count = 0;
+static uint32_t head_sector = 0;     // открытый сектор
+static uint8_t write_buf[JOURNAL_SECTOR_RECORDS * JOURNAL_RECORD_BYTES];
+
+// Кольцо еще не записанных событий (закодированные записи)
+static uint8_t ring[ACCESS_JOURNAL_RING][JOURNAL_RECORD_BYTES];
+static uint32_t ring_head = 0;
+static uint32_t ring_tail = 0;
+static uint64_t last_ms = 0;         // время последнего события
+static int64_t clock_offset_ms = 0;
+
+static SemaphoreHandle_t ring_mutex = NULL;
+static SemaphoreHandle_t io_mutex = NULL;   // флеш и индекс секторов
+static TaskHandle_t journal_task_handle = NULL;
+static bool journal_ready = false;
+static AccessJournalStats journal_stats = {};
+
+// ==========================================
+// ФЛЕШ (платформенная часть)
+// ==========================================
+
+#ifdef ESP_PLATFORM
+
+static const esp_partition_t* journal_partition = NULL;
+
+static bool flash_open(uint32_t* size) {
+    journal_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                 (esp_partition_subtype_t)JOURNAL_PARTITION_SUBTYPE,
+                                                 JOURNAL_PARTITION_LABEL);
+    if (!journal_partition) return false;
+    *size = journal_partition->size;
+    return true;
+}
+
+static bool flash_read(uint32_t offset, void* dst, size_t len) {
+    return esp_partition_read(journal_partition, offset, dst, len) == ESP_OK;
+}
+
+static bool flash_write(uint32_t offset, const void* src, size_t len) {
+    return esp_partition_write(journal_partition, offset, src, len) == ESP_OK;
+}
+
+static bool flash_erase_sector(uint32_t offset) {
+    return esp_partition_erase_range(journal_partition, offset, JOURNAL_SECTOR_SIZE) == ESP_OK;
+}
+
+#else
+
+// Сборка под хост: раздел - файл, стертый флеш - 0xFF
+static FILE* journal_file = NULL;
+
+static bool flash_open(uint32_t* size) {
+    journal_file = fopen(JOURNAL_HOST_FILE, "r+b");
+    if (!journal_file) {
+        journal_file = fopen(JOURNAL_HOST_FILE, "w+b");
+        if (!journal_file) return false;
+        uint8_t ff[JOURNAL_SECTOR_SIZE];
+        memset(ff, 0xFF, sizeof(ff));
+        for (uint32_t done = 0; done < JOURNAL_HOST_SIZE; done += sizeof(ff)) {
+            fwrite(ff, 1, sizeof(ff), journal_file);
+        }
+    }
+    *size = JOURNAL_HOST_SIZE;
+    return true;
+}
+
+static bool flash_read(uint32_t offset, void* dst, size_t len) {
+    return fseek(journal_file, (long)offset, SEEK_SET) == 0 && fread(dst, 1, len, journal_file) == len;
+}
+
+static bool flash_write(uint32_t offset, const void* src, size_t len) {
+    bool ok = fseek(journal_file, (long)offset, SEEK_SET) == 0 && fwrite(src, 1, len, journal_file) == len;
+    return ok && fflush(journal_file) == 0;
+}
+
+static bool flash_erase_sector(uint32_t offset) {
+    uint8_t ff[JOURNAL_SECTOR_SIZE];
+    memset(ff, 0xFF, sizeof(ff));
+    return flash_write(offset, ff, sizeof(ff));
+}
+
+#endif
+
+static uint32_t slot_offset(uint32_t sector, uint32_t slot) {
+    return sector * JOURNAL_SECTOR_SIZE + slot * JOURNAL_RECORD_BYTES;
+}
+
+// ==========================================
+// ЗАПИСИ: time:48 | reader:4 | decision:4 | card:56 | 0 | crc8
+// ==========================================
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void put_le(uint8_t* dst, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) dst[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t* src, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)src[i] << (8 * i);
+    return v;
+}
+
+static bool slot_erased(const uint8_t* rec) {
+    for (int i = 0; i < JOURNAL_RECORD_BYTES; i++) {
+        if (rec[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+static void encode_event(const AccessEvent* ev, uint8_t* rec) {
+    put_le(rec, ev->time_ms, 6);
+    rec[6] = (uint8_t)((ev->reader << 4) | (ev->decision & 0x0F));
+    put_le(rec + 7, ev->card_hex, 7);
+    rec[14] = 0;
+    rec[15] = crc8(rec, JOURNAL_RECORD_BYTES - 1);
+}
+
+// false - стертая, оборванная или испорченная запись
+static bool decode_event(const uint8_t* rec, AccessEvent* ev) {
+    if (rec[14] != 0 || crc8(rec, JOURNAL_RECORD_BYTES - 1) != rec[15]) return false;
+    ev->time_ms = get_le(rec, 6);
+    ev->reader = rec[6] >> 4;
+    ev->decision = rec[6] & 0x0F;
+    ev->card_hex = get_le(rec + 7, 7);
+    return true;
+}
+
+// Фильтр карт сектора: 2 бита из 256 на карту
+static void bloom_bits(uint64_t card_hex, uint8_t* a, uint8_t* b) {
+    uint64_t h = card_hex * 0x9E3779B97F4A7C15ULL;
+    *a = (uint8_t)(h >> 56);
+    *b = (uint8_t)(h >> 48);
+}
+
+static void bloom_add(uint8_t* bloom, uint64_t card_hex) {
+    uint8_t a, b;
+    bloom_bits(card_hex, &a, &b);
+    bloom[a >> 3] |= (uint8_t)(1 << (a & 7));
+    bloom[b >> 3] |= (uint8_t)(1 << (b & 7));
+}
+
+static bool bloom_may_contain(const uint8_t* bloom, uint64_t card_hex) {
+    uint8_t a, b;
+    bloom_bits(card_hex, &a, &b);
+    return (bloom[a >> 3] & (1 << (a & 7))) && (bloom[b >> 3] & (1 << (b & 7)));
+}
+
+// ==========================================
+// СЕКТОРЫ
+// ==========================================
+
+static bool read_sector_header(uint32_t sector, uint32_t* seq) {
+    uint8_t rec[JOURNAL_RECORD_BYTES];
+    if (!flash_read(slot_offset(sector, 0), rec, sizeof(rec))) return false;
+    if (get_le(rec, 4) != JOURNAL_SECTOR_MAGIC || crc8(rec, JOURNAL_RECORD_BYTES - 1) != rec[15]) return false;
+    *seq = (uint32_t)get_le(rec + 4, 4);
+    return *seq != 0;
+}
+
+static bool read_sector_footer(uint32_t sector, uint8_t* bloom) {
+    uint8_t footer[JOURNAL_FOOTER_BYTES];
+    if (!flash_read(sector * JOURNAL_SECTOR_SIZE + JOURNAL_FOOTER_OFFSET, footer, sizeof(footer))) return false;
+    if (get_le(footer + JOURNAL_BLOOM_BYTES, 4) != JOURNAL_FOOTER_MAGIC ||
+        crc8(footer, JOURNAL_FOOTER_BYTES - 1) != footer[JOURNAL_FOOTER_BYTES - 1]) {
+        return false;
+    }
+    memcpy(bloom, footer, JOURNAL_BLOOM_BYTES);
+    return true;
+}
+
+// Стереть сектор и записать его заголовок - он становится открытым
+static bool open_sector(uint32_t sector, uint32_t seq) {
+    memset(&sectors[sector], 0, sizeof(JournalSector));
+    if (!flash_erase_sector(sector * JOURNAL_SECTOR_SIZE)) return false;
+    journal_stats.sectors_erased++;
+
+    uint8_t hdr[JOURNAL_RECORD_BYTES];
+    memset(hdr, 0, sizeof(hdr));
+    put_le(hdr, JOURNAL_SECTOR_MAGIC, 4);
+    put_le(hdr + 4, seq, 4);
+    hdr[15] = crc8(hdr, JOURNAL_RECORD_BYTES - 1);
+    if (!flash_write(slot_offset(sector, 0), hdr, sizeof(hdr))) return false;
+    journal_stats.bytes_written += sizeof(hdr);
+
+    sectors[sector].seq = seq;
+    head_sector = sector;
+    return true;
+}
+
+// Закрыть заполненный сектор (фильтр) и открыть следующий: он стирается,
+// его события - самые старые в журнале - пропадают
+static bool advance_sector() {
+    JournalSector* cur = &sectors[head_sector];
+    uint8_t footer[JOURNAL_FOOTER_BYTES];
+    memset(footer, 0, sizeof(footer));
+    memcpy(footer, cur->bloom, JOURNAL_BLOOM_BYTES);
+    put_le(footer + JOURNAL_BLOOM_BYTES, JOURNAL_FOOTER_MAGIC, 4);
+    put_le(footer + JOURNAL_BLOOM_BYTES + 4, cur->records, 4);
+    footer[JOURNAL_FOOTER_BYTES - 1] = crc8(footer, JOURNAL_FOOTER_BYTES - 1);
+    // Фильтр не записался - сектор все равно читается целиком (фильтр в RAM верен)
+    if (flash_write(head_sector * JOURNAL_SECTOR_SIZE + JOURNAL_FOOTER_OFFSET, footer, sizeof(footer))) {
+        journal_stats.bytes_written += sizeof(footer);
+    }
+
+    return open_sector((head_sector + 1) % sector_count, cur->seq + 1);
+}
+
+// Секторы от старого к новому (номера), возвращает их число
+static uint32_t ordered_sectors(uint32_t* order) {
+    uint32_t n = 0;
+    for (uint32_t i = 1; i <= sector_count; i++) {
+        uint32_t s = (head_sector + i) % sector_count;
+        if (sectors[s].seq != 0) order[n++] = s;
+    }
+    return n;
+}
+
+// ==========================================
+// ГРУППОВАЯ ФИКСАЦИЯ
+// ==========================================
+
+static uint32_t ring_depth() {
+    return ring_head - ring_tail;
+}
+
+// Все накопленное - на флеш: одна запись на сектор (под io_mutex)
+static void commit_pending_locked() {
+    while (true) {
+        if (sectors[head_sector].records >= JOURNAL_SECTOR_RECORDS && !advance_sector()) {
+            printf("❌ Журнал проходов: не удалось открыть сектор %lu\n", (unsigned long)head_sector);
+            return;
+        }
+        JournalSector* cur = &sectors[head_sector];
+        uint32_t room = JOURNAL_SECTOR_RECORDS - cur->records;
+
+        xSemaphoreTake(ring_mutex, portMAX_DELAY);
+        uint32_t n = ring_depth();
+        if (n > room) n = room;
+        for (uint32_t i = 0; i < n; i++) {
+            memcpy(write_buf + i * JOURNAL_RECORD_BYTES, ring[(ring_tail + i) & (ACCESS_JOURNAL_RING - 1)],
+                   JOURNAL_RECORD_BYTES);
+        }
+        ring_tail += n;
+        xSemaphoreGive(ring_mutex);
+        if (n == 0) return;
+
+        int64_t t0 = esp_timer_get_time();
+        size_t bytes = (size_t)n * JOURNAL_RECORD_BYTES;
+        if (!flash_write(slot_offset(head_sector, 1 + cur->records), write_buf, bytes)) {
+            printf("❌ Журнал проходов: ошибка записи, потеряно %lu событий\n", (unsigned long)n);
+            return;
+        }
+        uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+
+        for (uint32_t i = 0; i < n; i++) {
+            AccessEvent ev;
+            decode_event(write_buf + i * JOURNAL_RECORD_BYTES, &ev);
+            if (cur->records == 0 && i == 0) cur->first_ms = ev.time_ms;
+            bloom_add(cur->bloom, ev.card_hex);
+        }
+        cur->records += n;
+        journal_stats.committed += n;
+        journal_stats.commits++;
+        journal_stats.bytes_written += bytes;
+        if (dt > journal_stats.max_commit_us) journal_stats.max_commit_us = dt;
+    }
+}
+
+void access_journal_sync() {
+    if (!journal_ready) return;
+    xSemaphoreTake(io_mutex, portMAX_DELAY);
+    commit_pending_locked();
+    xSemaphoreGive(io_mutex);
+}
+
+static void journal_task(void* pvParameters) {
+    while (1) {
+        // Группа набралась (уведомление) или событие ждет дольше COMMIT_MS
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACCESS_JOURNAL_COMMIT_MS));
+        if (ring_depth() > 0) access_journal_sync();
+    }
+}
+
+// ==========================================
+// ЗАПИСЬ СОБЫТИЯ
+// ==========================================
+
+static uint64_t system_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+uint64_t access_journal_now() {
+    int64_t now = (int64_t)system_ms() + clock_offset_ms;
+    return now < (int64_t)last_ms ? last_ms : (uint64_t)now;
+}
+
+bool access_journal_append(uint64_t card_hex, uint8_t reader, uint8_t decision) {
+    if (!journal_ready) return false;
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    uint32_t depth = ring_depth();
+    bool ok = depth < ACCESS_JOURNAL_RING;
+    if (ok) {
+        AccessEvent ev = {access_journal_now(), card_hex, reader, decision};
+        last_ms = ev.time_ms;
+        encode_event(&ev, ring[ring_head & (ACCESS_JOURNAL_RING - 1)]);
+        ring_head++;
+        depth++;
+        journal_stats.appended++;
+        if (depth > journal_stats.max_pending) journal_stats.max_pending = depth;
+    } else {
+        journal_stats.dropped++;
+    }
+    xSemaphoreGive(ring_mutex);
+
+    if (ok && depth >= ACCESS_JOURNAL_GROUP && journal_task_handle) xTaskNotifyGive(journal_task_handle);
+    return ok;
+}
+
+// ==========================================
+// ЗАПРОСЫ
+// ==========================================
+
+// Записи сектора с флеша (только записанные ячейки), NULL - ошибка
+static const uint8_t* load_sector(uint32_t sector, uint8_t* buf) {
+    size_t bytes = (size_t)sectors[sector].records * JOURNAL_RECORD_BYTES;
+    if (bytes == 0) return buf;
+    return flash_read(slot_offset(sector, 1), buf, bytes) ? buf : NULL;
+}
+
+size_t access_journal_query_range(uint64_t from_ms, uint64_t to_ms, AccessEvent* out, size_t max) {
+    if (!journal_ready || max == 0) return 0;
+    uint32_t* order = (uint32_t*)malloc(sector_count * sizeof(uint32_t));
+    uint8_t* buf = (uint8_t*)malloc(JOURNAL_SECTOR_RECORDS * JOURNAL_RECORD_BYTES);
+    size_t found = 0;
+    if (!order || !buf) {
+        free(order);
+        free(buf);
+        return 0;
+    }
+
+    xSemaphoreTake(io_mutex, portMAX_DELAY);
+    // Первый нужный сектор - последний, начавшийся раньше from_ms
+    uint32_t n = ordered_sectors(order);
+    uint32_t left = 0, right = n;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (sectors[order[mid]].records > 0 && sectors[order[mid]].first_ms < from_ms) left = mid + 1;
+        else right = mid;
+    }
+    uint32_t start = left > 0 ? left - 1 : 0;
+
+    for (uint32_t p = start; p < n && found < max; p++) {
+        const JournalSector* sec = &sectors[order[p]];
+        if (sec->records == 0 || sec->first_ms > to_ms) break;
+        const uint8_t* recs = load_sector(order[p], buf);
+        for (uint32_t r = 0; recs && r < sec->records && found < max; r++) {
+            AccessEvent ev;
+            if (!decode_event(recs + r * JOURNAL_RECORD_BYTES, &ev)) continue;
+            if (ev.time_ms > to_ms) break;
+            if (ev.time_ms >= from_ms) out[found++] = ev;
+        }
+    }
+
+    // Еще не записанные - новее всего на флеше
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    for (uint32_t i = ring_tail; i != ring_head && found < max; i++) {
+        AccessEvent ev;
+        decode_event(ring[i & (ACCESS_JOURNAL_RING - 1)], &ev);
+        if (ev.time_ms > to_ms) break;
+        if (ev.time_ms >= from_ms) out[found++] = ev;
+    }
+    xSemaphoreGive(ring_mutex);
+    xSemaphoreGive(io_mutex);
+
+    free(order);
+    free(buf);
+    return found;
+}
+
+size_t access_journal_query_card(uint64_t card_hex, AccessEvent* out, size_t max) {
+    if (!journal_ready || max == 0) return 0;
+    uint32_t* order = (uint32_t*)malloc(sector_count * sizeof(uint32_t));
+    uint8_t* buf = (uint8_t*)malloc(JOURNAL_SECTOR_RECORDS * JOURNAL_RECORD_BYTES);
+    size_t found = 0;
+    if (!order || !buf) {
+        free(order);
+        free(buf);
+        return 0;
+    }
+
+    xSemaphoreTake(io_mutex, portMAX_DELAY);
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    for (uint32_t i = ring_head; i != ring_tail && found < max; i--) {
+        AccessEvent ev;
+        decode_event(ring[(i - 1) & (ACCESS_JOURNAL_RING - 1)], &ev);
+        if (ev.card_hex == card_hex) out[found++] = ev;
+    }
+    xSemaphoreGive(ring_mutex);
+
+    // От нового сектора к старому; фильтр отсекает секторы без карты
+    uint32_t n = ordered_sectors(order);
+    for (uint32_t p = n; p > 0 && found < max; p--) {
+        const JournalSector* sec = &sectors[order[p - 1]];
+        if (sec->records == 0 || !bloom_may_contain(sec->bloom, card_hex)) continue;
+        const uint8_t* recs = load_sector(order[p - 1], buf);
+        for (uint32_t r = sec->records; recs && r > 0 && found < max; r--) {
+            AccessEvent ev;
+            if (decode_event(recs + (r - 1) * JOURNAL_RECORD_BYTES, &ev) && ev.card_hex == card_hex) {
+                out[found++] = ev;
+            }
+        }
+    }
+    xSemaphoreGive(io_mutex);
+
+    free(order);
+    free(buf);
+    return found;
+}
+
+uint32_t access_journal_capacity() {
+    // Следующий сектор стирается перед записью
+    return sector_count > 1 ? (sector_count - 1) * JOURNAL_SECTOR_RECORDS : 0;
+}
+
+uint32_t access_journal_count() {
+    uint32_t total = 0;
+    for (uint32_t s = 0; s < sector_count; s++) {
+        if (sectors[s].seq != 0) total += sectors[s].records;
+    }
+    return total;
+}
+
+// ==========================================
+// ВОССТАНОВЛЕНИЕ ПРИ ЗАГРУЗКЕ
+// ==========================================
+
+// Конец открытого сектора: первая стертая ячейка. Записи идут подряд,
+// поэтому двоичный поиск; затем читается только хвост - этот сектор.
+static void recover_head(uint8_t* buf) {
+    JournalSector* head = &sectors[head_sector];
+    uint32_t left = 0, right = JOURNAL_SECTOR_RECORDS;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        uint8_t rec[JOURNAL_RECORD_BYTES];
+        if (flash_read(slot_offset(head_sector, 1 + mid), rec, sizeof(rec)) && slot_erased(rec)) right = mid;
+        else left = mid + 1;
+    }
+    head->records = (uint16_t)left;
+    memset(head->bloom, 0, sizeof(head->bloom));
+    if (left == 0 || !load_sector(head_sector, buf)) return;
+
+    bool first = true;
+    for (uint32_t r = 0; r < left; r++) {
+        AccessEvent ev;
+        if (!decode_event(buf + r * JOURNAL_RECORD_BYTES, &ev)) {
+            journal_stats.torn++;  // запись оборвана питанием - пропускается
+            continue;
+        }
+        if (first) head->first_ms = ev.time_ms;
+        first = false;
+        bloom_add(head->bloom, ev.card_hex);
+        last_ms = ev.time_ms;
+        journal_stats.recovered++;
+    }
+}
+
+static bool journal_recover() {
+    uint8_t* buf = (uint8_t*)malloc(JOURNAL_SECTOR_RECORDS * JOURNAL_RECORD_BYTES);
+    if (!buf) return false;
+
+    // 1. Заголовки: открытый сектор - с наибольшим номером
+    uint32_t head_seq = 0;
+    for (uint32_t s = 0; s < sector_count; s++) {
+        uint32_t seq = 0;
+        if (read_sector_header(s, &seq)) sectors[s].seq = seq;
+        if (seq > head_seq) {
+            head_seq = seq;
+            head_sector = s;
+        }
+    }
+    if (head_seq == 0) {
+        // Пустой раздел: открываем сектор 0 с номером 1
+        free(buf);
+        return open_sector(0, 1);
+    }
+
+    // 2. Закрытые секторы: номер должен идти подряд до открытого
+    for (uint32_t s = 0; s < sector_count; s++) {
+        if (s == head_sector) continue;
+        uint32_t behind = (head_sector + sector_count - s) % sector_count;
+        JournalSector* sec = &sectors[s];
+        if (sec->seq == 0 || sec->seq + behind != head_seq) {
+            memset(sec, 0, sizeof(*sec));
+            continue;
+        }
+        sec->records = JOURNAL_SECTOR_RECORDS;
+        uint8_t rec[JOURNAL_RECORD_BYTES];
+        AccessEvent ev;
+        if (flash_read(slot_offset(s, 1), rec, sizeof(rec)) && decode_event(rec, &ev)) sec->first_ms = ev.time_ms;
+        // Фильтр не дописан (сбой при закрытии) - сектор читается целиком
+        if (!read_sector_footer(s, sec->bloom)) memset(sec->bloom, 0xFF, sizeof(sec->bloom));
+        journal_stats.recovered += sec->records;
+    }
+
+    // 3. Хвост открытого сектора
+    recover_head(buf);
+    if (last_ms == 0) {
+        // Открытый сектор пуст - время последней записи предыдущего
+        uint32_t prev = (head_sector + sector_count - 1) % sector_count;
+        uint8_t rec[JOURNAL_RECORD_BYTES];
+        AccessEvent ev;
+        if (sectors[prev].seq && flash_read(slot_offset(prev, JOURNAL_SECTOR_RECORDS), rec, sizeof(rec)) &&
+            decode_event(rec, &ev)) {
+            last_ms = ev.time_ms;
+        }
+    }
+    free(buf);
+    return true;
+}
+
+void access_journal_init() {
+    if (journal_ready) return;
+    ring_mutex = xSemaphoreCreateMutex();
+    io_mutex = xSemaphoreCreateMutex();
+    uint32_t size = 0;
+    if (!ring_mutex || !io_mutex || !flash_open(&size)) {
+        printf("❌ Журнал проходов: раздел %s не найден\n", JOURNAL_PARTITION_LABEL);
+        return;
+    }
+    sector_count = size / JOURNAL_SECTOR_SIZE;
+    sectors = (JournalSector*)calloc(sector_count, sizeof(JournalSector));
+    if (sector_count < 2 || !sectors) {
+        printf("❌ Журнал проходов: не хватает памяти\n");
+        return;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (!journal_recover()) {
+        printf("❌ Журнал проходов: ошибка восстановления\n");
+        return;
+    }
+    journal_stats.recover_us = (uint32_t)(esp_timer_get_time() - t0);
+
+    // Часы журнала продолжаются от последней записи
+    uint64_t now = system_ms();
+    if (now <= last_ms) clock_offset_ms = (int64_t)(last_ms - now) + 1;
+
+    journal_ready = true;
+    xTaskCreatePinnedToCore(journal_task, "access_journal", 3072, NULL,
+                            tskIDLE_PRIORITY + 1, &journal_task_handle, 0);
+    printf("✅ Журнал проходов: %lu событий (емкость %lu, %lu секторов), оборванных %lu, %lu мкс\n",
+           (unsigned long)access_journal_count(), (unsigned long)access_journal_capacity(),
+           (unsigned long)sector_count, (unsigned long)journal_stats.torn,
+           (unsigned long)journal_stats.recover_us);
+}
+
+bool access_journal_ready() {
+    return journal_ready;
+}
+
+// ==========================================
+// СТАТИСТИКА
+// ==========================================
+
+void get_access_journal_stats(AccessJournalStats* out) {
+    *out = journal_stats;
+}
+
+void print_access_journal_stats() {
+    if (!journal_ready) return;
+    const AccessJournalStats* s = &journal_stats;
+    printf("📒 Журнал проходов: %lu событий | добавлено %lu, отброшено %lu | записей на флеш %lu (%.1f событий), "
+           "%llu Б, max %lu мкс | стерто секторов %lu | очередь max %lu\n",
+           (unsigned long)access_journal_count(), (unsigned long)s->appended, (unsigned long)s->dropped,
+           (unsigned long)s->commits, s->commits ? (double)s->committed / s->commits : 0.0,
+           (unsigned long long)s->bytes_written, (unsigned long)s->max_commit_us,
+           (unsigned long)s->sectors_erased, (unsigned long)s->max_pending);
+}
@@ -0,0 +1,2633 @@
+#include "benchmark.h"
+#include "card_record.h"
+#include "card_block.h"
+#include "search.h"
+#include "card_filter.h"
+#include "card_cache.h"
+#include "card_storage.h"
+#include "card_table.h"
+#include "card_scan.h"
+#include "card_db.h"
+#include "card_usage.h"
+#include "access_journal.h"
+#include "card_import.h"
+#include "wiegand_processor.h"
+#include "wiegand_capture.h"
+#include "wiegand_formats.h"
+#include "read_channel.h"
+#include "event_log.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_spiffs.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "i2c_driver.h"
+
+#define BENCH_BUFFER_RECORDS 1000
+#define BENCH_BUFFER_BYTES ((BENCH_BUFFER_RECORDS * RECORD_BITS) / 8)
+#define BENCH_ITERATIONS 20000
+#define BENCH_LOOKUPS 200
+
+// ==========================================
+// ЭТАЛОННЫЕ ПОБИТОВЫЕ ЯДРА (прежняя реализация)
+// ==========================================
+
+static uint64_t extract_bits_bitwise(const uint8_t* buffer, uint64_t global_bit_start, int bit_count) {
+    uint64_t result = 0;
+    for (int i = 0; i < bit_count; i++) {
+        uint64_t current_bit_pos = global_bit_start + i;
+        uint32_t byte_idx = current_bit_pos / 8;
+        uint8_t  bit_idx  = current_bit_pos % 8;
+        uint8_t bit = (buffer[byte_idx] >> (7 - bit_idx)) & 1;
+        result = (result << 1) | bit;
+    }
+    return result;
+}
+
+static void get_card_bitwise(const uint8_t* buffer, int index, CardInfo* out) {
+    uint64_t start_bit = (uint64_t)index * RECORD_BITS;
+    out->hex_id = extract_bits_bitwise(buffer, start_bit, 56);
+    start_bit += 56;
+    out->status = (uint8_t)extract_bits_bitwise(buffer, start_bit, 2);
+    start_bit += 2;
+    out->count = (uint8_t)extract_bits_bitwise(buffer, start_bit, 4);
+    start_bit += 4;
+    out->zones = (uint8_t)extract_bits_bitwise(buffer, start_bit, 8);
+    start_bit += 8;
+    out->link = (uint16_t)extract_bits_bitwise(buffer, start_bit, 16);
+}
+
+static void push_bits_bitwise(uint8_t* buffer, int* bit_cursor, uint64_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        uint8_t bit = (value >> i) & 1;
+        int byte_idx = (*bit_cursor) / 8;
+        int bit_idx = (*bit_cursor) % 8;
+        if (bit) buffer[byte_idx] |= (1 << (7 - bit_idx));
+        else     buffer[byte_idx] &= ~(1 << (7 - bit_idx));
+        (*bit_cursor)++;
+    }
+}
+
+static void put_card_bitwise(uint8_t* buffer, int index, const CardInfo* ci) {
+    int bit_cursor = index * RECORD_BITS;
+    push_bits_bitwise(buffer, &bit_cursor, ci->hex_id, 56);
+    push_bits_bitwise(buffer, &bit_cursor, ci->status, 2);
+    push_bits_bitwise(buffer, &bit_cursor, ci->count, 4);
+    push_bits_bitwise(buffer, &bit_cursor, ci->zones, 8);
+    push_bits_bitwise(buffer, &bit_cursor, ci->link, 16);
+}
+
+static bool card_equal(const CardInfo* a, const CardInfo* b) {
+    return card_info_equal(a, b);
+}
+
+#define BENCH_RANDOM_FIELD(P, name, type, width) ci->name = (type)(esp_random() & CARD_FIELD_MASK(width));
+
+static void random_card(CardInfo* ci) {
+    ci->hex_id = (((uint64_t)esp_random() << 32) | esp_random()) & CARD_FIELD_MASK(CARD_KEY_BITS);
+    CARD_ATTR_FIELDS(BENCH_RANDOM_FIELD, CARD_ATTR)
+}
+
+static void print_bench_line(const char* name, int64_t old_us, int64_t new_us, int iterations) {
+    printf("  %-26s old: %6llu нс/оп | new: %6llu нс/оп | x%.1f\n", name,
+           (unsigned long long)(old_us * 1000 / iterations),
+           (unsigned long long)(new_us * 1000 / iterations),
+           new_us > 0 ? (double)old_us / (double)new_us : 0.0);
+}
+
+// ==========================================
+// ЗАМЕР: ЯДРА БИТОВЫХ ОПЕРАЦИЙ
+// ==========================================
+
+void bench_bit_kernels() {
+    printf("\n⏱️  === BENCH: ядра упаковки записей ===\n");
+
+    uint8_t* buf_old = (uint8_t*)calloc(1, BENCH_BUFFER_BYTES + RECORD_READ_PAD);
+    uint8_t* buf_new = (uint8_t*)calloc(1, BENCH_BUFFER_BYTES + RECORD_READ_PAD);
+    uint32_t* offsets = (uint32_t*)malloc(BENCH_ITERATIONS * sizeof(uint32_t));
+    CardInfo* cards = (CardInfo*)malloc(BENCH_BUFFER_RECORDS * sizeof(CardInfo));
+    if (!buf_old || !buf_new || !offsets || !cards) {
+        printf("❌ Ошибка выделения памяти\n");
+        free(buf_old); free(buf_new); free(offsets); free(cards);
+        return;
+    }
+
+    int mismatches = 0;
+
+    // 1. Упаковка: оба упаковщика должны дать одинаковые байты
+    for (int i = 0; i < BENCH_BUFFER_RECORDS; i++) random_card(&cards[i]);
+
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_BUFFER_RECORDS; i++) put_card_bitwise(buf_old, i, &cards[i]);
+    int64_t t_old = esp_timer_get_time() - t0;
+
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_BUFFER_RECORDS; i++) put_card_to_buffer(buf_new, i, &cards[i]);
+    int64_t t_new = esp_timer_get_time() - t0;
+
+    if (memcmp(buf_old, buf_new, BENCH_BUFFER_BYTES) != 0) mismatches++;
+    print_bench_line("pack record", t_old, t_new, BENCH_BUFFER_RECORDS);
+
+    // 2. Произвольные поля на случайных битовых смещениях
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        offsets[i] = esp_random() % (BENCH_BUFFER_BYTES * 8 - 64);
+    }
+    static const int widths[] = {2, 4, 8, 16, 56, 64};
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        volatile uint64_t sink = 0;
+        t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) sink += extract_bits_bitwise(buf_new, offsets[i], widths[w]);
+        t_old = esp_timer_get_time() - t0;
+
+        t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) sink += extract_bits_from_ram(buf_new, offsets[i], widths[w]);
+        t_new = esp_timer_get_time() - t0;
+
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            if (extract_bits_bitwise(buf_new, offsets[i], widths[w]) !=
+                extract_bits_from_ram(buf_new, offsets[i], widths[w])) {
+                mismatches++;
+                break;
+            }
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "extract %d bits", widths[w]);
+        print_bench_line(name, t_old, t_new, BENCH_ITERATIONS);
+    }
+
+    // 3. Ключ (проба бинарного поиска) и запись целиком на случайных записях
+    for (int i = 0; i < BENCH_ITERATIONS; i++) offsets[i] = esp_random() % BENCH_BUFFER_RECORDS;
+    {
+        volatile uint64_t sink = 0;
+        t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            sink += extract_bits_bitwise(buf_new, (uint64_t)offsets[i] * RECORD_BITS, 56);
+        }
+        t_old = esp_timer_get_time() - t0;
+
+        t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) sink += get_card_id_from_buffer(buf_new, offsets[i]);
+        t_new = esp_timer_get_time() - t0;
+        print_bench_line("search probe (56-bit key)", t_old, t_new, BENCH_ITERATIONS);
+    }
+    {
+        CardInfo ci;
+        volatile uint32_t sink = 0;
+        t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            get_card_bitwise(buf_new, offsets[i], &ci);
+            sink += ci.link;
+        }
+        t_old = esp_timer_get_time() - t0;
+
+        t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            get_card_from_buffer(buf_new, offsets[i], &ci);
+            sink += ci.link;
+        }
+        t_new = esp_timer_get_time() - t0;
+        print_bench_line("unpack CardInfo", t_old, t_new, BENCH_ITERATIONS);
+    }
+    for (int i = 0; i < BENCH_BUFFER_RECORDS; i++) {
+        CardInfo a, b;
+        get_card_bitwise(buf_new, i, &a);
+        get_card_from_buffer(buf_new, i, &b);
+        if (!card_equal(&a, &b) || !card_equal(&b, &cards[i])) {
+            mismatches++;
+            break;
+        }
+    }
+
+    printf("%s Сверка побитовых и пословных ядер: %d расхождений\n",
+           mismatches == 0 ? "✅" : "❌", mismatches);
+
+    free(buf_old);
+    free(buf_new);
+    free(offsets);
+    free(cards);
+}
+
+// ==========================================
+// ЗАМЕР: РАЗРЕЖЕННЫЙ ИНДЕКС БЛОКОВ
+// ==========================================
+
+// Прежний путь поиска: чтение файла целиком и бинарный поиск в RAM
+static LookupResult lookup_full_file(uint64_t target_hex, CardInfo* out, uint32_t* bytes_read) {
+    *bytes_read = 0;
+
+    ShardInfo shard;
+    if (!get_shard_info(find_shard_for_card(target_hex), &shard)) return LOOKUP_OUT_OF_RANGE;
+    const int file_records = (int)shard.records;
+
+    char fname[32];
+    shard_file_name(shard.file_id, fname, sizeof(fname));
+    FILE* fd = fopen(fname, "rb");
+    if (!fd) return LOOKUP_IO_ERROR;
+    uint8_t* file_buffer = (uint8_t*)malloc(shard.bytes + RECORD_READ_PAD);
+    CardInfo* cards = (CardInfo*)malloc(file_records * sizeof(CardInfo));
+    if (!file_buffer || !cards) {
+        fclose(fd);
+        free(file_buffer);
+        free(cards);
+        return LOOKUP_IO_ERROR;
+    }
+    *bytes_read = fread(file_buffer, 1, shard.bytes, fd);
+    fclose(fd);
+
+    LookupResult res = LOOKUP_IO_ERROR;
+    if (card_file_decode(file_buffer, *bytes_read, cards)) {
+        res = LOOKUP_NOT_FOUND;
+        int left = 0, right = file_records - 1;
+        while (left <= right) {
+            int mid = left + (right - left) / 2;
+            if (cards[mid].hex_id == target_hex) {
+                *out = cards[mid];
+                res = LOOKUP_FOUND;
+                break;
+            }
+            if (cards[mid].hex_id < target_hex) left = mid + 1;
+            else right = mid - 1;
+        }
+    }
+    free(file_buffer);
+    free(cards);
+    return res;
+}
+
+// Случайный существующий ключ: шард распаковывается целиком
+static bool pick_existing_card(uint64_t* out) {
+    ShardInfo shard;
+    if (get_shard_count() == 0 || !get_shard_info(esp_random() % get_shard_count(), &shard)) return false;
+    if (shard.records == 0) return false;
+    CardInfo* cards = read_shard_cards(&shard);
+    if (!cards) return false;
+    *out = cards[esp_random() % shard.records].hex_id;
+    free(cards);
+    return true;
+}
+
+// Ключ внутри диапазона шарда, которого нет в базе: случайный ключ
+// между first_id и last_id, пока поиск не ответит LOOKUP_NOT_FOUND
+#define BENCH_ABSENT_TRIES 64
+
+static bool pick_absent_card(uint64_t* out) {
+    ShardInfo shard;
+    if (get_shard_count() == 0 || !get_shard_info(esp_random() % get_shard_count(), &shard)) return false;
+    if (shard.records == 0 || shard.last_id - shard.first_id < 2) return false;
+    uint64_t span = shard.last_id - shard.first_id - 1;
+    for (int t = 0; t < BENCH_ABSENT_TRIES; t++) {
+        uint64_t r = ((uint64_t)esp_random() << 32) | esp_random();
+        uint64_t key = shard.first_id + 1 + r % span;
+        CardInfo ci;
+        if (lookup_card_base(key, &ci, NULL) == LOOKUP_NOT_FOUND) {
+            *out = key;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct LookupBenchResult {
+    int64_t total_us;
+    int64_t max_us;
+    uint64_t bytes;
+    int found;
+};
+
+static void print_lookup_bench(const char* name, const LookupBenchResult* r, int n) {
+    printf("  %-22s avg: %5lld мкс | max: %5lld мкс | %6llu байт/поиск | найдено %d/%d\n",
+           name, (long long)(r->total_us / n), (long long)r->max_us,
+           (unsigned long long)(r->bytes / n), r->found, n);
+}
+
+void bench_block_index() {
+    printf("\n⏱️  === BENCH: поиск с разреженным индексом блоков ===\n");
+    card_cache_set_enabled(false);
+    card_filter_set_enabled(false);
+
+    uint64_t* keys = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    if (!keys) {
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool hits = (pass == 0);
+        int n = 0;
+        while (n < BENCH_LOOKUPS) {
+            uint64_t key;
+            if (!pick_existing_card(&key)) break;
+            keys[n++] = hits ? key : key + 1;  // key + 1 - почти всегда промах
+        }
+        if (n == 0) {
+            printf("❌ База данных недоступна\n");
+            break;
+        }
+
+        LookupBenchResult full = {}, block = {};
+        for (int i = 0; i < n; i++) {
+            CardInfo ci;
+            uint32_t bytes;
+            int64_t t0 = esp_timer_get_time();
+            LookupResult res = lookup_full_file(keys[i], &ci, &bytes);
+            int64_t dt = esp_timer_get_time() - t0;
+            full.total_us += dt;
+            if (dt > full.max_us) full.max_us = dt;
+            full.bytes += bytes;
+            if (res == LOOKUP_FOUND) full.found++;
+
+            LookupInfo info;
+            t0 = esp_timer_get_time();
+            res = lookup_card(keys[i], &ci, &info);
+            dt = esp_timer_get_time() - t0;
+            block.total_us += dt;
+            if (dt > block.max_us) block.max_us = dt;
+            block.bytes += info.bytes_read;
+            if (res == LOOKUP_FOUND) block.found++;
+        }
+
+        printf(" %s:\n", hits ? "Попадания" : "Промахи");
+        print_lookup_bench("full file (before)", &full, n);
+        print_lookup_bench("block index (after)", &block, n);
+    }
+
+    card_cache_set_enabled(true);
+    card_filter_set_enabled(true);
+    free(keys);
+}
+
+// ==========================================
+// ЗАМЕР: ФИЛЬТР ОТРИЦАТЕЛЬНЫХ ПОИСКОВ
+// ==========================================
+
+void bench_card_filter() {
+    printf("\n⏱️  === BENCH: фильтр Блума перед базой ===\n");
+    if (!card_filter_ready()) {
+        printf("❌ Фильтр не готов\n");
+        return;
+    }
+    print_card_filter_info();
+    card_cache_set_enabled(false);
+
+    // Промахи рядом с существующими ключами - худший случай: диапазон файла
+    // совпадает, без фильтра поиск доходит до флеша
+    uint64_t* keys = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    if (!keys) {
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    int n = 0;
+    while (n < BENCH_LOOKUPS) {
+        uint64_t key;
+        if (!pick_existing_card(&key)) break;
+        CardInfo ci;
+        card_filter_set_enabled(false);
+        bool absent = lookup_card(key + 1, &ci, NULL) == LOOKUP_NOT_FOUND;
+        card_filter_set_enabled(true);
+        if (absent) keys[n++] = key + 1;
+    }
+    if (n == 0) {
+        free(keys);
+        card_cache_set_enabled(true);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+
+    int false_positives = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < n; i++) {
+        if (card_filter_may_contain(keys[i])) false_positives++;
+    }
+    int64_t t_check = esp_timer_get_time() - t0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool with_filter = (pass == 1);
+        card_filter_set_enabled(with_filter);
+        LookupBenchResult r = {};
+        for (int i = 0; i < n; i++) {
+            CardInfo ci;
+            LookupInfo info;
+            t0 = esp_timer_get_time();
+            lookup_card(keys[i], &ci, &info);
+            int64_t dt = esp_timer_get_time() - t0;
+            r.total_us += dt;
+            if (dt > r.max_us) r.max_us = dt;
+            r.bytes += info.bytes_read;
+        }
+        print_lookup_bench(with_filter ? "miss, filter on" : "miss, filter off", &r, n);
+    }
+    card_filter_set_enabled(true);
+    card_cache_set_enabled(true);
+
+    printf("  Проверка фильтра: %llu нс/оп | ложных срабатываний: %d/%d (%.2f%%)\n",
+           (unsigned long long)(t_check * 1000 / n), false_positives, n,
+           100.0 * false_positives / n);
+    free(keys);
+}
+
+// ==========================================
+// ЗАМЕР: КЕШ ПОСЛЕДНИХ РЕШЕНИЙ
+// ==========================================
+
+#define BENCH_CACHE_WORKING_SET 24
+
+void bench_card_cache() {
+    printf("\n⏱️  === BENCH: кеш последних решений ===\n");
+
+    // Рабочий набор: одни и те же карты предъявляются многократно,
+    // половина - незнакомые карты (отрицательные записи)
+    uint64_t working_set[BENCH_CACHE_WORKING_SET];
+    for (int i = 0; i < BENCH_CACHE_WORKING_SET; i++) {
+        if (!pick_existing_card(&working_set[i])) {
+            printf("❌ База данных недоступна\n");
+            return;
+        }
+        if (i % 2) working_set[i] += 1;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool with_cache = (pass == 1);
+        card_cache_set_enabled(with_cache);
+        CardCacheStats before;
+        get_card_cache_stats(&before);
+
+        LookupBenchResult r = {};
+        for (int i = 0; i < BENCH_LOOKUPS; i++) {
+            CardInfo ci;
+            LookupInfo info;
+            int64_t t0 = esp_timer_get_time();
+            LookupResult res = lookup_card(working_set[esp_random() % BENCH_CACHE_WORKING_SET], &ci, &info);
+            int64_t dt = esp_timer_get_time() - t0;
+            r.total_us += dt;
+            if (dt > r.max_us) r.max_us = dt;
+            r.bytes += info.bytes_read;
+            if (res == LOOKUP_FOUND) r.found++;
+        }
+        print_lookup_bench(with_cache ? "repeat, cache on" : "repeat, cache off", &r, BENCH_LOOKUPS);
+
+        if (with_cache) {
+            CardCacheStats after;
+            get_card_cache_stats(&after);
+            printf("  Кеш: попаданий %lu | отрицательных %lu | промахов %lu\n",
+                   (unsigned long)(after.hits - before.hits),
+                   (unsigned long)(after.negative_hits - before.negative_hits),
+                   (unsigned long)(after.misses - before.misses));
+        }
+    }
+    card_cache_set_enabled(true);
+}
+
+// ==========================================
+// ЗАМЕР: SPIFFS vs ОТОБРАЖЕННЫЙ РАЗДЕЛ
+// ==========================================
+
+void bench_storage_backends() {
+    printf("\n⏱️  === BENCH: бэкенды хранения (SPIFFS vs mmap раздела) ===\n");
+
+    uint64_t* keys = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    if (!keys) {
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    int n = 0;
+    while (n < BENCH_LOOKUPS && pick_existing_card(&keys[n])) n++;
+    if (n == 0) {
+        free(keys);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+
+    const CardStorageBackend initial = card_storage()->backend;
+    card_cache_set_enabled(false);
+    card_filter_set_enabled(false);
+
+    static const CardStorageBackend backends[] = {CARD_STORAGE_SPIFFS, CARD_STORAGE_PARTITION};
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (!card_storage_select(backends[b])) {
+            printf("  %-22s недоступен (нет раздела или образа)\n",
+                   backends[b] == CARD_STORAGE_SPIFFS ? "spiffs" : "partition");
+            continue;
+        }
+        LookupBenchResult r = {};
+        for (int i = 0; i < n; i++) {
+            CardInfo ci;
+            LookupInfo info;
+            int64_t t0 = esp_timer_get_time();
+            LookupResult res = lookup_card(keys[i], &ci, &info);
+            int64_t dt = esp_timer_get_time() - t0;
+            r.total_us += dt;
+            if (dt > r.max_us) r.max_us = dt;
+            r.bytes += info.bytes_read;
+            if (res == LOOKUP_FOUND) r.found++;
+        }
+        print_lookup_bench(card_storage()->name, &r, n);
+    }
+
+    card_storage_select(initial);
+    card_cache_set_enabled(true);
+    card_filter_set_enabled(true);
+    free(keys);
+}
+
+// ==========================================
+// ЗАМЕР: ЖУРНАЛ ИЗМЕНЕНИЙ И УПЛОТНЕНИЕ
+// ==========================================
+
+#define BENCH_DELTA_CARDS 48
+
+static void bench_lookup_keys(const uint64_t* keys, int n, LookupBenchResult* r) {
+    for (int i = 0; i < n; i++) {
+        CardInfo ci;
+        LookupInfo info;
+        int64_t t0 = esp_timer_get_time();
+        LookupResult res = lookup_card(keys[i], &ci, &info);
+        int64_t dt = esp_timer_get_time() - t0;
+        r->total_us += dt;
+        if (dt > r->max_us) r->max_us = dt;
+        r->bytes += info.bytes_read;
+        if (res == LOOKUP_FOUND) r->found++;
+    }
+}
+
+void bench_delta_log() {
+    printf("\n⏱️  === BENCH: журнал изменений и фоновое уплотнение ===\n");
+
+    // Новые карты - соседи существующих ключей, которых еще нет в базе
+    uint64_t added[BENCH_DELTA_CARDS];
+    int n_added = 0;
+    for (int tries = 0; tries < BENCH_DELTA_CARDS * 4 && n_added < BENCH_DELTA_CARDS; tries++) {
+        uint64_t key;
+        CardInfo ci;
+        if (!pick_existing_card(&key)) break;
+        if (lookup_card(key + 1, &ci, NULL) == LOOKUP_FOUND) continue;
+        added[n_added++] = key + 1;
+    }
+    uint64_t* keys = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    int n = 0;
+    while (keys && n < BENCH_LOOKUPS && pick_existing_card(&keys[n])) n++;
+    if (n_added == 0 || n == 0) {
+        free(keys);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+
+    CompactionStats before;
+    get_compaction_stats(&before);
+
+    // 1. Запись в журнал (карты заблокированы, чтобы не открыть доступ)
+    int64_t put_max = 0;
+    int64_t t_start = esp_timer_get_time();
+    for (int i = 0; i < n_added; i++) {
+        CardInfo ci = {added[i], 0, 0, 0, 0};
+        int64_t t0 = esp_timer_get_time();
+        card_db_put(&ci);
+        int64_t dt = esp_timer_get_time() - t0;
+        if (dt > put_max) put_max = dt;
+    }
+    printf("  %-22s avg: %5lld мкс | max: %5lld мкс\n", "delta put",
+           (long long)((esp_timer_get_time() - t_start) / n_added), (long long)put_max);
+
+    // 2. Поиск: простой против фонового уплотнения
+    card_cache_set_enabled(false);
+    LookupBenchResult idle = {};
+    bench_lookup_keys(keys, n, &idle);
+    print_lookup_bench("lookup, idle", &idle, n);
+
+    card_db_request_compaction();
+    LookupBenchResult busy = {};
+    int busy_n = 0;
+    CompactionStats progress = before;
+    for (int wait = 0; wait < 1000 && !card_db_compaction_running() && progress.runs == before.runs; wait++) {
+        vTaskDelay(1);
+        get_compaction_stats(&progress);
+    }
+    while (card_db_compaction_running()) {
+        int chunk = n < 16 ? n : 16;
+        bench_lookup_keys(keys + (busy_n % (n - chunk + 1)), chunk, &busy);
+        busy_n += chunk;
+        vTaskDelay(1);
+    }
+    if (busy_n > 0) print_lookup_bench("lookup, compacting", &busy, busy_n);
+
+    // Добавленные карты должны пережить уплотнение
+    int survived = 0;
+    for (int i = 0; i < n_added; i++) {
+        CardInfo ci;
+        if (lookup_card_base(added[i], &ci, NULL) == LOOKUP_FOUND) survived++;
+    }
+    printf("  После уплотнения в файлах: %d/%d новых карт\n", survived, n_added);
+
+    CompactionStats after;
+    get_compaction_stats(&after);
+    uint32_t mutations = after.mutations - before.mutations;
+    uint64_t written = (after.log_bytes - before.log_bytes) + (after.compaction_bytes - before.compaction_bytes);
+    printf("  Усиление записи: %llu байт на %lu изменений = %.1fx | уплотнение %lu мс\n",
+           (unsigned long long)written, (unsigned long)mutations,
+           (double)written / (double)(mutations * ((RECORD_BITS + 7) / 8)),
+           (unsigned long)after.last_duration_ms);
+
+    // 3. Возвращаем базу в исходное состояние
+    for (int i = 0; i < n_added; i++) card_db_delete(added[i]);
+    card_db_compact();
+    card_cache_set_enabled(true);
+    free(keys);
+}
+
+// ==========================================
+// ЗАМЕР: СЧЕТЧИКИ ИСПОЛЬЗОВАНИЯ
+// ==========================================
+
+#define BENCH_USAGE_CARDS 100
+#define BENCH_USAGE_SWIPES 1000
+#define BENCH_USAGE_FLUSH_EVERY 100   // предъявлений между сбросами (вместо таймера)
+#define BENCH_DELTA_RECORD_BYTES 16   // запись delta.log (card_db.cpp)
+
+// Сверка счетчиков lookup_card (или только файлов) с ожидаемыми
+static int usage_mismatches(const uint64_t* keys, const uint8_t* expect, int n, bool base_only) {
+    int bad = 0;
+    for (int i = 0; i < n; i++) {
+        CardInfo ci;
+        LookupResult res = base_only ? lookup_card_base(keys[i], &ci, NULL) : lookup_card(keys[i], &ci, NULL);
+        if (res != LOOKUP_FOUND || ci.count != expect[i]) bad++;
+    }
+    return bad;
+}
+
+void bench_usage_counters() {
+    printf("\n⏱️  === BENCH: счетчики использования (RAM + usage.log + слияние) ===\n");
+    uint64_t keys[BENCH_USAGE_CARDS];
+    uint8_t expect[BENCH_USAGE_CARDS];
+    int n = 0;
+    for (int tries = 0; tries < BENCH_USAGE_CARDS * 4 && n < BENCH_USAGE_CARDS; tries++) {
+        CardInfo ci;
+        if (!pick_existing_card(&keys[n]) || lookup_card(keys[n], &ci, NULL) != LOOKUP_FOUND) break;
+        bool dup = false;
+        for (int j = 0; j < n && !dup; j++) dup = keys[j] == keys[n];
+        if (dup) continue;
+        expect[n++] = ci.count;
+    }
+    if (n == 0) {
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+
+    // 1. Поиск до предъявлений: обращения к флешу (кеш выключен)
+    card_cache_set_enabled(false);
+    SearchStats s0, s1, s2, s3;
+    LookupBenchResult before = {}, with_usage = {};
+    get_search_stats(&s0);
+    bench_lookup_keys(keys, n, &before);
+    get_search_stats(&s1);
+
+    // 2. Предъявления: поиск + счетчик, сброс каждые BENCH_USAGE_FLUSH_EVERY
+    CardUsageStats u0, u1, u2;
+    CompactionStats c0, c1;
+    card_usage_flush();
+    get_card_usage_stats(&u0);
+    int64_t record_us = 0;
+    for (int i = 0; i < BENCH_USAGE_SWIPES; i++) {
+        int k = esp_random() % n;
+        CardInfo ci;
+        if (lookup_card(keys[k], &ci, NULL) != LOOKUP_FOUND) continue;
+        int64_t t0 = esp_timer_get_time();
+        card_usage_record(&ci);
+        record_us += esp_timer_get_time() - t0;
+        if (expect[k] < USAGE_COUNT_MAX) expect[k]++;
+        if ((i + 1) % BENCH_USAGE_FLUSH_EVERY == 0) card_usage_flush();
+    }
+    card_usage_flush();
+    get_card_usage_stats(&u1);
+
+    // 3. Поиск с накопленными счетчиками: столько же обращений к флешу
+    get_search_stats(&s2);
+    bench_lookup_keys(keys, n, &with_usage);
+    get_search_stats(&s3);
+    int bad_pending = usage_mismatches(keys, expect, n, false);
+    print_lookup_bench("lookup, no counters", &before, n);
+    print_lookup_bench("lookup, pending counts", &with_usage, n);
+    printf("  Обращений к SPIFFS: %lu -> %lu\n", (unsigned long)(s1.flash_reads - s0.flash_reads),
+           (unsigned long)(s3.flash_reads - s2.flash_reads));
+    printf("  card_usage_record: avg %lld мкс | насыщено %lu из %lu\n",
+           (long long)(record_us / BENCH_USAGE_SWIPES), (unsigned long)(u1.saturated - u0.saturated),
+           (unsigned long)(u1.swipes - u0.swipes));
+
+    // 4. Слияние в шарды (по запросу, как при переполнении журнала)
+    get_compaction_stats(&c0);
+    card_usage_request_merge();
+    card_db_compact();
+    get_compaction_stats(&c1);
+    get_card_usage_stats(&u2);
+    int bad_merged = usage_mismatches(keys, expect, n, false);
+    int bad_base = usage_mismatches(keys, expect, n, true);
+    card_cache_set_enabled(true);
+
+    uint64_t log_bytes = u1.log_bytes - u0.log_bytes;
+    uint64_t merge_bytes = (c1.compaction_bytes - c0.compaction_bytes) + (u2.log_bytes - u1.log_bytes);
+    uint64_t shard_bytes = 0;
+    for (int i = 0; i < get_shard_count(); i++) {
+        ShardInfo shard;
+        if (get_shard_info(i, &shard)) shard_bytes += shard.bytes;
+    }
+    if (get_shard_count() > 0) shard_bytes /= get_shard_count();
+    double per_k = 1000.0 / BENCH_USAGE_SWIPES;
+    printf("  На 1000 предъявлений: usage.log %.0f Б (%lu сбросов) + слияние %.0f Б | "
+           "перезапись шарда на каждое: %.0f Б | журнал изменений: %.0f Б + уплотнение\n",
+           log_bytes * per_k, (unsigned long)(u1.flushes - u0.flushes), merge_bytes * per_k,
+           (double)shard_bytes * 1000.0, (double)BENCH_DELTA_RECORD_BYTES * 1000.0);
+    printf("  Сверка счетчиков: до слияния %d, после %d, в файлах %d расхождений из %d\n",
+           bad_pending, bad_merged, bad_base, n);
+}
+
+// ==========================================
+// ЗАМЕР: ПОИСК ВО ВРЕМЯ ПОДМЕНЫ ПОКОЛЕНИЯ
+// ==========================================
+
+#define SWAP_BENCH_IDLE_MS 500
+
+// Читатель на ядре 1: поиск известных карт по кругу, счетчики по фазам
+// (0 - простой, 1 - перезапись базы)
+struct SwapBenchReader {
+    const uint64_t* keys;
+    const CardInfo* expect;
+    int n;
+    bool use_lock;           // прежняя схема: поиск под db_lock
+    volatile int phase;      // 2 - стоп
+    volatile bool done;
+    uint32_t lookups[2];
+    uint32_t errors[2];      // карта не найдена или запись не та
+    uint32_t max_us[2];
+};
+
+static void swap_bench_reader(void* arg) {
+    SwapBenchReader* r = (SwapBenchReader*)arg;
+    for (int i = 0; r->phase < 2; i++) {
+        int phase = r->phase;
+        const uint64_t key = r->keys[i % r->n];
+        const CardInfo* expect = &r->expect[i % r->n];
+        CardInfo ci;
+        int64_t t0 = esp_timer_get_time();
+        if (r->use_lock) db_lock();
+        LookupResult res = lookup_card_base(key, &ci, NULL);
+        if (r->use_lock) db_unlock();
+        uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+        if (res != LOOKUP_FOUND || ci.status != expect->status || ci.zones != expect->zones ||
+            ci.link != expect->link) {
+            r->errors[phase]++;
+        }
+        r->lookups[phase]++;
+        if (dt > r->max_us[phase]) r->max_us[phase] = dt;
+        if ((i & 63) == 63) taskYIELD();
+    }
+    r->done = true;
+    vTaskDelete(NULL);
+}
+
+// Перезапись всех шардов уплотнением (содержимое не меняется) при
+// непрерывном поиске с другого ядра
+static void run_swap_bench(const char* name, bool use_lock, const uint64_t* keys,
+                           const CardInfo* expect, int n) {
+    SwapBenchReader r;
+    memset(&r, 0, sizeof(r));
+    r.keys = keys;
+    r.expect = expect;
+    r.n = n;
+    r.use_lock = use_lock;
+    if (xTaskCreatePinnedToCore(swap_bench_reader, "swap_bench", 4096, &r, 1, NULL, 1) != pdPASS) {
+        printf("❌ Не удалось запустить читателя\n");
+        return;
+    }
+    int64_t t0 = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(SWAP_BENCH_IDLE_MS));
+    int64_t idle_us = esp_timer_get_time() - t0;
+
+    // По карте из каждого шарда в журнал - уплотнение перепишет все шарды
+    r.phase = 1;
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < get_shard_count(); i++) {
+        ShardInfo shard;
+        CardInfo ci;
+        if (get_shard_info(i, &shard) && lookup_card_base(shard.first_id, &ci, NULL) == LOOKUP_FOUND) {
+            card_db_put(&ci);
+        }
+    }
+    bool ok = card_db_compact();
+    int64_t rewrite_us = esp_timer_get_time() - t0;
+    r.phase = 2;
+    while (!r.done) vTaskDelay(1);
+
+    printf("  %-24s простой: %7.0f поисков/с, max %5lu мкс | перезапись %5lld мс: %7.0f поисков/с, "
+           "max %7lu мкс, ошибок %lu%s\n",
+           name, (double)r.lookups[0] * 1000000.0 / (double)idle_us, (unsigned long)r.max_us[0],
+           (long long)(rewrite_us / 1000), (double)r.lookups[1] * 1000000.0 / (double)rewrite_us,
+           (unsigned long)r.max_us[1], (unsigned long)(r.errors[0] + r.errors[1]),
+           ok ? "" : " (уплотнение не удалось)");
+}
+
+void bench_generation_swap() {
+    printf("\n⏱️  === BENCH: поиск во время перезаписи базы (поколения vs db_lock) ===\n");
+    uint64_t* keys = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    CardInfo* expect = (CardInfo*)malloc(BENCH_LOOKUPS * sizeof(CardInfo));
+    int n = 0;
+    while (keys && expect && n < BENCH_LOOKUPS && pick_existing_card(&keys[n])) {
+        if (lookup_card_base(keys[n], &expect[n], NULL) == LOOKUP_FOUND) n++;
+    }
+    if (n == 0) {
+        printf("❌ База данных недоступна\n");
+        free(keys);
+        free(expect);
+        return;
+    }
+
+    SearchStats before;
+    get_search_stats(&before);
+    run_swap_bench("db_lock (прежняя схема)", true, keys, expect, n);
+    run_swap_bench("закрепление поколения", false, keys, expect, n);
+    SearchStats after;
+    get_search_stats(&after);
+    printf("  Поколений опубликовано: %lu | ожиданий читателей: %lu (max %lu мкс)\n",
+           (unsigned long)(after.generations - before.generations),
+           (unsigned long)(after.reclaim_waits - before.reclaim_waits),
+           (unsigned long)after.reclaim_wait_max_us);
+    free(keys);
+    free(expect);
+}
+
+// ==========================================
+// ЗАМЕР: ПАКЕТНЫЙ ПОИСК
+// ==========================================
+
+#define BENCH_BATCH_CARDS 256
+
+void bench_batch_lookup() {
+    printf("\n⏱️  === BENCH: пакетный поиск (карт/с по размеру пакета) ===\n");
+
+    uint64_t* keys = (uint64_t*)malloc(BENCH_BATCH_CARDS * sizeof(uint64_t));
+    CardInfo* cards = (CardInfo*)malloc(BENCH_BATCH_CARDS * sizeof(CardInfo));
+    LookupResult* results = (LookupResult*)malloc(BENCH_BATCH_CARDS * sizeof(LookupResult));
+    int n = 0;
+    while (keys && n < BENCH_BATCH_CARDS && pick_existing_card(&keys[n])) n++;
+    if (!cards || !results || n < BENCH_BATCH_CARDS) {
+        free(keys);
+        free(cards);
+        free(results);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+    // Половина - промахи мимо фильтра (соседние ключи)
+    for (int i = 1; i < n; i += 2) keys[i] += 1;
+
+    const CardStorageBackend initial = card_storage()->backend;
+    card_cache_set_enabled(false);
+
+    static const CardStorageBackend backends[] = {CARD_STORAGE_SPIFFS, CARD_STORAGE_PARTITION};
+    static const int batch_sizes[] = {1, 4, 8, SEARCH_BATCH_MAX};
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (!card_storage_select(backends[b])) continue;
+        printf(" %s:\n", card_storage()->name);
+        for (size_t s = 0; s < sizeof(batch_sizes) / sizeof(batch_sizes[0]); s++) {
+            int batch = batch_sizes[s];
+            SearchStats before, after;
+            get_search_stats(&before);
+            size_t hits = 0;
+            int64_t t0 = esp_timer_get_time();
+            for (int i = 0; i + batch <= n; i += batch) {
+                hits += search_cards_batch(keys + i, batch, cards + i, results + i, NULL);
+            }
+            int64_t dt = esp_timer_get_time() - t0;
+            get_search_stats(&after);
+            printf("  batch %-16d %8.0f карт/с | %5.2f чтений/карту | %5llu байт/карту | найдено %u/%d\n",
+                   batch, dt > 0 ? (double)n * 1000000.0 / (double)dt : 0.0,
+                   (double)(after.flash_reads - before.flash_reads) / n,
+                   (unsigned long long)((after.bytes_read - before.bytes_read) / n),
+                   (unsigned)hits, n);
+        }
+    }
+
+    card_storage_select(initial);
+    card_cache_set_enabled(true);
+    free(keys);
+    free(cards);
+    free(results);
+}
+
+// ==========================================
+// НАБОР ЗАМЕРОВ ПОИСКА: ПЕРЦЕНТИЛИ
+// ==========================================
+
+#define BENCH_SUITE_LOOKUPS 1000
+
+struct LatencySamples {
+    uint32_t* us;
+    int count;
+    uint64_t bytes;
+    int found;
+    int64_t wall_us;
+};
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_latency_samples(const char* name, LatencySamples* r) {
+    if (r->count == 0) return;
+    qsort(r->us, r->count, sizeof(uint32_t), compare_u32);
+    uint32_t p50 = r->us[(r->count - 1) * 50 / 100];
+    uint32_t p99 = r->us[(r->count - 1) * 99 / 100];
+    printf("  %-14s p50: %4lu | p99: %5lu | max: %5lu мкс | %8.0f поиск/с | %4llu байт/поиск | найдено %d/%d\n",
+           name, (unsigned long)p50, (unsigned long)p99, (unsigned long)r->us[r->count - 1],
+           r->wall_us > 0 ? (double)r->count * 1000000.0 / (double)r->wall_us : 0.0,
+           (unsigned long long)(r->bytes / r->count), r->found, r->count);
+}
+
+static void run_latency_samples(const uint64_t* keys, int n, LatencySamples* r) {
+    int64_t wall = esp_timer_get_time();
+    for (int i = 0; i < n; i++) {
+        CardInfo ci;
+        LookupInfo info;
+        int64_t t0 = esp_timer_get_time();
+        LookupResult res = lookup_card(keys[i], &ci, &info);
+        r->us[r->count++] = (uint32_t)(esp_timer_get_time() - t0);
+        r->bytes += info.bytes_read;
+        if (res == LOOKUP_FOUND) r->found++;
+    }
+    r->wall_us = esp_timer_get_time() - wall;
+}
+
+void bench_lookup_suite() {
+    printf("\n⏱️  === BENCH: поиск по классам карт (%d поисков, база %lu записей, %s) ===\n",
+           BENCH_SUITE_LOOKUPS, (unsigned long)card_filter_key_count(), card_storage()->name);
+
+    uint64_t* keys = (uint64_t*)malloc(BENCH_SUITE_LOOKUPS * sizeof(uint64_t));
+    uint32_t* samples = (uint32_t*)malloc(BENCH_SUITE_LOOKUPS * sizeof(uint32_t));
+    if (!keys || !samples) {
+        free(keys);
+        free(samples);
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    card_cache_set_enabled(false);
+
+    static const char* classes[] = {"hit", "miss", "out of range"};
+    for (int c = 0; c < 3; c++) {
+        int n = 0;
+        while (n < BENCH_SUITE_LOOKUPS) {
+            uint64_t key;
+            if (c == 2) {
+                // Ниже первого ключа базы
+                ShardInfo first;
+                key = get_shard_info(0, &first) && first.first_id > 1 ? esp_random() % first.first_id : 0;
+            } else if (c == 1) {
+                if (!pick_absent_card(&key)) break;  // внутри диапазона, но мимо записи
+            } else {
+                if (!pick_existing_card(&key)) break;
+            }
+            keys[n++] = key;
+        }
+        if (n == 0) {
+            printf("❌ База данных недоступна\n");
+            break;
+        }
+        LatencySamples r = {samples, 0, 0, 0, 0};
+        run_latency_samples(keys, n, &r);
+        print_latency_samples(classes[c], &r);
+    }
+
+    card_cache_set_enabled(true);
+    free(keys);
+    free(samples);
+}
+
+// Двухуровневый индекс на синтетических базах 10k/100k/1M записей: шарды по
+// RECORDS_PER_FILE записей, внутри - границы блоков. С размером базы растет
+// только поиск в RAM; с флеша по-прежнему читается один блок. Настоящие
+// базы тех же размеров - на ПК: tools/host (lookup_suite_host).
+void bench_index_scaling() {
+    printf("\n⏱️  === BENCH: масштабирование индекса (синтетические базы) ===\n");
+    static const uint32_t sizes[] = {10000, 100000, 1000000};
+    const uint64_t stride = 25;  // средний шаг ключей генератора
+    const uint32_t shard_blocks = (RECORDS_PER_FILE + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t shard_total = (sizes[s] + RECORDS_PER_FILE - 1) / RECORDS_PER_FILE;
+        uint32_t blocks = shard_total * shard_blocks;
+        size_t index_bytes = (size_t)blocks * (sizeof(uint64_t) + sizeof(uint32_t)) +
+                             (size_t)shard_total * sizeof(uint64_t);
+        uint64_t* shard_first = (uint64_t*)malloc(shard_total * sizeof(uint64_t));
+        uint64_t* fences = (uint64_t*)malloc((size_t)blocks * sizeof(uint64_t));
+        if (!shard_first || !fences) {
+            printf("  %7lu записей: индекс %lu КБ не помещается в RAM - пропуск\n",
+                   (unsigned long)sizes[s], (unsigned long)(index_bytes / 1024));
+            free(shard_first);
+            free(fences);
+            continue;
+        }
+        for (uint32_t sh = 0; sh < shard_total; sh++) {
+            shard_first[sh] = (uint64_t)sh * RECORDS_PER_FILE * stride;
+            for (uint32_t b = 0; b < shard_blocks; b++) {
+                fences[sh * shard_blocks + b] = shard_first[sh] + (uint64_t)b * INDEX_BLOCK_RECORDS * stride;
+            }
+        }
+
+        volatile uint32_t sink = 0;
+        int64_t t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            uint64_t target = ((uint64_t)esp_random() % sizes[s]) * stride;
+            // 1. Шард
+            uint32_t left = 0, right = shard_total - 1;
+            while (left < right) {
+                uint32_t mid = left + (right - left + 1) / 2;
+                if (shard_first[mid] <= target) left = mid;
+                else right = mid - 1;
+            }
+            // 2. Блок внутри шарда
+            const uint64_t* shard_fences = fences + left * shard_blocks;
+            uint32_t lo = 0, hi = shard_blocks - 1;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo + 1) / 2;
+                if (shard_fences[mid] <= target) lo = mid;
+                else hi = mid - 1;
+            }
+            sink += lo;
+        }
+        int64_t dt = esp_timer_get_time() - t0;
+        printf("  %7lu записей: %4lu шардов | индекс %6lu байт RAM | %5lld нс/поиск блока | %8.0f поиск/с | флеш до %d байт/поиск\n",
+               (unsigned long)sizes[s], (unsigned long)shard_total, (unsigned long)index_bytes,
+               (long long)(dt * 1000 / BENCH_ITERATIONS),
+               dt > 0 ? (double)BENCH_ITERATIONS * 1000000.0 / (double)dt : 0.0,
+               (int)CARD_BLOCK_MAX_BYTES);
+        free(shard_first);
+        free(fences);
+    }
+}
+
+// ==========================================
+// ЗАМЕР: БАЗА ЦЕЛИКОМ В RAM (EYTZINGER) vs ПОИСК ПО ФЛЕШУ
+// ==========================================
+
+#define BENCH_TABLE_KEYS 1024
+
+static void run_table_lookups(const char* name, const uint64_t* keys, int n) {
+    int64_t total_us = 0, max_us = 0;
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        CardInfo ci;
+        int64_t t0 = esp_timer_get_time();
+        LookupResult res = lookup_card(keys[i], &ci, NULL);
+        int64_t dt = esp_timer_get_time() - t0;
+        total_us += dt;
+        if (dt > max_us) max_us = dt;
+        if (res == LOOKUP_FOUND) found++;
+    }
+    printf("  %-22s avg: %7lld нс | max: %5lld мкс | найдено %d/%d\n",
+           name, (long long)(total_us * 1000 / n), (long long)max_us, found, n);
+}
+
+// Синтетическая база: отсортированные карты, шаг ключей 1..49
+static CardInfo* make_sorted_cards(uint32_t records) {
+    CardInfo* cards = (CardInfo*)malloc((size_t)records * sizeof(CardInfo));
+    if (!cards) return NULL;
+    uint64_t key = 0x100000000ULL;
+    for (uint32_t i = 0; i < records; i++) {
+        random_card(&cards[i]);
+        key += 1 + esp_random() % 49;
+        cards[i].hex_id = key;
+    }
+    return cards;
+}
+
+// Путь "по флешу" без самого флеша: шарды в формате файлов данных лежат в
+// RAM (как в отображенном разделе), поиск - шард, граница блока, card_block_find
+struct EncodedShards {
+    uint32_t count;
+    uint32_t blocks_per_shard;
+    uint64_t* first_ids;
+    uint64_t* fences;
+    uint32_t* offsets;
+    uint8_t** files;
+    size_t bytes;
+};
+
+static void free_encoded_shards(EncodedShards* db) {
+    for (uint32_t i = 0; db->files && i < db->count; i++) free(db->files[i]);
+    free(db->files);
+    free(db->first_ids);
+    free(db->fences);
+    free(db->offsets);
+}
+
+static bool encode_shards(const CardInfo* cards, uint32_t records, EncodedShards* db) {
+    memset(db, 0, sizeof(*db));
+    db->count = (records + RECORDS_PER_FILE - 1) / RECORDS_PER_FILE;
+    db->blocks_per_shard = (RECORDS_PER_FILE + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+    size_t blocks = (size_t)db->count * db->blocks_per_shard;
+    db->first_ids = (uint64_t*)malloc(db->count * sizeof(uint64_t));
+    db->fences = (uint64_t*)calloc(blocks, sizeof(uint64_t));
+    db->offsets = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    db->files = (uint8_t**)calloc(db->count, sizeof(uint8_t*));
+    if (!db->first_ids || !db->fences || !db->offsets || !db->files) return false;
+    for (uint32_t sh = 0; sh < db->count; sh++) {
+        uint32_t first = sh * RECORDS_PER_FILE;
+        uint32_t n = records - first < RECORDS_PER_FILE ? records - first : RECORDS_PER_FILE;
+        uint8_t* file = (uint8_t*)malloc(card_file_max_bytes(n) + RECORD_READ_PAD);
+        if (!file) return false;
+        size_t size = card_file_encode(cards + first, n, file);
+        uint64_t last_id;
+        if (size == 0 || !card_file_index(file, size, db->offsets + sh * db->blocks_per_shard,
+                                           db->fences + sh * db->blocks_per_shard, &last_id)) {
+            free(file);
+            return false;
+        }
+        db->files[sh] = file;
+        db->first_ids[sh] = cards[first].hex_id;
+        db->bytes += size;
+    }
+    return true;
+}
+
+static bool encoded_shards_find(const EncodedShards* db, uint64_t target, CardInfo* out) {
+    if (target < db->first_ids[0]) return false;
+    uint32_t left = 0, right = db->count - 1;
+    while (left < right) {
+        uint32_t mid = left + (right - left + 1) / 2;
+        if (db->first_ids[mid] <= target) left = mid;
+        else right = mid - 1;
+    }
+    // Последний шард короче: лишние границы - нули, в поиск не попадают
+    const uint64_t* fences = db->fences + left * db->blocks_per_shard;
+    uint32_t lo = 0, hi = db->blocks_per_shard - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (fences[mid] != 0 && fences[mid] <= target) lo = mid;
+        else hi = mid - 1;
+    }
+    return card_block_find(db->files[left] + db->offsets[left * db->blocks_per_shard + lo], target, out) >= 0;
+}
+
+// Режим CARD_RAM_TABLE: память и время загрузки, поиск по живой базе
+// через SPIFFS, раздел и RAM; затем синтетические 10k/100k карт -
+// спуск Эйтцингера по массивам vs распаковка блока шарда из памяти.
+void bench_ram_table() {
+    printf("\n⏱️  === BENCH: база целиком в RAM (Эйтцингер) vs поиск по флешу ===\n");
+
+    // 1. Живая база
+    uint64_t* keys = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    if (!keys) {
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    int n = 0;
+    while (n < BENCH_LOOKUPS && pick_existing_card(&keys[n])) n++;
+    if (n > 0) {
+        uint32_t records = 0, load_us = 0;
+        size_t bytes = 0;
+        const bool had_table = get_ram_table_info(&records, &bytes, &load_us);
+        const CardStorageBackend initial = card_storage()->backend;
+        card_cache_set_enabled(false);
+        card_filter_set_enabled(false);
+
+        set_ram_table_enabled(false);
+        static const CardStorageBackend backends[] = {CARD_STORAGE_SPIFFS, CARD_STORAGE_PARTITION};
+        for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+            if (!card_storage_select(backends[b])) continue;
+            run_table_lookups(card_storage()->name, keys, n);
+        }
+        card_storage_select(initial);
+
+        if (set_ram_table_enabled(true) && get_ram_table_info(&records, &bytes, &load_us)) {
+            printf("  База в RAM: %lu записей | %lu байт (%.1f байт/запись) | загрузка %lu мс\n",
+                   (unsigned long)records, (unsigned long)bytes,
+                   records ? (double)bytes / records : 0.0, (unsigned long)(load_us / 1000));
+            run_table_lookups("ram", keys, n);
+        } else {
+            printf("  База в RAM: не хватило памяти\n");
+        }
+        set_ram_table_enabled(had_table);
+
+        card_cache_set_enabled(true);
+        card_filter_set_enabled(true);
+    } else {
+        printf("❌ База данных недоступна\n");
+    }
+    free(keys);
+
+    // 2. Синтетические базы: половина ключей есть, половина - соседи
+    static const uint32_t sizes[] = {10000, 100000};
+    uint64_t* probe = (uint64_t*)malloc(BENCH_TABLE_KEYS * sizeof(uint64_t));
+    if (!probe) return;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        CardInfo* cards = make_sorted_cards(sizes[s]);
+        CardTable* table = cards ? card_table_build(cards, sizes[s]) : NULL;
+        EncodedShards db;
+        bool encoded = cards && encode_shards(cards, sizes[s], &db);
+        if (!table || !encoded) {
+            printf("  %6lu карт: не помещается в RAM (%lu КБ таблица) - пропуск\n",
+                   (unsigned long)sizes[s], (unsigned long)(sizes[s] * 13 / 1024));
+            if (cards) free_encoded_shards(&db);
+            card_table_free(table);
+            free(cards);
+            continue;
+        }
+        for (int i = 0; i < BENCH_TABLE_KEYS; i++) {
+            probe[i] = cards[esp_random() % sizes[s]].hex_id + (i & 1);
+        }
+
+        int mismatches = 0;
+        for (int i = 0; i < BENCH_TABLE_KEYS; i++) {
+            CardInfo a, b;
+            bool in_table = card_table_lookup(table, probe[i], &a);
+            bool in_blocks = encoded_shards_find(&db, probe[i], &b);
+            if (in_table != in_blocks || (in_table && !card_equal(&a, &b))) mismatches++;
+        }
+
+        const int rounds = BENCH_ITERATIONS / BENCH_TABLE_KEYS;
+        volatile uint32_t sink = 0;
+        int64_t t0 = esp_timer_get_time();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < BENCH_TABLE_KEYS; i++) {
+                CardInfo ci;
+                sink += encoded_shards_find(&db, probe[i], &ci);
+            }
+        }
+        int64_t blocks_us = esp_timer_get_time() - t0;
+        t0 = esp_timer_get_time();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < BENCH_TABLE_KEYS; i++) {
+                CardInfo ci;
+                sink += card_table_lookup(table, probe[i], &ci);
+            }
+        }
+        int64_t table_us = esp_timer_get_time() - t0;
+        int lookups = rounds * BENCH_TABLE_KEYS;
+
+        printf("  %6lu карт: блоки %6lu байт, %5lld нс/поиск | RAM %7lu байт, сборка %4lu мс, %5lld нс/поиск | x%.1f | расхождений %d\n",
+               (unsigned long)sizes[s], (unsigned long)db.bytes, (long long)(blocks_us * 1000 / lookups),
+               (unsigned long)table->bytes, (unsigned long)(table->load_us / 1000),
+               (long long)(table_us * 1000 / lookups),
+               table_us > 0 ? (double)blocks_us / (double)table_us : 0.0, mismatches);
+
+        free_encoded_shards(&db);
+        card_table_free(table);
+        free(cards);
+    }
+    free(probe);
+}
+
+// ==========================================
+// ЗАМЕР: ХЕШ-ИНДЕКС НА ФЛЕШЕ vs ГРАНИЦЫ БЛОКОВ
+// ==========================================
+
+static void run_hash_bench(const char* name, const uint64_t* keys, int n) {
+    SearchStats before, after;
+    get_search_stats(&before);
+    LookupBenchResult r = {};
+    for (int i = 0; i < n; i++) {
+        CardInfo ci;
+        LookupInfo info;
+        int64_t t0 = esp_timer_get_time();
+        LookupResult res = lookup_card(keys[i], &ci, &info);
+        int64_t dt = esp_timer_get_time() - t0;
+        r.total_us += dt;
+        if (dt > r.max_us) r.max_us = dt;
+        r.bytes += info.bytes_read;
+        if (res == LOOKUP_FOUND) r.found++;
+    }
+    get_search_stats(&after);
+    printf("  %-30s avg: %5lld мкс | max: %5lld мкс | %4llu байт/поиск | чтений %.2f/поиск | найдено %d/%d\n",
+           name, (long long)(r.total_us / n), (long long)r.max_us, (unsigned long long)(r.bytes / n),
+           (double)(after.flash_reads - before.flash_reads) / n, r.found, n);
+}
+
+// Попадания и промахи (соседние ключи, которых нет в базе): границы блоков
+// в RAM vs корзина хеш-индекса, через SPIFFS и через раздел
+void bench_hash_index() {
+    printf("\n⏱️  === BENCH: хеш-индекс на флеше vs границы блоков ===\n");
+
+    uint64_t* hits = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    uint64_t* misses = (uint64_t*)malloc(BENCH_LOOKUPS * sizeof(uint64_t));
+    if (!hits || !misses) {
+        free(hits);
+        free(misses);
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    uint32_t buckets = 0, build_us = 0;
+    size_t hash_bytes = 0;
+    const bool had_hash = get_hash_index_info(&buckets, &hash_bytes, &build_us);
+    set_hash_index_enabled(false);
+    int n = 0, n_miss = 0;
+    while (n < BENCH_LOOKUPS && pick_existing_card(&hits[n])) {
+        CardInfo ci;
+        if (lookup_card_base(hits[n] + 1, &ci, NULL) != LOOKUP_FOUND) misses[n_miss++] = hits[n] + 1;
+        n++;
+    }
+    if (n == 0 || n_miss == 0) {
+        free(hits);
+        free(misses);
+        set_hash_index_enabled(had_hash);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+
+    // Память: границы и смещения блоков в RAM vs файл индекса на флеше
+    uint32_t blocks = 0;
+    for (int i = 0; i < get_shard_count(); i++) {
+        ShardInfo shard;
+        if (get_shard_info(i, &shard)) blocks += (shard.records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+    }
+    if (!set_hash_index_enabled(true)) {
+        printf("❌ Хеш-индекс не построен\n");
+        set_hash_index_enabled(had_hash);
+        free(hits);
+        free(misses);
+        return;
+    }
+    get_hash_index_info(&buckets, &hash_bytes, &build_us);
+    printf("  Границы блоков: %lu байт RAM | хеш-индекс: %lu корзин, %lu байт флеша, построен за %lu мс\n",
+           (unsigned long)(blocks * (sizeof(uint64_t) + sizeof(uint32_t))), (unsigned long)buckets,
+           (unsigned long)hash_bytes, (unsigned long)(build_us / 1000));
+
+    const CardStorageBackend initial = card_storage()->backend;
+    card_cache_set_enabled(false);
+    card_filter_set_enabled(false);
+    static const CardStorageBackend backends[] = {CARD_STORAGE_SPIFFS, CARD_STORAGE_PARTITION};
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (!card_storage_select(backends[b])) continue;
+        char name[64];
+        for (int mode = 0; mode < 2; mode++) {
+            set_hash_index_enabled(mode == 1);
+            const char* index = mode ? "хеш" : "границы";
+            snprintf(name, sizeof(name), "%s/%s попадания", card_storage()->name, index);
+            run_hash_bench(name, hits, n);
+            snprintf(name, sizeof(name), "%s/%s промахи", card_storage()->name, index);
+            run_hash_bench(name, misses, n_miss);
+        }
+    }
+    card_storage_select(initial);
+    card_cache_set_enabled(true);
+    card_filter_set_enabled(true);
+    set_hash_index_enabled(had_hash);
+    free(hits);
+    free(misses);
+}
+
+// ==========================================
+// ЗАМЕР: ОБХОД ВСЕЙ БАЗЫ
+// ==========================================
+
+#define BENCH_SCAN_ADDED 16        // новых карт в журнале изменений на время замера
+#define BENCH_SCAN_DELETED 4       // и отозванных из файлов
+#define BENCH_SCAN_LINK 65000      // у сгенерированных карт link < 60000
+#define BENCH_SCAN_LOOKUPS 500
+
+static bool bench_scan_match(const CardScanQuery* q, const CardInfo* ci) {
+    if (q->status_mask && !((q->status_mask >> ci->status) & 1)) return false;
+    if (q->zones_any && !(ci->zones & q->zones_any)) return false;
+    if (q->match_link && ci->link != q->link) return false;
+    return true;
+}
+
+static void bench_scan_account(const CardScanQuery* q, const CardInfo* ci, CardScanResult* r) {
+    r->scanned++;
+    if (!bench_scan_match(q, ci)) return;
+    r->matched++;
+    r->by_status[ci->status]++;
+    for (int z = 0; z < (int)CARD_ATTR_WIDTH(zones); z++) r->by_zone[z] += (ci->zones >> z) & 1;
+}
+
+// Эталон: шарды целиком (read_shard_cards), поверх - журнал изменений по одной карте
+static bool scan_reference(const CardScanQuery* q, const uint64_t* added, int n_added, CardScanResult* r) {
+    memset(r, 0, sizeof(*r));
+    int64_t t_start = esp_timer_get_time();
+    for (int s = 0; s < get_shard_count(); s++) {
+        ShardInfo shard;
+        if (!get_shard_info(s, &shard)) return false;
+        CardInfo* cards = read_shard_cards(&shard);
+        if (!cards) return false;
+        r->chunks++;
+        r->bytes_read += shard.bytes;
+        for (uint32_t i = 0; i < shard.records; i++) {
+            CardInfo ci;
+            DeltaLookupResult d = card_delta_lookup(cards[i].hex_id, &ci);
+            if (d != DELTA_DELETED) bench_scan_account(q, d == DELTA_FOUND ? &ci : &cards[i], r);
+        }
+        free(cards);
+    }
+    for (int i = 0; i < n_added; i++) {
+        CardInfo ci;
+        if (card_delta_lookup(added[i], &ci) == DELTA_FOUND) bench_scan_account(q, &ci, r);
+    }
+    r->duration_us = (uint32_t)(esp_timer_get_time() - t_start);
+    r->ok = true;
+    return true;
+}
+
+static bool scan_results_equal(const CardScanResult* a, const CardScanResult* b) {
+    return a->ok && b->ok && a->scanned == b->scanned && a->matched == b->matched &&
+           memcmp(a->by_status, b->by_status, sizeof(a->by_status)) == 0 &&
+           memcmp(a->by_zone, b->by_zone, sizeof(a->by_zone)) == 0;
+}
+
+static void count_scan_card(const CardInfo* ci, void* arg) {
+    (*(uint32_t*)arg)++;
+}
+
+static void print_scan_line(const char* name, const CardScanResult* r) {
+    printf("  %-24s %8.0f карт/с | %4lu мс | %3lu чтений, %6llu Б с флеша | подошло %lu/%lu\n", name,
+           r->duration_us ? (double)r->scanned * 1000000.0 / (double)r->duration_us : 0.0,
+           (unsigned long)(r->duration_us / 1000), (unsigned long)r->chunks,
+           (unsigned long long)r->bytes_read, (unsigned long)r->matched, (unsigned long)r->scanned);
+}
+
+// Поиск по ключам с паузой раз в 16 (как между предъявлениями); background -
+// все это время идет фоновый обход, закончившийся сразу запускается снова
+static void run_scan_latency(const uint64_t* keys, int n, bool background, const CardScanQuery* q,
+                             LatencySamples* r, uint32_t* scans) {
+    int64_t wall = esp_timer_get_time();
+    for (int i = 0; i < n; i++) {
+        if (background && !card_scan_running() && card_scan_start(q)) (*scans)++;
+        CardInfo ci;
+        LookupInfo info;
+        int64_t t0 = esp_timer_get_time();
+        LookupResult res = lookup_card(keys[i], &ci, &info);
+        r->us[r->count++] = (uint32_t)(esp_timer_get_time() - t0);
+        r->bytes += info.bytes_read;
+        if (res == LOOKUP_FOUND) r->found++;
+        if ((i & 15) == 15) vTaskDelay(1);
+    }
+    r->wall_us = esp_timer_get_time() - wall;
+}
+
+void bench_card_scan() {
+    printf("\n⏱️  === BENCH: обход всей базы (отчеты) и поиск во время обхода ===\n");
+
+    uint64_t* keys = (uint64_t*)malloc(BENCH_SCAN_LOOKUPS * sizeof(uint64_t));
+    uint32_t* samples = (uint32_t*)malloc(BENCH_SCAN_LOOKUPS * sizeof(uint32_t));
+    int n = 0;
+    while (keys && samples && n < BENCH_SCAN_LOOKUPS && pick_existing_card(&keys[n])) n++;
+    if (n == 0) {
+        free(keys);
+        free(samples);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+
+    // 1. Журнал изменений не пуст: новые карты с особой связью и отозванные
+    uint64_t added[BENCH_SCAN_ADDED];
+    CardInfo removed[BENCH_SCAN_DELETED];
+    int n_added = 0, n_removed = 0;
+    for (int tries = 0; tries < BENCH_SCAN_ADDED * 4 && n_added < BENCH_SCAN_ADDED; tries++) {
+        uint64_t key;
+        CardInfo ci;
+        if (!pick_existing_card(&key)) break;
+        if (lookup_card_record(key + 1, &ci, NULL) == LOOKUP_FOUND) continue;
+        CardInfo add = {key + 1, 0, 0, (uint8_t)(1u << (n_added % 8)), BENCH_SCAN_LINK};
+        if (card_db_put(&add)) added[n_added++] = key + 1;
+    }
+    for (int i = 0; i < BENCH_SCAN_DELETED; i++) {
+        if (lookup_card_record(keys[i], &removed[n_removed], NULL) == LOOKUP_FOUND &&
+            card_db_delete(keys[i])) {
+            n_removed++;
+        }
+    }
+    card_cache_set_enabled(false);
+
+    // 2. Сверка с эталоном: все карты, активные по зонам, карты одной связи
+    CardScanQuery queries[3];
+    memset(queries, 0, sizeof(queries));
+    queries[1].status_mask = 1u << 1;
+    queries[2].match_link = true;
+    queries[2].link = BENCH_SCAN_LINK;
+    uint32_t linked = 0;
+    queries[2].on_card = count_scan_card;
+    queries[2].arg = &linked;
+    int mismatches = 0;
+    CardScanResult ref = {}, got = {};
+    for (int i = 0; i < 3; i++) {
+        if (!scan_reference(&queries[i], added, n_added, &ref) || !card_scan_run(&queries[i], &got) ||
+            !scan_results_equal(&ref, &got)) {
+            mismatches++;
+        }
+    }
+    if (linked != (uint32_t)n_added || got.matched != (uint32_t)n_added) mismatches++;
+    printf("  Журнал изменений: +%d карт, -%d карт | сверка с эталоном: %s %d расхождений\n",
+           n_added, n_removed, mismatches == 0 ? "✅" : "❌", mismatches);
+
+    // 3. Пропускная способность: эталон (шард целиком) и порции по бэкендам
+    scan_reference(&queries[1], added, n_added, &ref);
+    print_scan_line("шарды целиком (эталон)", &ref);
+    const CardStorageBackend initial = card_storage()->backend;
+    static const CardStorageBackend backends[] = {CARD_STORAGE_SPIFFS, CARD_STORAGE_PARTITION};
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (!card_storage_select(backends[b])) continue;
+        char name[48];
+        snprintf(name, sizeof(name), "обход, %s", card_storage()->name);
+        card_scan_run(&queries[1], &got);
+        print_scan_line(name, &got);
+    }
+    card_storage_select(initial);
+    print_card_scan_result(&got);
+
+    // 4. Задержка поиска: простой vs фоновый обход
+    LatencySamples idle = {samples, 0, 0, 0, 0};
+    uint32_t scans = 0;
+    run_scan_latency(keys, n, false, &queries[1], &idle, &scans);
+    print_latency_samples("idle", &idle);
+    LatencySamples busy = {samples, 0, 0, 0, 0};
+    run_scan_latency(keys, n, true, &queries[1], &busy, &scans);
+    print_latency_samples("во время обхода", &busy);
+    while (card_scan_running()) vTaskDelay(1);
+    if (card_scan_result(&got)) {
+        printf("  Фоновых обходов: %lu, последний %lu мс (%s)\n", (unsigned long)scans,
+               (unsigned long)(got.duration_us / 1000),
+               got.ok && got.scanned == ref.scanned ? "все карты" : "❌ не все карты");
+    }
+
+    // 5. Возвращаем базу в исходное состояние
+    for (int i = 0; i < n_added; i++) card_db_delete(added[i]);
+    for (int i = 0; i < n_removed; i++) card_db_put(&removed[i]);
+    card_db_compact();
+    card_cache_set_enabled(true);
+    free(keys);
+    free(samples);
+}
+
+// ==========================================
+// ЗАМЕР: ЗАГРУЗКА ИНДЕКСА (МАНИФЕСТ vs ОБХОД ФАЙЛОВ)
+// ==========================================
+
+void bench_manifest_boot() {
+    printf("\n⏱️  === BENCH: загрузка индекса при старте ===\n");
+    int shards = get_shard_count();
+    uint64_t data_bytes = 0;
+    uint32_t records = 0;
+    for (int i = 0; i < shards; i++) {
+        ShardInfo shard;
+        get_shard_info(i, &shard);
+        records += shard.records;
+        data_bytes += shard.bytes;
+    }
+    uint32_t blocks = (records + (uint32_t)shards * (INDEX_BLOCK_RECORDS - 1)) / INDEX_BLOCK_RECORDS;
+
+    // Обход файлов: читаются все шарды, манифест перезаписывается
+    db_lock();
+    int64_t t0 = esp_timer_get_time();
+    rebuild_manifest();
+    int64_t scan_us = esp_timer_get_time() - t0;
+    db_unlock();
+
+    // Манифест: одно чтение (фильтр уже загружен и не перечитывается)
+    db_lock();
+    t0 = esp_timer_get_time();
+    load_indices();
+    int64_t manifest_us = esp_timer_get_time() - t0;
+    db_unlock();
+
+    printf("  База: %lu записей в %d шардах\n", (unsigned long)records, shards);
+    printf("  %-22s %7lld мкс | %7llu байт прочитано\n", "scan data files",
+           (long long)scan_us, (unsigned long long)data_bytes);
+    struct stat st;
+    long manifest_bytes = stat(MOUNT_POINT "/manifest.bin", &st) == 0 ? (long)st.st_size : -1;
+    printf("  %-22s %7lld мкс | %7ld байт прочитано (1 чтение, %lu границ блоков)\n", "manifest",
+           (long long)manifest_us, manifest_bytes, (unsigned long)blocks);
+}
+
+// ==========================================
+// ЗАМЕР: ФОРМАТ ФАЙЛА ШАРДА (v1 vs v2)
+// ==========================================
+#define BENCH_FORMAT_V1_FILE MOUNT_POINT "/bench_v1.bin"
+#define BENCH_FORMAT_V2_FILE MOUNT_POINT "/bench_v2.bin"
+
+// Поиск в блоке версии 1: бинарный поиск по 86-битным записям
+static int find_in_block_v1(const uint8_t* block, int block_records, uint64_t target_hex, CardInfo* out) {
+    int left = 0, right = block_records - 1;
+    while (left <= right) {
+        int mid = left + (right - left) / 2;
+        uint64_t mid_id = get_card_id_from_buffer(block, mid);
+        if (mid_id == target_hex) {
+            get_card_from_buffer(block, mid, out);
+            return mid;
+        }
+        if (mid_id < target_hex) left = mid + 1;
+        else right = mid - 1;
+    }
+    return -1;
+}
+
+static int find_fence(const uint64_t* fences, int blocks, uint64_t target_hex) {
+    int left = 0, right = blocks - 1;
+    while (left < right) {
+        int mid = left + (right - left + 1) / 2;
+        if (fences[mid] <= target_hex) left = mid;
+        else right = mid - 1;
+    }
+    return left;
+}
+
+static bool write_bench_file(const char* fname, const uint8_t* data, size_t bytes) {
+    FILE* fd = fopen(fname, "wb");
+    bool ok = fd && fwrite(data, 1, bytes, fd) == bytes;
+    if (fd) fclose(fd);
+    return ok;
+}
+
+// Одно чтение блока с SPIFFS, как в бэкенде spiffs
+static size_t read_bench_block(const char* fname, uint32_t offset, uint8_t* dst, size_t len) {
+    FILE* fd = fopen(fname, "rb");
+    if (!fd) return 0;
+    size_t got = fseek(fd, (long)offset, SEEK_SET) == 0 ? fread(dst, 1, len, fd) : 0;
+    fclose(fd);
+    return got;
+}
+
+void bench_block_format() {
+    printf("\n⏱️  === BENCH: формат файла шарда (86 бит/запись vs дельты ключей) ===\n");
+
+    // 1. Размер базы в обоих форматах и емкость раздела spiffs
+    uint64_t records = 0, v1_bytes = 0, v2_bytes = 0;
+    for (int i = 0; i < get_shard_count(); i++) {
+        ShardInfo shard;
+        get_shard_info(i, &shard);
+        records += shard.records;
+        v1_bytes += ((uint64_t)shard.records * RECORD_BITS + 7) / 8;
+        v2_bytes += shard.bytes;
+    }
+    if (records == 0) {
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+    size_t fs_total = 0, fs_used = 0;
+    esp_spiffs_info(NULL, &fs_total, &fs_used);
+    double v1_bits = (double)v1_bytes * 8.0 / (double)records;
+    double v2_bits = (double)v2_bytes * 8.0 / (double)records;
+    printf("  База: %llu записей\n", (unsigned long long)records);
+    printf("  %-10s %8llu байт | %5.1f бит/запись | в %u КБ spiffs: ~%lu записей\n", "v1 (86 бит)",
+           (unsigned long long)v1_bytes, v1_bits, (unsigned)(fs_total / 1024),
+           (unsigned long)((double)fs_total * 8.0 / v1_bits));
+    printf("  %-10s %8llu байт | %5.1f бит/запись | в %u КБ spiffs: ~%lu записей (%.2fx)\n", "v2 (дельты)",
+           (unsigned long long)v2_bytes, v2_bits, (unsigned)(fs_total / 1024),
+           (unsigned long)((double)fs_total * 8.0 / v2_bits), v1_bits / v2_bits);
+
+    // 2. Один шард в обоих форматах: в RAM и в файлах на SPIFFS
+    ShardInfo shard;
+    get_shard_info(0, &shard);
+    const int n = (int)shard.records;
+    const int blocks = (n + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+    CardInfo* cards = read_shard_cards(&shard);
+    size_t v1_size = ((size_t)n * RECORD_BITS + 7) / 8;
+    uint8_t* v1 = (uint8_t*)calloc(1, v1_size + RECORD_READ_PAD);
+    uint8_t* v2 = (uint8_t*)malloc(card_file_max_bytes(n) + RECORD_READ_PAD);
+    uint64_t* fences = (uint64_t*)malloc(blocks * sizeof(uint64_t));
+    uint32_t* offsets = (uint32_t*)malloc((blocks + 1) * sizeof(uint32_t));
+    uint64_t* keys = (uint64_t*)malloc(BENCH_ITERATIONS * sizeof(uint64_t));
+    if (!cards || !v1 || !v2 || !fences || !offsets || !keys) {
+        printf("❌ Ошибка выделения памяти\n");
+        free(cards);
+        free(v1);
+        free(v2);
+        free(fences);
+        free(offsets);
+        free(keys);
+        return;
+    }
+    for (int r = 0; r < n; r++) put_card_to_buffer(v1, r, &cards[r]);
+    size_t v2_size = card_file_encode(cards, n, v2);
+    uint64_t last_id = 0;
+    bool indexed = v2_size > 0 && card_file_index(v2, v2_size, offsets, fences, &last_id);
+    offsets[blocks] = (uint32_t)v2_size;
+    // Половина ключей есть в шарде, половина - соседние промахи
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint64_t key = cards[esp_random() % n].hex_id;
+        keys[i] = (i & 1) ? key + 1 : key;
+    }
+
+    // 3. Разбор блока в RAM (блок уже найден по границам)
+    volatile uint32_t sink = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        int b = find_fence(fences, blocks, keys[i]);
+        int in_block = n - b * INDEX_BLOCK_RECORDS;
+        if (in_block > INDEX_BLOCK_RECORDS) in_block = INDEX_BLOCK_RECORDS;
+        CardInfo ci;
+        const uint8_t* block = v1 + (size_t)b * INDEX_BLOCK_RECORDS * RECORD_BITS / 8;
+        sink += find_in_block_v1(block, in_block, keys[i], &ci) + 1;
+    }
+    int64_t v1_ram_us = esp_timer_get_time() - t0;
+    uint32_t v1_sum = sink;
+
+    sink = 0;
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        int b = find_fence(fences, blocks, keys[i]);
+        CardInfo ci;
+        sink += card_block_find(v2 + offsets[b], keys[i], &ci) + 1;
+    }
+    int64_t v2_ram_us = esp_timer_get_time() - t0;
+    uint32_t v2_sum = sink;
+    printf("  Разбор блока в RAM: v1 %lld нс | v2 %lld нс на поиск%s\n",
+           (long long)(v1_ram_us * 1000 / BENCH_ITERATIONS), (long long)(v2_ram_us * 1000 / BENCH_ITERATIONS),
+           indexed && v1_sum == v2_sum ? "" : " - ❌ РЕЗУЛЬТАТЫ РАСХОДЯТСЯ");
+
+    // 4. Чтение блока с флеша + разбор
+    bool files_ok = write_bench_file(BENCH_FORMAT_V1_FILE, v1, v1_size) &&
+                    write_bench_file(BENCH_FORMAT_V2_FILE, v2, v2_size);
+    uint8_t block_buf[CARD_BLOCK_MAX_BYTES + RECORD_READ_PAD];
+    LookupBenchResult r1 = {}, r2 = {};
+    for (int i = 0; files_ok && i < BENCH_LOOKUPS; i++) {
+        int b = find_fence(fences, blocks, keys[i]);
+        int in_block = n - b * INDEX_BLOCK_RECORDS;
+        if (in_block > INDEX_BLOCK_RECORDS) in_block = INDEX_BLOCK_RECORDS;
+        CardInfo ci;
+
+        t0 = esp_timer_get_time();
+        size_t got = read_bench_block(BENCH_FORMAT_V1_FILE, (uint32_t)b * INDEX_BLOCK_RECORDS * RECORD_BITS / 8,
+                                      block_buf, ((size_t)in_block * RECORD_BITS + 7) / 8);
+        bool hit = find_in_block_v1(block_buf, in_block, keys[i], &ci) >= 0;
+        int64_t dt = esp_timer_get_time() - t0;
+        r1.total_us += dt;
+        if (dt > r1.max_us) r1.max_us = dt;
+        r1.bytes += got;
+        if (hit) r1.found++;
+
+        t0 = esp_timer_get_time();
+        got = read_bench_block(BENCH_FORMAT_V2_FILE, offsets[b], block_buf, offsets[b + 1] - offsets[b]);
+        hit = card_block_find(block_buf, keys[i], &ci) >= 0;
+        dt = esp_timer_get_time() - t0;
+        r2.total_us += dt;
+        if (dt > r2.max_us) r2.max_us = dt;
+        r2.bytes += got;
+        if (hit) r2.found++;
+    }
+    if (files_ok) {
+        printf("  Шард %d: %d записей, v1 %u байт, v2 %u байт (блок v1 %d байт, v2 в среднем %u)\n",
+               0, n, (unsigned)v1_size, (unsigned)v2_size, (INDEX_BLOCK_RECORDS * RECORD_BITS) / 8,
+               (unsigned)((v2_size - CARD_FILE_HEADER_BYTES) / blocks));
+        print_lookup_bench("spiffs block v1", &r1, BENCH_LOOKUPS);
+        print_lookup_bench("spiffs block v2", &r2, BENCH_LOOKUPS);
+    } else {
+        printf("❌ Не удалось записать файлы замера\n");
+    }
+    remove(BENCH_FORMAT_V1_FILE);
+    remove(BENCH_FORMAT_V2_FILE);
+
+    free(cards);
+    free(v1);
+    free(v2);
+    free(fences);
+    free(offsets);
+    free(keys);
+}
+
+// ==========================================
+// ЗАПУСК ВСЕХ ЗАМЕРОВ
+// ==========================================
+
+// ==========================================
+// ВОСПРОИЗВЕДЕНИЕ ИМПУЛЬСОВ WIEGAND
+// ==========================================
+#define REPLAY_FRAMES 500
+#define REPLAY_PULSE_US 50        // ширина импульса D0/D1
+#define REPLAY_INT_WAKE_US 15     // ISR + пробуждение задачи захвата (оценка)
+
+struct ReplayTrain {
+    uint64_t data[REPLAY_FRAMES];
+    uint8_t bits[REPLAY_FRAMES];
+    uint32_t start_us[REPLAY_FRAMES];
+    uint16_t interval_us[REPLAY_FRAMES];   // шаг между битами кадра
+};
+
+static uint32_t replay_edge_time(const ReplayTrain* t, int f, int b) {
+    return t->start_us[f] + (uint32_t)b * t->interval_us[f];
+}
+
+// Кадры 26/34/37/56/58 бит, биты через 1-2 мс, паузы между кадрами 30-100 мс
+static void make_replay_train(ReplayTrain* t) {
+    static const uint8_t lengths[] = {26, 34, 37, 56, 58};
+    uint32_t now = 1000;
+    for (int f = 0; f < REPLAY_FRAMES; f++) {
+        t->bits[f] = lengths[esp_random() % 5];
+        uint64_t v = ((uint64_t)esp_random() << 32) | esp_random();
+        t->data[f] = v & ((t->bits[f] >= 64) ? ~0ULL : ((1ULL << t->bits[f]) - 1));
+        t->interval_us[f] = 1000 + esp_random() % 1001;
+        t->start_us[f] = now;
+        now = replay_edge_time(t, f, t->bits[f] - 1) + 30000 + esp_random() % 70000;
+    }
+}
+
+static bool frame_matches(const ReplayTrain* t, int f, const WiegandFrame* got) {
+    return got->bits == t->bits[f] && got->lost_bits == 0 && got->data == t->data[f];
+}
+
+// Фронты через кольцо захвата в декодер. Читатель опаздывает: забирает
+// фронты пачками, а кадр завершает то по таймауту, то следующим фронтом.
+static void replay_through_ring(const ReplayTrain* t) {
+    WiegandDecoder dec;
+    wiegand_decoder_reset(&dec);
+    WiegandEdge e;
+    while (wiegand_edge_pop(&e)) {}
+
+    WiegandCaptureStats before;
+    get_wiegand_capture_stats(&before);
+
+    int frames_ok = 0, expected = 0;
+    uint32_t bits_total = 0, bits_ok = 0, edges = 0;
+    int64_t decode_us = 0;
+
+    for (int f = 0; f < REPLAY_FRAMES; f++) {
+        uint32_t batch = 1 + esp_random() % 32;
+        for (int b = 0; b < t->bits[f]; b++) {
+            uint8_t bit = (t->data[f] >> (t->bits[f] - 1 - b)) & 1;
+            wiegand_edge_push(replay_edge_time(t, f, b), 0, bit);
+            bits_total++;
+
+            if (wiegand_edge_pending() < batch && b != t->bits[f] - 1) continue;
+            int64_t t0 = esp_timer_get_time();
+            while (wiegand_edge_pop(&e)) {
+                WiegandFrame done;
+                edges++;
+                if (wiegand_decoder_feed(&dec, e.bit, e.time_us, &done)) {
+                    if (frame_matches(t, expected, &done)) { frames_ok++; bits_ok += done.bits; }
+                    expected++;
+                }
+            }
+            decode_us += esp_timer_get_time() - t0;
+        }
+
+        // Половину кадров закрывает таймаут, остальные - первый фронт следующего
+        if (esp_random() & 1 || f == REPLAY_FRAMES - 1) {
+            WiegandFrame done;
+            uint32_t now = replay_edge_time(t, f, t->bits[f] - 1) + WIEGAND_TIMEOUT_MS * 1000 + 1000;
+            if (wiegand_decoder_poll(&dec, now, &done)) {
+                if (frame_matches(t, expected, &done)) { frames_ok++; bits_ok += done.bits; }
+                expected++;
+            }
+        }
+    }
+
+    WiegandCaptureStats after;
+    get_wiegand_capture_stats(&after);
+    printf("  %-26s кадров %d/%d | бит %lu/%lu | переполнений %lu | %.0f нс/фронт\n",
+           "edge ring + decoder", frames_ok, REPLAY_FRAMES,
+           (unsigned long)bits_ok, (unsigned long)bits_total,
+           (unsigned long)(after.overflows - before.overflows),
+           edges ? (double)decode_us * 1000.0 / edges : 0.0);
+}
+
+// Опрос уровня линий с периодом period_us: импульс виден, только если
+// чтение попало в его 50 мкс
+static void replay_polling(const ReplayTrain* t, const char* name, uint32_t period_us) {
+    int frames_ok = 0;
+    uint32_t bits_total = 0, bits_seen = 0;
+    uint32_t phase = esp_random() % period_us;
+    for (int f = 0; f < REPLAY_FRAMES; f++) {
+        int seen = 0;
+        for (int b = 0; b < t->bits[f]; b++) {
+            int64_t te = replay_edge_time(t, f, b);
+            int64_t k = (te - phase + period_us - 1) / period_us;
+            int64_t sample = k * period_us + phase;
+            if (sample < te + REPLAY_PULSE_US) seen++;
+        }
+        bits_total += t->bits[f];
+        bits_seen += seen;
+        if (seen == t->bits[f]) frames_ok++;
+    }
+    printf("  %-26s кадров %d/%d | бит %lu/%lu\n", name, frames_ok, REPLAY_FRAMES,
+           (unsigned long)bits_seen, (unsigned long)bits_total);
+}
+
+// INT расширителя: порт фиксируется на ACK адресного байта чтения, то есть
+// через пробуждение + 10 тактов SCL после фронта. Не успели - фронт
+// записывается как потерянный и кадр отбрасывается, а не искажается.
+static void replay_pcf_int(const ReplayTrain* t, uint32_t scl_hz, uint32_t pulse_us) {
+    uint32_t latency_us = REPLAY_INT_WAKE_US + 10 * 1000000 / scl_hz;
+    bool seen = latency_us < pulse_us;
+    uint32_t bits_total = 0;
+    for (int f = 0; f < REPLAY_FRAMES; f++) bits_total += t->bits[f];
+    printf("  INT %3lu кГц, импульс %3lu мкс задержка чтения %3lu мкс: бит %lu/%lu, %s\n",
+           (unsigned long)(scl_hz / 1000), (unsigned long)pulse_us, (unsigned long)latency_us,
+           (unsigned long)(seen ? bits_total : 0), (unsigned long)bits_total,
+           seen ? "кадры целые" : "все фронты помечены потерянными");
+}
+
+void bench_wiegand_replay() {
+    printf("\n⏱️  === BENCH: воспроизведение импульсов Wiegand (%d кадров, импульс %d мкс, шаг 1-2 мс) ===\n",
+           REPLAY_FRAMES, REPLAY_PULSE_US);
+
+    ReplayTrain* t = (ReplayTrain*)malloc(sizeof(ReplayTrain));
+    if (!t) {
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    make_replay_train(t);
+
+    replay_through_ring(t);
+    replay_polling(t, "poll 5 ms + I2C (before)", 5000 + 200);
+    replay_polling(t, "poll 1 ms + I2C", 1000 + 200);
+    replay_pcf_int(t, 100000, REPLAY_PULSE_US);
+    replay_pcf_int(t, 400000, REPLAY_PULSE_US);
+    replay_pcf_int(t, 100000, 4 * REPLAY_PULSE_US);
+
+    free(t);
+}
+
+// ==========================================
+// РЕЕСТР ФОРМАТОВ: ЭТАЛОННЫЕ И ИСПОРЧЕННЫЕ КАДРЫ
+// ==========================================
+#define FORMAT_BENCH_ROUNDS 2000
+
+// Кадры с заведомо верной четностью, посчитанные вне прошивки по
+// спецификациям форматов, и ожидаемые поля
+struct FormatSample {
+    uint64_t data;
+    uint8_t bits;
+    uint64_t key;
+    uint64_t fields[WIEGAND_FORMAT_FIELDS];
+};
+
+static const FormatSample format_corpus[] = {
+    {0x2020002ULL, 26, 0x2020002ULL, {1, 1, 0}},
+    {0x2F764DDULL, 26, 0x2F764DDULL, {123, 45678, 0}},
+    {0x1FFFFFFULL, 26, 0x1FFFFFFULL, {255, 65535, 0}},
+    {0x0000001ULL, 26, 0x0000001ULL, {0, 0, 0}},
+    {0x200020002ULL, 34, 0x200020002ULL, {65537, 0, 0}},
+    {0x007D1A862ULL, 34, 0x007D1A862ULL, {65590321, 0, 0}},
+    {0x600200003ULL, 35, 0x600200003ULL, {1, 1, 0}},
+    {0x69A5154A4ULL, 35, 0x69A5154A4ULL, {1234, 567890, 0}},
+    {0x5FFFFFFFEULL, 35, 0x5FFFFFFFEULL, {4095, 1048575, 0}},
+#if WIEGAND_37BIT_H10304
+    {0x1000100002ULL, 37, 0x1000100002ULL, {1, 1, 0}},
+    {0x13039A8C9DULL, 37, 0x13039A8C9DULL, {12345, 345678, 0}},
+#else
+    {0x1000100002ULL, 37, 0x1000100002ULL, {524289, 0, 0}},
+    {0x13039A8C9DULL, 37, 0x13039A8C9DULL, {6472681038ULL, 0, 0}},
+#endif
+    {0x12345678ABCDEFULL, 56, 0x12345678ABCDEFULL, {0x12, 0x3456, 0x78ABCDEF}},
+#if WIEGAND_58BIT_PARITY
+    {0x2468ACF1579BDFULL, 58, 0x12345678ABCDEFULL, {0x12, 0x3456, 0x78ABCDEF}},
+#endif
+};
+#define FORMAT_CORPUS_SIZE ((int)(sizeof(format_corpus) / sizeof(format_corpus[0])))
+
+static bool format_has_parity(const WiegandFormat* f) {
+    for (int i = 0; i < WIEGAND_FORMAT_PARITIES; i++) {
+        if (f->parity[i].mask) return true;
+    }
+    return false;
+}
+
+void bench_wiegand_formats() {
+    printf("\n⏱️  === BENCH: реестр форматов Wiegand (%d форматов, %d эталонных кадров) ===\n",
+           wiegand_format_count(), FORMAT_CORPUS_SIZE);
+
+    WiegandCredential c;
+    int good_ok = 0, flips = 0, flips_rejected = 0;
+    for (int i = 0; i < FORMAT_CORPUS_SIZE; i++) {
+        const FormatSample* s = &format_corpus[i];
+        WiegandDecodeResult r = wiegand_decode(s->data, s->bits, &c);
+        bool ok = r == WIEGAND_DECODE_OK && c.key == s->key &&
+                  memcmp(c.fields, s->fields, sizeof(c.fields)) == 0;
+        if (ok) good_ok++;
+        else printf("  ❌ %d бит 0x%llX: %s\n", s->bits, (unsigned long long)s->data,
+                    wiegand_decode_result_name(r));
+
+        // Любой одиночный сбой бита должен ловиться четностью
+        if (!c.format || !format_has_parity(c.format)) continue;
+        for (int b = 0; b < s->bits; b++) {
+            flips++;
+            if (wiegand_decode(s->data ^ (1ULL << b), s->bits, &c) == WIEGAND_DECODE_BAD_PARITY) flips_rejected++;
+            else printf("  ❌ %d бит 0x%llX, бит %d: сбой не замечен\n", s->bits,
+                        (unsigned long long)s->data, b);
+        }
+    }
+
+    // Длины, которых нет в реестре (кадр оборван или склеен)
+    static const uint8_t bad_lengths[] = {0, 1, 8, 24, 25, 27, 32, 57, 59, 64};
+    int lengths_rejected = 0, lengths = 0;
+    for (unsigned i = 0; i < sizeof(bad_lengths); i++) {
+        if (wiegand_format_for_bits(bad_lengths[i])) continue;   // зарегистрирован на месте
+        lengths++;
+        if (wiegand_decode(0x2020002ULL, bad_lengths[i], &c) == WIEGAND_DECODE_UNKNOWN_LENGTH) lengths_rejected++;
+    }
+
+    printf("  эталонные кадры: %d/%d разобраны | сбои одного бита: %d/%d отброшены | чужие длины: %d/%d\n",
+           good_ok, FORMAT_CORPUS_SIZE, flips_rejected, flips, lengths_rejected, lengths);
+
+    volatile uint64_t sink = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int r = 0; r < FORMAT_BENCH_ROUNDS; r++) {
+        for (int i = 0; i < FORMAT_CORPUS_SIZE; i++) {
+            if (wiegand_decode(format_corpus[i].data, format_corpus[i].bits, &c) == WIEGAND_DECODE_OK) sink += c.key;
+        }
+    }
+    int64_t elapsed = esp_timer_get_time() - t0;
+    (void)sink;
+    printf("  разбор: %.0f нс/кадр\n", (double)elapsed * 1000.0 / (FORMAT_BENCH_ROUNDS * FORMAT_CORPUS_SIZE));
+    printf("  %s\n", (good_ok == FORMAT_CORPUS_SIZE && flips_rejected == flips && lengths_rejected == lengths)
+                        ? "✅ корпус пройден" : "❌ корпус НЕ пройден");
+}
+
+// ==========================================
+// ОПРОС РАСШИРИТЕЛЕЙ ПО I2C
+// ==========================================
+#define I2C_BENCH_SWEEPS 500
+
+// Прежнее чтение: список команд в куче на каждый вызов, таймаут 50 мс
+static esp_err_t pcf8574_read_heap(uint8_t addr, uint8_t* data) {
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
+    i2c_master_read_byte(cmd, data, I2C_MASTER_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 50 / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return ret;
+}
+
+void bench_i2c_poll() {
+    int expanders = wiegand_expander_count();
+    static const uint8_t default_addrs[] = WIEGAND_EXPANDERS;
+    printf("\n⏱️  === BENCH: опрос расширителей I2C (%d расширителей, %lu кГц, %d проходов) ===\n",
+           expanders, (unsigned long)(i2c_bus_freq_hz() / 1000), I2C_BENCH_SWEEPS);
+
+    uint32_t errors = 0, max_us = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < I2C_BENCH_SWEEPS; i++) {
+        int64_t s0 = esp_timer_get_time();
+        for (int e = 0; e < expanders; e++) {
+            uint8_t data;
+            if (pcf8574_read_heap(default_addrs[e], &data) != ESP_OK) errors++;
+        }
+        uint32_t dt = (uint32_t)(esp_timer_get_time() - s0);
+        if (dt > max_us) max_us = dt;
+    }
+    int64_t heap_us = (esp_timer_get_time() - t0) / I2C_BENCH_SWEEPS;
+    printf("  %-28s avg: %5lld мкс | max: %5lu мкс | %7.0f проходов/с | ошибок %lu\n",
+           "per-read heap link (before)", (long long)heap_us, (unsigned long)max_us,
+           heap_us > 0 ? 1000000.0 / heap_us : 0.0, (unsigned long)errors);
+
+    I2cPollStats before, after;
+    get_i2c_poll_stats(&before);
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < I2C_BENCH_SWEEPS; i++) {
+        uint8_t ports[I2C_SWEEP_MAX_DEVICES];
+        pcf8574_sweep(ports);
+    }
+    int64_t sweep_us = (esp_timer_get_time() - t0) / I2C_BENCH_SWEEPS;
+    get_i2c_poll_stats(&after);
+    printf("  %-28s avg: %5lld мкс | max: %5lu мкс | %7.0f проходов/с | ошибок %lu\n",
+           "static sweep (after)", (long long)sweep_us, (unsigned long)after.max_us,
+           sweep_us > 0 ? 1000000.0 / sweep_us : 0.0, (unsigned long)(after.errors - before.errors));
+
+    // Сколько бит увидит непрерывный опрос с такой частотой
+    ReplayTrain* t = (ReplayTrain*)malloc(sizeof(ReplayTrain));
+    if (t) {
+        make_replay_train(t);
+        if (heap_us > 0) replay_polling(t, "poll back-to-back (before)", (uint32_t)heap_us);
+        if (sweep_us > 0) replay_polling(t, "poll back-to-back (after)", (uint32_t)sweep_us);
+        free(t);
+    }
+}
+
+// ==========================================
+// НЕСКОЛЬКО СЧИТЫВАТЕЛЕЙ НА ОДНОМ ЧТЕНИИ ПОРТА
+// ==========================================
+#define MULTI_SWEEP_US 25          // период чтения портов в модели (быстрее импульса)
+
+struct MultiReaderFrame {
+    uint64_t data;
+    uint8_t bits;
+    uint32_t start_us;
+    uint32_t step_us;
+};
+
+// Линия считывателя в момент t: номер бита, импульс которого идет, или -1
+static int multi_active_bit(const MultiReaderFrame* f, uint32_t t) {
+    if (t < f->start_us) return -1;
+    uint32_t k = (t - f->start_us) / f->step_us;
+    if (k >= f->bits || (t - f->start_us) % f->step_us >= REPLAY_PULSE_US) return -1;
+    return (int)k;
+}
+
+static void run_multi_reader(const WiegandReaderPins* pins, int readers,
+                             const uint8_t* addrs, int exp_count) {
+    if (!wiegand_set_readers(pins, readers, addrs, exp_count)) return;
+    WiegandEdge e;
+    while (wiegand_edge_pop(&e)) {}
+
+    // Все считыватели передают кадры одновременно, со сдвигом и разным шагом
+    static const uint8_t lengths[] = {26, 34, 37, 56, 58};
+    MultiReaderFrame frames[WIEGAND_MAX_READERS];
+    WiegandDecoder dec[WIEGAND_MAX_READERS];
+    uint32_t end_us = 0;
+    for (int r = 0; r < readers; r++) {
+        frames[r].bits = lengths[esp_random() % 5];
+        frames[r].data = (((uint64_t)esp_random() << 32) | esp_random()) & ((1ULL << frames[r].bits) - 1);
+        frames[r].start_us = 1000 + r * 137;
+        frames[r].step_us = 1000 + r * 50;
+        uint32_t last = frames[r].start_us + (frames[r].bits - 1) * frames[r].step_us + REPLAY_PULSE_US;
+        if (last > end_us) end_us = last;
+        wiegand_decoder_reset(&dec[r]);
+    }
+
+    uint32_t sweeps = 0, edges = 0;
+    int64_t sweep_us = 0, max_us = 0;
+    for (uint32_t t = 0; t <= end_us + MULTI_SWEEP_US; t += MULTI_SWEEP_US) {
+        uint8_t ports[WIEGAND_MAX_EXPANDERS];
+        memset(ports, 0xFF, sizeof(ports));
+        for (int r = 0; r < readers; r++) {
+            int k = multi_active_bit(&frames[r], t);
+            if (k < 0) continue;
+            int bit = (frames[r].data >> (frames[r].bits - 1 - k)) & 1;
+            ports[pins[r].expander] &= (uint8_t)~(1u << ((bit ? pins[r].d1_input : pins[r].d0_input) - 1));
+        }
+
+        // Разбор одного чтения портов: фронты всех считывателей + декодеры
+        int64_t t0 = esp_timer_get_time();
+        wiegand_capture_feed_ports(ports, t, false);
+        while (wiegand_edge_pop(&e)) {
+            WiegandFrame done;
+            wiegand_decoder_feed(&dec[e.reader], e.bit, e.time_us, &done);
+            edges++;
+        }
+        int64_t dt = esp_timer_get_time() - t0;
+        sweep_us += dt;
+        if (dt > max_us) max_us = dt;
+        sweeps++;
+    }
+
+    int ok = 0;
+    for (int r = 0; r < readers; r++) {
+        WiegandFrame done;
+        if (wiegand_decoder_poll(&dec[r], end_us + WIEGAND_TIMEOUT_MS * 1000 + 1000, &done) &&
+            done.bits == frames[r].bits && done.data == frames[r].data && done.lost_bits == 0) {
+            ok++;
+        }
+    }
+    printf("  %2d считыв. / %d расшир. | %d чтений I2C/опрос | разбор опроса avg %5.0f нс, max %3lld мкс | фронтов %4lu | кадров %d/%d\n",
+           readers, exp_count, exp_count, (double)sweep_us * 1000.0 / sweeps, (long long)max_us,
+           (unsigned long)edges, ok, readers);
+}
+
+void bench_multi_reader() {
+    printf("\n⏱️  === BENCH: несколько считывателей на расширителях (опрос каждые %d мкс) ===\n",
+           MULTI_SWEEP_US);
+    static const WiegandReaderPins pins[] = {
+        {0, 1, 2}, {0, 3, 4}, {0, 5, 6}, {0, 7, 8},
+        {1, 1, 2}, {1, 3, 4}, {1, 5, 6}, {1, 7, 8},
+    };
+    static const uint8_t addrs[] = {0x20, 0x21};
+    for (int n = 1; n <= 4; n++) run_multi_reader(pins, n, addrs, 1);
+    run_multi_reader(pins, 8, addrs, 2);
+
+    // Обратно к конфигурации из config.h
+    wiegand_set_readers(NULL, 0, NULL, 0);
+}
+
+// ==========================================
+// КАНАЛ СОБЫТИЙ vs ОЧЕРЕДЬ FREERTOS
+// ==========================================
+#define CHANNEL_BENCH_EVENTS 2000
+
+struct ChannelBench {
+    ReadChannel* ch;          // NULL - очередь FreeRTOS
+    QueueHandle_t q;
+    uint32_t spacing_us;      // интервал между событиями писателя
+    uint32_t full;
+    volatile bool done;
+};
+
+// Писатель на ядре 1, как sensor_task
+static void channel_bench_producer(void* arg) {
+    ChannelBench* b = (ChannelBench*)arg;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < CHANNEL_BENCH_EVENTS; i++) {
+        while (esp_timer_get_time() - t0 < (int64_t)i * b->spacing_us) {}
+
+        CardReadEvent ev = {};
+        ev.card_hex = (uint64_t)i;
+        ev.bits = 56;
+        if (b->ch) {
+            while (!read_channel_push(b->ch, &ev)) taskYIELD();
+        } else {
+            ev.enqueue_us = (uint32_t)esp_timer_get_time();
+            while (xQueueSend(b->q, &ev, 0) != pdTRUE) {
+                b->full++;
+                taskYIELD();
+            }
+        }
+    }
+    b->done = true;
+    vTaskDelete(NULL);
+}
+
+static void run_channel_bench(const char* name, ReadChannel* ch, QueueHandle_t q,
+                              uint32_t spacing_us, uint32_t* samples) {
+    ChannelBench b = {ch, q, spacing_us, 0, false};
+    if (ch) read_channel_init(ch);
+
+    int n = 0;
+    int64_t wall = esp_timer_get_time();
+    if (xTaskCreatePinnedToCore(channel_bench_producer, "chan_bench", 3072, &b, 2, NULL, 1) != pdPASS) {
+        printf("❌ Не удалось запустить писателя\n");
+        return;
+    }
+    while (n < CHANNEL_BENCH_EVENTS) {
+        CardReadEvent ev;
+        if (ch) {
+            read_channel_wait(ch, 100);
+            while (n < CHANNEL_BENCH_EVENTS && read_channel_pop(ch, &ev)) {
+                samples[n++] = (uint32_t)esp_timer_get_time() - ev.enqueue_us;
+            }
+        } else if (xQueueReceive(q, &ev, pdMS_TO_TICKS(100)) == pdTRUE) {
+            samples[n++] = (uint32_t)esp_timer_get_time() - ev.enqueue_us;
+        }
+        if (b.done && n < CHANNEL_BENCH_EVENTS && (ch ? read_channel_depth(ch) == 0
+                                                   : uxQueueMessagesWaiting(q) == 0)) break;
+    }
+    wall = esp_timer_get_time() - wall;
+    while (!b.done) vTaskDelay(1);
+
+    uint32_t full = b.full, wakeups = 0;
+    if (ch) {
+        ReadChannelStats st;
+        get_read_channel_stats(ch, &st);
+        full = st.full;
+        wakeups = st.wakeups;
+    }
+    qsort(samples, n, sizeof(uint32_t), compare_u32);
+    printf("  %-9s %-10s p50: %4lu | p99: %5lu | max: %5lu мкс | %8.0f соб/с | полон %5lu | пробуждений %4lu | %d/%d\n",
+           name, spacing_us ? "" : "burst", (unsigned long)samples[(n - 1) * 50 / 100],
+           (unsigned long)samples[(n - 1) * 99 / 100], (unsigned long)samples[n - 1],
+           wall > 0 ? (double)n * 1000000.0 / (double)wall : 0.0,
+           (unsigned long)full, (unsigned long)wakeups, n, CHANNEL_BENCH_EVENTS);
+}
+
+void bench_read_channel() {
+    printf("\n⏱️  === BENCH: канал событий vs очередь FreeRTOS (%d событий, %d мест, ядро 1 -> ядро 0) ===\n",
+           CHANNEL_BENCH_EVENTS, READ_CHANNEL_SIZE);
+
+    uint32_t* samples = (uint32_t*)malloc(CHANNEL_BENCH_EVENTS * sizeof(uint32_t));
+    static ReadChannel bench_channel;
+    ReadChannel* ch = &bench_channel;
+    QueueHandle_t q = xQueueCreate(READ_CHANNEL_SIZE, sizeof(CardReadEvent));
+    if (!samples || !q) {
+        printf("❌ Ошибка выделения памяти\n");
+    } else {
+        static const uint32_t spacings[] = {1000, 50, 0};
+        for (int i = 0; i < 3; i++) {
+            printf(" интервал %lu мкс:\n", (unsigned long)spacings[i]);
+            run_channel_bench("queue", NULL, q, spacings[i], samples);
+            run_channel_bench("channel", ch, NULL, spacings[i], samples);
+        }
+    }
+    if (q) vQueueDelete(q);
+    free(samples);
+}
+
+// ==========================================
+// ОТЛОЖЕННЫЙ ЖУРНАЛ: ЗАДЕРЖКА ПОИСКА
+// ==========================================
+#define EVLOG_BENCH_LOOKUPS 50
+
+struct EvlogBenchResult {
+    const char* name;
+    uint32_t p50, p99, max;
+    uint32_t dropped;
+};
+
+// search_card целиком, вместе с выводом решения; флеш читается каждый раз
+static void run_logged_searches(EvlogBenchResult* r, const uint64_t* keys, int n, uint32_t* samples) {
+    EventLogStats before, after;
+    get_event_log_stats(&before);
+    for (int i = 0; i < n; i++) {
+        int64_t t0 = esp_timer_get_time();
+        search_card(keys[i]);
+        samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+    }
+    get_event_log_stats(&after);
+    evlog_flush();   // вывод прохода не попадает в следующий замер
+
+    qsort(samples, n, sizeof(uint32_t), compare_u32);
+    r->p50 = samples[(n - 1) * 50 / 100];
+    r->p99 = samples[(n - 1) * 99 / 100];
+    r->max = samples[n - 1];
+    r->dropped = after.dropped - before.dropped;
+}
+
+void bench_event_log() {
+    printf("\n⏱️  === BENCH: задержка поиска с выводом в консоль (%d поисков) ===\n", EVLOG_BENCH_LOOKUPS);
+
+    uint64_t* keys = (uint64_t*)malloc(EVLOG_BENCH_LOOKUPS * sizeof(uint64_t));
+    uint32_t* samples = (uint32_t*)malloc(EVLOG_BENCH_LOOKUPS * sizeof(uint32_t));
+    int n = 0;
+    while (keys && n < EVLOG_BENCH_LOOKUPS && pick_existing_card(&keys[n])) n++;
+    if (!keys || !samples || n == 0) {
+        free(keys);
+        free(samples);
+        printf("❌ База данных недоступна\n");
+        return;
+    }
+    card_cache_set_enabled(false);
+    uint8_t level = evlog_level;
+
+    EvlogBenchResult res[3] = {{"printf (before)"}, {"deferred"}, {"log off"}};
+    evlog_set_deferred(false);
+    run_logged_searches(&res[0], keys, n, samples);
+    evlog_set_deferred(true);
+    run_logged_searches(&res[1], keys, n, samples);
+    evlog_set_level(EVLOG_OFF);
+    run_logged_searches(&res[2], keys, n, samples);
+
+    evlog_set_level(level);
+    evlog_set_deferred(EVLOG_DEFERRED);
+    card_cache_set_enabled(true);
+
+    for (int i = 0; i < 3; i++) {
+        printf("  %-18s p50: %5lu | p99: %6lu | max: %6lu мкс | потеряно записей %lu\n", res[i].name,
+               (unsigned long)res[i].p50, (unsigned long)res[i].p99, (unsigned long)res[i].max,
+               (unsigned long)res[i].dropped);
+    }
+    free(keys);
+    free(samples);
+}
+
+// ==========================================
+// BENCH: МАССОВЫЙ ИМПОРТ
+// ==========================================
+
+// Выгрузка отдела кадров без файла: строки генерируются по запросу,
+// ключи случайные, каждая 20-я строка повторяет одну из прежних
+struct SyntheticCsv {
+    uint32_t emitted;
+    uint32_t total;
+    uint64_t recent[16];
+    char line[48];
+    size_t line_len;
+    size_t line_pos;
+};
+
+static size_t synthetic_csv_read(void* ctx, char* buf, size_t len) {
+    SyntheticCsv* src = (SyntheticCsv*)ctx;
+    size_t got = 0;
+    while (got < len) {
+        if (src->line_pos == src->line_len) {
+            if (src->emitted == src->total) break;
+            uint64_t id = (((uint64_t)esp_random() << 32) | esp_random()) & 0xFFFFFFFFFFFFFFULL;
+            if (src->emitted % 20 == 19) id = src->recent[esp_random() % 16];
+            src->recent[src->emitted % 16] = id;
+            src->line_len = snprintf(src->line, sizeof(src->line), "%014llX,%u,0x%02X,%u\n",
+                                     (unsigned long long)id, (unsigned)(esp_random() % 4),
+                                     (unsigned)(esp_random() & 0xFF), (unsigned)(esp_random() & 0xFFFF));
+            src->line_pos = 0;
+            src->emitted++;
+        }
+        size_t n = src->line_len - src->line_pos;
+        if (n > len - got) n = len - got;
+        memcpy(buf + got, src->line + src->line_pos, n);
+        src->line_pos += n;
+        got += n;
+    }
+    return got;
+}
+
+void bench_bulk_import() {
+    printf("\n⏱️  === BENCH: массовый импорт (внешняя сортировка, %d КБ памяти) ===\n",
+           IMPORT_MEMORY_BYTES / 1024);
+    ShardInfo* table = (ShardInfo*)malloc(MAX_SHARDS * sizeof(ShardInfo));
+    if (!table) {
+        printf("❌ Ошибка выделения памяти\n");
+        return;
+    }
+    printf("  %8s | %6s | %6s | %8s | %8s | %10s | %12s\n",
+           "строк", "прогон", "слиян", "прогоны", "слияние", "записей/с", "записано/база");
+
+    const uint32_t sizes[] = {10000, 50000};
+    for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++) {
+        SyntheticCsv src;
+        memset(&src, 0, sizeof(src));
+        src.total = sizes[t];
+        // Шарды пишутся рядом с живой базой, но в манифест не попадают
+        CardImportStats stats;
+        int count = 0;
+        bool ok = card_import_build(synthetic_csv_read, &src, MOUNT_POINT, allocate_shard_file_id,
+                                    table, &count, &stats);
+        uint64_t db_bytes = 0;
+        for (int i = 0; i < count; i++) {
+            db_bytes += table[i].bytes;
+            char fname[32];
+            shard_file_name(table[i].file_id, fname, sizeof(fname));
+            remove(fname);
+        }
+        if (!ok) {
+            printf("  %8lu | ❌ ошибка импорта\n", (unsigned long)sizes[t]);
+            continue;
+        }
+        printf("  %8lu | %6lu | %6lu | %5lu мс | %5lu мс | %10lu | %11.2fx\n",
+               (unsigned long)sizes[t], (unsigned long)stats.runs, (unsigned long)stats.merge_passes,
+               (unsigned long)(stats.run_us / 1000), (unsigned long)(stats.merge_us / 1000),
+               (unsigned long)stats.records_per_s,
+               db_bytes ? (double)stats.bytes_written / (double)db_bytes : 0.0);
+    }
+    free(table);
+}
+
+// ==========================================
+// ЗАМЕР: ЖУРНАЛ ПРОХОДОВ
+// ==========================================
+
+#define BENCH_JOURNAL_CHUNKS 10
+#define BENCH_JOURNAL_CHUNK 200          // событий подряд (меньше ACCESS_JOURNAL_RING)
+#define BENCH_JOURNAL_CARDS 50
+#define BENCH_JOURNAL_LAST 10
+#define BENCH_JOURNAL_READER 15          // считыватель событий замера
+#define BENCH_JOURNAL_FILE MOUNT_POINT "/journal_bench.bin"
+
+struct JournalFileRecord {
+    uint64_t time_ms;
+    uint64_t card_hex;   // считыватель и решение - в старшем байте
+};
+
+static uint64_t bench_journal_card(int i) {
+    return 0xBE000000000000ULL + (uint64_t)(i % BENCH_JOURNAL_CARDS) * 7919;
+}
+
+// Запросы по файлу - полный просмотр
+static size_t journal_file_query_range(uint64_t from_ms, uint64_t to_ms) {
+    FILE* fd = fopen(BENCH_JOURNAL_FILE, "rb");
+    if (!fd) return 0;
+    JournalFileRecord recs[64];
+    size_t found = 0, got;
+    while ((got = fread(recs, sizeof(JournalFileRecord), 64, fd)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            if (recs[i].time_ms >= from_ms && recs[i].time_ms <= to_ms) found++;
+        }
+    }
+    fclose(fd);
+    return found;
+}
+
+static size_t journal_file_query_card(uint64_t card_hex, uint64_t* last_ms) {
+    FILE* fd = fopen(BENCH_JOURNAL_FILE, "rb");
+    if (!fd) return 0;
+    JournalFileRecord recs[64];
+    size_t found = 0, got;
+    while ((got = fread(recs, sizeof(JournalFileRecord), 64, fd)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            if ((recs[i].card_hex & 0xFFFFFFFFFFFFFFULL) != card_hex) continue;
+            last_ms[found % BENCH_JOURNAL_LAST] = recs[i].time_ms;
+            found++;
+        }
+    }
+    fclose(fd);
+    return found < BENCH_JOURNAL_LAST ? found : BENCH_JOURNAL_LAST;
+}
+
+// Те же события в файл SPIFFS: по событию или группой на fopen/fwrite/fclose
+static int64_t journal_file_append(const JournalFileRecord* recs, int n, int group) {
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < n; i += group) {
+        int k = n - i < group ? n - i : group;
+        FILE* fd = fopen(BENCH_JOURNAL_FILE, "ab");
+        if (!fd) return -1;
+        fwrite(recs + i, sizeof(JournalFileRecord), k, fd);
+        fclose(fd);
+    }
+    return esp_timer_get_time() - t0;
+}
+
+void bench_access_journal() {
+    printf("\n⏱️  === BENCH: журнал проходов (групповая фиксация, запросы по времени и карте) ===\n");
+    if (!access_journal_ready()) {
+        printf("❌ Журнал проходов не готов\n");
+        return;
+    }
+    const int total = BENCH_JOURNAL_CHUNKS * BENCH_JOURNAL_CHUNK;
+    JournalFileRecord* file_recs = (JournalFileRecord*)malloc(total * sizeof(JournalFileRecord));
+    AccessEvent* out = (AccessEvent*)malloc(BENCH_JOURNAL_CHUNK * 2 * sizeof(AccessEvent));
+    if (!file_recs || !out) {
+        printf("❌ Ошибка выделения памяти\n");
+        free(file_recs);
+        free(out);
+        return;
+    }
+
+    // 1. Пачки по BENCH_JOURNAL_CHUNK событий: добавление не ждет флеша,
+    //    затем вся пачка фиксируется (в работе это делает задача журнала)
+    access_journal_sync();
+    AccessJournalStats before;
+    get_access_journal_stats(&before);
+    uint64_t chunk_from[BENCH_JOURNAL_CHUNKS], chunk_to[BENCH_JOURNAL_CHUNKS];
+    int64_t append_us = 0, append_max = 0, burst_us = 0;
+    for (int c = 0; c < BENCH_JOURNAL_CHUNKS; c++) {
+        int64_t t_burst = esp_timer_get_time();
+        chunk_from[c] = access_journal_now();
+        for (int i = 0; i < BENCH_JOURNAL_CHUNK; i++) {
+            int k = c * BENCH_JOURNAL_CHUNK + i;
+            uint8_t decision = (uint8_t)(k % 3);
+            int64_t t0 = esp_timer_get_time();
+            access_journal_append(bench_journal_card(k), BENCH_JOURNAL_READER, decision);
+            int64_t dt = esp_timer_get_time() - t0;
+            append_us += dt;
+            if (dt > append_max) append_max = dt;
+            file_recs[k].time_ms = access_journal_now();
+            file_recs[k].card_hex = bench_journal_card(k) | ((uint64_t)(BENCH_JOURNAL_READER << 4 | decision) << 56);
+        }
+        chunk_to[c] = access_journal_now();
+        access_journal_sync();
+        burst_us += esp_timer_get_time() - t_burst;
+        vTaskDelay(2);  // пачки разнесены во времени
+    }
+    AccessJournalStats after;
+    get_access_journal_stats(&after);
+    uint32_t committed = after.committed - before.committed;
+    printf("  append: avg %.2f мкс, max %lld мкс | отброшено %lu\n", (double)append_us / total,
+           (long long)append_max, (unsigned long)(after.dropped - before.dropped));
+    printf("  %-26s %8.0f соб/с | записей на флеш %lu, %llu Б, стерто секторов %lu\n", "журнал (раздел)",
+           burst_us > 0 ? committed * 1000000.0 / burst_us : 0.0, (unsigned long)(after.commits - before.commits),
+           (unsigned long long)(after.bytes_written - before.bytes_written),
+           (unsigned long)(after.sectors_erased - before.sectors_erased));
+
+    remove(BENCH_JOURNAL_FILE);
+    int64_t single_us = journal_file_append(file_recs, BENCH_JOURNAL_CHUNK, 1);
+    remove(BENCH_JOURNAL_FILE);
+    int64_t group_us = journal_file_append(file_recs, total, ACCESS_JOURNAL_GROUP);
+    if (single_us > 0) {
+        printf("  %-26s %8.0f соб/с\n", "файл SPIFFS, по событию", BENCH_JOURNAL_CHUNK * 1000000.0 / single_us);
+    }
+    if (group_us > 0) {
+        printf("  %-26s %8.0f соб/с (по %d)\n", "файл SPIFFS, группой", total * 1000000.0 / group_us,
+               ACCESS_JOURNAL_GROUP);
+    }
+
+    // 2. Интервал: средняя пачка - ровно BENCH_JOURNAL_CHUNK событий замера
+    int mid = BENCH_JOURNAL_CHUNKS / 2;
+    int64_t t0 = esp_timer_get_time();
+    size_t n = access_journal_query_range(chunk_from[mid], chunk_to[mid], out, BENCH_JOURNAL_CHUNK * 2);
+    int64_t range_us = esp_timer_get_time() - t0;
+    size_t ours = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (out[i].reader == BENCH_JOURNAL_READER) ours++;
+    }
+    t0 = esp_timer_get_time();
+    size_t file_n = journal_file_query_range(chunk_from[mid], chunk_to[mid]);
+    int64_t file_range_us = esp_timer_get_time() - t0;
+    printf("  Интервал: журнал %lld мкс (%u событий, замера %u/%d) | файл %lld мкс (%u)\n",
+           (long long)range_us, (unsigned)n, (unsigned)ours, BENCH_JOURNAL_CHUNK,
+           (long long)file_range_us, (unsigned)file_n);
+
+    // 3. Последние события карты: от новых к старым, с последнего события замера
+    uint64_t card = bench_journal_card(total - 1);
+    t0 = esp_timer_get_time();
+    n = access_journal_query_card(card, out, BENCH_JOURNAL_LAST);
+    int64_t card_us = esp_timer_get_time() - t0;
+    bool ordered = n > 0 && out[0].time_ms == file_recs[total - 1].time_ms;
+    for (size_t i = 1; i < n; i++) {
+        if (out[i].time_ms > out[i - 1].time_ms || out[i].card_hex != card) ordered = false;
+    }
+    uint64_t last_ms[BENCH_JOURNAL_LAST];
+    t0 = esp_timer_get_time();
+    size_t file_card_n = journal_file_query_card(card, last_ms);
+    int64_t file_card_us = esp_timer_get_time() - t0;
+    printf("  Последние %d карты: журнал %lld мкс (%u, порядок %s) | файл %lld мкс (%u)\n",
+           BENCH_JOURNAL_LAST, (long long)card_us, (unsigned)n, ordered ? "верный" : "НАРУШЕН",
+           (long long)file_card_us, (unsigned)file_card_n);
+
+    remove(BENCH_JOURNAL_FILE);
+    free(file_recs);
+    free(out);
+}
+
+void run_benchmarks() {
+    printf("\n⏱️  === ЗАПУСК БЕНЧМАРКОВ ===\n");
+    bench_bit_kernels();
+    bench_block_index();
+    bench_card_filter();
+    bench_card_cache();
+    bench_storage_backends();
+    bench_delta_log();
+    bench_usage_counters();
+    bench_generation_swap();
+    bench_batch_lookup();
+    bench_lookup_suite();
+    bench_index_scaling();
+    bench_ram_table();
+    bench_hash_index();
+    bench_card_scan();
+    bench_manifest_boot();
+    bench_block_format();
+    bench_bulk_import();
+    bench_wiegand_replay();
+    bench_wiegand_formats();
+    bench_multi_reader();
+    bench_i2c_poll();
+    bench_read_channel();
+    bench_event_log();
+    bench_access_journal();
+    printf("⏱️  === БЕНЧМАРКИ ЗАВЕРШЕНЫ ===\n\n");
+}
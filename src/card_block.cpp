@@ -0,0 +1,199 @@
+#include "card_block.h"
+#include "card_record.h"
+#include <string.h>
+
+#define HEX_ID_MASK ((1ULL << CARD_KEY_BITS) - 1)
+
+static_assert(sizeof(CardFileHeader) == 16, "Заголовок файла шарда - 16 байт");
+// Файлы версии 2 записаны с 30-битными атрибутами: новое поле в схеме -
+// новая версия файла и конвертер (как из версии 1)
+static_assert(CARD_ATTR_BITS == 30, "Схема атрибутов изменилась - поднимите CARD_FILE_VERSION");
+
+// ==========================================
+// БЛОК
+// ==========================================
+
+static inline int block_count(const uint8_t* block) {
+    return block[7];
+}
+
+static inline int block_width(const uint8_t* block) {
+    return block[8];
+}
+
+static inline bool block_header_valid(const uint8_t* block) {
+    int n = block_count(block);
+    int width = block_width(block);
+    return n >= 1 && n <= INDEX_BLOCK_RECORDS && width <= CARD_KEY_BITS && (n == 1 || width > 0);
+}
+
+static inline size_t block_bytes(int n, int width) {
+    return CARD_BLOCK_HEADER_BYTES + ((size_t)(n - 1) * width + (size_t)n * CARD_ATTR_BITS + 7) / 8;
+}
+
+size_t card_block_size(const uint8_t* block) {
+    if (!block_header_valid(block)) return 0;
+    return block_bytes(block_count(block), block_width(block));
+}
+
+int card_block_find(const uint8_t* block, uint64_t target_hex, CardInfo* out) {
+    if (!block_header_valid(block)) return -1;
+    int n = block_count(block);
+    int width = block_width(block);
+    uint64_t id = read_bits57(block, 0, CARD_KEY_BITS);
+    if (target_hex < id) return -1;
+
+    // Дельты идут подряд одной ширины: одно чтение слова на запись
+    const uint8_t* payload = block + CARD_BLOCK_HEADER_BYTES;
+    uint64_t bit = 0;
+    int i = 0;
+    while (id < target_hex && i + 1 < n) {
+        id += read_bits57(payload, bit, width);
+        bit += width;
+        i++;
+    }
+    if (id != target_hex) return -1;
+
+    uint64_t attr_bit = (uint64_t)(n - 1) * width + (uint64_t)i * CARD_ATTR_BITS;
+    out->hex_id = id;
+    card_unpack_attrs(read_bits57(payload, attr_bit, CARD_ATTR_BITS), out);
+    return i;
+}
+
+int card_block_decode(const uint8_t* block, CardInfo* out) {
+    if (!block_header_valid(block)) return 0;
+    int n = block_count(block);
+    int width = block_width(block);
+    const uint8_t* payload = block + CARD_BLOCK_HEADER_BYTES;
+    uint64_t id = read_bits57(block, 0, CARD_KEY_BITS);
+    uint64_t delta_bit = 0;
+    uint64_t attr_bit = (uint64_t)(n - 1) * width;
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            id += read_bits57(payload, delta_bit, width);
+            delta_bit += width;
+        }
+        out[i].hex_id = id;
+        card_unpack_attrs(read_bits57(payload, attr_bit, CARD_ATTR_BITS), &out[i]);
+        attr_bit += CARD_ATTR_BITS;
+    }
+    return n;
+}
+
+size_t card_block_encode(const CardInfo* cards, int n, uint8_t* out) {
+    if (n < 1 || n > INDEX_BLOCK_RECORDS) return 0;
+    uint64_t max_delta = 0;
+    for (int i = 1; i < n; i++) {
+        uint64_t prev = cards[i - 1].hex_id & HEX_ID_MASK;
+        uint64_t cur = cards[i].hex_id & HEX_ID_MASK;
+        if (cur <= prev) return 0;
+        if (cur - prev > max_delta) max_delta = cur - prev;
+    }
+    int width = max_delta ? 64 - __builtin_clzll(max_delta) : 0;
+    size_t bytes = block_bytes(n, width);
+    memset(out, 0, bytes + RECORD_READ_PAD);
+
+    write_bits57(out, 0, cards[0].hex_id & HEX_ID_MASK, CARD_KEY_BITS);
+    out[7] = (uint8_t)n;
+    out[8] = (uint8_t)width;
+
+    uint8_t* payload = out + CARD_BLOCK_HEADER_BYTES;
+    uint64_t bit = 0;
+    for (int i = 1; i < n; i++) {
+        write_bits57(payload, bit, (cards[i].hex_id - cards[i - 1].hex_id) & HEX_ID_MASK, width);
+        bit += width;
+    }
+    for (int i = 0; i < n; i++) {
+        write_bits57(payload, bit, card_pack_attrs(&cards[i]), CARD_ATTR_BITS);
+        bit += CARD_ATTR_BITS;
+    }
+    return bytes;
+}
+
+// ==========================================
+// ФАЙЛ
+// ==========================================
+
+static inline uint32_t file_blocks(uint32_t records) {
+    return (records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+}
+
+size_t card_file_max_bytes(uint32_t records) {
+    return CARD_FILE_HEADER_BYTES + (size_t)file_blocks(records) * CARD_BLOCK_MAX_BYTES;
+}
+
+void card_file_init_header(uint8_t* out, uint32_t records) {
+    CardFileHeader hdr = {};
+    hdr.magic = CARD_FILE_MAGIC;
+    hdr.version = CARD_FILE_VERSION;
+    hdr.block_records = INDEX_BLOCK_RECORDS;
+    hdr.records = records;
+    hdr.blocks = file_blocks(records);
+    memcpy(out, &hdr, sizeof(hdr));
+}
+
+size_t card_file_encode(const CardInfo* cards, uint32_t records, uint8_t* out) {
+    memset(out, 0, CARD_FILE_HEADER_BYTES + RECORD_READ_PAD);
+    card_file_init_header(out, records);
+
+    size_t pos = CARD_FILE_HEADER_BYTES;
+    for (uint32_t first = 0; first < records; first += INDEX_BLOCK_RECORDS) {
+        uint32_t left = records - first;
+        int n = left > INDEX_BLOCK_RECORDS ? INDEX_BLOCK_RECORDS : (int)left;
+        if (first > 0 && cards[first].hex_id <= cards[first - 1].hex_id) return 0;
+        size_t bytes = card_block_encode(cards + first, n, out + pos);
+        if (bytes == 0) return 0;
+        pos += bytes;
+    }
+    return pos;
+}
+
+bool card_file_header(const uint8_t* data, size_t len, uint32_t* records) {
+    if (len < CARD_FILE_HEADER_BYTES) return false;
+    CardFileHeader hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.magic != CARD_FILE_MAGIC || hdr.version != CARD_FILE_VERSION ||
+        hdr.block_records != INDEX_BLOCK_RECORDS || hdr.blocks != file_blocks(hdr.records)) {
+        return false;
+    }
+    *records = hdr.records;
+    return true;
+}
+
+// Обход блоков с проверкой; любой из выходов может быть NULL
+static bool walk_blocks(const uint8_t* data, size_t len, uint32_t* offsets, uint64_t* fences,
+                        uint64_t* last_id, CardInfo* out) {
+    uint32_t records;
+    if (!card_file_header(data, len, &records)) return false;
+    size_t pos = CARD_FILE_HEADER_BYTES;
+    uint64_t prev = 0;
+    CardInfo cards[INDEX_BLOCK_RECORDS];
+    for (uint32_t first = 0; first < records; first += INDEX_BLOCK_RECORDS) {
+        uint32_t left = records - first;
+        int n = left > INDEX_BLOCK_RECORDS ? INDEX_BLOCK_RECORDS : (int)left;
+        if (pos + CARD_BLOCK_HEADER_BYTES > len) return false;
+        const uint8_t* block = data + pos;
+        size_t bytes = card_block_size(block);
+        if (bytes == 0 || pos + bytes > len || block_count(block) != n) return false;
+        card_block_decode(block, cards);
+        for (int i = 0; i < n; i++) {
+            if ((first > 0 || i > 0) && cards[i].hex_id <= prev) return false;
+            prev = cards[i].hex_id;
+        }
+        uint32_t b = first / INDEX_BLOCK_RECORDS;
+        if (offsets) offsets[b] = (uint32_t)pos;
+        if (fences) fences[b] = cards[0].hex_id;
+        if (out) memcpy(out + first, cards, n * sizeof(CardInfo));
+        pos += bytes;
+    }
+    if (last_id) *last_id = prev;
+    return pos == len;
+}
+
+bool card_file_index(const uint8_t* data, size_t len, uint32_t* offsets, uint64_t* fences, uint64_t* last_id) {
+    return walk_blocks(data, len, offsets, fences, last_id, NULL);
+}
+
+bool card_file_decode(const uint8_t* data, size_t len, CardInfo* out) {
+    return walk_blocks(data, len, NULL, NULL, NULL, out);
+}
@@ -0,0 +1,180 @@
+#include "card_cache.h"
+#include "config.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define CACHE_FLAG_VALID    0x01
+#define CACHE_FLAG_NEGATIVE 0x02
+#define CACHE_FLAG_REF      0x04
+
+struct CacheEntry {
+    uint64_t hex_id;
+    CardInfo info;
+    uint32_t stored_ms;
+    uint8_t flags;
+};
+
+struct CacheSet {
+    CacheEntry ways[CARD_CACHE_WAYS];
+    uint32_t epoch;  // растет при каждой инвалидации набора
+    uint8_t hand;    // стрелка CLOCK
+};
+
+static CacheSet cache_sets[CARD_CACHE_SETS];
+static CardCacheStats cache_stats = {};
+static bool cache_enabled = true;
+static portMUX_TYPE cache_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline CacheSet* cache_set_for(uint64_t hex_id) {
+    // Fibonacci-хеширование: соседние ID попадают в разные наборы
+    uint32_t h = (uint32_t)((hex_id * 0x9E3779B97F4A7C15ULL) >> 32);
+    return &cache_sets[h % CARD_CACHE_SETS];
+}
+
+static inline uint32_t cache_now_ms() {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static inline bool cache_entry_expired(const CacheEntry* e, uint32_t now) {
+    uint32_t ttl = (e->flags & CACHE_FLAG_NEGATIVE) ? CARD_CACHE_NEGATIVE_TTL_MS : CARD_CACHE_TTL_MS;
+    return (now - e->stored_ms) > ttl;
+}
+
+// ==========================================
+// ПОИСК
+// ==========================================
+
+CardCacheResult card_cache_lookup(uint64_t hex_id, CardInfo* out) {
+    if (!cache_enabled) return CARD_CACHE_MISS;
+
+    uint32_t now = cache_now_ms();
+    CacheSet* set = cache_set_for(hex_id);
+    CardCacheResult result = CARD_CACHE_MISS;
+
+    portENTER_CRITICAL(&cache_mux);
+    for (int w = 0; w < CARD_CACHE_WAYS; w++) {
+        CacheEntry* e = &set->ways[w];
+        if (!(e->flags & CACHE_FLAG_VALID) || e->hex_id != hex_id) continue;
+
+        if (cache_entry_expired(e, now)) {
+            e->flags = 0;
+            cache_stats.expired++;
+            break;
+        }
+        e->flags |= CACHE_FLAG_REF;
+        if (e->flags & CACHE_FLAG_NEGATIVE) {
+            result = CARD_CACHE_NEGATIVE;
+            cache_stats.negative_hits++;
+        } else {
+            *out = e->info;
+            result = CARD_CACHE_HIT;
+            cache_stats.hits++;
+        }
+        break;
+    }
+    if (result == CARD_CACHE_MISS) cache_stats.misses++;
+    portEXIT_CRITICAL(&cache_mux);
+
+    return result;
+}
+
+// ==========================================
+// ЗАПИСЬ (CLOCK)
+// ==========================================
+
+uint32_t card_cache_epoch(uint64_t hex_id) {
+    return __atomic_load_n(&cache_set_for(hex_id)->epoch, __ATOMIC_ACQUIRE);
+}
+
+static void cache_store(uint64_t hex_id, const CardInfo* ci, uint8_t flags, uint32_t epoch) {
+    if (!cache_enabled) return;
+
+    uint32_t now = cache_now_ms();
+    CacheSet* set = cache_set_for(hex_id);
+
+    portENTER_CRITICAL(&cache_mux);
+    // Набор инвалидирован после того, как ответ начали искать
+    if (set->epoch != epoch) {
+        cache_stats.stale_puts++;
+        portEXIT_CRITICAL(&cache_mux);
+        return;
+    }
+    CacheEntry* slot = NULL;
+
+    // 1. Тот же ключ или свободный слот
+    for (int w = 0; w < CARD_CACHE_WAYS; w++) {
+        CacheEntry* e = &set->ways[w];
+        if ((e->flags & CACHE_FLAG_VALID) && e->hex_id == hex_id) {
+            slot = e;
+            break;
+        }
+        if (!slot && !(e->flags & CACHE_FLAG_VALID)) slot = e;
+    }
+
+    // 2. CLOCK: снимаем бит обращения, пока не найдем жертву
+    if (!slot) {
+        while (true) {
+            CacheEntry* e = &set->ways[set->hand];
+            set->hand = (set->hand + 1) % CARD_CACHE_WAYS;
+            if (e->flags & CACHE_FLAG_REF) {
+                e->flags &= ~CACHE_FLAG_REF;
+            } else {
+                slot = e;
+                cache_stats.evictions++;
+                break;
+            }
+        }
+    }
+
+    slot->hex_id = hex_id;
+    if (ci) slot->info = *ci;
+    slot->stored_ms = now;
+    slot->flags = CACHE_FLAG_VALID | flags;
+    portEXIT_CRITICAL(&cache_mux);
+}
+
+void card_cache_put(uint64_t hex_id, const CardInfo* ci, uint32_t epoch) {
+    cache_store(hex_id, ci, 0, epoch);
+}
+
+void card_cache_put_negative(uint64_t hex_id, uint32_t epoch) {
+    cache_store(hex_id, NULL, CACHE_FLAG_NEGATIVE, epoch);
+}
+
+// ==========================================
+// ИНВАЛИДАЦИЯ
+// ==========================================
+
+void card_cache_invalidate(uint64_t hex_id) {
+    CacheSet* set = cache_set_for(hex_id);
+    portENTER_CRITICAL(&cache_mux);
+    for (int w = 0; w < CARD_CACHE_WAYS; w++) {
+        if (set->ways[w].hex_id == hex_id) set->ways[w].flags = 0;
+    }
+    __atomic_store_n(&set->epoch, set->epoch + 1, __ATOMIC_RELEASE);
+    cache_stats.invalidations++;
+    portEXIT_CRITICAL(&cache_mux);
+}
+
+void card_cache_invalidate_all() {
+    portENTER_CRITICAL(&cache_mux);
+    for (int s = 0; s < CARD_CACHE_SETS; s++) {
+        memset(cache_sets[s].ways, 0, sizeof(cache_sets[s].ways));
+        cache_sets[s].hand = 0;
+        __atomic_store_n(&cache_sets[s].epoch, cache_sets[s].epoch + 1, __ATOMIC_RELEASE);
+    }
+    cache_stats.invalidations++;
+    portEXIT_CRITICAL(&cache_mux);
+}
+
+void card_cache_set_enabled(bool enable) {
+    if (!enable) card_cache_invalidate_all();
+    cache_enabled = enable;
+}
+
+void get_card_cache_stats(CardCacheStats* out) {
+    portENTER_CRITICAL(&cache_mux);
+    *out = cache_stats;
+    portEXIT_CRITICAL(&cache_mux);
+}
@@ -0,0 +1,701 @@
+#include "card_db.h"
+#include "card_record.h"
+#include "card_block.h"
+#include "card_filter.h"
+#include "card_cache.h"
+#include "card_storage.h"
+#include "card_usage.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define DELTA_LOG_FILE MOUNT_POINT "/delta.log"
+
+#define DELTA_OP_PUT 1
+#define DELTA_OP_DELETE 2
+// Метка поколения в журнале (hex_id - номер поколения манифеста): все
+// записи выше нее уже вошли в это поколение, если оно опубликовано
+#define DELTA_OP_GENERATION 3
+
+struct DeltaEntry {
+    uint64_t hex_id;
+    CardInfo info;
+    uint32_t seq;
+    uint8_t op;
+};
+
+// Запись журнала на флеше: 16 байт, CRC8 отсекает оборванный хвост.
+// Раскладка - формат файла и не меняется вместе со схемой; поля
+// атрибутов названы как в CardInfo и переносятся по CARD_ATTR_FIELDS,
+// так что новое поле схемы без места здесь не соберется.
+struct DeltaLogRecord {
+    uint64_t hex_id;
+    uint16_t link;
+    uint8_t op;
+    uint8_t status;
+    uint8_t count;
+    uint8_t zones;
+    uint8_t reserved;
+    uint8_t crc;
+};
+
+static_assert(sizeof(DeltaLogRecord) == 16, "Запись журнала должна занимать 16 байт");
+
+#define DELTA_FIELD_CHECK(P, name, type, width) \
+    static_assert(8 * sizeof(DeltaLogRecord::name) >= (width), "Поле " #name " не помещается в запись журнала");
+#define DELTA_FIELD_STORE(P, name, type, width) rec->name = e->info.name;
+#define DELTA_FIELD_LOAD(P, name, type, width) ci->name = (type)rec->name;
+
+CARD_ATTR_FIELDS(DELTA_FIELD_CHECK, CARD_ATTR)
+
+static DeltaEntry delta_entries[DELTA_LOG_CAPACITY];
+static uint32_t delta_count = 0;
+static uint32_t delta_seq = 0;
+static SemaphoreHandle_t delta_mutex = NULL;
+static SemaphoreHandle_t compact_mutex = NULL;  // одно уплотнение за раз
+
+static TaskHandle_t compaction_task_handle = NULL;
+static volatile bool compaction_running = false;
+static CompactionStats compaction_stats = {};
+
+// ==========================================
+// ЖУРНАЛ НА ФЛЕШЕ
+// ==========================================
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void delta_to_record(const DeltaEntry* e, DeltaLogRecord* rec) {
+    memset(rec, 0, sizeof(*rec));
+    rec->hex_id = e->hex_id;
+    rec->op = e->op;
+    CARD_ATTR_FIELDS(DELTA_FIELD_STORE, CARD_ATTR)
+    rec->crc = crc8((const uint8_t*)rec, sizeof(*rec) - 1);
+}
+
+static void record_to_card(const DeltaLogRecord* rec, CardInfo* ci) {
+    ci->hex_id = rec->hex_id;
+    CARD_ATTR_FIELDS(DELTA_FIELD_LOAD, CARD_ATTR)
+}
+
+static bool delta_log_append(const DeltaEntry* e) {
+    DeltaLogRecord rec;
+    delta_to_record(e, &rec);
+    FILE* fd = fopen(DELTA_LOG_FILE, "ab");
+    if (!fd) return false;
+    bool ok = fwrite(&rec, sizeof(rec), 1, fd) == 1;
+    fclose(fd);
+    if (ok) compaction_stats.log_bytes += sizeof(rec);
+    return ok;
+}
+
+// Метка "записи выше вошли в поколение generation" (под delta_mutex).
+// Пишется до публикации поколения: сбой между манифестом и перезаписью
+// журнала не вернет при восстановлении уже влитые изменения.
+static bool delta_log_mark_generation(uint32_t generation) {
+    DeltaLogRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.hex_id = generation;
+    rec.op = DELTA_OP_GENERATION;
+    rec.crc = crc8((const uint8_t*)&rec, sizeof(rec) - 1);
+    FILE* fd = fopen(DELTA_LOG_FILE, "ab");
+    if (!fd) return false;
+    bool ok = fwrite(&rec, sizeof(rec), 1, fd) == 1 && sync_file(fd);
+    fclose(fd);
+    if (ok) compaction_stats.log_bytes += sizeof(rec);
+    return ok;
+}
+
+// Перезаписывает журнал текущим содержимым таблицы (под delta_mutex)
+static bool delta_log_rewrite() {
+    FILE* fd = fopen(DELTA_LOG_FILE, "wb");
+    if (!fd) return false;
+    bool ok = true;
+    for (uint32_t i = 0; i < delta_count && ok; i++) {
+        DeltaLogRecord rec;
+        delta_to_record(&delta_entries[i], &rec);
+        ok = fwrite(&rec, sizeof(rec), 1, fd) == 1;
+    }
+    fclose(fd);
+    compaction_stats.compaction_bytes += (uint64_t)delta_count * sizeof(DeltaLogRecord);
+    return ok;
+}
+
+// Уплотнение сорвалось: метка не должна пережить его - перезапись журнала
+// без нее (иначе манифест, собранный заново, мог бы получить тот же номер)
+static void delta_log_unmark() {
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    delta_log_rewrite();
+    xSemaphoreGive(delta_mutex);
+}
+
+// ==========================================
+// ТАБЛИЦА ИЗМЕНЕНИЙ В RAM (отсортирована по hex_id)
+// ==========================================
+
+// Позиция первого элемента с hex_id >= ключа
+static uint32_t delta_lower_bound(uint64_t hex_id) {
+    uint32_t left = 0, right = delta_count;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (delta_entries[mid].hex_id < hex_id) left = mid + 1;
+        else right = mid;
+    }
+    return left;
+}
+
+// Вставка/замена под delta_mutex. false - таблица заполнена.
+static bool delta_apply(uint64_t hex_id, uint8_t op, const CardInfo* ci, DeltaEntry* applied) {
+    uint32_t pos = delta_lower_bound(hex_id);
+    bool exists = pos < delta_count && delta_entries[pos].hex_id == hex_id;
+    if (!exists) {
+        if (delta_count >= DELTA_LOG_CAPACITY) return false;
+        memmove(&delta_entries[pos + 1], &delta_entries[pos],
+                (delta_count - pos) * sizeof(DeltaEntry));
+        delta_count++;
+    }
+    DeltaEntry* e = &delta_entries[pos];
+    e->hex_id = hex_id;
+    e->op = op;
+    if (ci) {
+        e->info = *ci;
+    } else {
+        memset(&e->info, 0, sizeof(e->info));
+    }
+    e->info.hex_id = hex_id;
+    e->seq = ++delta_seq;
+    if (applied) *applied = *e;
+    return true;
+}
+
+static void delta_remove_at(uint32_t pos) {
+    memmove(&delta_entries[pos], &delta_entries[pos + 1],
+            (delta_count - pos - 1) * sizeof(DeltaEntry));
+    delta_count--;
+}
+
+DeltaLookupResult card_delta_lookup(uint64_t hex_id, CardInfo* out) {
+    if (!delta_mutex || delta_count == 0) return DELTA_MISS;
+
+    DeltaLookupResult result = DELTA_MISS;
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    uint32_t pos = delta_lower_bound(hex_id);
+    if (pos < delta_count && delta_entries[pos].hex_id == hex_id) {
+        if (delta_entries[pos].op == DELTA_OP_DELETE) {
+            result = DELTA_DELETED;
+        } else {
+            *out = delta_entries[pos].info;
+            result = DELTA_FOUND;
+        }
+    }
+    xSemaphoreGive(delta_mutex);
+    return result;
+}
+
+uint32_t card_delta_count() {
+    return delta_count;
+}
+
+uint32_t card_delta_collect(uint64_t from_id, CardInfo* out, bool* deleted, uint32_t max) {
+    if (!delta_mutex || delta_count == 0) return 0;
+    uint32_t n = 0;
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    for (uint32_t pos = delta_lower_bound(from_id); pos < delta_count && n < max; pos++, n++) {
+        out[n] = delta_entries[pos].info;
+        deleted[n] = delta_entries[pos].op == DELTA_OP_DELETE;
+    }
+    xSemaphoreGive(delta_mutex);
+    return n;
+}
+
+// ==========================================
+// API ИЗМЕНЕНИЙ
+// ==========================================
+
+static bool card_db_mutate(uint64_t hex_id, uint8_t op, const CardInfo* ci) {
+    if (!delta_mutex) {
+        printf("❌ Журнал изменений не инициализирован\n");
+        return false;
+    }
+
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    DeltaEntry applied;
+    bool ok = delta_apply(hex_id, op, ci, &applied);
+    if (ok && !delta_log_append(&applied)) {
+        printf("⚠️ Не удалось записать изменение в %s\n", DELTA_LOG_FILE);
+    }
+    // Кеш - под тем же мьютексом: поиск, прочитавший прежнее значение, уже
+    // снял эпоху набора и не сможет записать его после инвалидации
+    if (ok) card_cache_invalidate(hex_id);
+    uint32_t count = delta_count;
+    xSemaphoreGive(delta_mutex);
+
+    if (!ok) {
+        printf("❌ Журнал изменений заполнен (%d) - ждем уплотнения\n", DELTA_LOG_CAPACITY);
+        card_db_request_compaction();
+        return false;
+    }
+
+    compaction_stats.mutations++;
+    if (count >= DELTA_COMPACT_THRESHOLD) card_db_request_compaction();
+    return true;
+}
+
+bool card_db_put(const CardInfo* ci) {
+    return card_db_mutate(ci->hex_id, DELTA_OP_PUT, ci);
+}
+
+bool card_db_delete(uint64_t hex_id) {
+    return card_db_mutate(hex_id, DELTA_OP_DELETE, NULL);
+}
+
+bool card_db_set_status(uint64_t hex_id, uint8_t status) {
+    CardInfo ci;
+    if (lookup_card_record(hex_id, &ci, NULL) != LOOKUP_FOUND) return false;
+    ci.status = status;
+    return card_db_put(&ci);
+}
+
+bool card_db_set_zones(uint64_t hex_id, uint8_t zones) {
+    CardInfo ci;
+    if (lookup_card_record(hex_id, &ci, NULL) != LOOKUP_FOUND) return false;
+    ci.zones = zones;
+    return card_db_put(&ci);
+}
+
+// ==========================================
+// УПЛОТНЕНИЕ: СЛИЯНИЕ ШАРДОВ С ЖУРНАЛОМ
+// ==========================================
+// Переписываются только шарды, в диапазон которых попали изменения.
+// Новые шарды пишутся в файлы с новыми номерами, затем атомарно
+// подменяется манифест и удаляются файлы выбывших шардов. Сбой на любом
+// шаге оставляет целую базу, лишние файлы убирает load_indices().
+
+// Счетчики использования (отсортированы, как и merged) прибавляются к записям
+static void apply_usage(CardInfo* merged, int records, const CardUsageDelta* usage, uint32_t n) {
+    int r = 0;
+    for (uint32_t u = 0; u < n; u++) {
+        while (r < records && merged[r].hex_id < usage[u].hex_id) r++;
+        if (r == records) break;
+        if (merged[r].hex_id != usage[u].hex_id) continue;
+        uint32_t count = (uint32_t)merged[r].count + usage[u].pending;
+        merged[r].count = (uint8_t)(count > USAGE_COUNT_MAX ? USAGE_COUNT_MAX : count);
+    }
+}
+
+// Слияние записей шарда с его изменениями. Возвращает число записей в merged.
+// Новые ключи сразу идут в живой фильтр (лишний ключ фильтру не вредит),
+// в *removed - сколько ключей исчезло из шарда.
+static int merge_shard(const CardInfo* base, uint32_t base_records,
+                       const DeltaEntry* deltas, uint32_t n, CardInfo* merged,
+                       uint32_t* added, uint32_t* removed) {
+    int out = 0;
+    uint32_t bi = 0, di = 0;
+    while (bi < base_records || di < n) {
+        bool has_base = bi < base_records;
+        if (di < n && (!has_base || deltas[di].hex_id <= base[bi].hex_id)) {
+            bool existed = has_base && deltas[di].hex_id == base[bi].hex_id;
+            if (existed) bi++;
+            if (deltas[di].op == DELTA_OP_PUT) {
+                merged[out++] = deltas[di].info;
+                if (!existed) {
+                    card_filter_add(deltas[di].hex_id);
+                    (*added)++;
+                }
+            } else if (existed) {
+                (*removed)++;
+            }
+            di++;
+        } else {
+            merged[out++] = base[bi++];
+        }
+    }
+    return out;
+}
+
+// Пишет записи шарда в один или несколько новых файлов (шарды больше
+// 2 x RECORDS_PER_FILE делятся поровну) и дописывает их в таблицу out.
+static bool write_shard_pieces(const CardInfo* merged, int records, ShardInfo* out, int* out_count) {
+    if (records == 0) return true;  // шард опустел - просто выбывает
+    int pieces = records > 2 * RECORDS_PER_FILE ? (records + RECORDS_PER_FILE - 1) / RECORDS_PER_FILE : 1;
+    if (*out_count + pieces > MAX_SHARDS) {
+        printf("❌ Уплотнение: превышен предел шардов (%d)\n", MAX_SHARDS);
+        return false;
+    }
+    for (int p = 0; p < pieces; p++) {
+        int first = (int)((int64_t)records * p / pieces);
+        int count = (int)((int64_t)records * (p + 1) / pieces) - first;
+        uint8_t* piece = (uint8_t*)malloc(card_file_max_bytes(count) + RECORD_READ_PAD);
+        if (!piece) return false;
+        size_t bytes = card_file_encode(merged + first, (uint32_t)count, piece);
+        ShardInfo* shard = &out[*out_count];
+        memset(shard, 0, sizeof(*shard));
+        shard->file_id = allocate_shard_file_id();
+        shard->records = (uint32_t)count;
+        shard->first_id = merged[first].hex_id;
+        shard->last_id = merged[first + count - 1].hex_id;
+        shard->bytes = (uint32_t)bytes;
+
+        char fname[32];
+        shard_file_name(shard->file_id, fname, sizeof(fname));
+        FILE* fd = bytes ? fopen(fname, "wb") : NULL;
+        bool ok = fd && fwrite(piece, 1, bytes, fd) == bytes && sync_file(fd);
+        if (fd) fclose(fd);
+        free(piece);
+        compaction_stats.compaction_bytes += bytes;
+        (*out_count)++;
+        if (!ok) {
+            printf("❌ Уплотнение: ошибка записи %s\n", fname);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool shard_listed(const ShardInfo* table, int count, uint32_t file_id) {
+    for (int i = 0; i < count; i++) {
+        if (table[i].file_id == file_id) return true;
+    }
+    return false;
+}
+
+static bool card_db_compact_locked();
+
+bool card_db_compact() {
+    if (!compact_mutex) return false;
+    xSemaphoreTake(compact_mutex, portMAX_DELAY);
+    bool ok = card_db_compact_locked();
+    xSemaphoreGive(compact_mutex);
+    return ok;
+}
+
+static bool card_db_compact_locked() {
+    int64_t t_start = esp_timer_get_time();
+
+    // 1. Снимок журнала: изменения, пришедшие во время уплотнения, останутся в нем.
+    //    Метка следующего поколения отделяет в файле снятое от пришедшего позже.
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    uint32_t n = delta_count;
+    DeltaEntry* snapshot = n ? (DeltaEntry*)malloc(n * sizeof(DeltaEntry)) : NULL;
+    if (snapshot) memcpy(snapshot, delta_entries, n * sizeof(DeltaEntry));
+    bool marked = snapshot && delta_log_mark_generation(get_manifest_generation() + 1);
+    xSemaphoreGive(delta_mutex);
+    if (snapshot && !marked) {
+        printf("❌ Уплотнение: не удалось записать метку поколения в %s\n", DELTA_LOG_FILE);
+        free(snapshot);
+        return false;
+    }
+
+    // Счетчики использования едут в шарды, которые переписываются все
+    // равно; ради них самих - только когда пора (card_usage_merge_due)
+    bool usage_due = card_usage_merge_due();
+    uint32_t un = 0;
+    CardUsageDelta* usage = card_usage_collect(&un);
+    if (n == 0 && (!usage_due || un == 0)) {
+        free(snapshot);
+        free(usage);
+        return true;
+    }
+
+    // Текущая таблица шардов (меняет ее только уплотнение)
+    ShardInfo* table = (ShardInfo*)malloc(MAX_SHARDS * sizeof(ShardInfo));
+    ShardInfo* out = (ShardInfo*)malloc(MAX_SHARDS * sizeof(ShardInfo));
+    if ((n && !snapshot) || !table || !out) {
+        printf("❌ Уплотнение: не хватает памяти\n");
+        if (marked) delta_log_unmark();
+        free(snapshot);
+        free(usage);
+        free(table);
+        free(out);
+        return false;
+    }
+    db_lock();
+    int count = get_shard_count();
+    for (int i = 0; i < count; i++) get_shard_info(i, &table[i]);
+    db_unlock();
+    // Пустая база: все карты попадут в один новый шард
+    bool empty_db = count == 0;
+    if (empty_db) {
+        memset(&table[0], 0, sizeof(table[0]));
+        count = 1;
+    }
+
+    compaction_running = true;
+    printf("🗜️  Уплотнение: %lu изменений, %lu счетчиков%s...\n", (unsigned long)n,
+           (unsigned long)un, usage_due ? " (слияние)" : "");
+
+    // 2. Слияние затронутых шардов, остальные переходят в новую таблицу как есть
+    int out_count = 0, rewritten = 0;
+    uint32_t di = 0, ui = 0, keys_added = 0, keys_removed = 0;
+    bool ok = true;
+    for (int s = 0; s < count && ok; s++) {
+        uint32_t d_begin = di, u_begin = ui;
+        while (di < n && (s == count - 1 || snapshot[di].hex_id < table[s + 1].first_id)) di++;
+        while (ui < un && (s == count - 1 || usage[ui].hex_id < table[s + 1].first_id)) ui++;
+        if (d_begin == di && (!usage_due || u_begin == ui)) {
+            // Шард не переписывается - его счетчики ждут следующего раза
+            for (uint32_t u = u_begin; u < ui; u++) usage[u].pending = 0;
+            out[out_count++] = table[s];
+            continue;
+        }
+
+        uint32_t base_records = empty_db ? 0 : table[s].records;
+        CardInfo* base = read_shard_cards(&table[s]);
+        CardInfo* merged = (CardInfo*)malloc((base_records + (di - d_begin)) * sizeof(CardInfo));
+        if (base && merged) {
+            int records = merge_shard(base, base_records, snapshot + d_begin, di - d_begin, merged,
+                                      &keys_added, &keys_removed);
+            apply_usage(merged, records, usage + u_begin, ui - u_begin);
+            ok = write_shard_pieces(merged, records, out, &out_count);
+            rewritten++;
+        } else {
+            ok = false;
+        }
+        free(base);
+        free(merged);
+        taskYIELD();
+    }
+
+    // 3. Новое поколение: манифест и атомарная подмена (поиск не ждет -
+    //    дочитывает прежнее поколение, его файлы удалит commit_shards).
+    //    Влитые счетчики помечаются в usage.log до публикации.
+    //    Фильтр не выключается: новые ключи в нем уже есть, файл с ними
+    //    сохраняется до публикации. Перестройка (по всем шардам) - только
+    //    если ключи удалялись или фильтр переполнен.
+    bool usage_marked = false;
+    if (ok) ok = usage_marked = card_usage_prepare_merge(usage, un, get_manifest_generation() + 1);
+    bool filter_rebuild = false;
+    if (ok && (keys_added > 0 || keys_removed > 0)) {
+        filter_rebuild = keys_removed > 0 || !card_filter_ready() || card_filter_saturated();
+        if (filter_rebuild) card_filter_remove_file();
+        else filter_rebuild = !card_filter_save();
+    }
+    if (ok) {
+        db_lock();
+        ok = commit_shards(out, out_count);
+        if (ok) card_storage_sync();
+        db_unlock();
+        // Влитое вычитается сразу за публикацией (в промежутке поиск может
+        // показать счетчик с учетом влитого дважды - он насыщается на 15)
+        if (ok) card_usage_merged(usage, un);
+        card_cache_invalidate_all();
+        if (filter_rebuild) card_filter_rebuild();
+    }
+    if (!ok) {
+        // Новые файлы в манифест не попали - удаляем их
+        for (int i = 0; i < out_count; i++) {
+            if (shard_listed(table, count, out[i].file_id)) continue;
+            char fname[32];
+            shard_file_name(out[i].file_id, fname, sizeof(fname));
+            remove(fname);
+        }
+        printf("❌ Уплотнение прервано - старая база сохранена\n");
+        if (marked) delta_log_unmark();
+        if (usage_marked) card_usage_merge_failed();
+        free(snapshot);
+        free(usage);
+        free(table);
+        free(out);
+        compaction_running = false;
+        return false;
+    }
+
+    // 4. Перенесенные изменения убираем из журнала (если их не меняли снова)
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t pos = delta_lower_bound(snapshot[i].hex_id);
+        if (pos < delta_count && delta_entries[pos].hex_id == snapshot[i].hex_id &&
+            delta_entries[pos].seq == snapshot[i].seq) {
+            delta_remove_at(pos);
+        }
+    }
+    delta_log_rewrite();
+    xSemaphoreGive(delta_mutex);
+
+    uint32_t total_records = 0;
+    for (int i = 0; i < out_count; i++) total_records += out[i].records;
+    free(snapshot);
+    free(usage);
+    free(table);
+    free(out);
+
+    compaction_stats.runs++;
+    compaction_stats.last_records = total_records;
+    compaction_stats.last_duration_ms = (uint32_t)((esp_timer_get_time() - t_start) / 1000);
+    compaction_running = false;
+
+    printf("✅ Уплотнение завершено: переписано шардов %d, всего %d шардов, %lu записей, %lu мс\n",
+           rewritten, out_count, (unsigned long)total_records,
+           (unsigned long)compaction_stats.last_duration_ms);
+    return true;
+}
+
+// ==========================================
+// ЗАМЕНА БАЗЫ ЦЕЛИКОМ (импорт)
+// ==========================================
+
+bool card_db_replace(const ShardInfo* table, int count) {
+    if (!compact_mutex) return false;
+    xSemaphoreTake(compact_mutex, portMAX_DELAY);
+
+    // Новый список заменяет и накопленные изменения. Журнал держится до
+    // сброса, метка поколения перед публикацией отсекает весь прежний журнал
+    // при сбое до его перезаписи.
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    bool ok = delta_log_mark_generation(get_manifest_generation() + 1);
+    if (ok) {
+        card_filter_invalidate();
+        db_lock();
+        ok = commit_shards(table, count);
+        if (ok) card_storage_sync();
+        db_unlock();
+    } else {
+        printf("❌ Не удалось записать метку поколения в %s\n", DELTA_LOG_FILE);
+    }
+    uint32_t dropped = delta_count;
+    if (ok) delta_count = 0;
+    delta_log_rewrite();  // без метки: при ошибке журнал остается как был
+    card_cache_invalidate_all();
+    xSemaphoreGive(delta_mutex);
+    if (ok && dropped > 0) printf("🗑️ Журнал изменений сброшен: %lu записей\n", (unsigned long)dropped);
+    card_filter_load_or_build();
+
+    xSemaphoreGive(compact_mutex);
+    return ok;
+}
+
+// ==========================================
+// ИНИЦИАЛИЗАЦИЯ
+// ==========================================
+
+static void delta_log_replay() {
+    FILE* fd = fopen(DELTA_LOG_FILE, "rb");
+    if (!fd) return;
+
+    // Метка опубликованного поколения: все выше нее уже в шардах
+    uint32_t generation = get_manifest_generation();
+    uint32_t replayed = 0, merged = 0;
+    bool torn = false, stale = false;
+    DeltaLogRecord rec;
+    while (fread(&rec, sizeof(rec), 1, fd) == 1) {
+        if (rec.crc != crc8((const uint8_t*)&rec, sizeof(rec) - 1) ||
+            (rec.op != DELTA_OP_PUT && rec.op != DELTA_OP_DELETE && rec.op != DELTA_OP_GENERATION)) {
+            torn = true;
+            break;
+        }
+        if (rec.op == DELTA_OP_GENERATION) {
+            if (rec.hex_id <= generation) {
+                merged += replayed;
+                replayed = 0;
+                delta_count = 0;
+            } else {
+                stale = true;  // сбой до публикации: метка не должна дождаться своего номера
+            }
+            continue;
+        }
+        CardInfo ci;
+        record_to_card(&rec, &ci);
+        if (!delta_apply(rec.hex_id, rec.op, &ci, NULL)) {
+            torn = true;
+            break;
+        }
+        replayed++;
+    }
+    fclose(fd);
+
+    // Оборванный хвост отрезаем, иначе новые записи окажутся за мусором;
+    // влитое до сбоя - чтобы не перечитывать его при каждом старте
+    if (torn) {
+        printf("⚠️ Журнал изменений поврежден после %lu записей - перезаписываем\n",
+               (unsigned long)replayed);
+    }
+    if (merged > 0) {
+        printf("⚠️ Журнал не сброшен после уплотнения: пропущено %lu влитых записей\n",
+               (unsigned long)merged);
+    }
+    if (torn || merged > 0 || stale) delta_log_rewrite();
+    printf("✅ Журнал изменений: %lu записей, %lu активных\n",
+           (unsigned long)replayed, (unsigned long)delta_count);
+}
+
+static void compaction_task(void* pvParameters) {
+    while (1) {
+        // Просыпаемся по запросу или периодически, если журнал не пуст
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DELTA_COMPACT_INTERVAL_MS));
+        if (delta_count > 0 || card_usage_merge_due()) {
+            card_db_compact();
+        }
+    }
+}
+
+void card_db_init() {
+    if (delta_mutex) return;
+    delta_mutex = xSemaphoreCreateMutex();
+    compact_mutex = xSemaphoreCreateMutex();
+    if (!delta_mutex || !compact_mutex) {
+        printf("❌ Не удалось создать мьютекс журнала изменений\n");
+        return;
+    }
+
+    xSemaphoreTake(delta_mutex, portMAX_DELAY);
+    delta_log_replay();
+    xSemaphoreGive(delta_mutex);
+
+    xTaskCreatePinnedToCore(compaction_task, "compaction", 6144, NULL,
+                            tskIDLE_PRIORITY, &compaction_task_handle, 0);
+}
+
+void card_db_request_compaction() {
+    if (compaction_task_handle) xTaskNotifyGive(compaction_task_handle);
+}
+
+bool card_db_compaction_running() {
+    return compaction_running;
+}
+
+// ==========================================
+// СТАТИСТИКА
+// ==========================================
+
+void get_compaction_stats(CompactionStats* out) {
+    *out = compaction_stats;
+}
+
+void print_compaction_stats() {
+    const CompactionStats* s = &compaction_stats;
+    // Полезный объем изменения - одна упакованная запись
+    uint64_t logical = (uint64_t)s->mutations * ((RECORD_BITS + 7) / 8);
+    printf("🗜️  Журнал: %lu активных | изменений %lu | журнал %llu Б | уплотнений %lu (%llu Б, последнее %lu мс)\n",
+           (unsigned long)delta_count, (unsigned long)s->mutations,
+           (unsigned long long)s->log_bytes, (unsigned long)s->runs,
+           (unsigned long long)s->compaction_bytes, (unsigned long)s->last_duration_ms);
+    if (logical > 0) {
+        printf("   Усиление записи: %.1fx\n",
+               (double)(s->log_bytes + s->compaction_bytes) / (double)logical);
+    }
+
+    SearchStats ss;
+    get_search_stats(&ss);
+    if (ss.requests > 0) {
+        printf("   Поиск: в среднем %llu мкс", (unsigned long long)(ss.request_us / ss.requests));
+        if (ss.compaction_requests > 0) {
+            printf(" | во время уплотнения %llu мкс (%lu запросов)",
+                   (unsigned long long)(ss.compaction_request_us / ss.compaction_requests),
+                   (unsigned long)ss.compaction_requests);
+        }
+        printf("\n");
+    }
+}
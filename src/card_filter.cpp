@@ -0,0 +1,326 @@
+#include "card_filter.h"
+#include "search.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define FILTER_FILE MOUNT_POINT "/filter.bin"
+#define FILTER_MAGIC 0x544C4643  // "CFLT"
+#define FILTER_VERSION 1
+#define FILTER_MAX_HASHES 16
+
+struct FilterHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t  num_hashes;
+    uint8_t  reserved;
+    uint32_t num_bits;
+    uint32_t num_keys;
+    uint32_t fp_rate_ppm;
+};
+
+struct CardFilter {
+    uint32_t* bits;
+    uint32_t num_bits;
+    uint32_t num_keys;
+    uint8_t  num_hashes;
+    uint32_t fp_rate_ppm;
+};
+
+static CardFilter filter = {};
+static bool filter_enabled = true;
+static float target_fp_rate = CARD_FILTER_FP_RATE;
+static portMUX_TYPE filter_mux = portMUX_INITIALIZER_UNLOCKED;
+// Сохранения, читающие биты вне критической секции: пока они есть,
+// подмененный фильтр не освобождается
+static uint32_t filter_pins = 0;
+
+// ==========================================
+// ХЕШИРОВАНИЕ
+// ==========================================
+
+// Финализатор splitmix64: хорошее перемешивание 56-битных ключей
+static inline uint64_t filter_hash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Двойное хеширование h1 + i*h2, приведение к [0, num_bits) без деления
+static inline void filter_set_key(uint32_t* bits, uint32_t num_bits, uint8_t k, uint64_t hex_id) {
+    uint64_t h = filter_hash(hex_id);
+    uint32_t h1 = (uint32_t)h;
+    uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    for (uint8_t i = 0; i < k; i++) {
+        uint32_t pos = (uint32_t)(((uint64_t)(h1 + i * h2) * num_bits) >> 32);
+        bits[pos >> 5] |= 1u << (pos & 31);
+    }
+}
+
+static inline bool filter_test_key(const uint32_t* bits, uint32_t num_bits, uint8_t k, uint64_t hex_id) {
+    uint64_t h = filter_hash(hex_id);
+    uint32_t h1 = (uint32_t)h;
+    uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    for (uint8_t i = 0; i < k; i++) {
+        uint32_t pos = (uint32_t)(((uint64_t)(h1 + i * h2) * num_bits) >> 32);
+        if (!(bits[pos >> 5] & (1u << (pos & 31)))) return false;
+    }
+    return true;
+}
+
+static size_t filter_words(uint32_t num_bits) {
+    return (num_bits + 31) / 32;
+}
+
+// Снимок полей фильтра под блокировкой
+static CardFilter filter_snapshot() {
+    portENTER_CRITICAL(&filter_mux);
+    CardFilter f = filter;
+    portEXIT_CRITICAL(&filter_mux);
+    return f;
+}
+
+// Снимок с закреплением битов: до filter_unpin их можно читать без
+// блокировки (card_filter_add в это время только добавляет биты)
+static CardFilter filter_pin() {
+    portENTER_CRITICAL(&filter_mux);
+    CardFilter f = filter;
+    if (f.bits) filter_pins++;
+    portEXIT_CRITICAL(&filter_mux);
+    return f;
+}
+
+static void filter_unpin() {
+    portENTER_CRITICAL(&filter_mux);
+    filter_pins--;
+    portEXIT_CRITICAL(&filter_mux);
+}
+
+// Подменяет текущий фильтр новым; старый освобождается вне критической
+// секции, когда его отпустят сохранения
+static void filter_install(const CardFilter* next) {
+    portENTER_CRITICAL(&filter_mux);
+    uint32_t* old_bits = filter.bits;
+    if (next) filter = *next;
+    else memset(&filter, 0, sizeof(filter));
+    portEXIT_CRITICAL(&filter_mux);
+    if (old_bits) {
+        while (__atomic_load_n(&filter_pins, __ATOMIC_SEQ_CST) != 0) vTaskDelay(1);
+    }
+    free(old_bits);
+}
+
+// ==========================================
+// ПОСТРОЕНИЕ И ХРАНЕНИЕ
+// ==========================================
+
+static bool filter_save(const CardFilter* f) {
+    FILE* fd = fopen(FILTER_FILE, "wb");
+    if (!fd) {
+        printf("❌ Не могу создать файл фильтра\n");
+        return false;
+    }
+    FilterHeader hdr = {};
+    hdr.magic = FILTER_MAGIC;
+    hdr.version = FILTER_VERSION;
+    hdr.num_hashes = f->num_hashes;
+    hdr.num_bits = f->num_bits;
+    hdr.num_keys = f->num_keys;
+    hdr.fp_rate_ppm = f->fp_rate_ppm;
+    size_t bytes = filter_words(f->num_bits) * sizeof(uint32_t);
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fd) == 1 &&
+              fwrite(f->bits, 1, bytes, fd) == bytes;
+    fclose(fd);
+    if (!ok) {
+        printf("❌ Ошибка записи файла фильтра\n");
+        remove(FILTER_FILE);
+    }
+    return ok;
+}
+
+static bool filter_load() {
+    FILE* fd = fopen(FILTER_FILE, "rb");
+    if (!fd) return false;
+
+    FilterHeader hdr;
+    uint32_t fp_ppm = (uint32_t)(target_fp_rate * 1000000.0f);
+    if (fread(&hdr, sizeof(hdr), 1, fd) != 1 || hdr.magic != FILTER_MAGIC ||
+        hdr.version != FILTER_VERSION || hdr.num_bits == 0 ||
+        hdr.num_hashes == 0 || hdr.num_hashes > FILTER_MAX_HASHES ||
+        hdr.fp_rate_ppm != fp_ppm) {
+        fclose(fd);
+        return false;
+    }
+
+    size_t bytes = filter_words(hdr.num_bits) * sizeof(uint32_t);
+    uint32_t* bits = (uint32_t*)malloc(bytes);
+    if (!bits) {
+        fclose(fd);
+        return false;
+    }
+    bool ok = fread(bits, 1, bytes, fd) == bytes;
+    fclose(fd);
+    if (!ok) {
+        free(bits);
+        return false;
+    }
+
+    CardFilter next = {bits, hdr.num_bits, hdr.num_keys, hdr.num_hashes, hdr.fp_rate_ppm};
+    filter_install(&next);
+    return true;
+}
+
+bool card_filter_rebuild() {
+    int64_t t_start = esp_timer_get_time();
+
+    // 1. Число ключей по манифесту
+    uint32_t total_keys = 0;
+    for (int f = 0; f < get_shard_count(); f++) {
+        ShardInfo shard;
+        if (get_shard_info(f, &shard)) total_keys += shard.records;
+    }
+    if (total_keys == 0) {
+        printf("⚠️ Фильтр: база пуста, фильтр отключен\n");
+        filter_install(NULL);
+        return false;
+    }
+
+    // 2. Размер: m = -n*ln(p)/ln(2)^2, k = m/n*ln(2)
+    double p = target_fp_rate;
+    if (p <= 0.0 || p >= 1.0) p = 0.01;
+    double m = ceil(-(double)total_keys * log(p) / (M_LN2 * M_LN2));
+    int k = (int)lround(m / total_keys * M_LN2);
+    if (k < 1) k = 1;
+    if (k > FILTER_MAX_HASHES) k = FILTER_MAX_HASHES;
+
+    CardFilter next = {};
+    next.num_bits = (uint32_t)m;
+    next.num_hashes = (uint8_t)k;
+    next.fp_rate_ppm = (uint32_t)(target_fp_rate * 1000000.0f);
+    next.bits = (uint32_t*)calloc(filter_words(next.num_bits), sizeof(uint32_t));
+    if (!next.bits) {
+        printf("❌ Фильтр: не хватает памяти (%u байт)\n",
+               (unsigned)(filter_words(next.num_bits) * sizeof(uint32_t)));
+        return false;
+    }
+
+    // 3. Ключи всех шардов, по одному шарду в RAM
+    for (int f = 0; f < get_shard_count(); f++) {
+        ShardInfo shard;
+        if (!get_shard_info(f, &shard)) continue;
+        CardInfo* cards = read_shard_cards(&shard);
+        if (!cards) continue;
+        for (uint32_t r = 0; r < shard.records; r++) {
+            filter_set_key(next.bits, next.num_bits, next.num_hashes, cards[r].hex_id);
+        }
+        next.num_keys += shard.records;
+        free(cards);
+    }
+
+    bool saved = filter_save(&next);
+    filter_install(&next);
+
+    printf("✅ Фильтр построен: %lu ключей, %lu бит, k=%d, %lu мс%s\n",
+           (unsigned long)next.num_keys, (unsigned long)next.num_bits, k,
+           (unsigned long)((esp_timer_get_time() - t_start) / 1000),
+           saved ? "" : " (не сохранен)");
+    return true;
+}
+
+void card_filter_load_or_build() {
+    if (card_filter_ready()) return;
+    if (filter_load()) {
+        printf("✅ Фильтр загружен: %lu ключей, %u байт\n",
+               (unsigned long)card_filter_key_count(), (unsigned)card_filter_memory_bytes());
+        return;
+    }
+    card_filter_rebuild();
+}
+
+void card_filter_invalidate() {
+    filter_install(NULL);
+    remove(FILTER_FILE);
+}
+
+// ==========================================
+// ПРОВЕРКА
+// ==========================================
+
+void card_filter_add(uint64_t hex_id) {
+    portENTER_CRITICAL(&filter_mux);
+    if (filter.bits) {
+        filter_set_key(filter.bits, filter.num_bits, filter.num_hashes, hex_id);
+        filter.num_keys++;
+    }
+    portEXIT_CRITICAL(&filter_mux);
+}
+
+bool card_filter_save() {
+    CardFilter f = filter_pin();
+    if (!f.bits) return false;
+    bool ok = filter_save(&f);
+    filter_unpin();
+    return ok;
+}
+
+void card_filter_remove_file() {
+    remove(FILTER_FILE);
+}
+
+// Оценка для n ключей в m битах при k хешах: (1 - e^(-k*n/m))^k
+bool card_filter_saturated() {
+    CardFilter f = filter_snapshot();
+    if (!f.bits) return false;
+    double fill = 1.0 - exp(-(double)f.num_hashes * f.num_keys / f.num_bits);
+    double fp_rate = pow(fill, f.num_hashes);
+    return fp_rate > f.fp_rate_ppm / 1000000.0 * CARD_FILTER_SATURATION;
+}
+
+bool card_filter_may_contain(uint64_t hex_id) {
+    if (!filter_enabled) return true;
+    portENTER_CRITICAL(&filter_mux);
+    bool result = !filter.bits ||
+                  filter_test_key(filter.bits, filter.num_bits, filter.num_hashes, hex_id);
+    portEXIT_CRITICAL(&filter_mux);
+    return result;
+}
+
+void card_filter_set_enabled(bool enable) {
+    filter_enabled = enable;
+}
+
+void card_filter_set_fp_rate(float fp_rate) {
+    target_fp_rate = fp_rate;
+}
+
+bool card_filter_ready() {
+    return filter_snapshot().bits != NULL;
+}
+
+size_t card_filter_memory_bytes() {
+    CardFilter f = filter_snapshot();
+    return f.bits ? filter_words(f.num_bits) * sizeof(uint32_t) : 0;
+}
+
+uint32_t card_filter_key_count() {
+    return filter_snapshot().num_keys;
+}
+
+void print_card_filter_info() {
+    CardFilter f = filter_snapshot();
+    if (!f.bits) {
+        printf("🧮 Фильтр: не готов (все карты идут в поиск по базе)\n");
+        return;
+    }
+    printf("🧮 Фильтр: %lu ключей | %u байт RAM | k=%d | цель FP %.3f%%\n",
+           (unsigned long)f.num_keys, (unsigned)filter_words(f.num_bits) * (unsigned)sizeof(uint32_t),
+           f.num_hashes, f.fp_rate_ppm / 10000.0);
+}
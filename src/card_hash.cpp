@@ -0,0 +1,232 @@
+#include "card_hash.h"
+#include "search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_timer.h"
+
+#define HASH_MAGIC 0x58494843  // "CHIX"
+#define HASH_VERSION 1
+#define HASH_FILE_PATTERN "%s/hash_%lu.bin"  // каталог, поколение
+// Заполнение 80%: цепочки из двух корзин редки
+#define HASH_LOAD_PERCENT 80
+// Цепочка длиннее - индекс не годится (все корзины полны)
+#define HASH_MAX_CHAIN 16
+
+struct HashFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t bucket_bytes;
+    uint32_t generation;
+    uint32_t bucket_count;
+    uint32_t records;
+    uint32_t shards_sign;  // подпись списка шардов поколения
+};
+
+static_assert(sizeof(HashFileHeader) <= CARD_HASH_BUCKET_BYTES, "Заголовок не помещается в корзину");
+
+// ==========================================
+// ХЕШИРОВАНИЕ
+// ==========================================
+
+// Финализатор splitmix64 (как у фильтра, card_filter.cpp)
+static inline uint64_t hash_key(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Старшие биты - корзина (без деления), младшие - отпечаток (не 0)
+static inline uint32_t hash_bucket(uint64_t h, uint32_t bucket_count) {
+    return (uint32_t)(((h >> 32) * bucket_count) >> 32);
+}
+
+static inline uint32_t hash_fingerprint(uint64_t h) {
+    uint32_t fp = (uint32_t)(h & 0xFFFF);
+    return fp ? fp : 1;
+}
+
+static uint32_t shards_signature(const ShardInfo* shards, int count) {
+    uint64_t sign = (uint64_t)count;
+    for (int i = 0; i < count; i++) {
+        sign = hash_key(sign ^ shards[i].first_id);
+        sign = hash_key(sign ^ shards[i].last_id);
+        sign = hash_key(sign ^ ((uint64_t)shards[i].file_id << 32 | shards[i].records));
+    }
+    return (uint32_t)sign;
+}
+
+void card_hash_file_name(uint32_t generation, char* buf, size_t len) {
+    snprintf(buf, len, HASH_FILE_PATTERN, MOUNT_POINT, (unsigned long)generation);
+}
+
+// ==========================================
+// ПОСТРОЕНИЕ
+// ==========================================
+
+static bool hash_insert(uint32_t* buckets, uint32_t bucket_count, uint64_t hex_id, uint32_t slot_value) {
+    uint64_t h = hash_key(hex_id);
+    uint32_t b = hash_bucket(h, bucket_count);
+    uint32_t cell = hash_fingerprint(h) << 16 | slot_value;
+    for (uint32_t step = 0; step < bucket_count && step < HASH_MAX_CHAIN; step++) {
+        uint32_t* bucket = buckets + (size_t)b * CARD_HASH_BUCKET_SLOTS;
+        for (int s = 0; s < CARD_HASH_BUCKET_SLOTS; s++) {
+            if (bucket[s] == 0) {
+                bucket[s] = cell;
+                return true;
+            }
+        }
+        b = b + 1 == bucket_count ? 0 : b + 1;
+    }
+    return false;
+}
+
+// Корзины строятся в RAM, шарды читаются по одному; заголовок - последним
+static bool hash_build(const ShardInfo* shards, int count, const HashFileHeader* hdr, const char* path) {
+    size_t bucket_bytes = (size_t)hdr->bucket_count * CARD_HASH_BUCKET_BYTES;
+    uint32_t* buckets = (uint32_t*)calloc(1, bucket_bytes);
+    if (!buckets) {
+        printf("❌ Хеш-индекс: не хватает памяти (%u байт)\n", (unsigned)bucket_bytes);
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        if ((shards[i].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS > 256) {
+            printf("❌ Хеш-индекс: шард %d больше 256 блоков\n", i);
+            ok = false;
+            break;
+        }
+        CardInfo* cards = read_shard_cards(&shards[i]);
+        if (!cards) {
+            ok = false;
+            break;
+        }
+        for (uint32_t r = 0; r < shards[i].records && ok; r++) {
+            ok = hash_insert(buckets, hdr->bucket_count, cards[r].hex_id,
+                             (uint32_t)i << 8 | (r / INDEX_BLOCK_RECORDS));
+        }
+        free(cards);
+    }
+
+    FILE* fd = ok ? fopen(path, "wb") : NULL;
+    if (fd) {
+        uint8_t head[CARD_HASH_BUCKET_BYTES];
+        memset(head, 0, sizeof(head));
+        ok = fwrite(head, 1, sizeof(head), fd) == sizeof(head) &&
+             fwrite(buckets, 1, bucket_bytes, fd) == bucket_bytes &&
+             fseek(fd, 0, SEEK_SET) == 0 &&
+             fwrite(hdr, sizeof(*hdr), 1, fd) == 1 &&
+             sync_file(fd);
+        fclose(fd);
+        if (!ok) remove(path);
+    } else if (ok) {
+        ok = false;
+    }
+    free(buckets);
+    if (!ok) printf("❌ Хеш-индекс: не удалось записать %s\n", path);
+    return ok;
+}
+
+static bool hash_file_valid(const char* path, const HashFileHeader* expect) {
+    struct stat st;
+    if (stat(path, &st) != 0 ||
+        (size_t)st.st_size != ((size_t)expect->bucket_count + 1) * CARD_HASH_BUCKET_BYTES) {
+        return false;
+    }
+    FILE* fd = fopen(path, "rb");
+    if (!fd) return false;
+    HashFileHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, fd) == 1;
+    fclose(fd);
+    return ok && memcmp(&hdr, expect, sizeof(hdr)) == 0;
+}
+
+CardHashIndex* card_hash_open(const ShardInfo* shards, int count, uint32_t generation) {
+    if (count > 256) {
+        printf("❌ Хеш-индекс: %d шардов, номер шарда в ячейке - 8 бит\n", count);
+        return NULL;
+    }
+    int64_t t_start = esp_timer_get_time();
+    uint32_t records = 0;
+    for (int i = 0; i < count; i++) records += shards[i].records;
+
+    HashFileHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = HASH_MAGIC;
+    hdr.version = HASH_VERSION;
+    hdr.bucket_bytes = CARD_HASH_BUCKET_BYTES;
+    hdr.generation = generation;
+    hdr.bucket_count = (uint32_t)(((uint64_t)records * 100 / HASH_LOAD_PERCENT + CARD_HASH_BUCKET_SLOTS - 1) /
+                                  CARD_HASH_BUCKET_SLOTS);
+    if (hdr.bucket_count == 0) hdr.bucket_count = 1;
+    hdr.records = records;
+    hdr.shards_sign = shards_signature(shards, count);
+
+    CardHashIndex* idx = (CardHashIndex*)malloc(sizeof(CardHashIndex));
+    if (!idx) return NULL;
+    card_hash_file_name(generation, idx->path, sizeof(idx->path));
+    idx->generation = generation;
+    idx->bucket_count = hdr.bucket_count;
+    idx->records = records;
+    idx->bytes = ((size_t)hdr.bucket_count + 1) * CARD_HASH_BUCKET_BYTES;
+    idx->build_us = 0;
+
+    // Файл того же поколения и тех же шардов - готов (загрузка после перезагрузки)
+    if (hash_file_valid(idx->path, &hdr)) return idx;
+    if (!hash_build(shards, count, &hdr, idx->path)) {
+        free(idx);
+        return NULL;
+    }
+    idx->build_us = (uint32_t)(esp_timer_get_time() - t_start);
+    return idx;
+}
+
+void card_hash_close(CardHashIndex* idx, bool remove_file) {
+    if (!idx) return;
+    if (remove_file) remove(idx->path);
+    free(idx);
+}
+
+// ==========================================
+// ПОИСК
+// ==========================================
+
+int card_hash_probe(const CardHashIndex* idx, uint64_t hex_id, CardHashRef* out, int max, uint32_t* bytes_read) {
+    *bytes_read = 0;
+    FILE* fd = fopen(idx->path, "rb");
+    if (!fd) return -1;
+
+    uint64_t h = hash_key(hex_id);
+    uint32_t b = hash_bucket(h, idx->bucket_count);
+    uint32_t fp = hash_fingerprint(h);
+    uint32_t bucket[CARD_HASH_BUCKET_SLOTS];
+    int found = 0;
+    for (uint32_t step = 0; step < idx->bucket_count && step < HASH_MAX_CHAIN; step++) {
+        if (fseek(fd, (long)(b + 1) * CARD_HASH_BUCKET_BYTES, SEEK_SET) != 0 ||
+            fread(bucket, 1, sizeof(bucket), fd) != sizeof(bucket)) {
+            fclose(fd);
+            return -1;
+        }
+        *bytes_read += sizeof(bucket);
+        bool has_empty = false;
+        for (int s = 0; s < CARD_HASH_BUCKET_SLOTS; s++) {
+            if (bucket[s] == 0) {
+                has_empty = true;
+                break;  // ячейки корзины заполняются по порядку
+            }
+            if ((bucket[s] >> 16) == fp && found < max) {
+                out[found].file_idx = (uint8_t)(bucket[s] >> 8);
+                out[found].block_idx = (uint8_t)bucket[s];
+                found++;
+            }
+        }
+        if (has_empty) break;
+        b = b + 1 == idx->bucket_count ? 0 : b + 1;
+    }
+    fclose(fd);
+    return found;
+}
@@ -0,0 +1,758 @@
+#include "card_import.h"
+#include "card_block.h"
+#include "card_record.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#ifdef CARD_IMPORT_OFFLINE
+#include <time.h>
+#else
+#include "card_db.h"
+#include "search.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#ifdef ESP_PLATFORM
+#include "driver/uart.h"
+#endif
+#endif
+
+#define IMPORT_MAX_RUNS 256
+#define IMPORT_READ_CHUNK 256
+#define IMPORT_LINE_MAX 96
+#define IMPORT_HEX_DIGITS 14
+#define IMPORT_ALIGN 8
+
+#define IMPORT_BOOT_FILE MOUNT_POINT "/import.csv"
+#define IMPORT_ERROR_FILE MOUNT_POINT "/import.err"
+
+// Колонки CSV после HEX: X(поле CardInfo, основание числа, значение для
+// пустой колонки). Предел значения - ширина поля в схеме записи; поля
+// схемы, которых здесь нет (счетчик), при импорте обнуляются.
+#define IMPORT_CSV_COLUMNS(X)   \
+    X(status, 10, 1)            \
+    X(zones, 0, 0xFF)           \
+    X(link, 0, 0)
+
+#define IMPORT_CSV_COLUMN_COUNT(name, base, def) + 1
+#define IMPORT_CSV_FIELDS (1 IMPORT_CSV_COLUMNS(IMPORT_CSV_COLUMN_COUNT))
+
+// Разбор колонки в parse_line: пустая или отсутствующая - значение по умолчанию
+#define IMPORT_CSV_PARSE(name, base, def)                                          \
+    {                                                                              \
+        unsigned long v = (def);                                                   \
+        if (n > col && fields[col][0] &&                                           \
+            !parse_number(fields[col], base, CARD_ATTR_MAX(name), &v)) return -1;  \
+        ci.name = v;                                                               \
+        col++;                                                                     \
+    }
+
+// Запись прогона: seq - номер строки, при равных ключах побеждает больший;
+// атрибуты упакованы по схеме (card_pack_attrs)
+struct ImportRecord {
+    uint64_t hex_id;
+    uint32_t seq;
+    uint32_t attrs;
+};
+
+static_assert(CARD_ATTR_BITS <= 32, "Атрибуты записи прогона - 32 бита");
+
+static_assert(sizeof(ImportRecord) == 16, "Запись прогона должна занимать 16 байт");
+
+// Временный файл прогона: блоки card_block.h подряд, без заголовка
+struct ImportRun {
+    uint32_t file_no;
+    uint32_t records;
+};
+
+// Курсор прогона при слиянии: в RAM только текущий блок
+struct RunReader {
+    uint32_t file_no;
+    uint32_t left;      // записей еще в файле
+    uint32_t offset;    // следующий блок
+    int pos;
+    int n;
+    CardInfo cards[INDEX_BLOCK_RECORDS];
+    uint8_t buf[CARD_BLOCK_MAX_BYTES + RECORD_READ_PAD];
+};
+
+// Приемник слияния: временный прогон или шарды базы
+struct MergeSink {
+    bool shards;
+    CardInfo block[INDEX_BLOCK_RECORDS];
+    int block_n;
+    uint8_t* out;          // буфер блока (прогон) или шарда целиком
+    // Прогон
+    FILE* fd;
+    uint32_t records;
+    // Шард
+    size_t shard_pos;
+    uint32_t shard_records;
+    uint64_t first_id;
+    uint64_t last_id;
+};
+
+struct ImportContext {
+    const char* dir;
+    uint32_t (*next_id)(void);
+    ShardInfo* table;
+    int count;
+    CardImportStats* stats;
+
+    ImportRun* runs;       // в начале рабочего буфера
+    int run_count;
+    uint32_t next_run_file;
+    uint8_t* work;         // остаток буфера, меняет назначение по фазам
+    size_t work_bytes;
+};
+
+// ==========================================
+// ВСПОМОГАТЕЛЬНЫЕ
+// ==========================================
+
+static int64_t import_now_us() {
+#ifdef CARD_IMPORT_OFFLINE
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+    return esp_timer_get_time();
+#endif
+}
+
+static inline void import_yield() {
+#ifndef CARD_IMPORT_OFFLINE
+    taskYIELD();
+#endif
+}
+
+static inline size_t align_up(size_t n) {
+    return (n + IMPORT_ALIGN - 1) & ~(size_t)(IMPORT_ALIGN - 1);
+}
+
+static void run_file_name(const ImportContext* ctx, uint32_t file_no, char* buf, size_t len) {
+    snprintf(buf, len, "%s/run_%lu.tmp", ctx->dir, (unsigned long)file_no);
+}
+
+static void output_file_name(const ImportContext* ctx, uint32_t file_id, char* buf, size_t len) {
+    snprintf(buf, len, SHARD_FILE_PATTERN, ctx->dir, (unsigned long)file_id);
+}
+
+// ==========================================
+// РАЗБОР СТРОК
+// ==========================================
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool parse_hex_id(const char* s, uint64_t* out) {
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) s += 2;
+    size_t len = strlen(s);
+    if (len == 0 || len > IMPORT_HEX_DIGITS) return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!isxdigit((unsigned char)s[i])) return false;
+        v = (v << 4) | (uint64_t)(isdigit((unsigned char)s[i]) ? s[i] - '0' : (tolower((unsigned char)s[i]) - 'a' + 10));
+    }
+    *out = v;
+    return true;
+}
+
+static bool parse_number(const char* s, int base, unsigned long max, unsigned long* out) {
+    if (!isdigit((unsigned char)s[0])) return false;
+    char* end;
+    unsigned long v = strtoul(s, &end, base);
+    if (*end != '\0' || v > max) return false;
+    *out = v;
+    return true;
+}
+
+// 1 - запись, 0 - пустая строка или комментарий, -1 - строка не распознана
+static int parse_line(char* line, ImportRecord* out) {
+    char* p = line;
+    while (is_blank(*p)) p++;
+    if (*p == '\0' || *p == '#') return 0;
+
+    // Поля: пробелы вокруг разделителя не в счет, пустое поле - значение по умолчанию
+    char* fields[IMPORT_CSV_FIELDS];
+    int n = 0;
+    while (*p) {
+        if (n == IMPORT_CSV_FIELDS) return -1;
+        fields[n++] = p;
+        while (*p && *p != ',' && *p != ';' && !is_blank(*p)) p++;
+        char* end = p;
+        while (is_blank(*p)) p++;
+        if (*p == ',' || *p == ';') {
+            p++;
+            while (is_blank(*p)) p++;
+        }
+        *end = '\0';
+    }
+
+    CardInfo ci = {};
+    if (!parse_hex_id(fields[0], &ci.hex_id)) return -1;
+    int col = 1;
+    IMPORT_CSV_COLUMNS(IMPORT_CSV_PARSE)
+    out->hex_id = ci.hex_id;
+    out->attrs = (uint32_t)card_pack_attrs(&ci);
+    return 1;
+}
+
+// ==========================================
+// ФАЗА 1: ПРОГОНЫ
+// ==========================================
+
+static int compare_records(const void* a, const void* b) {
+    const ImportRecord* ra = (const ImportRecord*)a;
+    const ImportRecord* rb = (const ImportRecord*)b;
+    if (ra->hex_id != rb->hex_id) return ra->hex_id < rb->hex_id ? -1 : 1;
+    return ra->seq < rb->seq ? -1 : (ra->seq > rb->seq ? 1 : 0);
+}
+
+// Место под упаковку блока прогона - в конце рабочего буфера
+static size_t run_staging_bytes() {
+    return align_up(INDEX_BLOCK_RECORDS * sizeof(CardInfo)) + align_up(CARD_BLOCK_MAX_BYTES + RECORD_READ_PAD);
+}
+
+// Сортирует буфер, убирает повторы и пишет прогон во временный файл
+static bool flush_run(ImportContext* ctx, ImportRecord* records, uint32_t n) {
+    if (n == 0) return true;
+    if (ctx->run_count >= IMPORT_MAX_RUNS) {
+        printf("❌ Импорт: больше %d прогонов - увеличьте IMPORT_MEMORY_BYTES\n", IMPORT_MAX_RUNS);
+        return false;
+    }
+    qsort(records, n, sizeof(ImportRecord), compare_records);
+
+    CardInfo* block = (CardInfo*)(ctx->work + ctx->work_bytes - run_staging_bytes());
+    uint8_t* encoded = (uint8_t*)block + align_up(INDEX_BLOCK_RECORDS * sizeof(CardInfo));
+
+    ImportRun* run = &ctx->runs[ctx->run_count];
+    run->file_no = ctx->next_run_file++;
+    run->records = 0;
+    char fname[64];
+    run_file_name(ctx, run->file_no, fname, sizeof(fname));
+    FILE* fd = fopen(fname, "wb");
+    if (!fd) {
+        printf("❌ Импорт: не удалось создать %s\n", fname);
+        return false;
+    }
+    ctx->run_count++;
+
+    bool ok = true;
+    int block_n = 0;
+    for (uint32_t i = 0; i < n && ok; i++) {
+        if (i + 1 < n && records[i + 1].hex_id == records[i].hex_id) {
+            ctx->stats->duplicates++;  // позже в файле есть та же карта
+            continue;
+        }
+        CardInfo* ci = &block[block_n++];
+        ci->hex_id = records[i].hex_id;
+        card_unpack_attrs(records[i].attrs, ci);
+        if (block_n == INDEX_BLOCK_RECORDS || i + 1 == n) {
+            size_t bytes = card_block_encode(block, block_n, encoded);
+            ok = bytes > 0 && fwrite(encoded, 1, bytes, fd) == bytes;
+            ctx->stats->bytes_written += bytes;
+            run->records += block_n;
+            block_n = 0;
+        }
+    }
+    fclose(fd);
+    if (!ok) printf("❌ Импорт: ошибка записи %s\n", fname);
+    return ok;
+}
+
+static bool build_runs(ImportContext* ctx, CardImportRead read, void* src) {
+    ImportRecord* records = (ImportRecord*)ctx->work;
+    uint32_t capacity = (uint32_t)((ctx->work_bytes - run_staging_bytes()) / sizeof(ImportRecord));
+    uint32_t n = 0;
+
+    char chunk[IMPORT_READ_CHUNK];
+    char line[IMPORT_LINE_MAX];
+    size_t line_len = 0;
+    bool overflow = false;
+    bool ok = true;
+    bool eof = false;
+    while (ok && !eof) {
+        size_t got = read(src, chunk, sizeof(chunk));
+        eof = got == 0;
+        ctx->stats->bytes_in += got;
+        // Конец потока завершает последнюю строку без перевода строки
+        size_t end = eof ? 1 : got;
+        for (size_t i = 0; i < end && ok; i++) {
+            char c = eof ? '\n' : chunk[i];
+            if (c != '\n') {
+                if (line_len < sizeof(line) - 1) line[line_len++] = c;
+                else overflow = true;
+                continue;
+            }
+            if (eof && line_len == 0 && !overflow) break;
+            line[line_len] = '\0';
+            ctx->stats->lines++;
+            int parsed = overflow ? -1 : parse_line(line, &records[n]);
+            line_len = 0;
+            overflow = false;
+            if (parsed < 0) {
+                ctx->stats->rejected++;
+                continue;
+            }
+            if (parsed == 0) continue;
+            records[n].seq = ctx->stats->records_in++;
+            if (++n == capacity) {
+                ok = flush_run(ctx, records, n);
+                n = 0;
+                import_yield();
+            }
+        }
+    }
+    return ok && flush_run(ctx, records, n);
+}
+
+// ==========================================
+// ФАЗА 2: СЛИЯНИЕ
+// ==========================================
+
+// Следующий блок прогона (файл открывается на одно чтение: на SPIFFS
+// открытых файлов не больше max_files, а прогонов может быть десятки)
+static bool reader_refill(const ImportContext* ctx, RunReader* r) {
+    r->pos = 0;
+    r->n = 0;
+    if (r->left == 0) return true;
+
+    char fname[64];
+    run_file_name(ctx, r->file_no, fname, sizeof(fname));
+    FILE* fd = fopen(fname, "rb");
+    if (!fd) return false;
+    size_t got = 0;
+    if (fseek(fd, r->offset, SEEK_SET) == 0) got = fread(r->buf, 1, CARD_BLOCK_MAX_BYTES, fd);
+    fclose(fd);
+    memset(r->buf + got, 0, sizeof(r->buf) - got);
+
+    size_t bytes = got >= CARD_BLOCK_HEADER_BYTES ? card_block_size(r->buf) : 0;
+    if (bytes == 0 || bytes > got) return false;
+    int n = card_block_decode(r->buf, r->cards);
+    if (n == 0 || (uint32_t)n > r->left) return false;
+    r->offset += bytes;
+    r->left -= n;
+    r->n = n;
+    return true;
+}
+
+// Порядок кучи: ключ, затем номер прогона (поздний прогон - позже)
+static inline bool reader_less(const RunReader* readers, int a, int b) {
+    uint64_t ka = readers[a].cards[readers[a].pos].hex_id;
+    uint64_t kb = readers[b].cards[readers[b].pos].hex_id;
+    return ka < kb || (ka == kb && a < b);
+}
+
+static void heap_sift_down(const RunReader* readers, int* heap, int size, int i) {
+    while (true) {
+        int smallest = i;
+        int l = 2 * i + 1, r = 2 * i + 2;
+        if (l < size && reader_less(readers, heap[l], heap[smallest])) smallest = l;
+        if (r < size && reader_less(readers, heap[r], heap[smallest])) smallest = r;
+        if (smallest == i) return;
+        int t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+static bool sink_finish_shard(ImportContext* ctx, MergeSink* sink) {
+    if (sink->shard_records == 0) return true;
+    if (ctx->count >= MAX_SHARDS) {
+        printf("❌ Импорт: больше %d шардов (%d карт)\n", MAX_SHARDS, MAX_SHARDS * RECORDS_PER_FILE);
+        return false;
+    }
+    card_file_init_header(sink->out, sink->shard_records);
+
+    ShardInfo* shard = &ctx->table[ctx->count];
+    memset(shard, 0, sizeof(*shard));
+    shard->file_id = ctx->next_id();
+    shard->first_id = sink->first_id;
+    shard->last_id = sink->last_id;
+    shard->records = sink->shard_records;
+    shard->bytes = (uint32_t)sink->shard_pos;
+    ctx->count++;
+
+    char fname[64];
+    output_file_name(ctx, shard->file_id, fname, sizeof(fname));
+    FILE* fd = fopen(fname, "wb");
+    // Данные на флеше до того, как на шард сошлется манифест
+    bool ok = fd && fwrite(sink->out, 1, sink->shard_pos, fd) == sink->shard_pos &&
+              fflush(fd) == 0 && fsync(fileno(fd)) == 0;
+    if (fd) fclose(fd);
+    if (!ok) {
+        printf("❌ Импорт: ошибка записи %s\n", fname);
+        return false;
+    }
+    ctx->stats->bytes_written += sink->shard_pos;
+    ctx->stats->shards++;
+    sink->shard_records = 0;
+    return true;
+}
+
+static bool sink_flush_block(ImportContext* ctx, MergeSink* sink) {
+    if (sink->block_n == 0) return true;
+    int n = sink->block_n;
+    sink->block_n = 0;
+    if (!sink->shards) {
+        size_t bytes = card_block_encode(sink->block, n, sink->out);
+        if (bytes == 0 || fwrite(sink->out, 1, bytes, sink->fd) != bytes) return false;
+        ctx->stats->bytes_written += bytes;
+        sink->records += n;
+        return true;
+    }
+
+    if (sink->shard_records == 0) {
+        sink->shard_pos = CARD_FILE_HEADER_BYTES;
+        sink->first_id = sink->block[0].hex_id;
+    }
+    size_t bytes = card_block_encode(sink->block, n, sink->out + sink->shard_pos);
+    if (bytes == 0) return false;
+    sink->shard_pos += bytes;
+    sink->shard_records += n;
+    sink->last_id = sink->block[n - 1].hex_id;
+    ctx->stats->records_out += n;
+    return sink->shard_records < RECORDS_PER_FILE || sink_finish_shard(ctx, sink);
+}
+
+static bool sink_emit(ImportContext* ctx, MergeSink* sink, const CardInfo* ci) {
+    sink->block[sink->block_n++] = *ci;
+    // Блоки шарда режутся по его границе: последний блок файла - остаток
+    int limit = INDEX_BLOCK_RECORDS;
+    if (sink->shards && RECORDS_PER_FILE - sink->shard_records < (uint32_t)limit) {
+        limit = (int)(RECORDS_PER_FILE - sink->shard_records);
+    }
+    return sink->block_n < limit || sink_flush_block(ctx, sink);
+}
+
+static bool sink_finish(ImportContext* ctx, MergeSink* sink) {
+    if (!sink_flush_block(ctx, sink)) return false;
+    return !sink->shards || sink_finish_shard(ctx, sink);
+}
+
+// Слияние k соседних прогонов в приемник
+static bool merge_runs(ImportContext* ctx, const ImportRun* group, int k,
+                       RunReader* readers, int* heap, MergeSink* sink) {
+    int size = 0;
+    for (int i = 0; i < k; i++) {
+        RunReader* r = &readers[i];
+        r->file_no = group[i].file_no;
+        r->left = group[i].records;
+        r->offset = 0;
+        if (!reader_refill(ctx, r)) return false;
+        if (r->n > 0) heap[size++] = i;
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) heap_sift_down(readers, heap, size, i);
+
+    CardInfo pending = {};
+    bool has_pending = false;
+    uint32_t steps = 0;
+    while (size > 0) {
+        RunReader* r = &readers[heap[0]];
+        CardInfo ci = r->cards[r->pos];
+        if (++r->pos == r->n && !reader_refill(ctx, r)) return false;
+        if (r->n == 0) heap[0] = heap[--size];
+        heap_sift_down(readers, heap, size, 0);
+
+        if (has_pending && pending.hex_id == ci.hex_id) {
+            ctx->stats->duplicates++;  // более поздний прогон перекрывает
+        } else if (has_pending && !sink_emit(ctx, sink, &pending)) {
+            return false;
+        }
+        pending = ci;
+        has_pending = true;
+        if ((++steps & 1023) == 0) import_yield();
+    }
+    if (has_pending && !sink_emit(ctx, sink, &pending)) return false;
+    return sink_finish(ctx, sink);
+}
+
+static void remove_runs(const ImportContext* ctx, const ImportRun* runs, int n) {
+    for (int i = 0; i < n; i++) {
+        char fname[64];
+        run_file_name(ctx, runs[i].file_no, fname, sizeof(fname));
+        remove(fname);
+    }
+}
+
+static bool merge_all(ImportContext* ctx) {
+    // Раскладка буфера: приемник, буфер шарда, курсоры прогонов, куча
+    MergeSink* sink = (MergeSink*)ctx->work;
+    uint8_t* out = ctx->work + align_up(sizeof(MergeSink));
+    size_t out_bytes = align_up(card_file_max_bytes(RECORDS_PER_FILE) + RECORD_READ_PAD);
+    RunReader* readers = (RunReader*)(out + out_bytes);
+    size_t used = align_up(sizeof(MergeSink)) + out_bytes;
+    int fan_in = used < ctx->work_bytes ? (int)((ctx->work_bytes - used) / (sizeof(RunReader) + sizeof(int))) : 0;
+    if (fan_in > ctx->run_count) fan_in = ctx->run_count;
+    if (fan_in < 2 && ctx->run_count > 1) {
+        printf("❌ Импорт: IMPORT_MEMORY_BYTES мало для слияния\n");
+        return false;
+    }
+    int* heap = (int*)(readers + (fan_in > 0 ? fan_in : 1));
+
+    // Промежуточные проходы: соседние группы сливаются по порядку, так
+    // что "поздний прогон побеждает" сохраняется
+    while (ctx->run_count > fan_in) {
+        int groups = 0;
+        for (int first = 0; first < ctx->run_count; first += fan_in) {
+            int k = ctx->run_count - first < fan_in ? ctx->run_count - first : fan_in;
+            ImportRun merged = { ctx->next_run_file++, 0 };
+            char fname[64];
+            run_file_name(ctx, merged.file_no, fname, sizeof(fname));
+            memset(sink, 0, sizeof(*sink));
+            sink->out = out;
+            sink->fd = fopen(fname, "wb");
+            if (!sink->fd) return false;
+            bool ok = merge_runs(ctx, &ctx->runs[first], k, readers, heap, sink);
+            fclose(sink->fd);
+            remove_runs(ctx, &ctx->runs[first], k);
+            merged.records = sink->records;
+            ctx->runs[groups++] = merged;
+            if (!ok) {
+                // Необработанные прогоны тоже должны попасть в уборку
+                for (int rest = first + k; rest < ctx->run_count; rest++) ctx->runs[groups++] = ctx->runs[rest];
+                ctx->run_count = groups;
+                printf("❌ Импорт: ошибка промежуточного слияния\n");
+                return false;
+            }
+        }
+        ctx->run_count = groups;
+        ctx->stats->merge_passes++;
+    }
+
+    // Последний проход пишет шарды
+    memset(sink, 0, sizeof(*sink));
+    sink->shards = true;
+    sink->out = out;
+    bool ok = merge_runs(ctx, ctx->runs, ctx->run_count, readers, heap, sink);
+    ctx->stats->merge_passes++;
+    if (!ok) printf("❌ Импорт: ошибка слияния прогонов\n");
+    return ok;
+}
+
+// ==========================================
+// КОНВЕЙЕР
+// ==========================================
+
+bool card_import_build(CardImportRead read, void* src, const char* dir,
+                       uint32_t (*next_id)(void), ShardInfo* table, int* count,
+                       CardImportStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->memory_bytes = IMPORT_MEMORY_BYTES;
+    *count = 0;
+
+    // Вся рабочая память - один буфер: прогоны, затем курсоры слияния
+    uint8_t* arena = (uint8_t*)malloc(IMPORT_MEMORY_BYTES);
+    if (!arena) {
+        printf("❌ Импорт: не хватает памяти (%d байт)\n", IMPORT_MEMORY_BYTES);
+        return false;
+    }
+    ImportContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.dir = dir;
+    ctx.next_id = next_id;
+    ctx.table = table;
+    ctx.stats = stats;
+    ctx.runs = (ImportRun*)arena;
+    size_t runs_bytes = align_up(IMPORT_MAX_RUNS * sizeof(ImportRun));
+    ctx.work = arena + runs_bytes;
+    ctx.work_bytes = (IMPORT_MEMORY_BYTES - runs_bytes) & ~(size_t)(IMPORT_ALIGN - 1);
+
+    int64_t t_start = import_now_us();
+    bool ok = build_runs(&ctx, read, src);
+    stats->runs = ctx.run_count;
+    int64_t t_merge = import_now_us();
+    stats->run_us = (uint32_t)(t_merge - t_start);
+
+    if (ok && ctx.run_count > 0) ok = merge_all(&ctx);
+    remove_runs(&ctx, ctx.runs, ctx.run_count);
+    free(arena);
+
+    int64_t t_end = import_now_us();
+    stats->merge_us = (uint32_t)(t_end - t_merge);
+    stats->total_us = (uint32_t)(t_end - t_start);
+    if (stats->total_us > 0) {
+        stats->records_per_s = (uint32_t)((uint64_t)stats->records_in * 1000000 / stats->total_us);
+    }
+
+    if (!ok) {
+        for (int i = 0; i < ctx.count; i++) {
+            char fname[64];
+            output_file_name(&ctx, table[i].file_id, fname, sizeof(fname));
+            remove(fname);
+        }
+        return false;
+    }
+    *count = ctx.count;
+    return true;
+}
+
+void print_card_import_stats(const CardImportStats* s) {
+    printf("📥 Импорт: строк %lu, карт %lu, отброшено %lu, повторов %lu -> %lu карт в %lu шардах\n",
+           (unsigned long)s->lines, (unsigned long)s->records_in, (unsigned long)s->rejected,
+           (unsigned long)s->duplicates, (unsigned long)s->records_out, (unsigned long)s->shards);
+    printf("   Прогонов %lu, проходов слияния %lu, память %lu Б, прочитано %llu Б, записано %llu Б\n",
+           (unsigned long)s->runs, (unsigned long)s->merge_passes, (unsigned long)s->memory_bytes,
+           (unsigned long long)s->bytes_in, (unsigned long long)s->bytes_written);
+    printf("   Время: прогоны %lu мс, слияние %lu мс, всего %lu мс - %lu записей/с\n",
+           (unsigned long)(s->run_us / 1000), (unsigned long)(s->merge_us / 1000),
+           (unsigned long)(s->total_us / 1000), (unsigned long)s->records_per_s);
+}
+
+#ifndef CARD_IMPORT_OFFLINE
+
+// ==========================================
+// ЗАМЕНА ЖИВОЙ БАЗЫ
+// ==========================================
+
+static volatile bool import_running = false;
+
+bool card_import_stream(CardImportRead read, void* src, CardImportStats* stats) {
+    if (import_running) {
+        printf("⚠️ Импорт уже идет\n");
+        return false;
+    }
+    ShardInfo* table = (ShardInfo*)malloc(MAX_SHARDS * sizeof(ShardInfo));
+    if (!table) {
+        printf("❌ Импорт: не хватает памяти\n");
+        return false;
+    }
+    import_running = true;
+    printf("📥 Импорт списка карт...\n");
+
+    int count = 0;
+    bool ok = card_import_build(read, src, MOUNT_POINT, allocate_shard_file_id, table, &count, stats);
+    if (ok && count == 0) {
+        printf("❌ Импорт: в списке нет ни одной карты - база не заменена\n");
+        ok = false;
+    } else if (ok) {
+        // Старые шарды обслуживают поиск до этой точки
+        ok = card_db_replace(table, count);
+        if (!ok) {
+            for (int i = 0; i < count; i++) {
+                char fname[32];
+                shard_file_name(table[i].file_id, fname, sizeof(fname));
+                remove(fname);
+            }
+        }
+    }
+    print_card_import_stats(stats);
+    if (ok) printf("✅ Импорт завершен: база заменена\n");
+    else printf("❌ Импорт не выполнен - старая база сохранена\n");
+
+    free(table);
+    import_running = false;
+    return ok;
+}
+
+static size_t file_source_read(void* ctx, char* buf, size_t len) {
+    return fread(buf, 1, len, (FILE*)ctx);
+}
+
+bool card_import_file(const char* path, CardImportStats* stats) {
+    FILE* fd = fopen(path, "rb");
+    if (!fd) {
+        printf("❌ Импорт: нет файла %s\n", path);
+        return false;
+    }
+    bool ok = card_import_stream(file_source_read, fd, stats);
+    fclose(fd);
+    return ok;
+}
+
+void card_import_boot_file() {
+    FILE* fd = fopen(IMPORT_BOOT_FILE, "rb");
+    if (!fd) return;
+    fclose(fd);
+
+    printf("📥 Найден %s\n", IMPORT_BOOT_FILE);
+    CardImportStats stats;
+    if (card_import_file(IMPORT_BOOT_FILE, &stats)) {
+        remove(IMPORT_BOOT_FILE);
+    } else {
+        // Не повторять неудачный импорт на каждой загрузке
+        remove(IMPORT_ERROR_FILE);
+        rename(IMPORT_BOOT_FILE, IMPORT_ERROR_FILE);
+        printf("⚠️ Файл переименован в %s\n", IMPORT_ERROR_FILE);
+    }
+}
+
+// ==========================================
+// ПРИЕМ ПО UART
+// ==========================================
+
+#ifdef ESP_PLATFORM
+
+// Первый байт уже принят задачей - отдаем его первым
+struct UartSource {
+    bool has_first;
+    char first;
+};
+
+static size_t uart_source_read(void* ctx, char* buf, size_t len) {
+    UartSource* src = (UartSource*)ctx;
+    size_t got = 0;
+    if (src->has_first) {
+        buf[got++] = src->first;
+        src->has_first = false;
+    }
+    // Возвращает накопленное по таймауту: 0 - пауза, конец передачи
+    int n = uart_read_bytes(IMPORT_UART_NUM, buf + got, len - got, pdMS_TO_TICKS(IMPORT_UART_IDLE_MS));
+    if (n > 0) got += n;
+    return got;
+}
+
+static void import_uart_task(void* pvParameters) {
+    while (1) {
+        UartSource src;
+        if (uart_read_bytes(IMPORT_UART_NUM, &src.first, 1, portMAX_DELAY) != 1) continue;
+        src.has_first = true;
+
+        CardImportStats stats;
+        bool ok = card_import_stream(uart_source_read, &src, &stats);
+        char reply[64];
+        int len = snprintf(reply, sizeof(reply), "%s %lu %lu\n", ok ? "OK" : "ERR",
+                           (unsigned long)stats.records_out, (unsigned long)stats.rejected);
+        uart_write_bytes(IMPORT_UART_NUM, reply, len);
+    }
+}
+
+void card_import_uart_start() {
+    uart_config_t cfg = {};
+    cfg.baud_rate = IMPORT_UART_BAUD;
+    cfg.data_bits = UART_DATA_8_BITS;
+    cfg.parity = UART_PARITY_DISABLE;
+    cfg.stop_bits = UART_STOP_BITS_1;
+    cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    cfg.source_clk = UART_SCLK_DEFAULT;
+
+    esp_err_t ret = uart_driver_install(IMPORT_UART_NUM, IMPORT_UART_RX_BUFFER, 0, 0, NULL, 0);
+    if (ret == ESP_OK) ret = uart_param_config(IMPORT_UART_NUM, &cfg);
+    if (ret == ESP_OK) {
+        ret = uart_set_pin(IMPORT_UART_NUM, IMPORT_UART_TX_GPIO, IMPORT_UART_RX_GPIO,
+                           UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (ret != ESP_OK) {
+        printf("❌ Импорт по UART%d: %s\n", IMPORT_UART_NUM, esp_err_to_name(ret));
+        return;
+    }
+    xTaskCreatePinnedToCore(import_uart_task, "card_import", 6144, NULL,
+                            tskIDLE_PRIORITY, NULL, 0);
+    printf("✅ Импорт карт по UART%d (%d бод) готов\n", IMPORT_UART_NUM, IMPORT_UART_BAUD);
+}
+
+#else
+
+void card_import_uart_start() {
+    printf("⚠️ Импорт по UART доступен только на устройстве\n");
+}
+
+#endif // ESP_PLATFORM
+
+#endif // CARD_IMPORT_OFFLINE
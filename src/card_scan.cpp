@@ -0,0 +1,179 @@
+#include "card_scan.h"
+#include "search.h"
+#include "card_db.h"
+#include "card_block.h"
+#include "card_record.h"
+#include "card_usage.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SCAN_CARDS (CARD_SCAN_BLOCKS * INDEX_BLOCK_RECORDS)
+
+static_assert(CARD_SCAN_BUFFER_BYTES >= CARD_BLOCK_MAX_BYTES + RECORD_READ_PAD, "Блок шарда не помещается в буфер обхода");
+static_assert(CARD_ATTR_MAX(status) < 32, "Статусы - биты status_mask");
+static_assert(CARD_ATTR_WIDTH(zones) <= 32, "Зоны - биты zones_any");
+
+static TaskHandle_t scan_task_handle = NULL;
+static CardScanQuery scan_query;
+static CardScanResult scan_result;
+static bool scan_running = false;
+static bool scan_done = false;      // scan_result заполнен
+
+// ==========================================
+// УСЛОВИЕ И СЧЕТЧИКИ
+// ==========================================
+
+static inline bool scan_match(const CardScanQuery* q, const CardInfo* ci) {
+    if (q->status_mask && !((q->status_mask >> ci->status) & 1)) return false;
+    if (q->zones_any && !(ci->zones & q->zones_any)) return false;
+    if (q->match_link && ci->link != q->link) return false;
+    return true;
+}
+
+static void scan_account(const CardScanQuery* q, const CardInfo* ci, CardScanResult* r) {
+    r->scanned++;
+    if (!scan_match(q, ci)) return;
+    r->matched++;
+    r->by_status[ci->status]++;
+    for (int z = 0; z < (int)CARD_ATTR_WIDTH(zones); z++) r->by_zone[z] += (ci->zones >> z) & 1;
+    if (q->on_card) {
+        CardInfo card = *ci;
+        card_usage_apply(&card);
+        q->on_card(&card, q->arg);
+    }
+}
+
+// ==========================================
+// ОБХОД
+// ==========================================
+
+bool card_scan_run(const CardScanQuery* query, CardScanResult* out) {
+    memset(out, 0, sizeof(*out));
+    int64_t t_start = esp_timer_get_time();
+    // Один рабочий буфер: порция с флеша, ее записи, журнал изменений
+    size_t cards_bytes = SCAN_CARDS * sizeof(CardInfo);
+    size_t delta_bytes = DELTA_LOG_CAPACITY * sizeof(CardInfo);
+    uint8_t* work = (uint8_t*)malloc(cards_bytes + delta_bytes + DELTA_LOG_CAPACITY + CARD_SCAN_BUFFER_BYTES);
+    if (!work) {
+        printf("❌ Обход базы: не хватает памяти\n");
+        return false;
+    }
+    CardInfo* cards = (CardInfo*)work;
+    CardInfo* delta = (CardInfo*)(work + cards_bytes);
+    bool* deleted = (bool*)(work + cards_bytes + delta_bytes);
+    uint8_t* buf = work + cards_bytes + delta_bytes + DELTA_LOG_CAPACITY;
+
+    out->ok = true;
+    uint64_t from_id = 0;
+    bool more = true;
+    while (more) {
+        // Новое чтение - только когда поиску нечего делать
+        while (search_queue_depth() > 0) {
+            vTaskDelay(1);
+            out->yields++;
+        }
+
+        // Журнал - раньше шардов: уплотнение между двумя чтениями переносит
+        // изменения в шарды, и порция видит их хотя бы в одном из двух мест
+        uint32_t nd = card_delta_collect(from_id, delta, deleted, DELTA_LOG_CAPACITY);
+        uint32_t got = 0;
+        uint64_t next_id = UINT64_MAX;
+        int n = read_cards_from(from_id, buf, CARD_SCAN_BUFFER_BYTES, CARD_SCAN_BLOCKS, cards, &next_id, &got);
+        if (n < 0) {
+            out->ok = false;
+            break;
+        }
+        out->bytes_read += got;
+        if (n > 0) out->chunks++;
+
+        // Порция закрывает ключи до начала следующей, пустая - все остальные
+        more = n > 0;
+        uint64_t to_id = more ? next_id - 1 : UINT64_MAX;
+        uint32_t d = 0;
+        for (int i = 0; i < n; i++) {
+            for (; d < nd && delta[d].hex_id < cards[i].hex_id; d++) {
+                if (!deleted[d]) scan_account(query, &delta[d], out);
+            }
+            if (d < nd && delta[d].hex_id == cards[i].hex_id) {
+                if (!deleted[d]) scan_account(query, &delta[d], out);
+                d++;
+                continue;
+            }
+            scan_account(query, &cards[i], out);
+        }
+        for (; d < nd && delta[d].hex_id <= to_id; d++) {
+            if (!deleted[d]) scan_account(query, &delta[d], out);
+        }
+        from_id = to_id + 1;
+    }
+
+    free(work);
+    out->duration_us = (uint32_t)(esp_timer_get_time() - t_start);
+    return out->ok;
+}
+
+// ==========================================
+// ФОНОВАЯ ЗАДАЧА
+// ==========================================
+
+static void scan_task(void* pvParameters) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        card_scan_run(&scan_query, &scan_result);
+        scan_done = true;
+        __atomic_store_n(&scan_running, false, __ATOMIC_SEQ_CST);
+    }
+}
+
+bool card_scan_start(const CardScanQuery* query) {
+    bool idle = false;
+    if (!__atomic_compare_exchange_n(&scan_running, &idle, true, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    // Ниже поиска (приоритет 1 на том же ядре): поиск вытесняет обход сразу
+    if (!scan_task_handle &&
+        xTaskCreatePinnedToCore(scan_task, "card_scan", 4096, NULL, tskIDLE_PRIORITY, &scan_task_handle, 0) != pdPASS) {
+        printf("❌ Не удалось запустить задачу обхода базы\n");
+        scan_task_handle = NULL;
+        __atomic_store_n(&scan_running, false, __ATOMIC_SEQ_CST);
+        return false;
+    }
+    scan_query = *query;
+    xTaskNotifyGive(scan_task_handle);
+    return true;
+}
+
+bool card_scan_running() {
+    return __atomic_load_n(&scan_running, __ATOMIC_SEQ_CST);
+}
+
+bool card_scan_result(CardScanResult* out) {
+    if (card_scan_running() || !scan_done) return false;
+    *out = scan_result;
+    return true;
+}
+
+// ==========================================
+// ОТЧЕТ
+// ==========================================
+
+void print_card_scan_result(const CardScanResult* r) {
+    printf("🔎 Обход: %lu карт, подошло %lu%s | %lu порций, %llu Б с флеша | %lu мс",
+           (unsigned long)r->scanned, (unsigned long)r->matched, r->ok ? "" : " (ошибка чтения)",
+           (unsigned long)r->chunks, (unsigned long long)r->bytes_read, (unsigned long)(r->duration_us / 1000));
+    if (r->yields) printf(" | уступил поиску %lu раз", (unsigned long)r->yields);
+    printf("\n   По статусам:");
+    for (size_t s = 0; s < sizeof(r->by_status) / sizeof(r->by_status[0]); s++) {
+        printf(" %u: %lu", (unsigned)s, (unsigned long)r->by_status[s]);
+    }
+    printf("\n   По зонам:");
+    for (size_t z = 0; z < sizeof(r->by_zone) / sizeof(r->by_zone[0]); z++) {
+        printf(" %u: %lu", (unsigned)z, (unsigned long)r->by_zone[z]);
+    }
+    printf("\n");
+}
@@ -0,0 +1,369 @@
+#include "card_storage.h"
+#include "card_record.h"
+#include "search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#else
+// Сборка под хост: раздел заменяется файлом-образом, отображенным через mmap
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define IMAGE_PARTITION_LABEL "carddb"
+#define IMAGE_PARTITION_SUBTYPE 0x40
+#define IMAGE_HOST_FILE MOUNT_POINT "/carddb.img"
+#define IMAGE_MAGIC 0x49424443  // "CDBI"
+#define IMAGE_VERSION 2
+#define IMAGE_MAX_FILES MAX_SHARDS
+#define IMAGE_SECTOR_SIZE 4096
+#ifndef IMAGE_HOST_SIZE
+#define IMAGE_HOST_SIZE (640 * 1024)  // размер файла-образа при сборке под хост (как carddb)
+#endif
+#define IMAGE_COPY_CHUNK 4096
+
+// Заголовок образа пишется последним: пока его нет, образ считается пустым
+struct ImageHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t file_count;
+    uint32_t data_size;
+    uint32_t generation;  // поколение манифеста, с которого снят образ
+    uint32_t file_offset[IMAGE_MAX_FILES];
+    uint32_t file_size[IMAGE_MAX_FILES];
+};
+
+// Данные - с первого сектора после заголовка (на устройстве - со второго)
+#define IMAGE_DATA_OFFSET ((sizeof(ImageHeader) + IMAGE_SECTOR_SIZE - 1) / IMAGE_SECTOR_SIZE * IMAGE_SECTOR_SIZE)
+
+// ==========================================
+// БЭКЕНД SPIFFS (fopen/fseek/fread)
+// ==========================================
+
+static size_t spiffs_read(const ShardInfo* shard, int file_idx, uint32_t offset, uint8_t* dst, size_t len) {
+    (void)file_idx;  // файл ищется по имени шарда
+    char fname[32];
+    shard_file_name(shard->file_id, fname, sizeof(fname));
+    FILE* fd = fopen(fname, "rb");
+    if (!fd) return 0;
+    size_t got = 0;
+    if (fseek(fd, (long)offset, SEEK_SET) == 0) {
+        got = fread(dst, 1, len, fd);
+    }
+    fclose(fd);
+    return got;
+}
+
+static const uint8_t* spiffs_map(int file_idx, size_t* len) {
+    (void)file_idx;
+    *len = 0;
+    return NULL;
+}
+
+static const CardStorage spiffs_storage = {
+    "spiffs", CARD_STORAGE_SPIFFS, spiffs_read, spiffs_map
+};
+
+// ==========================================
+// ОТОБРАЖЕНИЕ РАЗДЕЛА В ПАМЯТЬ (платформенная часть)
+// ==========================================
+
+static const uint8_t* image_base = NULL;
+static size_t image_capacity = 0;
+// Поколение готового образа; 0 - образ не читать (нет или переписывается)
+static uint32_t image_ready_generation = 0;
+
+#ifdef ESP_PLATFORM
+
+static const esp_partition_t* image_partition = NULL;
+static esp_partition_mmap_handle_t image_handle;
+
+static bool image_find() {
+    if (!image_partition) {
+        image_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                   (esp_partition_subtype_t)IMAGE_PARTITION_SUBTYPE,
+                                                   IMAGE_PARTITION_LABEL);
+    }
+    if (image_partition) image_capacity = image_partition->size;
+    return image_partition != NULL;
+}
+
+static bool image_map() {
+    if (image_base) return true;
+    if (!image_find()) return false;
+    const void* ptr = NULL;
+    esp_err_t ret = esp_partition_mmap(image_partition, 0, image_partition->size,
+                                       ESP_PARTITION_MMAP_DATA, &ptr, &image_handle);
+    if (ret != ESP_OK) {
+        printf("❌ Не удалось отобразить раздел %s: %s\n", IMAGE_PARTITION_LABEL, esp_err_to_name(ret));
+        return false;
+    }
+    image_base = (const uint8_t*)ptr;
+    return true;
+}
+
+static void image_unmap() {
+    if (!image_base) return;
+    esp_partition_munmap(image_handle);
+    image_base = NULL;
+}
+
+static bool image_write_begin(size_t total) {
+    if (!image_find()) return false;
+    size_t erase_size = (total + IMAGE_SECTOR_SIZE - 1) / IMAGE_SECTOR_SIZE * IMAGE_SECTOR_SIZE;
+    return esp_partition_erase_range(image_partition, 0, erase_size) == ESP_OK;
+}
+
+static bool image_write(size_t offset, const void* data, size_t len) {
+    return esp_partition_write(image_partition, offset, data, len) == ESP_OK;
+}
+
+static void image_write_end() {
+}
+
+#else
+
+static int image_fd = -1;
+static FILE* image_out = NULL;
+
+static bool image_find() {
+    image_capacity = IMAGE_HOST_SIZE;
+    return true;
+}
+
+static bool image_map() {
+    if (image_base) return true;
+    image_find();
+    image_fd = open(IMAGE_HOST_FILE, O_RDONLY);
+    if (image_fd < 0) return false;
+    if (lseek(image_fd, 0, SEEK_END) < (off_t)IMAGE_DATA_OFFSET) {
+        close(image_fd);
+        image_fd = -1;
+        return false;
+    }
+    void* ptr = mmap(NULL, image_capacity, PROT_READ, MAP_SHARED, image_fd, 0);
+    if (ptr == MAP_FAILED) {
+        close(image_fd);
+        image_fd = -1;
+        return false;
+    }
+    image_base = (const uint8_t*)ptr;
+    return true;
+}
+
+static void image_unmap() {
+    if (!image_base) return;
+    munmap((void*)image_base, image_capacity);
+    close(image_fd);
+    image_fd = -1;
+    image_base = NULL;
+}
+
+static bool image_write_begin(size_t total) {
+    (void)total;  // файл-образ заполняется целиком
+    image_find();
+    image_out = fopen(IMAGE_HOST_FILE, "wb");
+    if (!image_out) return false;
+    // Как после стирания флеша: весь образ заполнен 0xFF
+    uint8_t ff[IMAGE_COPY_CHUNK];
+    memset(ff, 0xFF, sizeof(ff));
+    for (size_t done = 0; done < image_capacity; done += sizeof(ff)) {
+        fwrite(ff, 1, sizeof(ff), image_out);
+    }
+    return true;
+}
+
+static bool image_write(size_t offset, const void* data, size_t len) {
+    return fseek(image_out, (long)offset, SEEK_SET) == 0 &&
+           fwrite(data, 1, len, image_out) == len;
+}
+
+static void image_write_end() {
+    if (image_out) fclose(image_out);
+    image_out = NULL;
+}
+
+#endif
+
+// ==========================================
+// БЭКЕНД PARTITION (образ в памяти)
+// ==========================================
+
+static const ImageHeader* image_header() {
+    return (const ImageHeader*)image_base;
+}
+
+static bool image_valid() {
+    const ImageHeader* hdr = image_header();
+    return hdr && hdr->magic == IMAGE_MAGIC && hdr->version == IMAGE_VERSION &&
+           hdr->file_count <= IMAGE_MAX_FILES &&
+           IMAGE_DATA_OFFSET + (size_t)hdr->data_size + RECORD_READ_PAD <= image_capacity;
+}
+
+static const uint8_t* partition_map(int file_idx, size_t* len) {
+    const ImageHeader* hdr = image_header();
+    if (!hdr || file_idx < 0 || file_idx >= hdr->file_count || hdr->file_size[file_idx] == 0) {
+        *len = 0;
+        return NULL;
+    }
+    *len = hdr->file_size[file_idx];
+    return image_base + hdr->file_offset[file_idx];
+}
+
+static size_t partition_read(const ShardInfo* shard, int file_idx, uint32_t offset, uint8_t* dst, size_t len) {
+    (void)shard;  // в образе шард ищется по позиции в манифесте
+    size_t size;
+    const uint8_t* data = partition_map(file_idx, &size);
+    if (!data || offset >= size) return 0;
+    if (len > size - offset) len = size - offset;
+    memcpy(dst, data + offset, len);
+    return len;
+}
+
+static const CardStorage partition_storage = {
+    "partition", CARD_STORAGE_PARTITION, partition_read, partition_map
+};
+
+// Копирует шарды с SPIFFS в раздел в порядке манифеста. Заголовок - последним.
+static bool partition_sync() {
+    ImageHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = IMAGE_MAGIC;
+    hdr.version = IMAGE_VERSION;
+    hdr.generation = get_manifest_generation();
+
+    // 1. Раскладка шардов по образу
+    uint32_t offset = IMAGE_DATA_OFFSET;
+    for (int f = 0; f < get_shard_count() && f < IMAGE_MAX_FILES; f++) {
+        ShardInfo shard;
+        get_shard_info(f, &shard);
+        hdr.file_offset[f] = offset;
+        hdr.file_size[f] = shard.bytes;
+        offset += (hdr.file_size[f] + 15) & ~15u;
+        hdr.file_count = f + 1;
+    }
+    hdr.data_size = offset - IMAGE_DATA_OFFSET;
+
+    // Поиск по прежнему образу закончен (прежнее поколение отпущено),
+    // новое поколение до конца записи читает файлы SPIFFS
+    __atomic_store_n(&image_ready_generation, 0, __ATOMIC_SEQ_CST);
+    image_unmap();
+    if (!image_find()) {
+        printf("⚠️ Раздел %s не найден - остаемся на SPIFFS\n", IMAGE_PARTITION_LABEL);
+        return false;
+    }
+    if ((size_t)offset + RECORD_READ_PAD > image_capacity) {
+        printf("❌ База (%lu байт) не помещается в раздел %s\n",
+               (unsigned long)offset, IMAGE_PARTITION_LABEL);
+        return false;
+    }
+
+    // 2. Стирание и копирование данных
+    uint8_t* chunk = (uint8_t*)malloc(IMAGE_COPY_CHUNK);
+    if (!chunk || !image_write_begin(offset + RECORD_READ_PAD)) {
+        printf("❌ Не удалось подготовить раздел %s\n", IMAGE_PARTITION_LABEL);
+        free(chunk);
+        image_write_end();
+        return false;
+    }
+    bool ok = true;
+    for (int f = 0; f < hdr.file_count && ok; f++) {
+        ShardInfo shard;
+        get_shard_info(f, &shard);
+        char fname[32];
+        shard_file_name(shard.file_id, fname, sizeof(fname));
+        FILE* fd = fopen(fname, "rb");
+        if (!fd) {
+            ok = false;
+            break;
+        }
+        uint32_t pos = hdr.file_offset[f];
+        uint32_t left = hdr.file_size[f];
+        size_t got;
+        while (ok && left > 0 &&
+               (got = fread(chunk, 1, left < IMAGE_COPY_CHUNK ? left : IMAGE_COPY_CHUNK, fd)) > 0) {
+            ok = image_write(pos, chunk, got);
+            pos += got;
+            left -= got;
+        }
+        fclose(fd);
+    }
+    free(chunk);
+
+    // 3. Заголовок фиксирует образ
+    ok = ok && image_write(0, &hdr, sizeof(hdr));
+    image_write_end();
+    if (!ok) {
+        printf("❌ Ошибка записи образа в раздел %s\n", IMAGE_PARTITION_LABEL);
+        return false;
+    }
+    if (!(image_map() && image_valid())) return false;
+    __atomic_store_n(&image_ready_generation, hdr.generation, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+// ==========================================
+// ВЫБОР БЭКЕНДА
+// ==========================================
+
+static CardStorageBackend preferred_backend = CARD_STORAGE_SPIFFS;
+static const CardStorage* active_storage = &spiffs_storage;
+
+void card_storage_init(CardStorageBackend preferred) {
+    preferred_backend = preferred;
+    active_storage = &spiffs_storage;
+    if (preferred != CARD_STORAGE_PARTITION) return;
+
+    if (image_map() && image_valid()) {
+        active_storage = &partition_storage;
+        image_ready_generation = image_header()->generation;
+        printf("✅ База отображена из раздела %s (%lu байт)\n",
+               IMAGE_PARTITION_LABEL, (unsigned long)image_header()->data_size);
+    } else {
+        printf("⚠️ Образ в разделе %s не готов - поиск через SPIFFS до синхронизации\n",
+               IMAGE_PARTITION_LABEL);
+    }
+}
+
+const CardStorage* card_storage() {
+    return active_storage;
+}
+
+const CardStorage* card_storage_for(uint32_t generation) {
+    if (active_storage == &partition_storage && generation != 0 &&
+        __atomic_load_n(&image_ready_generation, __ATOMIC_SEQ_CST) == generation) {
+        return &partition_storage;
+    }
+    return &spiffs_storage;
+}
+
+bool card_storage_sync() {
+    if (preferred_backend != CARD_STORAGE_PARTITION) return true;
+
+    active_storage = &spiffs_storage;
+    if (!partition_sync()) return false;
+    active_storage = &partition_storage;
+    printf("✅ Образ базы записан в раздел %s (%lu байт)\n",
+           IMAGE_PARTITION_LABEL, (unsigned long)image_header()->data_size);
+    return true;
+}
+
+uint32_t card_storage_generation() {
+    if (preferred_backend != CARD_STORAGE_PARTITION) return get_manifest_generation();
+    if (!(image_map() && image_valid())) return 0;
+    return image_header()->generation;
+}
+
+bool card_storage_select(CardStorageBackend backend) {
+    if (backend == CARD_STORAGE_SPIFFS) {
+        active_storage = &spiffs_storage;
+        return true;
+    }
+    if (!(image_map() && image_valid())) return false;
+    active_storage = &partition_storage;
+    return true;
+}
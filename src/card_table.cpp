@@ -0,0 +1,152 @@
+#include "card_table.h"
+#include "search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+// ==========================================
+// РАСКЛАДКА ЭЙТЦИНГЕРА
+// ==========================================
+
+// Позиции дерева по возрастанию ключей (симметричный обход): самый левый узел...
+static uint32_t eytzinger_first(uint32_t n) {
+    uint32_t k = 1;
+    while (2 * k <= n) k *= 2;
+    return k;
+}
+
+// ...и следующий за k. 0 - обход закончен.
+static uint32_t eytzinger_next(uint32_t k, uint32_t n) {
+    if (2 * k + 1 <= n) {
+        k = 2 * k + 1;
+        while (2 * k <= n) k *= 2;
+        return k;
+    }
+    while (k & 1) k >>= 1;  // поднимаемся, пока узел - правый потомок
+    return k >> 1;
+}
+
+// ==========================================
+// ПОСТРОЕНИЕ
+// ==========================================
+
+static inline size_t align8(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+#define TABLE_COLUMN_BYTES(P, name, type, width) + align8(n * sizeof(type))
+#define TABLE_COLUMN_PLACE(P, name, type, width) \
+    table->name = (type*)p;                      \
+    table->name[0] = 0;                          \
+    p += align8(n * sizeof(type));
+#define TABLE_COLUMN_PUT(P, name, type, width) table->name[k] = ci->name;
+#define TABLE_COLUMN_GET(P, name, type, width) out->name = table->name[k];
+
+// Одна область: заголовок, ключи, затем колонки атрибутов
+static CardTable* table_alloc(uint32_t records) {
+    size_t n = (size_t)records + 1;
+    size_t head = align8(sizeof(CardTable));
+    size_t bytes = head + n * sizeof(uint64_t) CARD_ATTR_FIELDS(TABLE_COLUMN_BYTES, CARD_ATTR);
+    uint8_t* mem = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!mem) mem = (uint8_t*)malloc(bytes);
+    if (!mem) return NULL;
+
+    CardTable* table = (CardTable*)mem;
+    table->records = records;
+    table->ids = (uint64_t*)(mem + head);
+    table->ids[0] = 0;
+    uint8_t* p = (uint8_t*)(table->ids + n);
+    CARD_ATTR_FIELDS(TABLE_COLUMN_PLACE, CARD_ATTR)
+    table->bytes = bytes;
+    table->load_us = 0;
+    return table;
+}
+
+static void table_put(CardTable* table, uint32_t k, const CardInfo* ci) {
+    table->ids[k] = ci->hex_id;
+    CARD_ATTR_FIELDS(TABLE_COLUMN_PUT, CARD_ATTR)
+}
+
+CardTable* card_table_build(const CardInfo* cards, uint32_t records) {
+    int64_t t_start = esp_timer_get_time();
+    CardTable* table = table_alloc(records);
+    if (!table) return NULL;
+    uint32_t k = records ? eytzinger_first(records) : 0;
+    for (uint32_t i = 0; i < records; i++) {
+        table_put(table, k, &cards[i]);
+        k = eytzinger_next(k, records);
+    }
+    table->load_us = (uint32_t)(esp_timer_get_time() - t_start);
+    return table;
+}
+
+// Шарды читаются по одному: в памяти только таблица и один распакованный шард
+CardTable* card_table_load(const ShardInfo* shards, int count) {
+    int64_t t_start = esp_timer_get_time();
+    uint32_t records = 0;
+    for (int i = 0; i < count; i++) records += shards[i].records;
+
+    CardTable* table = table_alloc(records);
+    if (!table) {
+        printf("⚠️ Нет памяти на базу в RAM (%lu записей)\n", (unsigned long)records);
+        return NULL;
+    }
+    uint32_t k = records ? eytzinger_first(records) : 0;
+    uint64_t prev_id = 0;
+    uint32_t done = 0;
+    for (int i = 0; i < count; i++) {
+        CardInfo* cards = read_shard_cards(&shards[i]);
+        if (!cards) {
+            printf("❌ База в RAM: не удалось прочитать шард %d\n", i);
+            card_table_free(table);
+            return NULL;
+        }
+        for (uint32_t r = 0; r < shards[i].records; r++) {
+            // Дерево верно только для строго возрастающих ключей
+            if (done > 0 && cards[r].hex_id <= prev_id) {
+                printf("❌ База в RAM: ключи шарда %d не по порядку\n", i);
+                free(cards);
+                card_table_free(table);
+                return NULL;
+            }
+            prev_id = cards[r].hex_id;
+            table_put(table, k, &cards[r]);
+            k = eytzinger_next(k, records);
+            done++;
+        }
+        free(cards);
+    }
+    table->load_us = (uint32_t)(esp_timer_get_time() - t_start);
+    return table;
+}
+
+void card_table_free(CardTable* table) {
+    free(table);
+}
+
+// ==========================================
+// ПОИСК
+// ==========================================
+
+// Спуск без ветвлений: на каждом уровне k = 2k + (ключ узла < x). После
+// выхода за лист младшие единичные биты k - повороты вправо после
+// последнего поворота влево; сдвиг на них дает узел, где был этот поворот,
+// - первый ключ >= x (0 - все ключи меньше x).
+uint32_t card_table_find(const CardTable* table, uint64_t hex_id) {
+    const uint64_t* ids = table->ids;
+    uint32_t n = table->records;
+    uint32_t k = 1;
+    while (k <= n) k = 2 * k + (ids[k] < hex_id);
+    k >>= __builtin_ffs(~k);
+    return (k && ids[k] == hex_id) ? k : 0;
+}
+
+bool card_table_lookup(const CardTable* table, uint64_t hex_id, CardInfo* out) {
+    uint32_t k = card_table_find(table, hex_id);
+    if (!k) return false;
+    out->hex_id = hex_id;
+    CARD_ATTR_FIELDS(TABLE_COLUMN_GET, CARD_ATTR)
+    return true;
+}
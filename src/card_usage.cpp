@@ -0,0 +1,458 @@
+#include "card_usage.h"
+#include "card_db.h"
+#include "search.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define USAGE_LOG_FILE MOUNT_POINT "/usage.log"
+#define USAGE_RECORD_BYTES 8
+
+struct UsageEntry {
+    uint64_t hex_id;
+    uint8_t pending;    // не влито в файлы данных (0..USAGE_COUNT_MAX)
+    uint8_t unflushed;  // из них еще не в usage.log
+};
+
+static UsageEntry usage_entries[USAGE_TABLE_CAPACITY];
+static uint32_t usage_count = 0;
+static uint32_t usage_dirty = 0;        // записей с unflushed > 0
+static uint32_t usage_log_size = 0;     // байт в usage.log
+static volatile bool merge_requested = false;
+static SemaphoreHandle_t usage_mutex = NULL;  // таблица
+static SemaphoreHandle_t log_mutex = NULL;    // файл: сброс и перезапись не перемежаются
+static TaskHandle_t usage_task_handle = NULL;
+static CardUsageStats usage_stats = {};
+
+// ==========================================
+// ЗАПИСЬ USAGE.LOG: id:56 | delta:4 | crc:4
+// ==========================================
+// delta = 0 - заголовок блока слияния: id = поколение:32 | записей:24.
+// За ним столько же записей "влито delta в поколение" - при
+// восстановлении они вычитаются, если поколение опубликовано.
+
+#define USAGE_MERGE_GENERATION_BITS 32
+
+static_assert(CARD_ATTR_WIDTH(count) <= 4, "Приращение в usage.log - 4 бита");
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void usage_encode(uint64_t hex_id, uint8_t delta, uint8_t* rec) {
+    for (int i = 0; i < 7; i++) rec[i] = (uint8_t)(hex_id >> (8 * i));
+    rec[7] = (uint8_t)(delta << 4);
+    rec[7] |= crc8(rec, USAGE_RECORD_BYTES) & 0x0F;
+}
+
+// false - оборванная или испорченная запись (delta = 0 - заголовок блока слияния)
+static bool usage_decode(const uint8_t* rec, uint64_t* hex_id, uint8_t* delta) {
+    uint8_t check[USAGE_RECORD_BYTES];
+    memcpy(check, rec, sizeof(check));
+    check[7] &= 0xF0;
+    if ((crc8(check, sizeof(check)) & 0x0F) != (rec[7] & 0x0F)) return false;
+    *delta = rec[7] >> 4;
+    *hex_id = 0;
+    for (int i = 0; i < 7; i++) *hex_id |= (uint64_t)rec[i] << (8 * i);
+    return true;
+}
+
+// ==========================================
+// ТАБЛИЦА В RAM (отсортирована по hex_id)
+// ==========================================
+
+static uint32_t usage_lower_bound(uint64_t hex_id) {
+    uint32_t left = 0, right = usage_count;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (usage_entries[mid].hex_id < hex_id) left = mid + 1;
+        else right = mid;
+    }
+    return left;
+}
+
+// Запись карты (новая вставляется). NULL - таблица заполнена.
+static UsageEntry* usage_entry(uint64_t hex_id) {
+    uint32_t pos = usage_lower_bound(hex_id);
+    if (pos < usage_count && usage_entries[pos].hex_id == hex_id) return &usage_entries[pos];
+    if (usage_count >= USAGE_TABLE_CAPACITY) return NULL;
+    memmove(&usage_entries[pos + 1], &usage_entries[pos], (usage_count - pos) * sizeof(UsageEntry));
+    usage_count++;
+    memset(&usage_entries[pos], 0, sizeof(UsageEntry));
+    usage_entries[pos].hex_id = hex_id;
+    return &usage_entries[pos];
+}
+
+void card_usage_apply(CardInfo* ci) {
+    if (!usage_mutex || usage_count == 0) return;
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    uint32_t pos = usage_lower_bound(ci->hex_id);
+    if (pos < usage_count && usage_entries[pos].hex_id == ci->hex_id) {
+        uint32_t count = (uint32_t)ci->count + usage_entries[pos].pending;
+        ci->count = (uint8_t)(count > USAGE_COUNT_MAX ? USAGE_COUNT_MAX : count);
+    }
+    xSemaphoreGive(usage_mutex);
+}
+
+void card_usage_record(const CardInfo* ci) {
+    if (!usage_mutex) return;
+    usage_stats.swipes++;
+    if (ci->count >= USAGE_COUNT_MAX) {
+        usage_stats.saturated++;
+        return;
+    }
+
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    UsageEntry* e = usage_entry(ci->hex_id);
+    if (e) {
+        if (e->pending < USAGE_COUNT_MAX) {
+            if (e->unflushed == 0) usage_dirty++;
+            e->pending++;
+            e->unflushed++;
+        }
+    }
+    bool flush = usage_dirty >= USAGE_FLUSH_THRESHOLD;
+    xSemaphoreGive(usage_mutex);
+
+    if (!e) {
+        usage_stats.dropped++;
+        card_usage_request_merge();
+    } else if (flush && usage_task_handle) {
+        xTaskNotifyGive(usage_task_handle);
+    }
+}
+
+// ==========================================
+// СБРОС И СЛИЯНИЕ
+// ==========================================
+
+// Под log_mutex
+static bool usage_flush_locked() {
+    // Новые приращения забираем под мьютексом, пишем - уже без него
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    uint32_t n = 0;
+    uint8_t* buf = usage_dirty ? (uint8_t*)malloc(usage_dirty * USAGE_RECORD_BYTES) : NULL;
+    bool ok = buf || usage_dirty == 0;
+    if (buf) {
+        for (uint32_t i = 0; i < usage_count; i++) {
+            UsageEntry* e = &usage_entries[i];
+            if (e->unflushed == 0) continue;
+            usage_encode(e->hex_id, e->unflushed, buf + n * USAGE_RECORD_BYTES);
+            e->unflushed = 0;
+            n++;
+        }
+        usage_dirty = 0;
+    }
+    xSemaphoreGive(usage_mutex);
+    if (n == 0) {
+        free(buf);
+        return ok;
+    }
+
+    // Одна запись на весь сброс
+    size_t bytes = (size_t)n * USAGE_RECORD_BYTES;
+    FILE* fd = fopen(USAGE_LOG_FILE, "ab");
+    ok = fd && fwrite(buf, 1, bytes, fd) == bytes;
+    if (fd) fclose(fd);
+    if (ok) {
+        usage_log_size += bytes;
+        usage_stats.flushes++;
+        usage_stats.records_written += n;
+        usage_stats.log_bytes += bytes;
+    } else {
+        // Не записалось - приращения снова ждут сброса
+        printf("⚠️ Не удалось записать %s\n", USAGE_LOG_FILE);
+        xSemaphoreTake(usage_mutex, portMAX_DELAY);
+        for (uint32_t r = 0; r < n; r++) {
+            uint64_t hex_id;
+            uint8_t delta;
+            usage_decode(buf + r * USAGE_RECORD_BYTES, &hex_id, &delta);
+            uint32_t pos = usage_lower_bound(hex_id);
+            if (pos < usage_count && usage_entries[pos].hex_id == hex_id) {
+                UsageEntry* e = &usage_entries[pos];
+                if (e->unflushed == 0) usage_dirty++;
+                uint32_t unflushed = (uint32_t)e->unflushed + delta;
+                e->unflushed = (uint8_t)(unflushed > e->pending ? e->pending : unflushed);
+            }
+        }
+        xSemaphoreGive(usage_mutex);
+    }
+    free(buf);
+    return ok;
+}
+
+bool card_usage_flush() {
+    if (!usage_mutex) return false;
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    bool ok = usage_flush_locked();
+    xSemaphoreGive(log_mutex);
+    return ok;
+}
+
+CardUsageDelta* card_usage_collect(uint32_t* count) {
+    *count = 0;
+    if (!usage_mutex) return NULL;
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    uint32_t n = usage_count;
+    CardUsageDelta* out = n ? (CardUsageDelta*)malloc(n * sizeof(CardUsageDelta)) : NULL;
+    if (out) {
+        for (uint32_t i = 0; i < n; i++) {
+            out[i].hex_id = usage_entries[i].hex_id;
+            out[i].pending = usage_entries[i].pending;
+        }
+        *count = n;
+    }
+    xSemaphoreGive(usage_mutex);
+    return out;
+}
+
+// Журнал переписывается остатком таблицы - он весь уже в ней (под log_mutex).
+// Заодно уходит блок слияния, если он был.
+static void usage_log_rewrite_locked() {
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < usage_count; i++) {
+        if (usage_entries[i].pending > 0) usage_entries[kept++] = usage_entries[i];
+    }
+    usage_count = kept;
+
+    uint8_t* buf = kept ? (uint8_t*)malloc(kept * USAGE_RECORD_BYTES) : NULL;
+    uint32_t n = 0;
+    if (buf) {
+        for (uint32_t i = 0; i < kept; i++) {
+            usage_encode(usage_entries[i].hex_id, usage_entries[i].pending, buf + n * USAGE_RECORD_BYTES);
+            usage_entries[i].unflushed = 0;
+            n++;
+        }
+        usage_dirty = 0;
+    } else {
+        // Без памяти журнал пустеет - остаток уйдет со следующим сбросом
+        for (uint32_t i = 0; i < kept; i++) usage_entries[i].unflushed = usage_entries[i].pending;
+        usage_dirty = kept;
+    }
+    xSemaphoreGive(usage_mutex);
+
+    size_t bytes = (size_t)n * USAGE_RECORD_BYTES;
+    FILE* fd = fopen(USAGE_LOG_FILE, "wb");
+    bool ok = fd && fwrite(buf, 1, bytes, fd) == bytes;
+    if (fd) fclose(fd);
+    free(buf);
+    usage_log_size = ok ? (uint32_t)bytes : 0;
+    if (ok) {
+        usage_stats.log_bytes += bytes;
+    } else {
+        printf("⚠️ Не удалось перезаписать %s\n", USAGE_LOG_FILE);
+    }
+}
+
+bool card_usage_prepare_merge(const CardUsageDelta* merged, uint32_t count, uint32_t generation) {
+    uint32_t cards = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (merged[i].pending > 0) cards++;
+    }
+    if (cards == 0 || !usage_mutex) return true;  // вливать нечего
+
+    // Все влитое должно лежать в журнале раньше блока, иначе вычитать не из чего
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    bool ok = usage_flush_locked();
+    size_t bytes = (size_t)(cards + 1) * USAGE_RECORD_BYTES;
+    uint8_t* buf = ok ? (uint8_t*)malloc(bytes) : NULL;
+    if (buf) {
+        usage_encode(generation | ((uint64_t)cards << USAGE_MERGE_GENERATION_BITS), 0, buf);
+        uint32_t n = 1;
+        for (uint32_t i = 0; i < count; i++) {
+            if (merged[i].pending == 0) continue;
+            usage_encode(merged[i].hex_id, (uint8_t)merged[i].pending, buf + n * USAGE_RECORD_BYTES);
+            n++;
+        }
+        FILE* fd = fopen(USAGE_LOG_FILE, "ab");
+        ok = fd && fwrite(buf, 1, bytes, fd) == bytes && sync_file(fd);
+        if (fd) fclose(fd);
+        free(buf);
+    } else {
+        ok = false;
+    }
+    if (ok) {
+        usage_log_size += bytes;
+        usage_stats.log_bytes += bytes;
+    } else {
+        printf("⚠️ Не удалось записать блок слияния в %s\n", USAGE_LOG_FILE);
+        usage_log_rewrite_locked();  // оборванный блок не должен остаться в хвосте
+    }
+    xSemaphoreGive(log_mutex);
+    return ok;
+}
+
+void card_usage_merged(const CardUsageDelta* merged, uint32_t count) {
+    if (!usage_mutex) return;
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+
+    // Влитое вычитаем: пришедшее за время уплотнения остается
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    uint32_t cards = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (merged[i].pending == 0) continue;
+        uint32_t pos = usage_lower_bound(merged[i].hex_id);
+        if (pos >= usage_count || usage_entries[pos].hex_id != merged[i].hex_id) continue;
+        UsageEntry* e = &usage_entries[pos];
+        e->pending = merged[i].pending >= e->pending ? 0 : (uint8_t)(e->pending - merged[i].pending);
+        if (e->unflushed > e->pending) e->unflushed = e->pending;
+        cards++;
+    }
+    merge_requested = false;
+    xSemaphoreGive(usage_mutex);
+    usage_log_rewrite_locked();
+    usage_stats.merges++;
+    usage_stats.merged_cards += cards;
+    xSemaphoreGive(log_mutex);
+}
+
+void card_usage_merge_failed() {
+    if (!usage_mutex) return;
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    usage_log_rewrite_locked();
+    xSemaphoreGive(log_mutex);
+}
+
+bool card_usage_merge_due() {
+    return usage_count > 0 && (merge_requested || usage_log_size >= USAGE_MERGE_LOG_BYTES ||
+                               usage_count >= USAGE_TABLE_CAPACITY * 3 / 4);
+}
+
+void card_usage_request_merge() {
+    merge_requested = true;
+    card_db_request_compaction();
+}
+
+// ==========================================
+// ИНИЦИАЛИЗАЦИЯ
+// ==========================================
+
+static void usage_log_replay() {
+    FILE* fd = fopen(USAGE_LOG_FILE, "rb");
+    if (!fd) return;
+
+    // Блок слияния опубликованного поколения: влитое уже в шардах
+    uint32_t generation = get_manifest_generation();
+    uint32_t replayed = 0, merged = 0, block_left = 0;
+    bool block_published = false;
+    bool torn = false, stale = false;
+    uint8_t rec[USAGE_RECORD_BYTES];
+    while (fread(rec, 1, sizeof(rec), fd) == sizeof(rec)) {
+        uint64_t hex_id;
+        uint8_t delta;
+        if (!usage_decode(rec, &hex_id, &delta) || (delta == 0 && block_left > 0)) {
+            torn = true;
+            break;
+        }
+        if (delta == 0) {
+            block_left = (uint32_t)(hex_id >> USAGE_MERGE_GENERATION_BITS);
+            block_published = (uint32_t)hex_id <= generation;
+            stale |= !block_published;  // сбой до публикации: блок не должен дождаться своего номера
+            continue;
+        }
+        if (block_left > 0) {
+            block_left--;
+            if (!block_published) continue;
+            uint32_t pos = usage_lower_bound(hex_id);
+            if (pos < usage_count && usage_entries[pos].hex_id == hex_id) {
+                UsageEntry* e = &usage_entries[pos];
+                e->pending = delta >= e->pending ? 0 : (uint8_t)(e->pending - delta);
+            }
+            merged++;
+            continue;
+        }
+        UsageEntry* e = usage_entry(hex_id);
+        if (!e) {
+            torn = true;
+            break;
+        }
+        uint32_t pending = (uint32_t)e->pending + delta;
+        e->pending = (uint8_t)(pending > USAGE_COUNT_MAX ? USAGE_COUNT_MAX : pending);
+        replayed++;
+    }
+    fclose(fd);
+    // Недописанный блок слияния: поколение не публиковалось
+    if (block_left > 0) torn = true;
+    usage_log_size = replayed * USAGE_RECORD_BYTES;
+
+    // Оборванный хвост отрезаем: журнал пишется заново из таблицы (и без
+    // влитого в шарды до сбоя - вычтенное не должно вычитаться снова)
+    if (torn) {
+        printf("⚠️ %s поврежден после %lu записей - перезаписываем\n", USAGE_LOG_FILE,
+               (unsigned long)replayed);
+    }
+    if (merged > 0) {
+        printf("⚠️ %s не переписан после слияния: вычтено %lu влитых счетчиков\n", USAGE_LOG_FILE,
+               (unsigned long)merged);
+    }
+    if (torn || merged > 0 || stale) {
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < usage_count; i++) {
+            if (usage_entries[i].pending > 0) usage_entries[kept++] = usage_entries[i];
+        }
+        usage_count = kept;
+        fd = fopen(USAGE_LOG_FILE, "wb");
+        if (fd) fclose(fd);
+        usage_log_size = 0;
+        for (uint32_t i = 0; i < usage_count; i++) usage_entries[i].unflushed = usage_entries[i].pending;
+        usage_dirty = usage_count;
+    }
+    printf("✅ Счетчики использования: %lu записей журнала, %lu карт\n",
+           (unsigned long)replayed, (unsigned long)usage_count);
+}
+
+static void usage_task(void* pvParameters) {
+    while (1) {
+        // Сброс по порогу или по таймеру; слияние - через уплотнение
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(USAGE_FLUSH_INTERVAL_MS));
+        if (usage_dirty > 0) card_usage_flush();
+        if (card_usage_merge_due()) card_db_request_compaction();
+    }
+}
+
+void card_usage_init() {
+    if (usage_mutex) return;
+    usage_mutex = xSemaphoreCreateMutex();
+    log_mutex = xSemaphoreCreateMutex();
+    if (!usage_mutex || !log_mutex) {
+        printf("❌ Не удалось создать мьютекс счетчиков использования\n");
+        usage_mutex = NULL;
+        return;
+    }
+
+    usage_log_replay();
+    if (usage_dirty > 0) card_usage_flush();
+
+    xTaskCreatePinnedToCore(usage_task, "usage_flush", 3072, NULL,
+                            tskIDLE_PRIORITY, &usage_task_handle, 0);
+}
+
+// ==========================================
+// СТАТИСТИКА
+// ==========================================
+
+void get_card_usage_stats(CardUsageStats* out) {
+    *out = usage_stats;
+}
+
+void print_card_usage_stats() {
+    const CardUsageStats* s = &usage_stats;
+    printf("👣 Счетчики: %lu карт в RAM (%lu не сброшено) | предъявлений %lu, насыщено %lu, потеряно %lu | "
+           "сбросов %lu, журнал %lu Б (всего записано %llu Б) | слияний %lu (%lu карт)\n",
+           (unsigned long)usage_count, (unsigned long)usage_dirty, (unsigned long)s->swipes,
+           (unsigned long)s->saturated, (unsigned long)s->dropped, (unsigned long)s->flushes,
+           (unsigned long)usage_log_size, (unsigned long long)s->log_bytes,
+           (unsigned long)s->merges, (unsigned long)s->merged_cards);
+}
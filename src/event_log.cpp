@@ -0,0 +1,205 @@
+#include "event_log.h"
+#include "config.h"
+#include <stdio.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#if (EVLOG_RING_SIZE & (EVLOG_RING_SIZE - 1)) != 0
+#error "EVLOG_RING_SIZE must be a power of two"
+#endif
+
+#define EVLOG_MASK (EVLOG_RING_SIZE - 1)
+
+// ==========================================
+// КОЛЬЦО ЯДРА
+// ==========================================
+// Писатели одного ядра могут вытеснять друг друга, поэтому место
+// захватывается сравнением с обменом head, а готовность записи читатель
+// узнает по номеру в seq[]: seq == pos - место свободно для записи pos,
+// seq == pos + 1 - запись pos готова к выводу.
+struct EvlogRing {
+    uint32_t head __attribute__((aligned(64)));
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t max_depth;
+    uint32_t tail __attribute__((aligned(64)));
+    uint32_t seq[EVLOG_RING_SIZE];
+    EventLogRecord slots[EVLOG_RING_SIZE];
+};
+
+static EvlogRing rings[portNUM_PROCESSORS];
+static EventLogFormatter formatters[EVLOG_SOURCES] = {};
+static SemaphoreHandle_t drain_mutex = NULL;
+static bool deferred = false;      // до evlog_start() - печать сразу
+static uint32_t printed = 0;
+
+volatile uint8_t evlog_level = EVLOG_DEFAULT_LEVEL;
+
+void evlog_register(uint8_t source, EventLogFormatter fmt) {
+    if (source < EVLOG_SOURCES) formatters[source] = fmt;
+}
+
+void evlog_set_level(uint8_t level) {
+    evlog_level = level;
+}
+
+void evlog_set_deferred(bool enable) {
+    deferred = enable && drain_mutex != NULL;
+}
+
+static void format_record(const EventLogRecord* r) {
+    EventLogFormatter fmt = r->source < EVLOG_SOURCES ? formatters[r->source] : NULL;
+    if (fmt) {
+        fmt(r);
+    } else {
+        printf("📝 [%u:%u] %lu %lu 0x%llX 0x%llX\n", r->source, r->id,
+               (unsigned long)r->a, (unsigned long)r->b,
+               (unsigned long long)r->x, (unsigned long long)r->y);
+    }
+}
+
+// ==========================================
+// ПИСАТЕЛЬ
+// ==========================================
+
+void evlog_write(uint8_t level, uint8_t source, uint8_t id,
+                 uint32_t a, uint32_t b, uint64_t x, uint64_t y) {
+    if (!deferred) {
+        EventLogRecord r = {(uint32_t)esp_timer_get_time(), source, id, level,
+                            (uint8_t)xPortGetCoreID(), a, b, x, y};
+        format_record(&r);
+        return;
+    }
+
+    uint8_t core = (uint8_t)xPortGetCoreID();
+    EvlogRing* ring = &rings[core];
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&ring->seq[pos & EVLOG_MASK], __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0) {
+            // Задача журнала еще не вывела запись круг назад
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    EventLogRecord* r = &ring->slots[pos & EVLOG_MASK];
+    r->time_us = (uint32_t)esp_timer_get_time();
+    r->source = source;
+    r->id = id;
+    r->level = level;
+    r->core = core;
+    r->a = a;
+    r->b = b;
+    r->x = x;
+    r->y = y;
+    __atomic_store_n(&ring->seq[pos & EVLOG_MASK], pos + 1, __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(&ring->written, 1, __ATOMIC_RELAXED);
+    uint32_t depth = pos + 1 - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    if (depth > ring->max_depth) ring->max_depth = depth;
+}
+
+// ==========================================
+// ЧИТАТЕЛЬ (задача журнала или evlog_flush под drain_mutex)
+// ==========================================
+
+static const EventLogRecord* ring_peek(EvlogRing* ring) {
+    uint32_t pos = ring->tail;
+    if (__atomic_load_n(&ring->seq[pos & EVLOG_MASK], __ATOMIC_ACQUIRE) != pos + 1) return NULL;
+    return &ring->slots[pos & EVLOG_MASK];
+}
+
+static void ring_release(EvlogRing* ring) {
+    uint32_t pos = ring->tail;
+    __atomic_store_n(&ring->seq[pos & EVLOG_MASK], pos + EVLOG_RING_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->tail, pos + 1, __ATOMIC_RELAXED);
+}
+
+// Кольца сливаются по времени записи: события разных ядер выводятся по порядку
+static uint32_t drain_rings() {
+    uint32_t n = 0;
+    for (;;) {
+        const EventLogRecord* best = NULL;
+        EvlogRing* from = NULL;
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            const EventLogRecord* r = ring_peek(&rings[c]);
+            if (r && (!best || (int32_t)(r->time_us - best->time_us) < 0)) {
+                best = r;
+                from = &rings[c];
+            }
+        }
+        if (!best) break;
+
+        // Копия до освобождения места: писатель может сразу его занять
+        EventLogRecord rec = *best;
+        ring_release(from);
+        format_record(&rec);
+        n++;
+    }
+    printed += n;
+    return n;
+}
+
+void evlog_flush() {
+    if (!drain_mutex) return;
+    xSemaphoreTake(drain_mutex, portMAX_DELAY);
+    drain_rings();
+    xSemaphoreGive(drain_mutex);
+}
+
+static void evlog_task(void* arg) {
+    while (1) {
+        xSemaphoreTake(drain_mutex, portMAX_DELAY);
+        uint32_t n = drain_rings();
+        xSemaphoreGive(drain_mutex);
+        if (n == 0) vTaskDelay(pdMS_TO_TICKS(EVLOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+bool evlog_start() {
+    if (drain_mutex) return true;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        for (uint32_t i = 0; i < EVLOG_RING_SIZE; i++) rings[c].seq[i] = i;
+    }
+    drain_mutex = xSemaphoreCreateMutex();
+    if (!drain_mutex) {
+        printf("❌ Не удалось создать мьютекс журнала - вывод без отложенной печати\n");
+        return false;
+    }
+    // Без привязки к ядру: печать идет там, где есть свободное время
+    if (xTaskCreate(evlog_task, "evlog", 4096, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        printf("❌ Не удалось запустить задачу журнала\n");
+        return false;
+    }
+    deferred = EVLOG_DEFERRED;
+    return true;
+}
+
+void get_event_log_stats(EventLogStats* out) {
+    out->written = 0;
+    out->dropped = 0;
+    out->max_depth = 0;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        out->written += __atomic_load_n(&rings[c].written, __ATOMIC_RELAXED);
+        out->dropped += __atomic_load_n(&rings[c].dropped, __ATOMIC_RELAXED);
+        if (rings[c].max_depth > out->max_depth) out->max_depth = rings[c].max_depth;
+    }
+    out->printed = printed;
+}
+
+void print_event_log_stats() {
+    EventLogStats s;
+    get_event_log_stats(&s);
+    printf("📝 Журнал: записано %lu | выведено %lu | потеряно %lu | макс. в кольце %lu/%d | уровень %u\n",
+           (unsigned long)s.written, (unsigned long)s.printed, (unsigned long)s.dropped,
+           (unsigned long)s.max_depth, EVLOG_RING_SIZE, evlog_level);
+}
@@ -1,29 +1,197 @@
 #include "i2c_driver.h"
 #include "config.h"
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
 
-esp_err_t i2c_master_init() {
-    i2c_config_t conf;
+// Транзакция длится доли миллисекунды; дольше - шина зависла
+#define I2C_TIMEOUT_TICKS (pdMS_TO_TICKS(5) > 0 ? pdMS_TO_TICKS(5) : 1)
+#define I2C_SELFTEST_SWEEPS 200
+
+static uint32_t bus_freq_hz = 0;
+
+static esp_err_t bus_install(uint32_t freq_hz) {
+    i2c_config_t conf = {};
     conf.mode = I2C_MODE_MASTER;
     conf.sda_io_num = I2C_MASTER_SDA_IO;
     conf.scl_io_num = I2C_MASTER_SCL_IO;
     conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
     conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.master.clk_speed = I2C_MASTER_FREQ_HZ;
+    conf.master.clk_speed = freq_hz;
     
     esp_err_t ret = i2c_param_config(I2C_MASTER_NUM, &conf);
     if (ret != ESP_OK) return ret;
     
-    return i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
+    ret = i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
+    if (ret == ESP_OK) bus_freq_hz = freq_hz;
+    return ret;
+}
+
+esp_err_t i2c_master_init() {
+    return bus_install(I2C_MASTER_FREQ_HZ);
 }
 
+uint32_t i2c_bus_freq_hz() {
+    return bus_freq_hz;
+}
+
+// Одиночное чтение: список команд на стеке, без кучи
 esp_err_t pcf8574_read(uint8_t addr, uint8_t *data) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    uint8_t link_buf[I2C_LINK_RECOMMENDED_SIZE(1)];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(link_buf, sizeof(link_buf));
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
     i2c_master_read_byte(cmd, data, I2C_MASTER_NACK);
     i2c_master_stop(cmd);
     
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 50 / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
+    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, I2C_TIMEOUT_TICKS);
+    i2c_cmd_link_delete_static(cmd);
     return ret;
-}
\ No newline at end of file
+}
+
+// ==========================================
+// ПРОХОД ШИНЫ ПО ВСЕМ РАСШИРИТЕЛЯМ
+// ==========================================
+static uint8_t sweep_link_buf[I2C_LINK_RECOMMENDED_SIZE(I2C_SWEEP_MAX_DEVICES)];
+static i2c_cmd_handle_t sweep_cmd = NULL;
+static uint8_t sweep_addrs[I2C_SWEEP_MAX_DEVICES];
+static uint8_t sweep_data[I2C_SWEEP_MAX_DEVICES];
+static int sweep_count = 0;
+
+static struct I2cPollStats poll_stats = {};
+
+esp_err_t pcf8574_sweep_init(const uint8_t* addrs, int count) {
+    if (count < 0 || count > I2C_SWEEP_MAX_DEVICES) return ESP_ERR_INVALID_ARG;
+
+    if (sweep_cmd != NULL) {
+        i2c_cmd_link_delete_static(sweep_cmd);
+        sweep_cmd = NULL;
+    }
+    sweep_count = count;
+    if (count == 0) return ESP_OK;
+
+    memcpy(sweep_addrs, addrs, count);
+    sweep_cmd = i2c_cmd_link_create_static(sweep_link_buf, sizeof(sweep_link_buf));
+    if (sweep_cmd == NULL) return ESP_ERR_NO_MEM;
+
+    // Между расширителями - повторный START без STOP
+    for (int i = 0; i < count; i++) {
+        i2c_master_start(sweep_cmd);
+        i2c_master_write_byte(sweep_cmd, (addrs[i] << 1) | I2C_MASTER_READ, true);
+        i2c_master_read_byte(sweep_cmd, &sweep_data[i], I2C_MASTER_NACK);
+    }
+    return i2c_master_stop(sweep_cmd);
+}
+
+esp_err_t pcf8574_sweep(uint8_t* ports) {
+    if (sweep_cmd == NULL) return ESP_ERR_INVALID_STATE;
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, sweep_cmd, I2C_TIMEOUT_TICKS);
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+
+    poll_stats.sweeps++;
+    poll_stats.total_us += dt;
+    poll_stats.last_us = dt;
+    if (dt > poll_stats.max_us) poll_stats.max_us = dt;
+
+    if (ret == ESP_OK) {
+        memcpy(ports, sweep_data, sweep_count);
+        return ESP_OK;
+    }
+
+    // Один расширитель не ответил - остальные читаем по отдельности;
+    // порт, который так и не прочитался, в ports не меняется
+    poll_stats.errors++;
+    esp_err_t result = ESP_OK;
+    for (int i = 0; i < sweep_count; i++) {
+        uint8_t data;
+        esp_err_t r = pcf8574_read(sweep_addrs[i], &data);
+        if (r == ESP_OK) ports[i] = data;
+        else result = r;
+    }
+    return result;
+}
+
+void get_i2c_poll_stats(struct I2cPollStats* out) {
+    *out = poll_stats;
+}
+
+void print_i2c_poll_stats() {
+    static uint32_t prev_sweeps = 0;
+    static int64_t prev_time = 0;
+
+    int64_t now = esp_timer_get_time();
+    struct I2cPollStats s = poll_stats;
+    double rate = prev_time > 0 && now > prev_time
+                  ? (double)(s.sweeps - prev_sweeps) * 1000000.0 / (double)(now - prev_time) : 0.0;
+    prev_sweeps = s.sweeps;
+    prev_time = now;
+
+    printf("🔌 I2C %lu кГц: опросов %lu (%.1f/с) | ошибок %lu | транзакция avg %llu мкс, max %lu мкс\n",
+           (unsigned long)(bus_freq_hz / 1000), (unsigned long)s.sweeps, rate, (unsigned long)s.errors,
+           (unsigned long long)(s.sweeps ? s.total_us / s.sweeps : 0), (unsigned long)s.max_us);
+}
+
+// ==========================================
+// САМОПРОВЕРКА БЫСТРОГО РЕЖИМА
+// ==========================================
+// PCF8574 по документации рассчитан на 100 кГц, многие экземпляры и
+// PCA8574 работают на 400 кГц. Проверяем: все проходы без ошибок и порты
+// читаются так же, как на штатной частоте (при старте линии в покое).
+struct SweepRun {
+    uint32_t errors;
+    uint32_t mismatches;
+    int64_t avg_us;
+};
+
+static void run_sweeps(const uint8_t* expected, SweepRun* r) {
+    r->errors = 0;
+    r->mismatches = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < I2C_SELFTEST_SWEEPS; i++) {
+        uint8_t ports[I2C_SWEEP_MAX_DEVICES];
+        if (i2c_master_cmd_begin(I2C_MASTER_NUM, sweep_cmd, I2C_TIMEOUT_TICKS) != ESP_OK) {
+            r->errors++;
+            continue;
+        }
+        memcpy(ports, sweep_data, sweep_count);
+        if (expected && memcmp(ports, expected, sweep_count) != 0) r->mismatches++;
+    }
+    r->avg_us = (esp_timer_get_time() - t0) / I2C_SELFTEST_SWEEPS;
+}
+
+bool i2c_bus_try_fast_mode() {
+    if (sweep_cmd == NULL || I2C_MASTER_FAST_FREQ_HZ <= I2C_MASTER_FREQ_HZ) return false;
+
+    uint8_t reference[I2C_SWEEP_MAX_DEVICES];
+    if (pcf8574_sweep(reference) != ESP_OK) {
+        printf("❌ Самопроверка I2C: расширители не отвечают на %d кГц\n", I2C_MASTER_FREQ_HZ / 1000);
+        return false;
+    }
+    SweepRun slow;
+    run_sweeps(NULL, &slow);
+
+    i2c_driver_delete(I2C_MASTER_NUM);
+    if (bus_install(I2C_MASTER_FAST_FREQ_HZ) != ESP_OK) {
+        bus_install(I2C_MASTER_FREQ_HZ);
+        return false;
+    }
+    SweepRun fast;
+    run_sweeps(reference, &fast);
+
+    bool ok = fast.errors == 0 && fast.mismatches == 0;
+    printf("%s Самопроверка I2C: %d кГц - проход %lld мкс (%.0f/с), %d кГц - проход %lld мкс (%.0f/с), ошибок %lu, расхождений %lu\n",
+           ok ? "✅" : "⚠️", I2C_MASTER_FREQ_HZ / 1000, (long long)slow.avg_us,
+           slow.avg_us > 0 ? 1000000.0 / slow.avg_us : 0.0,
+           I2C_MASTER_FAST_FREQ_HZ / 1000, (long long)fast.avg_us,
+           fast.avg_us > 0 ? 1000000.0 / fast.avg_us : 0.0,
+           (unsigned long)fast.errors, (unsigned long)fast.mismatches);
+
+    if (!ok) {
+        i2c_driver_delete(I2C_MASTER_NUM);
+        bus_install(I2C_MASTER_FREQ_HZ);
+        printf("⚠️ Шина остается на %d кГц\n", I2C_MASTER_FREQ_HZ / 1000);
+    }
+    return ok;
+}
@@ -0,0 +1,112 @@
+#include "latency_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <esp_timer.h>
+
+static LatencyHistogram hist[LAT_STAGES];
+
+static const char* const stage_names[LAT_STAGES] = {
+    "bits", "timeout", "decode", "queue", "check", "flash", "decision", "total",
+};
+
+// ==========================================
+// КОРЗИНЫ
+// ==========================================
+// 0..3 мкс - по корзине на значение, дальше по 4 корзины на октаву:
+// [4<<k, 5<<k), [5<<k, 6<<k), [6<<k, 7<<k), [7<<k, 8<<k)
+
+static inline uint32_t bucket_of(uint32_t us) {
+    if (us < 4) return us;
+    uint32_t e = 31 - __builtin_clz(us);
+    uint32_t idx = (e - 1) * 4 + ((us >> (e - 2)) & 3);
+    return idx < LAT_BUCKETS ? idx : LAT_BUCKETS - 1;
+}
+
+static uint32_t bucket_low(uint32_t idx) {
+    if (idx < 4) return idx;
+    uint32_t e = idx / 4 + 1;
+    return (4 + idx % 4) << (e - 2);
+}
+
+static uint32_t bucket_high(uint32_t idx) {
+    return idx + 1 < LAT_BUCKETS ? bucket_low(idx + 1) - 1 : 0xFFFFFFFF;
+}
+
+void latency_record(LatencyStage stage, uint32_t us) {
+    LatencyHistogram* h = &hist[stage];
+    h->buckets[bucket_of(us)]++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+    h->count++;
+}
+
+void latency_reset() {
+    memset(hist, 0, sizeof(hist));
+}
+
+const char* latency_stage_name(LatencyStage stage) {
+    return stage < LAT_STAGES ? stage_names[stage] : "?";
+}
+
+void get_latency_histogram(LatencyStage stage, LatencyHistogram* out) {
+    *out = hist[stage];
+}
+
+static uint32_t histogram_percentile(const LatencyHistogram* h, uint32_t pct) {
+    if (h->count == 0) return 0;
+    uint64_t rank = ((uint64_t)h->count * pct + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint32_t high = bucket_high(i);
+            return high < h->max_us ? high : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+uint32_t latency_percentile(LatencyStage stage, uint32_t pct) {
+    LatencyHistogram h = hist[stage];
+    return histogram_percentile(&h, pct);
+}
+
+// ==========================================
+// ВЫВОД
+// ==========================================
+
+void print_latency_stats() {
+    bool any = false;
+    for (int s = 0; s < LAT_STAGES; s++) {
+        LatencyHistogram h = hist[s];
+        if (h.count == 0) continue;
+        if (!any) printf("⏱️  Задержки, мкс (от последнего бита до решения):\n");
+        any = true;
+        printf("   %-9s p50: %7lu | p95: %7lu | p99: %7lu | max: %7lu | n: %lu\n", stage_names[s],
+               (unsigned long)histogram_percentile(&h, 50), (unsigned long)histogram_percentile(&h, 95),
+               (unsigned long)histogram_percentile(&h, 99), (unsigned long)h.max_us,
+               (unsigned long)h.count);
+    }
+}
+
+void dump_latency_json() {
+    printf("LATENCY {\"uptime_ms\":%llu,\"unit\":\"us\",\"stages\":{",
+           (unsigned long long)(esp_timer_get_time() / 1000));
+    for (int s = 0; s < LAT_STAGES; s++) {
+        LatencyHistogram h = hist[s];
+        printf("%s\"%s\":{\"n\":%lu,\"sum\":%llu,\"max\":%lu,\"p50\":%lu,\"p95\":%lu,\"p99\":%lu,\"buckets\":[",
+               s ? "," : "", stage_names[s], (unsigned long)h.count, (unsigned long long)h.sum_us,
+               (unsigned long)h.max_us, (unsigned long)histogram_percentile(&h, 50),
+               (unsigned long)histogram_percentile(&h, 95), (unsigned long)histogram_percentile(&h, 99));
+        // Корзина: [нижняя граница, число]
+        bool first = true;
+        for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+            if (!h.buckets[i]) continue;
+            printf("%s[%lu,%lu]", first ? "" : ",", (unsigned long)bucket_low(i), (unsigned long)h.buckets[i]);
+            first = false;
+        }
+        printf("]}");
+    }
+    printf("}}\n");
+}
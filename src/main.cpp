@@ -4,7 +4,17 @@
 
 #include "i2c_driver.h"
 #include "wiegand_processor.h"
+#include "wiegand_capture.h"
 #include "search.h"
+#include "card_cache.h"
+#include "card_storage.h"
+#include "card_db.h"
+#include "card_usage.h"
+#include "access_journal.h"
+#include "card_import.h"
+#include "benchmark.h"
+#include "event_log.h"
+#include "latency_trace.h"
 #include "config.h"
 
 // Глобальные переменные для статистики
@@ -18,6 +28,10 @@ void sensor_task(void *pvParameter) {
     
     // Включаем отладку, чтобы видеть сырые данные
     set_wiegand_debug(true);
+
+    // Фронты D0/D1 ловят прерывания на этом ядре, задача спит до фронта
+    // или до конца паузы кадра
+    wiegand_capture_start();
     
     while (1) {
         check_wiegand();
@@ -28,14 +42,19 @@ void sensor_task(void *pvParameter) {
             // Это решает проблему чтения глобальных переменных после их возможного сброса.
             uint64_t captured_data = wiegand_data;
             uint8_t captured_bits = wiegand_bit_count;
+            WiegandFrame captured_frame = wiegand_frame;
 
-            // 1. Обрабатываем данные Wiegand (для вывода в консоль и сброса флага ready)
-            // Эта функция использует ГЛОБАЛЬНЫЕ переменные для печати и сбрасывает флаг.
-            process_wiegand_data(); 
+            // 1. Разбор по реестру форматов (события в журнал и сброс флага ready).
+            // Потерянные фронты, неизвестная длина и ошибка четности - кадр
+            // в поиск не идет
+            WiegandCredential cred;
+            if (process_wiegand_data(&cred) != WIEGAND_DECODE_OK) {
+                continue;
+            }
             
             // 2. Проверка на мусорные данные (0x0)
-            if (captured_data == 0 || captured_bits == 0) {
-                printf("❌ Ошибка: Получен пустой/недействительный пакет (0x0, %d бит). Игнорирую.\n", captured_bits);
+            if (captured_data == 0) {
+                evlog(EVLOG_WARN, EVLOG_SRC_WIEGAND, WLOG_EMPTY, captured_bits, 0, 0, 0);
                 continue; // Начинаем новый цикл
             }
             
@@ -51,40 +70,72 @@ void sensor_task(void *pvParameter) {
                 last_card_time = current_time;
             }
             
-            // 4. Подготовка данных для поиска (используем захваченные ЛОКАЛЬНЫЕ данные)
-            uint64_t search_data = captured_data;
-
-            // Если это 58 бит (с четностью), обрезаем лишнее
-            if (captured_bits == 58) {
-                search_data = (captured_data >> 1) & 0x00FFFFFFFFFFFFFFULL;
-            }
-            // Для остальных форматов отправляем как есть
+            // 4. Ключ поиска - из описания формата (для 58 бит без четности)
+            uint64_t search_data = cred.key;
             
-            printf("🚀 Отправка в поиск HEX: 0x%014llX (Бит: %d)\n", search_data, captured_bits);
+            evlog(EVLOG_INFO, EVLOG_SRC_WIEGAND, WLOG_SENT, captured_bits, captured_frame.reader_id, search_data, 0);
             
-            // 5. Отправляем ЛОКАЛЬНУЮ переменную в очередь (FreeRTOS Queue)
-            add_card_to_search_queue(search_data);
+            // 5. Отправляем событие со всем контекстом чтения в канал поиска
+            CardReadEvent ev = {};
+            ev.card_hex = search_data;
+            ev.raw_data = captured_data;
+            ev.first_edge_us = captured_frame.first_edge_us;
+            ev.last_edge_us = captured_frame.last_edge_us;
+            ev.bits = captured_bits;
+            ev.reader_id = captured_frame.reader_id;
+            if (add_card_to_search_queue(&ev)) {
+                // Этапы кадра; enqueue_us проставил канал
+                latency_record(LAT_BITS, captured_frame.last_edge_us - captured_frame.first_edge_us);
+                latency_record(LAT_TIMEOUT, captured_frame.complete_us - captured_frame.last_edge_us);
+                latency_record(LAT_DECODE, ev.enqueue_us - captured_frame.complete_us);
+            }
         }
         
         speed_test();
-        vTaskDelay(5 / portTICK_PERIOD_MS);
+        wiegand_capture_wait(wiegand_wait_ms());
     }
 }
 
 // Задача для вывода статистики
 void stats_task(void *pvParameter) {
+    uint32_t stats_cycles = 0;
     while (1) {
         // Проверяем свободное место в стеке
         UBaseType_t stack_high_water_mark = uxTaskGetStackHighWaterMark(NULL);
         
-        if (search_queue != NULL) {
-            printf("📊 Статистика: %lu карт/мин | Очередь: %d | Free Stack: %d\n", 
-                   cards_per_minute, 
-                   uxQueueMessagesWaiting(search_queue),
-                   stack_high_water_mark);
-        } else {
-            printf("📊 Статистика: %lu карт/мин | Очередь: --\n", cards_per_minute);
+        printf("📊 Статистика: %lu карт/мин | Очередь: %lu | Free Stack: %d\n", 
+               cards_per_minute, 
+               search_queue_depth(),
+               stack_high_water_mark);
+
+        ReadChannelStats qs;
+        get_search_channel_stats(&qs);
+        printf("📨 Канал поиска: отправлено %lu | принято %lu | полон %lu | отброшено %lu | пробуждений %lu | макс. %lu\n",
+               qs.pushed, qs.popped, qs.full, qs.dropped, qs.wakeups, qs.max_depth);
+
+        CardCacheStats cs;
+        get_card_cache_stats(&cs);
+        printf("⚡ Кеш: попаданий %lu | отрицательных %lu | промахов %lu | вытеснено %lu | истекло %lu | устарело до записи %lu\n",
+               cs.hits, cs.negative_hits, cs.misses, cs.evictions, cs.expired, cs.stale_puts);
+        WiegandCaptureStats ws;
+        get_wiegand_capture_stats(&ws);
+        printf("📡 Захват: фронтов %lu | прерываний %lu | потеряно %lu | переполнений %lu | макс. в кольце %lu\n",
+               ws.edges, ws.interrupts, ws.lost_edges, ws.overflows, ws.max_depth);
+        if (wiegand_reader_count() > 1) {
+            printf("📡 Фронтов по считывателям:");
+            for (int r = 0; r < wiegand_reader_count(); r++) printf(" #%d: %lu", r, ws.reader_edges[r]);
+            printf("\n");
         }
+        print_wiegand_format_stats();
+        print_i2c_poll_stats();
+        print_compaction_stats();
+        print_card_usage_stats();
+        print_access_journal_stats();
+        print_event_log_stats();
+        print_latency_stats();
+#if LATENCY_DUMP_EVERY
+        if (++stats_cycles % LATENCY_DUMP_EVERY == 0) dump_latency_json();
+#endif
         vTaskDelay(10000 / portTICK_PERIOD_MS);
     }
 }
@@ -92,6 +143,11 @@ void stats_task(void *pvParameter) {
 extern "C" void app_main() {
     printf("=== WIEGAND READER - FIXED VERSION ===\n");
     printf("📍 D0: Input %d, D1: Input %d\n", WIEGAND_D0, WIEGAND_D1);
+
+    // Отложенный журнал: горячие пути пишут записи, печатает фоновая задача
+    evlog_register(EVLOG_SRC_WIEGAND, wiegand_log_format);
+    evlog_register(EVLOG_SRC_SEARCH, search_log_format);
+    evlog_start();
     
     // Инициализация I2C
     esp_err_t ret = i2c_master_init();
@@ -101,19 +157,38 @@ extern "C" void app_main() {
     }
     printf("✅ I2C initialized\n");
 
+    // Таблица считывателей задает расширители для прохода шины
+    wiegand_set_readers(NULL, 0, NULL, 0);
+#if I2C_FAST_MODE_SELFTEST
+    i2c_bus_try_fast_mode();
+#endif
+
     // Инициализация файловой системы
     init_spiffs();
+    card_storage_init(CARD_STORAGE_BACKEND);
     
     // Инициализация базы данных и ТЕСТОВЫХ КАРТ
     generate_data_if_needed();
     load_indices();
+    card_db_init();
+    card_usage_init();
+    access_journal_init();
+    card_import_boot_file();
+    add_test_cards_to_database();
     print_storage_info();
     
     // Показываем какие карты сейчас в памяти как тестовые
     print_test_cards_info();
+
+#if RUN_BENCHMARKS
+    run_benchmarks();
+#endif
     
     // Запускаем задачу поиска (Ядро 0)
     start_search_task();
+#if IMPORT_UART_ENABLE
+    card_import_uart_start();
+#endif
     
     // Запускаем задачу датчика (Ядро 1)
     xTaskCreatePinnedToCore(
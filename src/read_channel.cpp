@@ -0,0 +1,92 @@
+#include "read_channel.h"
+#include <esp_timer.h>
+#include <string.h>
+
+#if (READ_CHANNEL_SIZE & (READ_CHANNEL_SIZE - 1)) != 0
+#error "READ_CHANNEL_SIZE must be a power of two"
+#endif
+
+void read_channel_init(struct ReadChannel* ch) {
+    memset(ch, 0, sizeof(*ch));
+}
+
+uint32_t read_channel_depth(const struct ReadChannel* ch) {
+    return __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+}
+
+// ==========================================
+// ПИСАТЕЛЬ
+// ==========================================
+
+bool read_channel_push(struct ReadChannel* ch, struct CardReadEvent* ev) {
+    uint32_t head = ch->head;
+    uint32_t depth = head - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+    if (depth >= READ_CHANNEL_SIZE) {
+        ch->full++;
+        return false;
+    }
+
+    ev->seq = ch->seq++;
+    ev->enqueue_us = (uint32_t)esp_timer_get_time();
+    ch->slots[head & (READ_CHANNEL_SIZE - 1)] = *ev;
+    __atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+
+    ch->pushed++;
+    if (depth + 1 > ch->max_depth) ch->max_depth = depth + 1;
+
+    // Запись head должна стать видна раньше, чем мы прочитаем флаг
+    // ожидания - иначе читатель может уснуть на непустом канале
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&ch->consumer_waiting, 0, __ATOMIC_ACQ_REL)) {
+        ch->wakeups++;
+        xTaskNotifyGive(ch->consumer);
+    }
+    return true;
+}
+
+bool read_channel_send(struct ReadChannel* ch, struct CardReadEvent* ev, uint32_t wait_ms) {
+    if (read_channel_push(ch, ev)) return true;
+
+    // Канал полон: поиск отстает. Ждем по тику, пока не освободится место
+    for (uint32_t waited = 0; waited < wait_ms; waited += portTICK_PERIOD_MS) {
+        vTaskDelay(1);
+        if (read_channel_push(ch, ev)) return true;
+    }
+    ch->dropped++;
+    return false;
+}
+
+// ==========================================
+// ЧИТАТЕЛЬ
+// ==========================================
+
+bool read_channel_pop(struct ReadChannel* ch, struct CardReadEvent* out) {
+    uint32_t tail = ch->tail;
+    if (tail == __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE)) return false;
+
+    *out = ch->slots[tail & (READ_CHANNEL_SIZE - 1)];
+    __atomic_store_n(&ch->tail, tail + 1, __ATOMIC_RELEASE);
+    ch->popped++;
+    return true;
+}
+
+void read_channel_wait(struct ReadChannel* ch, uint32_t timeout_ms) {
+    if (read_channel_depth(ch) > 0) return;
+
+    ch->consumer = xTaskGetCurrentTaskHandle();
+    __atomic_store_n(&ch->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+    // Повторная проверка после флага: событие могло прийти между ними
+    if (read_channel_depth(ch) == 0) {
+        ulTaskNotifyTake(pdTRUE, timeout_ms == 0xFFFFFFFF ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+    }
+    __atomic_store_n(&ch->consumer_waiting, 0, __ATOMIC_RELEASE);
+}
+
+void get_read_channel_stats(const struct ReadChannel* ch, struct ReadChannelStats* out) {
+    out->pushed = ch->pushed;
+    out->popped = ch->popped;
+    out->full = ch->full;
+    out->dropped = ch->dropped;
+    out->wakeups = ch->wakeups;
+    out->max_depth = ch->max_depth;
+}
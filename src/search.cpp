@@ -1,10 +1,25 @@
 #include "search.h"
+#include "card_record.h"
+#include "card_block.h"
+#include "card_filter.h"
+#include "card_cache.h"
+#include "card_storage.h"
+#include "card_table.h"
+#include "card_hash.h"
+#include "card_db.h"
+#include "card_usage.h"
+#include "access_journal.h"
+#include "event_log.h"
+#include "latency_trace.h"
+#include "config.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <limits.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_spiffs.h"
@@ -12,21 +27,81 @@
 #include "esp_timer.h" 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h" // Важно добавить этот инклюд
+#include "freertos/semphr.h"
 
 // ==========================================
 // НАСТРОЙКИ И ГЛОБАЛЬНЫЕ ПЕРЕМЕННЫЕ
 // ==========================================
-#define TOTAL_FILES 10
-#define RECORDS_PER_FILE 1000
-#define RECORD_BITS 86
-#define FILE_SIZE_BYTES ((RECORDS_PER_FILE * RECORD_BITS) / 8)
-#define MOUNT_POINT "/spiffs"
-#define SEARCH_QUEUE_SIZE 10
-
-uint64_t file_start_ids[TOTAL_FILES];
-QueueHandle_t search_queue = NULL;
+
+// Разреженный индекс: первый ключ и смещение каждого блока из
+// INDEX_BLOCK_RECORDS записей. Поиск читает с флеша только один блок.
+
+// Пакетный поиск читает соседние блоки одного файла одним чтением
+#define BATCH_READ_BLOCKS 8
+
+// Манифест: заголовок, таблица шардов, ключи-границы и смещения блоков всех
+// шардов. Загрузка базы - одно чтение этого файла вместо обхода файлов данных.
+// Версия 2 - файлы шардов с дельтами ключей (card_block.h); манифест версии 1
+// не читается, база переводится в новый формат обходом файлов.
+#define MANIFEST_FILE MOUNT_POINT "/manifest.bin"
+#define MANIFEST_NEW_FILE MOUNT_POINT "/manifest.new"
+#define MANIFEST_MAGIC 0x4E414D43  // "CMAN"
+#define MANIFEST_VERSION 2
+
+struct ManifestHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t shard_count;
+    uint32_t fence_count;
+    uint32_t next_file_id;
+    uint32_t generation;
+    uint32_t crc;  // CRC32 таблицы шардов, границ и смещений блоков
+};
+
+// Поколение базы: двухуровневый индекс - бинарный поиск по first_id шардов,
+// затем по границам блоков шарда (shard_fence_start[i] - начало его границ
+// в block_fences и смещений блоков в файле в block_offsets).
+//
+// Поиск закрепляет текущее поколение счетчиком readers и читает его без
+// блокировок. Подмена (A/B): новое поколение собирается во втором слоте,
+// записывается манифест, одна атомарная запись live_snapshot делает его
+// текущим. Прежнее поколение освобождается, когда у него не остается
+// читателей: только тогда удаляются файлы выбывших шардов и индекс в RAM.
+// В режиме CARD_RAM_TABLE поколение несет и всю базу, распакованную в RAM,
+// в режиме CARD_HASH_INDEX - хеш-индекс на флеше, построенный для него.
+struct DbSnapshot {
+    uint32_t generation;  // поколение манифеста
+    int shard_count;
+    ShardInfo shards[MAX_SHARDS];
+    uint32_t shard_fence_start[MAX_SHARDS];
+    uint64_t* block_fences;
+    uint32_t* block_offsets;
+    uint32_t fence_count;
+    CardTable* table;     // база в RAM (card_table.h), NULL - поиск по флешу
+    CardHashIndex* hash;  // хеш-индекс (card_hash.h), NULL - по границам блоков
+    uint32_t readers;     // поиски, закрепившие поколение
+};
+static DbSnapshot snapshots[2];
+static int live_snapshot = 0;
+static bool ram_table_enabled = CARD_RAM_TABLE;
+static bool hash_index_enabled = CARD_HASH_INDEX;
+static uint32_t next_file_id = 0;
+static SearchStats search_stats = {};
+// Счетчики поиска растут из нескольких задач сразу (рабочая задача поиска,
+// одиночные поиски, замеры) - только атомарно. Поколения и ожидания
+// читателей пишутся под db_mutex.
+#define SEARCH_STAT_ADD(field, v) __atomic_fetch_add(&search_stats.field, (v), __ATOMIC_RELAXED)
+// События чтения от sensor_task (ядро 1) к рабочей задаче поиска (ядро 0)
+static ReadChannel search_channel;
+static bool search_started = false;
 static bool spiffs_initialized = false;
+// Файл данных не удалось перевести в новый формат или прочитать -
+// файлы вне манифеста не удаляются
+static bool keep_unlisted_files = false;
+
+// Подмены поколений идут по одной (уплотнение, импорт, загрузка индексов);
+// поиск эту блокировку не берет
+static SemaphoreHandle_t db_mutex = NULL;
 
 // ==========================================
 // ТЕСТОВЫЕ КАРТЫ (добавьте свои HEX-идентификаторы)
@@ -53,11 +128,9 @@ static TestCard test_cards[] = {
 // FORWARD DECLARATIONS
 // ==========================================
 
-uint64_t extract_bits_from_ram(const uint8_t* buffer, uint64_t global_bit_start, int bit_count);
-void get_card_from_buffer(const uint8_t* buffer, int index, CardInfo* out);
-void push_bits(uint8_t* buffer, int* bit_cursor, uint64_t value, int width);
 void print_card_info(const CardInfo* ci, int file_idx, int rec_idx);
 
+void generate_database(uint32_t records);
 void generate_data_if_needed();
 void load_indices();
 void add_test_cards_to_database();
@@ -87,279 +160,792 @@ void add_test_cards_to_database() {
     }
 
     printf("\n🔧 Добавление тестовых карт в базу данных...\n");
-    
-    // Для простоты добавим тестовые карты в первый файл
-    char fname[32];
-    snprintf(fname, sizeof(fname), "%s/data_0.bin", MOUNT_POINT);
-    
-    FILE* fd = fopen(fname, "r+b"); // Открываем для чтения и записи
-    if (!fd) {
-        printf("❌ Не могу открыть файл для добавления тестовых карт\n");
-        return;
-    }
 
-    // Читаем весь файл в память
-    uint8_t* file_buffer = (uint8_t*)malloc(FILE_SIZE_BYTES);
-    if (!file_buffer) {
-        printf("❌ Не могу выделить память\n");
-        fclose(fd);
-        return;
-    }
-    
-    fread(file_buffer, 1, FILE_SIZE_BYTES, fd);
-    
+    // Карты идут через журнал изменений: файлы данных остаются
+    // отсортированными, уплотнение само перенесет карты на место
     int cards_added = 0;
-    
-    // Заменяем первые несколько записей на тестовые карты
-    for (int i = 0; i < TEST_CARDS_COUNT && i < 10; i++) {
-        int record_index = i; // Заменяем первые записи
-        
-        uint64_t start_bit = (uint64_t)record_index * RECORD_BITS;
-        
-        // Очищаем старые данные
-        for (int bit = 0; bit < RECORD_BITS; bit++) {
-            uint64_t current_bit_pos = start_bit + bit;
-            uint32_t byte_idx = current_bit_pos / 8;
-            uint8_t  bit_idx  = current_bit_pos % 8;
-            file_buffer[byte_idx] &= ~(1 << (7 - bit_idx));
-        }
-        
-        // Записываем новую карту
-        int bit_cursor = start_bit;
-        push_bits(file_buffer, &bit_cursor, test_cards[i].hex_id, 56);
-        push_bits(file_buffer, &bit_cursor, 1, 2);  // status: активна
-        push_bits(file_buffer, &bit_cursor, 0, 4);  // count: 0
-        push_bits(file_buffer, &bit_cursor, 0xFF, 8); // zones: все зоны
-        push_bits(file_buffer, &bit_cursor, 0, 16); // link: 0
-        
+    for (int i = 0; i < TEST_CARDS_COUNT; i++) {
+        CardInfo ci;
+        ci.hex_id = test_cards[i].hex_id;
+        ci.status = 1;    // активна
+        ci.count = 0;
+        ci.zones = 0xFF;  // все зоны
+        ci.link = 0;
+
+        CardInfo existing;
+        if (lookup_card(ci.hex_id, &existing, NULL) == LOOKUP_FOUND &&
+            existing.status == ci.status && existing.zones == ci.zones) {
+            continue;  // уже в базе
+        }
+        if (!card_db_put(&ci)) continue;
+
         cards_added++;
         printf("✅ Добавлена тестовая карта: 0x%014llX - %s\n", 
                test_cards[i].hex_id, test_cards[i].name);
     }
-    
-    // Записываем изменения обратно в файл
-    fseek(fd, 0, SEEK_SET);
-    fwrite(file_buffer, 1, FILE_SIZE_BYTES, fd);
-    fclose(fd);
-    free(file_buffer);
-    
+
     printf("🎉 Добавлено %d тестовых карт в базу данных\n\n", cards_added);
-    
-    // Перезагружаем индексы
-    load_indices();
+}
+
+// ==========================================
+// ПОКОЛЕНИЯ ИНДЕКСА
+// ==========================================
+
+static const DbSnapshot* snapshot_pin() {
+    while (true) {
+        int slot = __atomic_load_n(&live_snapshot, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&snapshots[slot].readers, 1, __ATOMIC_SEQ_CST);
+        // Подмена прошла между чтением и закреплением - слот могут переписывать
+        if (__atomic_load_n(&live_snapshot, __ATOMIC_SEQ_CST) == slot) return &snapshots[slot];
+        __atomic_sub_fetch(&snapshots[slot].readers, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void snapshot_unpin(const DbSnapshot* snap) {
+    __atomic_sub_fetch(&snapshots[snap - snapshots].readers, 1, __ATOMIC_SEQ_CST);
+}
+
+static DbSnapshot* snapshot_live() {
+    return &snapshots[__atomic_load_n(&live_snapshot, __ATOMIC_SEQ_CST)];
+}
+
+// Ожидание, пока поколение не отпустят все поиски (они не блокируются
+// и заканчиваются за время одного чтения блока)
+static void snapshot_wait_readers(DbSnapshot* snap) {
+    if (__atomic_load_n(&snap->readers, __ATOMIC_SEQ_CST) == 0) return;
+    int64_t t_start = esp_timer_get_time();
+    while (__atomic_load_n(&snap->readers, __ATOMIC_SEQ_CST) != 0) vTaskDelay(1);
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t_start);
+    search_stats.reclaim_waits++;
+    if (dt > search_stats.reclaim_wait_max_us) search_stats.reclaim_wait_max_us = dt;
+}
+
+static void snapshot_free_index(DbSnapshot* snap) {
+    free(snap->block_fences);
+    free(snap->block_offsets);
+    snap->block_fences = NULL;
+    snap->block_offsets = NULL;
+    card_table_free(snap->table);
+    snap->table = NULL;
+    // Файл индекса нужен, только пока поколение текущее
+    card_hash_close(snap->hash, snap->hash && snap->hash->generation != snapshot_live()->generation);
+    snap->hash = NULL;
+    snap->fence_count = 0;
+    snap->shard_count = 0;
+}
+
+// Собирает поколение в свободном слоте (границы и смещения переходят в его
+// владение). Текущее поколение не меняется до snapshot_publish().
+static DbSnapshot* snapshot_prepare(const ShardInfo* new_shards, int count, uint64_t* fences,
+                                    uint32_t* offsets, uint32_t fences_total, uint32_t generation) {
+    DbSnapshot* next = &snapshots[live_snapshot ^ 1];
+    snapshot_wait_readers(next);
+    snapshot_free_index(next);
+    uint32_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        next->shards[i] = new_shards[i];
+        next->shard_fence_start[i] = offset;
+        offset += (new_shards[i].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+    }
+    next->shard_count = count;
+    next->block_fences = fences;
+    next->block_offsets = offsets;
+    next->fence_count = fences_total;
+    next->generation = generation;
+    return next;
+}
+
+// Делает поколение текущим и дожидается, пока прежнее отпустят. База в RAM
+// и хеш-индекс собираются до подмены; не вышло - поколение ищет по границам блоков.
+static void snapshot_publish(DbSnapshot* next) {
+    if (ram_table_enabled) next->table = card_table_load(next->shards, next->shard_count);
+    if (hash_index_enabled) next->hash = card_hash_open(next->shards, next->shard_count, next->generation);
+    DbSnapshot* prev = snapshot_live();
+    __atomic_store_n(&live_snapshot, (int)(next - snapshots), __ATOMIC_SEQ_CST);
+    search_stats.generations++;
+    snapshot_wait_readers(prev);
+    snapshot_free_index(prev);
 }
 
 // ==========================================
 // ОБНОВЛЕННАЯ ФУНКЦИЯ ПОИСКА
 // ==========================================
 
-// ...
-void search_card(uint64_t target_hex) {
-    if (!spiffs_initialized) {
-        printf("❌ SPIFFS не инициализирован - поиск невозможен\n");
-        return;
+// Последний шард, первый ключ которого <= target_hex
+static int snapshot_find_shard(const DbSnapshot* snap, uint64_t target_hex) {
+    const ShardInfo* shards = snap->shards;
+    int shard_count = snap->shard_count;
+    if (shard_count == 0 || target_hex < shards[0].first_id) return -1;
+    int left = 0, right = shard_count - 1;
+    while (left < right) {
+        int mid = left + (right - left + 1) / 2;
+        if (shards[mid].first_id <= target_hex) left = mid;
+        else right = mid - 1;
     }
-    
-    // Запускаем замер времени прямо в начале функции
-    int64_t t_start = esp_timer_get_time(); // <--- ДОБАВЛЕНО/ПЕРЕМЕЩЕНО
+    if (left == shard_count - 1 && target_hex > shards[left].last_id) return -1;
+    return left;
+}
 
-    // 1. Быстрая проверка тестовых карт
-    for (int i = 0; i < TEST_CARDS_COUNT; i++) {
-        if (test_cards[i].hex_id == target_hex) {
-            
-            // Расчет времени в наносекундах
-            int64_t search_time_us = esp_timer_get_time() - t_start;
-            uint64_t search_time_ns = (uint64_t)search_time_us * 1000;
-            
-            printf("\n🎉 === ТЕСТОВАЯ КАРТА ОБНАРУЖЕНА! ===\n");
-            printf("⏱️  Время поиска: %llu нс\n", search_time_ns); // <--- ДОБАВЛЕНО
-            printf("🔑 HEX: 0x%014llX\n", target_hex);
-            printf("🏷️  Название: %s\n", test_cards[i].name);
-            printf("📝 Описание: %s\n", test_cards[i].description);
-            printf("✅ Статус: Карта активна и разрешена\n");
-            printf("🎯 Результат: ДОСТУП РАЗРЕШЕН\n");
-            printf("================================\n\n");
-            return;
+int find_shard_for_card(uint64_t target_hex) {
+    const DbSnapshot* snap = snapshot_pin();
+    int shard = snapshot_find_shard(snap, target_hex);
+    snapshot_unpin(snap);
+    return shard;
+}
+
+static inline int shard_block_count(const DbSnapshot* snap, int shard) {
+    return (int)((snap->shards[shard].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS);
+}
+
+// Последний блок шарда, первый ключ которого <= target_hex
+static int find_block_for_card(const DbSnapshot* snap, int file_idx, uint64_t target_hex) {
+    const uint64_t* fences = snap->block_fences + snap->shard_fence_start[file_idx];
+    int left = 0, right = shard_block_count(snap, file_idx) - 1;
+    while (left < right) {
+        int mid = left + (right - left + 1) / 2;
+        if (fences[mid] <= target_hex) left = mid;
+        else right = mid - 1;
+    }
+    return left;
+}
+
+void db_lock() {
+    if (db_mutex) xSemaphoreTake(db_mutex, portMAX_DELAY);
+}
+
+void db_unlock() {
+    if (db_mutex) xSemaphoreGive(db_mutex);
+}
+
+int get_shard_count() {
+    return snapshot_live()->shard_count;
+}
+
+bool get_shard_info(int shard, ShardInfo* out) {
+    const DbSnapshot* snap = snapshot_pin();
+    bool ok = shard >= 0 && shard < snap->shard_count;
+    if (ok) *out = snap->shards[shard];
+    snapshot_unpin(snap);
+    return ok;
+}
+
+void shard_file_name(uint32_t file_id, char* buf, size_t len) {
+    snprintf(buf, len, SHARD_FILE_PATTERN, MOUNT_POINT, (unsigned long)file_id);
+}
+
+uint32_t allocate_shard_file_id() {
+    // Номера берут уплотнение и импорт из своих задач
+    return __atomic_fetch_add(&next_file_id, 1, __ATOMIC_RELAXED);
+}
+
+uint32_t get_manifest_generation() {
+    return snapshot_live()->generation;
+}
+
+bool set_ram_table_enabled(bool enable) {
+    db_lock();
+    DbSnapshot* live = snapshot_live();
+    ram_table_enabled = enable;
+    bool ok = true;
+    if (enable && !live->table) {
+        CardTable* table = card_table_load(live->shards, live->shard_count);
+        __atomic_store_n(&live->table, table, __ATOMIC_RELEASE);
+        ok = table != NULL;
+    } else if (!enable && live->table) {
+        // Поиски, уже взявшие таблицу, держат поколение закрепленным
+        CardTable* table = live->table;
+        __atomic_store_n(&live->table, (CardTable*)NULL, __ATOMIC_RELEASE);
+        snapshot_wait_readers(live);
+        card_table_free(table);
+    }
+    db_unlock();
+    return ok;
+}
+
+bool set_hash_index_enabled(bool enable) {
+    db_lock();
+    DbSnapshot* live = snapshot_live();
+    hash_index_enabled = enable;
+    bool ok = true;
+    if (enable && !live->hash) {
+        CardHashIndex* hash = card_hash_open(live->shards, live->shard_count, live->generation);
+        __atomic_store_n(&live->hash, hash, __ATOMIC_RELEASE);
+        ok = hash != NULL;
+    } else if (!enable && live->hash) {
+        CardHashIndex* hash = live->hash;
+        __atomic_store_n(&live->hash, (CardHashIndex*)NULL, __ATOMIC_RELEASE);
+        snapshot_wait_readers(live);
+        card_hash_close(hash, true);
+    }
+    db_unlock();
+    return ok;
+}
+
+bool get_hash_index_info(uint32_t* buckets, size_t* bytes, uint32_t* build_us) {
+    const DbSnapshot* snap = snapshot_pin();
+    const CardHashIndex* hash = __atomic_load_n(&snap->hash, __ATOMIC_ACQUIRE);
+    if (hash) {
+        *buckets = hash->bucket_count;
+        *bytes = hash->bytes;
+        *build_us = hash->build_us;
+    }
+    snapshot_unpin(snap);
+    return hash != NULL;
+}
+
+bool get_ram_table_info(uint32_t* records, size_t* bytes, uint32_t* load_us) {
+    const DbSnapshot* snap = snapshot_pin();
+    const CardTable* table = __atomic_load_n(&snap->table, __ATOMIC_ACQUIRE);
+    if (table) {
+        *records = table->records;
+        *bytes = table->bytes;
+        *load_us = table->load_us;
+    }
+    snapshot_unpin(snap);
+    return table != NULL;
+}
+
+// Смещение конца блока block_idx в файле шарда file_idx
+static uint32_t block_end(const DbSnapshot* snap, int file_idx, int block_idx) {
+    if (block_idx + 1 < shard_block_count(snap, file_idx)) {
+        return snap->block_offsets[snap->shard_fence_start[file_idx] + block_idx + 1];
+    }
+    return snap->shards[file_idx].bytes;
+}
+
+// Блок block_idx шарда file_idx: напрямую из отображенного раздела (если
+// образ снят с этого поколения) или одно чтение файла поколения с SPIFFS.
+// Затем дельты ключей внутри блока.
+static LookupResult find_in_block(const DbSnapshot* snap, int file_idx, int block_idx, uint64_t target_hex,
+                                  CardInfo* out, LookupInfo* info) {
+    uint32_t block_offset = snap->block_offsets[snap->shard_fence_start[file_idx] + block_idx];
+    size_t block_bytes = block_end(snap, file_idx, block_idx) - block_offset;
+    if (block_bytes > CARD_BLOCK_MAX_BYTES) return LOOKUP_IO_ERROR;
+
+    const CardStorage* storage = card_storage_for(snap->generation);
+    uint8_t block_buf[CARD_BLOCK_MAX_BYTES + RECORD_READ_PAD];
+    const uint8_t* block = block_buf;
+    size_t got = 0;
+
+    size_t file_len = 0;
+    const uint8_t* mapped = storage->map(file_idx, &file_len);
+    if (mapped) {
+        if (block_offset + block_bytes > file_len) return LOOKUP_IO_ERROR;
+        block = mapped + block_offset;
+    } else {
+        got = storage->read(&snap->shards[file_idx], file_idx, block_offset, block_buf, block_bytes);
+        if (got != block_bytes) return LOOKUP_IO_ERROR;
+    }
+
+    SEARCH_STAT_ADD(bytes_read, got);
+    if (!mapped) SEARCH_STAT_ADD(flash_reads, 1);
+    if (info) {
+        info->file_idx = file_idx;
+        info->bytes_read += got;
+        info->read_us = (uint32_t)esp_timer_get_time();
+    }
+
+    int rec = card_block_find(block, target_hex, out);
+    if (rec < 0) return LOOKUP_NOT_FOUND;
+    if (info) info->record_idx = block_idx * INDEX_BLOCK_RECORDS + rec;
+    return LOOKUP_FOUND;
+}
+
+// Хеш-индекс: корзина с флеша, затем блоки совпавших отпечатков
+// (обычно один; ложное совпадение 16-битного отпечатка - лишний блок)
+static LookupResult lookup_card_hashed(const DbSnapshot* snap, const CardHashIndex* hash, uint64_t target_hex,
+                                       CardInfo* out, LookupInfo* info) {
+    CardHashRef refs[4];
+    uint32_t bucket_bytes = 0;
+    int n = card_hash_probe(hash, target_hex, refs, 4, &bucket_bytes);
+    SEARCH_STAT_ADD(bytes_read, bucket_bytes);
+    if (bucket_bytes) SEARCH_STAT_ADD(flash_reads, 1);
+    if (info) info->bytes_read += bucket_bytes;
+    if (n < 0) return LOOKUP_IO_ERROR;
+
+    for (int i = 0; i < n; i++) {
+        if (refs[i].file_idx >= snap->shard_count ||
+            refs[i].block_idx >= shard_block_count(snap, refs[i].file_idx)) {
+            return LOOKUP_IO_ERROR;
         }
+        LookupResult res = find_in_block(snap, refs[i].file_idx, refs[i].block_idx, target_hex, out, info);
+        if (res != LOOKUP_NOT_FOUND) return res;
     }
-    
-    // 2. Подготовка к поиску в базе
-
-    int file_idx = -1;
-    for (int i = 0; i < TOTAL_FILES; i++) {
-        bool is_candidate = (target_hex >= file_start_ids[i]);
-        bool next_file_starts_later = (i == TOTAL_FILES - 1) || (target_hex < file_start_ids[i+1]);
-        if (is_candidate && next_file_starts_later) {
-            file_idx = i;
-            break;
+    return LOOKUP_NOT_FOUND;
+}
+
+static LookupResult lookup_card_in_files(const DbSnapshot* snap, uint64_t target_hex, CardInfo* out,
+                                         LookupInfo* info) {
+    if (info) info->bytes_read = 0;
+    // База в RAM: спуск по дереву дешевле фильтра, флеш не нужен
+    const CardTable* table = __atomic_load_n(&snap->table, __ATOMIC_ACQUIRE);
+    if (table) {
+        bool hit = card_table_lookup(table, target_hex, out);
+        SEARCH_STAT_ADD(lookups, 1);
+        if (info) info->checked_us = info->read_us = (uint32_t)esp_timer_get_time();
+        return hit ? LOOKUP_FOUND : LOOKUP_NOT_FOUND;
+    }
+
+    // 1. Фильтр: чужие карты отсекаются без обращения к флешу
+    bool may_contain = card_filter_may_contain(target_hex);
+    if (info) info->checked_us = (uint32_t)esp_timer_get_time();
+    if (!may_contain) {
+        SEARCH_STAT_ADD(filter_rejects, 1);
+        return LOOKUP_NOT_FOUND;
+    }
+
+    // 2. Хеш-индекс вместо границ блоков
+    const CardHashIndex* hash = __atomic_load_n(&snap->hash, __ATOMIC_ACQUIRE);
+    if (hash) {
+        SEARCH_STAT_ADD(lookups, 1);
+        return lookup_card_hashed(snap, hash, target_hex, out, info);
+    }
+
+    // 3. Файл по диапазону ключей, блок по разреженному индексу
+    int file_idx = snapshot_find_shard(snap, target_hex);
+    if (file_idx == -1) return LOOKUP_OUT_OF_RANGE;
+    SEARCH_STAT_ADD(lookups, 1);
+    return find_in_block(snap, file_idx, find_block_for_card(snap, file_idx, target_hex), target_hex, out, info);
+}
+
+// Поиск только по файлам данных (без кеша и журнала изменений)
+LookupResult lookup_card_base(uint64_t target_hex, CardInfo* out, LookupInfo* info) {
+    const DbSnapshot* snap = snapshot_pin();
+    LookupResult res = lookup_card_in_files(snap, target_hex, out, info);
+    snapshot_unpin(snap);
+    return res;
+}
+
+static LookupResult lookup_card_uncached(uint64_t target_hex, CardInfo* out, LookupInfo* info) {
+    // Журнал изменений новее файлов данных
+    DeltaLookupResult delta = card_delta_lookup(target_hex, out);
+    if (delta != DELTA_MISS) {
+        if (info) {
+            info->from_delta = true;
+            info->checked_us = (uint32_t)esp_timer_get_time();
         }
+        return delta == DELTA_FOUND ? LOOKUP_FOUND : LOOKUP_NOT_FOUND;
     }
+    return lookup_card_base(target_hex, out, info);
+}
 
-    if (file_idx == -1) {
-        printf("🔍 Результат: HEX 0x%llX вне диапазона базы данных\n", target_hex);
-        printf("❌ ДОСТУП ЗАПРЕЩЕН - карта не найдена в системе\n");
-        return;
+LookupResult lookup_card_record(uint64_t target_hex, CardInfo* out, LookupInfo* info) {
+    if (info) {
+        info->file_idx = -1;
+        info->record_idx = -1;
+        info->bytes_read = 0;
+        info->cache_hit = false;
+        info->from_delta = false;
+        info->checked_us = 0;
+        info->read_us = 0;
     }
+    if (!spiffs_initialized) return LOOKUP_IO_ERROR;
 
-    char fname[32];
-    snprintf(fname, sizeof(fname), "%s/data_%d.bin", MOUNT_POINT, file_idx);
-    FILE* fd = fopen(fname, "rb");
-    if (!fd) {
-        printf("❌ Ошибка открытия файла: %s\n", fname);
-        return;
+    int64_t t_start = esp_timer_get_time();
+    LookupResult res;
+
+    // Повторное предъявление - ответ из кеша без фильтра и флеша
+    uint32_t epoch = card_cache_epoch(target_hex);
+    CardCacheResult cached = card_cache_lookup(target_hex, out);
+    if (cached != CARD_CACHE_MISS) {
+        if (info) {
+            info->cache_hit = true;
+            info->checked_us = (uint32_t)esp_timer_get_time();
+        }
+        res = cached == CARD_CACHE_HIT ? LOOKUP_FOUND : LOOKUP_NOT_FOUND;
+    } else {
+        res = lookup_card_uncached(target_hex, out, info);
+        if (res == LOOKUP_FOUND) {
+            card_cache_put(target_hex, out, epoch);
+        } else if (res != LOOKUP_IO_ERROR) {
+            card_cache_put_negative(target_hex, epoch);
+        }
     }
 
-    uint8_t* file_buffer = (uint8_t*)malloc(FILE_SIZE_BYTES);
-    if (!file_buffer) {
-        printf("❌ Ошибка выделения памяти\n");
-        fclose(fd);
-        return;
+    // Время ответа отдельно для периода уплотнения
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t_start);
+    SEARCH_STAT_ADD(requests, 1);
+    SEARCH_STAT_ADD(request_us, dt);
+    if (card_db_compaction_running()) {
+        SEARCH_STAT_ADD(compaction_requests, 1);
+        SEARCH_STAT_ADD(compaction_request_us, dt);
     }
-    
-    fread(file_buffer, 1, FILE_SIZE_BYTES, fd);
-    fclose(fd);
+    return res;
+}
 
-    // 3. Бинарный поиск
-    int left = 0, right = RECORDS_PER_FILE - 1;
-    bool found = false;
-    CardInfo ci;
+LookupResult lookup_card(uint64_t target_hex, CardInfo* out, LookupInfo* info) {
+    LookupResult res = lookup_card_record(target_hex, out, info);
+    // Несброшенные счетчики использования - из RAM, кеш хранит запись базы
+    if (res == LOOKUP_FOUND) card_usage_apply(out);
+    return res;
+}
+
+void get_search_stats(SearchStats* out) {
+    *out = search_stats;
+}
+
+// ==========================================
+// ПАКЕТНЫЙ ПОИСК
+// ==========================================
+
+struct BatchProbe {
+    uint64_t hex_id;
+    uint32_t slot;   // позиция в массивах вызывающего
+    uint32_t epoch;  // эпоха кеша до чтения журнала (card_cache_epoch)
+};
+
+// Рабочие буферы пакетного поиска выделены один раз на пакет из
+// SEARCH_BATCH_MAX карт; вызовы из разных задач идут по очереди
+struct BatchScratch {
+    BatchProbe probes[SEARCH_BATCH_MAX];
+    uint8_t span_buf[BATCH_READ_BLOCKS * CARD_BLOCK_MAX_BYTES + RECORD_READ_PAD];
+};
+static BatchScratch batch_scratch;
+static SemaphoreHandle_t batch_mutex = NULL;
 
-    while (left <= right) {
-        int mid = left + (right - left) / 2;
-        uint64_t mid_id = extract_bits_from_ram(file_buffer, (uint64_t)mid * RECORD_BITS, 56);
-
-        if (mid_id == target_hex) {
-            get_card_from_buffer(file_buffer, mid, &ci);
-            found = true;
-            
-            // --- ИСПРАВЛЕНИЕ: ПЕРЕВОД В НС ---
-            int64_t search_time_us = esp_timer_get_time() - t_start;
-            uint64_t search_time_ns = (uint64_t)search_time_us * 1000;
-            
-            printf("\n🎉 === КАРТА НАЙДЕНА В БАЗЕ ДАННЫХ ===\n");
-            printf("⏱️  Время поиска: %llu нс\n", search_time_ns); // Вывод в наносекундах
-            printf("🔑 HEX: 0x%014llX\n", ci.hex_id);
-            printf("📊 Статус: %s\n", ci.status == 1 ? "АКТИВНА" : "ЗАБЛОКИРОВАНА");
-            printf("🔢 Счетчик использований: %d\n", ci.count);
-            printf("🚪 Доступные зоны: 0x%02X\n", ci.zones);
-            printf("🔗 Ссылка: %d\n", ci.link);
-            printf("📁 Местоположение: Файл %d, Запись %d\n", file_idx, mid);
-            
-            if (ci.status == 1) {
-                printf("✅ ДОСТУП РАЗРЕШЕН\n");
+static int compare_probes(const void* a, const void* b) {
+    uint64_t x = ((const BatchProbe*)a)->hex_id;
+    uint64_t y = ((const BatchProbe*)b)->hex_id;
+    return (x > y) - (x < y);
+}
+
+// Один пакет не больше SEARCH_BATCH_MAX карт, буферы - batch_scratch (под batch_mutex)
+static size_t search_batch_chunk(const uint64_t* ids, size_t n, CardInfo* out, LookupResult* results,
+                                 LookupInfo* info) {
+    int64_t t_start = esp_timer_get_time();
+    BatchProbe* probes = batch_scratch.probes;
+    uint8_t* span_buf = batch_scratch.span_buf;
+
+    // 1. Кеш, журнал изменений и фильтр - без обращения к флешу
+    //    (в трассе карта проверена, когда до нее дошла очередь)
+    size_t hits = 0, pending = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t epoch = card_cache_epoch(ids[i]);
+        CardCacheResult cached = card_cache_lookup(ids[i], &out[i]);
+        if (cached != CARD_CACHE_MISS) {
+            if (cached == CARD_CACHE_HIT) results[i] = LOOKUP_FOUND;
+            if (info) info[i].cache_hit = true;
+        } else {
+            DeltaLookupResult delta = card_delta_lookup(ids[i], &out[i]);
+            if (delta != DELTA_MISS && info) info[i].from_delta = true;
+            if (delta == DELTA_FOUND) {
+                results[i] = LOOKUP_FOUND;
+                card_cache_put(ids[i], &out[i], epoch);
+            } else if (delta == DELTA_DELETED) {
+                card_cache_put_negative(ids[i], epoch);
+            } else if (!card_filter_may_contain(ids[i])) {
+                SEARCH_STAT_ADD(filter_rejects, 1);
+                card_cache_put_negative(ids[i], epoch);
             } else {
-                printf("❌ ДОСТУП ЗАПРЕЩЕН - карта заблокирована\n");
+                probes[pending].hex_id = ids[i];
+                probes[pending].slot = (uint32_t)i;
+                probes[pending].epoch = epoch;
+                pending++;
             }
-            printf("================================\n\n");
-            break;
         }
-        if (mid_id < target_hex) left = mid + 1;
-        else right = mid - 1;
+        if (info) info[i].checked_us = (uint32_t)esp_timer_get_time();
     }
-    free(file_buffer);
-    
-    if (!found) {
-        printf("🔍 Результат: Карта 0x%llX не найдена в базе данных\n", target_hex);
-        printf("❌ ДОСТУП ЗАПРЕЩЕН\n");
+
+    // 2. Сортировка: карты одного файла и соседних блоков идут подряд
+    qsort(probes, pending, sizeof(BatchProbe), compare_probes);
+
+    // 3. Окно из нескольких блоков читается один раз на все карты, попавшие в него
+    // (и при хеш-индексе: окно соседних блоков дешевле корзины на каждую карту)
+    const DbSnapshot* snap = snapshot_pin();
+    const CardStorage* storage = card_storage_for(snap->generation);
+    const CardTable* table = __atomic_load_n(&snap->table, __ATOMIC_ACQUIRE);
+    int win_file = -1, win_first = 0, win_blocks = 0;
+    const uint8_t* win = NULL;
+    uint32_t win_read_us = 0;  // окно прочитано: этап флеша общий для всех его карт
+
+    for (size_t p = 0; p < pending; p++) {
+        uint64_t target = probes[p].hex_id;
+        uint32_t slot = probes[p].slot;
+        uint32_t epoch = probes[p].epoch;
+        if (table) {
+            SEARCH_STAT_ADD(lookups, 1);
+            bool hit = card_table_lookup(table, target, &out[slot]);
+            if (info) info[slot].read_us = (uint32_t)esp_timer_get_time();
+            if (hit) {
+                results[slot] = LOOKUP_FOUND;
+                card_cache_put(target, &out[slot], epoch);
+            } else {
+                card_cache_put_negative(target, epoch);
+            }
+            continue;
+        }
+        int file_idx = snapshot_find_shard(snap, target);
+        if (file_idx == -1) {
+            results[slot] = LOOKUP_OUT_OF_RANGE;
+            card_cache_put_negative(target, epoch);
+            continue;
+        }
+        int block_idx = find_block_for_card(snap, file_idx, target);
+
+        if (file_idx != win_file || block_idx < win_first || block_idx >= win_first + win_blocks) {
+            // Окно тянется до последнего блока, нужного следующим картам этого файла
+            int last_block = block_idx;
+            for (size_t q = p + 1; q < pending; q++) {
+                if (snapshot_find_shard(snap, probes[q].hex_id) != file_idx) break;
+                int b = find_block_for_card(snap, file_idx, probes[q].hex_id);
+                if (b - block_idx >= BATCH_READ_BLOCKS) break;
+                last_block = b;
+            }
+            const uint32_t* offsets = snap->block_offsets + snap->shard_fence_start[file_idx];
+            uint32_t win_offset = offsets[block_idx];
+            size_t win_bytes = block_end(snap, file_idx, last_block) - win_offset;
+
+            size_t file_len = 0, got = 0;
+            const uint8_t* mapped = storage->map(file_idx, &file_len);
+            win = NULL;
+            if (mapped) {
+                if (win_offset + win_bytes <= file_len) win = mapped + win_offset;
+            } else if (win_bytes <= (size_t)BATCH_READ_BLOCKS * CARD_BLOCK_MAX_BYTES) {
+                got = storage->read(&snap->shards[file_idx], file_idx, win_offset, span_buf, win_bytes);
+                SEARCH_STAT_ADD(bytes_read, got);
+                SEARCH_STAT_ADD(flash_reads, 1);
+                if (got == win_bytes) win = span_buf;
+            }
+            win_read_us = (uint32_t)esp_timer_get_time();
+            if (info) info[slot].bytes_read = (uint32_t)got;
+            win_file = file_idx;
+            win_first = block_idx;
+            win_blocks = win ? last_block - block_idx + 1 : 0;
+            if (!win) {
+                // Ошибка чтения - результат не кешируем
+                results[slot] = LOOKUP_IO_ERROR;
+                continue;
+            }
+        }
+
+        SEARCH_STAT_ADD(lookups, 1);
+        const uint32_t* offsets = snap->block_offsets + snap->shard_fence_start[file_idx];
+        const uint8_t* block = win + (offsets[block_idx] - offsets[win_first]);
+        int rec = card_block_find(block, target, &out[slot]);
+        if (info) {
+            info[slot].file_idx = file_idx;
+            info[slot].read_us = win_read_us;
+            if (rec >= 0) info[slot].record_idx = block_idx * INDEX_BLOCK_RECORDS + rec;
+        }
+        if (rec >= 0) {
+            results[slot] = LOOKUP_FOUND;
+            card_cache_put(target, &out[slot], epoch);
+        } else {
+            card_cache_put_negative(target, epoch);
+        }
     }
+    snapshot_unpin(snap);
+
+    for (size_t i = 0; i < n; i++) {
+        if (results[i] != LOOKUP_FOUND) continue;
+        card_usage_apply(&out[i]);
+        hits++;
+    }
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t_start);
+    SEARCH_STAT_ADD(requests, n);
+    SEARCH_STAT_ADD(request_us, dt);
+    if (card_db_compaction_running()) {
+        SEARCH_STAT_ADD(compaction_requests, n);
+        SEARCH_STAT_ADD(compaction_request_us, dt);
+    }
+    return hits;
 }
 
-// ==========================================
-// ОБНОВЛЕННАЯ ФУНКЦИЯ ГЕНЕРАЦИИ ДАННЫХ
-// ==========================================
+size_t search_cards_batch(const uint64_t* ids, size_t n, CardInfo* out, LookupResult* results, LookupInfo* info) {
+    for (size_t i = 0; i < n; i++) {
+        results[i] = spiffs_initialized ? LOOKUP_NOT_FOUND : LOOKUP_IO_ERROR;
+        if (!info) continue;
+        memset(&info[i], 0, sizeof(info[i]));
+        info[i].file_idx = -1;
+        info[i].record_idx = -1;
+    }
+    if (!spiffs_initialized || n == 0) return 0;
 
-void generate_data_if_needed() {
+    size_t hits = 0;
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < n; i += SEARCH_BATCH_MAX) {
+        size_t len = n - i < SEARCH_BATCH_MAX ? n - i : SEARCH_BATCH_MAX;
+        hits += search_batch_chunk(ids + i, len, out + i, results + i, info ? info + i : NULL);
+    }
+    xSemaphoreGive(batch_mutex);
+    return hits;
+}
+
+// Найденная карта и место ответа в одном 64-битном аргументе записи журнала
+#define FOUND_FROM_FLASH 0
+#define FOUND_FROM_CACHE 1
+#define FOUND_FROM_DELTA 2
+
+// y записи SLOG_FOUND: атрибуты по схеме | источник | запись | файл
+#define FOUND_FROM_SHIFT CARD_ATTR_BITS
+static_assert(CARD_ATTR_BITS + 2 <= 32, "Атрибуты и источник - младшие 32 бита записи лога");
+
+static uint64_t pack_found(const CardInfo* ci, const LookupInfo* info) {
+    uint64_t from = info->cache_hit ? FOUND_FROM_CACHE : info->from_delta ? FOUND_FROM_DELTA : FOUND_FROM_FLASH;
+    return card_pack_attrs(ci) | (from << FOUND_FROM_SHIFT) |
+           ((uint64_t)(uint16_t)info->record_idx << 32) | ((uint64_t)(uint16_t)info->file_idx << 48);
+}
+
+// Номер тестовой карты или -1
+static int find_test_card(uint64_t hex_id) {
+    for (int i = 0; i < TEST_CARDS_COUNT; i++) {
+        if (test_cards[i].hex_id == hex_id) return i;
+    }
+    return -1;
+}
+
+// Решение по результату поиска - одно для одиночного и пакетного пути.
+// Тестовая карта проходит без базы (ci не нужен).
+static AccessDecision access_decision(int test_card, LookupResult res, const CardInfo* ci) {
+    if (test_card >= 0) return ACCESS_GRANTED;
+    switch (res) {
+        case LOOKUP_FOUND:
+            return ci->status == 1 ? ACCESS_GRANTED : ACCESS_DENIED;
+        case LOOKUP_IO_ERROR:
+            return ACCESS_ERROR;
+        default:
+            return ACCESS_UNKNOWN;  // нет в базе или вне ее диапазона
+    }
+}
+
+// Решение по карте и его вывод; в info - где нашлась и точки трассы задержек
+static AccessDecision decide_card(uint64_t target_hex, LookupInfo* info) {
+    memset(info, 0, sizeof(*info));
+    info->file_idx = -1;
+    info->record_idx = -1;
     if (!spiffs_initialized) {
-        printf("❌ SPIFFS не инициализирован - нельзя генерировать данные\n");
-        return;
+        evlog(EVLOG_ERROR, EVLOG_SRC_SEARCH, SLOG_NO_SPIFFS, 0, 0, 0, 0);
+        return ACCESS_ERROR;
     }
     
-    struct stat st;
-    if (stat(MOUNT_POINT "/data_0.bin", &st) == 0) {
-        printf("✅ База данных уже существует\n");
-        
-        // Добавляем тестовые карты в существующую базу
-        add_test_cards_to_database();
-        return;
+    // Запускаем замер времени прямо в начале функции
+    int64_t t_start = esp_timer_get_time();
+
+    // 1. Быстрая проверка тестовых карт
+    int test_card = find_test_card(target_hex);
+    if (test_card >= 0) {
+        info->checked_us = (uint32_t)esp_timer_get_time();
+        uint32_t search_time_us = (uint32_t)(info->checked_us - t_start);
+        evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_TEST_CARD, test_card, search_time_us, target_hex, 0);
+        return access_decision(test_card, LOOKUP_NOT_FOUND, NULL);
+    }
+    
+    // 2. Поиск в базе (один блок с флеша)
+    CardInfo ci;
+    LookupResult res = lookup_card(target_hex, &ci, info);
+
+    if (res == LOOKUP_OUT_OF_RANGE) {
+        evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_OUT_OF_RANGE, 0, 0, target_hex, 0);
+    } else if (res == LOOKUP_IO_ERROR) {
+        evlog(EVLOG_ERROR, EVLOG_SRC_SEARCH, SLOG_IO_ERROR, info->file_idx, 0, target_hex, 0);
+    } else if (res == LOOKUP_FOUND) {
+        uint32_t search_time_us = (uint32_t)(esp_timer_get_time() - t_start);
+        evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_FOUND, search_time_us, info->bytes_read,
+              ci.hex_id, pack_found(&ci, info));
+        card_usage_record(&ci);
+    } else {
+        evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_NOT_FOUND, 0, 0, target_hex, 0);
+    }
+    return access_decision(-1, res, &ci);
+}
+
+void search_card(uint64_t target_hex) {
+    LookupInfo info;
+    decide_card(target_hex, &info);
+}
+
+// Этапы поиска события: от постановки в канал до решения (info - трасса поиска)
+static void record_search_latency(const CardReadEvent* ev, uint32_t dequeue_us, const LookupInfo* info,
+                                  uint32_t decided_us) {
+    latency_record(LAT_QUEUE, dequeue_us - ev->enqueue_us);
+    uint32_t checked = info->checked_us ? info->checked_us : decided_us;
+    latency_record(LAT_CHECK, checked - dequeue_us);
+    uint32_t looked_up = checked;
+    if (info->read_us) {
+        latency_record(LAT_FLASH, info->read_us - checked);
+        looked_up = info->read_us;
     }
+    latency_record(LAT_DECISION, decided_us - looked_up);
+    latency_record(LAT_TOTAL, decided_us - ev->last_edge_us);
+}
 
-    printf("📁 Генерация базы данных карт...\n");
-    uint8_t* ram_buf = (uint8_t*)malloc(FILE_SIZE_BYTES);
-    if (!ram_buf) {
+static void search_event(const CardReadEvent* ev, uint32_t dequeue_us) {
+    LookupInfo info;
+    AccessDecision decision = decide_card(ev->card_hex, &info);
+    uint32_t decided_us = (uint32_t)esp_timer_get_time();
+    access_journal_append(ev->card_hex, ev->reader_id, decision);
+    record_search_latency(ev, dequeue_us, &info, decided_us);
+}
+
+// ==========================================
+// ОБНОВЛЕННАЯ ФУНКЦИЯ ГЕНЕРАЦИИ ДАННЫХ
+// ==========================================
+
+void generate_database(uint32_t records) {
+    printf("📁 Генерация базы данных карт (%lu записей)...\n", (unsigned long)records);
+    card_filter_invalidate();
+    card_cache_invalidate_all();
+    remove(MANIFEST_FILE);
+    CardInfo* cards = (CardInfo*)malloc(RECORDS_PER_FILE * sizeof(CardInfo));
+    uint8_t* ram_buf = (uint8_t*)malloc(card_file_max_bytes(RECORDS_PER_FILE) + RECORD_READ_PAD);
+    if (!cards || !ram_buf) {
         printf("❌ Ошибка выделения памяти для базы данных\n");
+        free(cards);
+        free(ram_buf);
         return;
     }
     
     uint64_t current_hex = 0x10000000000000;
 
-    for (int f = 0; f < TOTAL_FILES; f++) {
-        memset(ram_buf, 0, FILE_SIZE_BYTES);
-        int bit_cursor = 0;
-        for (int r = 0; r < RECORDS_PER_FILE; r++) {
+    for (uint32_t f = 0; f * RECORDS_PER_FILE < records; f++) {
+        uint32_t left = records - f * RECORDS_PER_FILE;
+        int in_file = left < RECORDS_PER_FILE ? (int)left : RECORDS_PER_FILE;
+        for (int r = 0; r < in_file; r++) {
             current_hex += (esp_random() % 50) + 1; 
-            push_bits(ram_buf, &bit_cursor, current_hex, 56);
-            push_bits(ram_buf, &bit_cursor, esp_random() % 4, 2);
-            push_bits(ram_buf, &bit_cursor, esp_random() % 16, 4);
-            push_bits(ram_buf, &bit_cursor, esp_random() % 255, 8);
-            push_bits(ram_buf, &bit_cursor, esp_random() % 60000, 16);
+            CardInfo* ci = &cards[r];
+            ci->hex_id = current_hex;
+            ci->status = esp_random() % (CARD_ATTR_MAX(status) + 1);
+            ci->count = esp_random() % (CARD_ATTR_MAX(count) + 1);
+            ci->zones = esp_random() % 255;
+            ci->link = esp_random() % 60000;
         }
+        size_t bytes = card_file_encode(cards, in_file, ram_buf);
         char fname[32];
-        snprintf(fname, sizeof(fname), "%s/data_%d.bin", MOUNT_POINT, f);
+        shard_file_name(f, fname, sizeof(fname));
         FILE* fd = fopen(fname, "wb");
         if (fd) {
-            fwrite(ram_buf, 1, FILE_SIZE_BYTES, fd);
+            fwrite(ram_buf, 1, bytes, fd);
             fclose(fd);
-            printf("📄 Создан файл: %s\n", fname);
+            printf("📄 Создан файл: %s (%u байт)\n", fname, (unsigned)bytes);
         } else {
             printf("❌ Ошибка создания файла: %s\n", fname);
         }
     }
+    free(cards);
     free(ram_buf);
     printf("✅ База данных сгенерирована\n");
-    
-    // Добавляем тестовые карты после генерации
-    add_test_cards_to_database();
 }
 
-// ==========================================
-// ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ (BITS)
-// ==========================================
-
-uint64_t extract_bits_from_ram(const uint8_t* buffer, uint64_t global_bit_start, int bit_count) {
-    uint64_t result = 0;
-    for (int i = 0; i < bit_count; i++) {
-        uint64_t current_bit_pos = global_bit_start + i;
-        uint32_t byte_idx = current_bit_pos / 8;
-        uint8_t  bit_idx  = current_bit_pos % 8; 
-        uint8_t bit = (buffer[byte_idx] >> (7 - bit_idx)) & 1;
-        result = (result << 1) | bit;
+void generate_data_if_needed() {
+    if (!spiffs_initialized) {
+        printf("❌ SPIFFS не инициализирован - нельзя генерировать данные\n");
+        return;
+    }
+    
+    struct stat st;
+    if (stat(MANIFEST_FILE, &st) == 0 || stat(MANIFEST_NEW_FILE, &st) == 0 ||
+        stat(MOUNT_POINT "/data_0.bin", &st) == 0) {
+        printf("✅ База данных уже существует\n");
+        return;
     }
-    return result;
-}
 
-void get_card_from_buffer(const uint8_t* buffer, int index, CardInfo* out) {
-    uint64_t start_bit = (uint64_t)index * RECORD_BITS;
-    out->hex_id = extract_bits_from_ram(buffer, start_bit, 56);
-    start_bit += 56;
-    out->status = (uint8_t)extract_bits_from_ram(buffer, start_bit, 2);
-    start_bit += 2;
-    out->count = (uint8_t)extract_bits_from_ram(buffer, start_bit, 4);
-    start_bit += 4;
-    out->zones = (uint8_t)extract_bits_from_ram(buffer, start_bit, 8);
-    start_bit += 8;
-    out->link = (uint16_t)extract_bits_from_ram(buffer, start_bit, 16);
+    generate_database(TOTAL_FILES * RECORDS_PER_FILE);
+    // Манифест и образ в разделе создаст load_indices()
 }
 
-void push_bits(uint8_t* buffer, int* bit_cursor, uint64_t value, int width) {
-    for (int i = width - 1; i >= 0; i--) {
-        uint8_t bit = (value >> i) & 1;
-        int byte_idx = (*bit_cursor) / 8;
-        int bit_idx = (*bit_cursor) % 8;
-        if (bit) buffer[byte_idx] |= (1 << (7 - bit_idx));
-        else     buffer[byte_idx] &= ~(1 << (7 - bit_idx));
-        (*bit_cursor)++;
-    }
-}
+// ==========================================
+// ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ
+// ==========================================
 
 void print_card_info(const CardInfo* ci, int file_idx, int rec_idx) {
     printf("  [F:%d R:%03d] HEX: 0x%014llX | St:%d | Cnt:%2d | Zn:0x%02X | Lnk:%5d\n", 
@@ -384,29 +970,571 @@ void init_spiffs() {
         printf("❌ Ошибка SPIFFS: %s\n", esp_err_to_name(ret));
         return;
     }
+    db_mutex = xSemaphoreCreateMutex();
+    batch_mutex = xSemaphoreCreateMutex();
     spiffs_initialized = true;
     printf("✅ SPIFFS готов\n");
 }
 
-void load_indices() {
-    if (!spiffs_initialized) return;
-    printf("📑 Загрузка индексов...\n");
-    
-    uint8_t* temp_buf = (uint8_t*)malloc(16);
-    for (int i = 0; i < TOTAL_FILES; i++) {
+static int compare_cards(const void* a, const void* b) {
+    uint64_t x = ((const CardInfo*)a)->hex_id;
+    uint64_t y = ((const CardInfo*)b)->hex_id;
+    return (x > y) - (x < y);
+}
+
+// Читает файл целиком в буфер с запасом RECORD_READ_PAD; size - его размер
+static uint8_t* read_whole_file(const char* fname, size_t* size) {
+    struct stat st;
+    if (stat(fname, &st) != 0) return NULL;
+    *size = (size_t)st.st_size;
+    uint8_t* buf = (uint8_t*)calloc(1, *size + RECORD_READ_PAD);
+    FILE* fd = buf ? fopen(fname, "rb") : NULL;
+    bool ok = fd && fread(buf, 1, *size, fd) == *size;
+    if (fd) fclose(fd);
+    if (!ok) {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+CardInfo* read_shard_cards(const ShardInfo* shard) {
+    CardInfo* cards = (CardInfo*)malloc((shard->records ? shard->records : 1) * sizeof(CardInfo));
+    if (!cards || shard->records == 0) return cards;
+    char fname[32];
+    shard_file_name(shard->file_id, fname, sizeof(fname));
+    size_t size = 0;
+    uint8_t* data = read_whole_file(fname, &size);
+    uint32_t records = 0;
+    bool ok = data && card_file_header(data, size, &records) && records == shard->records &&
+              card_file_decode(data, size, cards);
+    free(data);
+    if (!ok) {
+        free(cards);
+        return NULL;
+    }
+    return cards;
+}
+
+// Поколение закрепляется на одну порцию: обход длиной в секунды не держит
+// подмену поколений, следующая порция продолжает с ключа в новом поколении
+int read_cards_from(uint64_t from_id, uint8_t* buf, size_t buf_len, int max_blocks, CardInfo* out,
+                    uint64_t* next_id, uint32_t* bytes_read) {
+    *bytes_read = 0;
+    *next_id = UINT64_MAX;
+    if (!spiffs_initialized) return -1;
+    const DbSnapshot* snap = snapshot_pin();
+    const CardStorage* storage = card_storage_for(snap->generation);
+
+    // Шард и блок, с которых начинаются ключи >= from_id
+    int file_idx = snap->shard_count, block_idx = 0;
+    if (snap->shard_count > 0 && from_id <= snap->shards[0].first_id) {
+        file_idx = 0;
+    } else if (snap->shard_count > 0) {
+        int shard = snapshot_find_shard(snap, from_id);
+        if (shard != -1 && from_id > snap->shards[shard].last_id) {
+            file_idx = shard + 1;
+        } else if (shard != -1) {
+            file_idx = shard;
+            block_idx = find_block_for_card(snap, shard, from_id);
+        }
+    }
+
+    int n = 0;
+    while (n == 0 && file_idx < snap->shard_count) {
+        int blocks = shard_block_count(snap, file_idx);
+        if (block_idx >= blocks) {
+            file_idx++;
+            block_idx = 0;
+            continue;
+        }
+        // Сколько следующих блоков входит в буфер
+        const uint32_t* offsets = snap->block_offsets + snap->shard_fence_start[file_idx];
+        uint32_t span_offset = offsets[block_idx];
+        int last = block_idx;
+        while (last + 1 < blocks && last + 1 - block_idx < max_blocks &&
+               block_end(snap, file_idx, last + 1) - span_offset + RECORD_READ_PAD <= buf_len) {
+            last++;
+        }
+        size_t span_bytes = block_end(snap, file_idx, last) - span_offset;
+        if (span_bytes + RECORD_READ_PAD > buf_len) {
+            n = -1;
+            break;
+        }
+
+        size_t file_len = 0;
+        const uint8_t* span = storage->map(file_idx, &file_len);
+        if (span) {
+            if (span_offset + span_bytes > file_len) {
+                n = -1;
+                break;
+            }
+            span += span_offset;
+        } else {
+            size_t got = storage->read(&snap->shards[file_idx], file_idx, span_offset, buf, span_bytes);
+            *bytes_read += got;
+            if (got != span_bytes) {
+                n = -1;
+                break;
+            }
+            span = buf;
+        }
+
+        // Распаковка блоков подряд; ключи < from_id (начало первого блока) отбрасываются
+        for (int b = block_idx; b <= last && n >= 0; b++) {
+            CardInfo* decoded = out + n;
+            int got = card_block_decode(span + (offsets[b] - span_offset), decoded);
+            if (got == 0) {
+                n = -1;
+                break;
+            }
+            for (int i = 0; i < got; i++) {
+                if (decoded[i].hex_id >= from_id) out[n++] = decoded[i];
+            }
+        }
+        block_idx = last + 1;
+    }
+
+    // Порция кончается на границе блока: следующая начнется ровно с
+    // первого ключа следующего блока, а не с повторного чтения последнего
+    if (n > 0) {
+        if (block_idx < shard_block_count(snap, file_idx)) {
+            *next_id = snap->block_fences[snap->shard_fence_start[file_idx] + block_idx];
+        } else if (file_idx + 1 < snap->shard_count) {
+            *next_id = snap->shards[file_idx + 1].first_id;
+        }
+        if (*next_id <= out[n - 1].hex_id) *next_id = out[n - 1].hex_id + 1;
+    }
+    snapshot_unpin(snap);
+    return n;
+}
+
+// Конвертер: файл версии 1 (86-битные записи подряд, без заголовка) ->
+// версия 2. Записи заодно сортируются, дубликаты отбрасываются: прежняя
+// запись тестовых карт поверх начала data_0 ломала порядок ключей.
+// Новый файл пишется рядом (data_N.v2) и подменяет старый только целиком.
+// Возвращает число записей, 0 - ошибка (старый файл не тронут).
+static uint32_t convert_v1_shard(uint32_t file_id, const uint8_t* data, size_t size) {
+    char fname[32], tmp_name[32];
+    shard_file_name(file_id, fname, sizeof(fname));
+    snprintf(tmp_name, sizeof(tmp_name), "%s/data_%lu.v2", MOUNT_POINT, (unsigned long)file_id);
+
+    uint32_t records = (uint32_t)(((uint64_t)size * 8) / RECORD_BITS);
+    CardInfo* cards = (CardInfo*)malloc((records ? records : 1) * sizeof(CardInfo));
+    uint8_t* out = (uint8_t*)malloc(card_file_max_bytes(records) + RECORD_READ_PAD);
+    uint32_t kept = 0;
+    size_t bytes = 0;
+    if (cards && out && records > 0) {
+        for (uint32_t r = 0; r < records; r++) get_card_from_buffer(data, r, &cards[r]);
+        qsort(cards, records, sizeof(CardInfo), compare_cards);
+        for (uint32_t r = 0; r < records; r++) {
+            if (kept > 0 && cards[r].hex_id == cards[kept - 1].hex_id) continue;
+            cards[kept++] = cards[r];
+        }
+        bytes = card_file_encode(cards, kept, out);
+    }
+    FILE* fd = bytes ? fopen(tmp_name, "wb") : NULL;
+    bool ok = fd && fwrite(out, 1, bytes, fd) == bytes;
+    if (fd) fclose(fd);
+    free(cards);
+    free(out);
+
+    // SPIFFS не переименовывает поверх существующего файла
+    ok = ok && remove(fname) == 0 && rename(tmp_name, fname) == 0;
+    if (!ok) {
+        remove(tmp_name);
+        printf("❌ Не удалось перевести %s в формат v2\n", fname);
+        return 0;
+    }
+    printf("🔧 %s переведен в формат v2: %lu записей, %u -> %u байт\n", fname,
+           (unsigned long)kept, (unsigned)size, (unsigned)bytes);
+    return kept;
+}
+
+// Читает файл шарда целиком: границы и смещения блоков, последний ключ,
+// размер файла в shard. false - файл поврежден или не версии 2.
+static bool index_shard_file(ShardInfo* shard, uint64_t* fences, uint32_t* offsets) {
+    char fname[32];
+    shard_file_name(shard->file_id, fname, sizeof(fname));
+    size_t size = 0;
+    uint8_t* data = read_whole_file(fname, &size);
+    uint32_t records = 0;
+    bool ok = data && card_file_header(data, size, &records) && records == shard->records &&
+              card_file_index(data, size, offsets, fences, &shard->last_id);
+    free(data);
+    if (!ok) {
+        printf("❌ Файл %s поврежден\n", fname);
+        return false;
+    }
+    shard->first_id = fences[0];
+    shard->bytes = (uint32_t)size;
+    return true;
+}
+
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+bool sync_file(FILE* fd) {
+    return fflush(fd) == 0 && fsync(fileno(fd)) == 0;
+}
+
+// Атомарная запись манифеста поколения: manifest.new -> manifest.bin.
+// SPIFFS не переименовывает поверх существующего файла, поэтому старый
+// удаляется перед переименованием; при сбое между шагами load_manifest()
+// подхватит целый manifest.new.
+static bool save_manifest(const DbSnapshot* snap) {
+    int shard_count = snap->shard_count;
+    uint32_t fence_count = snap->fence_count;
+    ManifestHeader hdr = {};
+    hdr.magic = MANIFEST_MAGIC;
+    hdr.version = MANIFEST_VERSION;
+    hdr.shard_count = (uint16_t)shard_count;
+    hdr.fence_count = fence_count;
+    hdr.next_file_id = next_file_id;
+    hdr.generation = snap->generation;
+    hdr.crc = crc32_update(0, snap->shards, shard_count * sizeof(ShardInfo));
+    hdr.crc = crc32_update(hdr.crc, snap->block_fences, fence_count * sizeof(uint64_t));
+    hdr.crc = crc32_update(hdr.crc, snap->block_offsets, fence_count * sizeof(uint32_t));
+
+    FILE* fd = fopen(MANIFEST_NEW_FILE, "wb");
+    bool ok = fd &&
+              fwrite(&hdr, sizeof(hdr), 1, fd) == 1 &&
+              fwrite(snap->shards, sizeof(ShardInfo), shard_count, fd) == (size_t)shard_count &&
+              fwrite(snap->block_fences, sizeof(uint64_t), fence_count, fd) == fence_count &&
+              fwrite(snap->block_offsets, sizeof(uint32_t), fence_count, fd) == fence_count &&
+              sync_file(fd);
+    if (fd) fclose(fd);
+    if (!ok) {
+        printf("❌ Ошибка записи манифеста\n");
+        remove(MANIFEST_NEW_FILE);
+        return false;
+    }
+    remove(MANIFEST_FILE);
+    return rename(MANIFEST_NEW_FILE, MANIFEST_FILE) == 0;
+}
+
+// Проверяет и устанавливает манифест из буфера (файл прочитан целиком)
+static bool parse_manifest(uint8_t* data, size_t size) {
+    if (size < sizeof(ManifestHeader)) return false;
+    ManifestHeader hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.magic != MANIFEST_MAGIC || hdr.version != MANIFEST_VERSION || hdr.shard_count > MAX_SHARDS) {
+        return false;
+    }
+    size_t shards_bytes = (size_t)hdr.shard_count * sizeof(ShardInfo);
+    size_t fences_bytes = (size_t)hdr.fence_count * sizeof(uint64_t);
+    size_t offsets_bytes = (size_t)hdr.fence_count * sizeof(uint32_t);
+    if (size != sizeof(hdr) + shards_bytes + fences_bytes + offsets_bytes) return false;
+    const uint8_t* table = data + sizeof(hdr);
+    uint32_t crc = crc32_update(0, table, shards_bytes);
+    crc = crc32_update(crc, table + shards_bytes, fences_bytes);
+    if (crc32_update(crc, table + shards_bytes + fences_bytes, offsets_bytes) != hdr.crc) return false;
+
+    ShardInfo new_shards[MAX_SHARDS];
+    memcpy(new_shards, table, shards_bytes);
+    uint32_t expected = 0;
+    for (int i = 0; i < hdr.shard_count; i++) {
+        expected += (new_shards[i].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+    }
+    if (expected != hdr.fence_count) return false;
+
+    uint64_t* fences = (uint64_t*)malloc(fences_bytes ? fences_bytes : sizeof(uint64_t));
+    uint32_t* offsets = (uint32_t*)malloc(offsets_bytes ? offsets_bytes : sizeof(uint32_t));
+    if (!fences || !offsets) {
+        free(fences);
+        free(offsets);
+        return false;
+    }
+    memcpy(fences, table + shards_bytes, fences_bytes);
+    memcpy(offsets, table + shards_bytes + fences_bytes, offsets_bytes);
+    snapshot_publish(snapshot_prepare(new_shards, hdr.shard_count, fences, offsets, hdr.fence_count,
+                                      hdr.generation));
+    next_file_id = hdr.next_file_id;
+    return true;
+}
+
+static bool read_manifest_file(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size <= 0) return false;
+    uint8_t* data = (uint8_t*)malloc(st.st_size);
+    FILE* fd = data ? fopen(path, "rb") : NULL;
+    // Одно чтение: заголовок, шарды и все границы блоков
+    bool ok = fd && fread(data, 1, st.st_size, fd) == (size_t)st.st_size;
+    if (fd) fclose(fd);
+    ok = ok && parse_manifest(data, st.st_size);
+    free(data);
+    return ok;
+}
+
+static bool load_manifest() {
+    // Сбой посреди save_manifest(): целый manifest.new новее manifest.bin
+    if (read_manifest_file(MANIFEST_NEW_FILE)) {
+        remove(MANIFEST_FILE);
+        rename(MANIFEST_NEW_FILE, MANIFEST_FILE);
+        return true;
+    }
+    remove(MANIFEST_NEW_FILE);
+    return read_manifest_file(MANIFEST_FILE);
+}
+
+static bool shard_file_in_use(uint32_t file_id) {
+    const DbSnapshot* live = snapshot_live();
+    for (int i = 0; i < live->shard_count; i++) {
+        if (live->shards[i].file_id == file_id) return true;
+    }
+    return false;
+}
+
+// Удаляет файлы данных, которых нет в манифесте (остатки прерванного
+// уплотнения). Удаляются по ходу обхода: уже пройденная запись каталога
+// на обход не влияет, а лишних файлов может быть сколько угодно.
+static void remove_orphan_shards() {
+    DIR* dir = opendir(MOUNT_POINT);
+    if (!dir) return;
+    static char path[PATH_MAX];  // только при загрузке, не на стеке задачи
+    struct dirent* entry;
+    const DbSnapshot* live = snapshot_live();
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned long id;
+        char ext[8];
+        // Хеш-индекс прежних поколений (или выключенный)
+        if (sscanf(entry->d_name, "hash_%lu.%7s", &id, ext) == 2) {
+            if (live->hash && id == live->generation) continue;
+        } else {
+            if (sscanf(entry->d_name, "data_%lu.%7s", &id, ext) != 2) continue;
+            if (strcmp(ext, "bin") == 0 && shard_file_in_use((uint32_t)id)) continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", MOUNT_POINT, entry->d_name);
+        printf("🧹 Удален лишний файл %s\n", path);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+// Остаток прерванного перевода в формат v2: целый data_N.v2 без data_N.bin
+// занимает его место, при живом data_N.bin - удаляется
+static void finish_shard_conversion(uint32_t file_id, const char* fname) {
+    char tmp_name[32];
+    snprintf(tmp_name, sizeof(tmp_name), "%s/data_%lu.v2", MOUNT_POINT, (unsigned long)file_id);
+    struct stat st;
+    if (stat(tmp_name, &st) != 0) return;
+    if (stat(fname, &st) == 0) remove(tmp_name);
+    else rename(tmp_name, fname);
+}
+
+// Медленный путь: обход всех файлов data_N.bin (база без манифеста или
+// с манифестом прежней версии). Файлы версии 1 переводятся в версию 2.
+void rebuild_manifest() {
+    struct ScannedShard {
+        ShardInfo info;
+        uint32_t fence_offset;
+    };
+    ScannedShard found[MAX_SHARDS];
+    uint32_t blocks_total = 0;
+    uint32_t max_id = 0;
+    int count = 0;
+    bool converted = false;
+    for (uint32_t id = 0; id < MAX_SHARDS; id++) {
         char fname[32];
-        snprintf(fname, sizeof(fname), "%s/data_%d.bin", MOUNT_POINT, i);
+        shard_file_name(id, fname, sizeof(fname));
+        finish_shard_conversion(id, fname);
+        struct stat st;
+        if (stat(fname, &st) != 0) continue;
+        max_id = id + 1;
+
+        uint8_t head[CARD_FILE_HEADER_BYTES];
         FILE* fd = fopen(fname, "rb");
-        if (fd) {
-            fread(temp_buf, 1, 8, fd);
-            file_start_ids[i] = extract_bits_from_ram(temp_buf, 0, 56);
-            fclose(fd);
-        } else {
-            file_start_ids[i] = 0xFFFFFFFFFFFFFFFFULL;
+        size_t got = fd ? fread(head, 1, sizeof(head), fd) : 0;
+        if (fd) fclose(fd);
+        uint32_t records = 0;
+        if (!card_file_header(head, got == sizeof(head) ? (size_t)st.st_size : 0, &records)) {
+            if ((uint64_t)st.st_size * 8 < RECORD_BITS) continue;
+            // Прежний формат: файл целиком в RAM и обратно на флеш в версии 2
+            size_t size = 0;
+            uint8_t* data = read_whole_file(fname, &size);
+            records = data ? convert_v1_shard(id, data, size) : 0;
+            free(data);
+            if (records == 0) keep_unlisted_files = true;
+            converted = true;
+        }
+        if (records == 0) continue;
+        memset(&found[count].info, 0, sizeof(ShardInfo));
+        found[count].info.file_id = id;
+        found[count].info.records = records;
+        found[count].fence_offset = blocks_total;
+        blocks_total += (records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+        count++;
+    }
+
+    uint64_t* scanned = (uint64_t*)malloc((blocks_total + 1) * sizeof(uint64_t));
+    uint32_t* scanned_offsets = (uint32_t*)malloc((blocks_total + 1) * sizeof(uint32_t));
+    uint64_t* fences = (uint64_t*)malloc((blocks_total + 1) * sizeof(uint64_t));
+    uint32_t* offsets = (uint32_t*)malloc((blocks_total + 1) * sizeof(uint32_t));
+    if (!scanned || !scanned_offsets || !fences || !offsets) {
+        printf("❌ Ошибка выделения памяти для индекса\n");
+        free(scanned);
+        free(scanned_offsets);
+        free(fences);
+        free(offsets);
+        return;
+    }
+    int indexed = 0;
+    for (int i = 0; i < count; i++) {
+        if (!index_shard_file(&found[i].info, scanned + found[i].fence_offset,
+                              scanned_offsets + found[i].fence_offset)) {
+            keep_unlisted_files = true;  // поврежденный файл остается на месте для разбора
+            continue;
         }
+        found[indexed++] = found[i];
+    }
+    count = indexed;
+
+    // Порядок шардов - по ключам, а не по именам файлов
+    for (int i = 1; i < count; i++) {
+        for (int j = i; j > 0 && found[j].info.first_id < found[j - 1].info.first_id; j--) {
+            ScannedShard tmp = found[j];
+            found[j] = found[j - 1];
+            found[j - 1] = tmp;
+        }
+    }
+    ShardInfo table[MAX_SHARDS];
+    uint32_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        table[i] = found[i].info;
+        uint32_t blocks = (table[i].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+        memcpy(fences + offset, scanned + found[i].fence_offset, blocks * sizeof(uint64_t));
+        memcpy(offsets + offset, scanned_offsets + found[i].fence_offset, blocks * sizeof(uint32_t));
+        offset += blocks;
     }
-    free(temp_buf);
-    printf("✅ Индексы загружены\n");
+    free(scanned);
+    free(scanned_offsets);
+
+    if (converted) card_filter_invalidate();
+    if (next_file_id < max_id) next_file_id = max_id;
+    // Новое поколение заведомо отличается от образа в разделе
+    uint32_t generation = get_manifest_generation();
+    uint32_t image_generation = card_storage_generation();
+    generation = (generation > image_generation ? generation : image_generation) + 1;
+    DbSnapshot* next = snapshot_prepare(table, count, fences, offsets, offset, generation);
+    // Файлы уже на месте: поколение в работе, даже если манифест не записался
+    save_manifest(next);
+    snapshot_publish(next);
+}
+
+bool commit_shards(const ShardInfo* new_shards, int count) {
+    if (count > MAX_SHARDS) {
+        printf("❌ Слишком много шардов: %d (максимум %d)\n", count, MAX_SHARDS);
+        return false;
+    }
+    uint32_t blocks_total = 0;
+    for (int i = 0; i < count; i++) {
+        blocks_total += (new_shards[i].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+    }
+    uint64_t* fences = (uint64_t*)malloc((blocks_total + 1) * sizeof(uint64_t));
+    uint32_t* offsets = (uint32_t*)malloc((blocks_total + 1) * sizeof(uint32_t));
+    if (!fences || !offsets) {
+        free(fences);
+        free(offsets);
+        printf("❌ Ошибка выделения памяти для индекса\n");
+        return false;
+    }
+
+    // Границы прежних шардов берем из RAM, новые файлы читаем
+    const DbSnapshot* live = snapshot_live();
+    ShardInfo table[MAX_SHARDS];
+    uint32_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        table[i] = new_shards[i];
+        uint32_t blocks = (table[i].records + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS;
+        int old = -1;
+        for (int k = 0; k < live->shard_count && old < 0; k++) {
+            if (live->shards[k].file_id == table[i].file_id) old = k;
+        }
+        if (old >= 0) {
+            memcpy(fences + offset, live->block_fences + live->shard_fence_start[old], blocks * sizeof(uint64_t));
+            memcpy(offsets + offset, live->block_offsets + live->shard_fence_start[old], blocks * sizeof(uint32_t));
+        } else if (!index_shard_file(&table[i], fences + offset, offsets + offset)) {
+            free(fences);
+            free(offsets);
+            return false;
+        }
+        offset += blocks;
+    }
+
+    // Файлы выбывших шардов удаляются, когда прежнее поколение отпустят все поиски
+    uint32_t retired[MAX_SHARDS];
+    int retired_count = 0;
+    for (int k = 0; k < live->shard_count; k++) {
+        bool kept = false;
+        for (int i = 0; i < count && !kept; i++) kept = table[i].file_id == live->shards[k].file_id;
+        if (!kept) retired[retired_count++] = live->shards[k].file_id;
+    }
+
+    // Манифест на флеше - точка фиксации: не записался - поколение не публикуется
+    DbSnapshot* next = snapshot_prepare(table, count, fences, offsets, offset, live->generation + 1);
+    if (!save_manifest(next)) {
+        snapshot_free_index(next);
+        return false;
+    }
+    snapshot_publish(next);
+    for (int i = 0; i < retired_count; i++) {
+        char fname[32];
+        shard_file_name(retired[i], fname, sizeof(fname));
+        remove(fname);
+    }
+    return true;
+}
+
+void load_indices() {
+    if (!spiffs_initialized) return;
+    printf("📑 Загрузка индексов...\n");
+    int64_t t_start = esp_timer_get_time();
+
+    bool from_manifest = load_manifest();
+    if (!from_manifest) {
+        printf("📑 Манифест не найден - обход файлов данных\n");
+        rebuild_manifest();
+    }
+    if (keep_unlisted_files) {
+        printf("⚠️ Часть файлов данных не прочитана - лишние файлы не удаляются\n");
+    } else {
+        remove_orphan_shards();
+    }
+
+    const DbSnapshot* live = snapshot_live();
+    uint32_t records = 0, bytes = 0;
+    for (int i = 0; i < live->shard_count; i++) {
+        records += live->shards[i].records;
+        bytes += live->shards[i].bytes;
+    }
+    printf("✅ Индексы загружены за %lld мс: %d шардов, %lu записей (%lu байт, %.1f бит/запись), "
+           "%lu блоков по %d (%u байт RAM)%s\n",
+           (long long)((esp_timer_get_time() - t_start) / 1000), live->shard_count, (unsigned long)records,
+           (unsigned long)bytes, records ? (double)bytes * 8.0 / records : 0.0,
+           (unsigned long)live->fence_count, INDEX_BLOCK_RECORDS,
+           (unsigned)(live->fence_count * (sizeof(uint64_t) + sizeof(uint32_t)) + sizeof(snapshots)),
+           from_manifest ? "" : " - манифест записан");
+    if (live->table) {
+        printf("✅ База в RAM: %lu записей, %lu байт, распакована за %lu мс\n",
+               (unsigned long)live->table->records, (unsigned long)live->table->bytes,
+               (unsigned long)(live->table->load_us / 1000));
+    }
+    if (live->hash) {
+        printf("✅ Хеш-индекс: %lu корзин по %d байт (%lu байт)%s\n",
+               (unsigned long)live->hash->bucket_count, CARD_HASH_BUCKET_BYTES,
+               (unsigned long)live->hash->bytes, live->hash->build_us ? " - построен" : "");
+    }
+
+    // Образ в разделе должен соответствовать манифесту
+    if (card_storage_generation() != live->generation) card_storage_sync();
+    card_filter_load_or_build();
 }
 
 void print_storage_info() {
@@ -414,37 +1542,192 @@ void print_storage_info() {
     size_t total = 0, used = 0;
     esp_spiffs_info(NULL, &total, &used);
     printf("💾 Storage: %d / %d KB used\n", used/1024, total/1024);
+    print_card_filter_info();
 }
 
 // ==========================================
 // ЗАДАЧИ FREERTOS
 // ==========================================
 
+static void log_batch_results(const uint64_t* ids, size_t n, const CardInfo* cards,
+                              const LookupResult* results, const AccessDecision* decisions, int64_t time_us) {
+    evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_BATCH_BEGIN, (uint32_t)n, (uint32_t)time_us, 0, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t zones = results[i] == LOOKUP_FOUND ? cards[i].zones : 0;
+        evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_BATCH_ITEM, decisions[i], zones, ids[i], 0);
+    }
+    evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_BATCH_END, 0, 0, 0, 0);
+}
+
 void search_worker_task(void *pvParameters) {
-    uint64_t card_to_search;
+    CardReadEvent events[SEARCH_BATCH_MAX];
+    uint64_t batch[SEARCH_BATCH_MAX];
+    CardInfo cards[SEARCH_BATCH_MAX];
+    LookupResult results[SEARCH_BATCH_MAX];
+    LookupInfo infos[SEARCH_BATCH_MAX];
+    AccessDecision decisions[SEARCH_BATCH_MAX];
     while (1) {
-        // Ждем карту в очереди
-        if (xQueueReceive(search_queue, &card_to_search, portMAX_DELAY) == pdTRUE) {
-            search_card(card_to_search);
+        // Ждем событие, затем забираем все, что успело накопиться
+        read_channel_wait(&search_channel, 0xFFFFFFFF);
+        size_t n = 0;
+        while (n < SEARCH_BATCH_MAX && read_channel_pop(&search_channel, &events[n])) n++;
+        if (n == 0) continue;
+
+        uint32_t now = (uint32_t)esp_timer_get_time();
+        for (size_t i = 0; i < n; i++) {
+            batch[i] = events[i].card_hex;
+            evlog(EVLOG_INFO, EVLOG_SRC_SEARCH, SLOG_EVENT, events[i].seq,
+                  ((uint32_t)events[i].reader_id << 8) | events[i].bits, now - events[i].enqueue_us, 0);
+        }
+
+        if (n == 1) {
+            search_event(&events[0], now);
+            continue;
+        }
+        int64_t t_start = esp_timer_get_time();
+        search_cards_batch(batch, n, cards, results, infos);
+        // Решения - как у одиночного поиска (decide_card)
+        for (size_t i = 0; i < n; i++) {
+            int test_card = find_test_card(batch[i]);
+            decisions[i] = access_decision(test_card, results[i], &cards[i]);
+            if (test_card >= 0) infos[i].read_us = 0;  // как в decide_card: до базы не доходит
+            else if (results[i] == LOOKUP_FOUND) card_usage_record(&cards[i]);
+        }
+        log_batch_results(batch, n, cards, results, decisions, esp_timer_get_time() - t_start);
+
+        // Трасса каждой карты пакета: проверка - когда до нее дошла очередь,
+        // флеш - когда прочитано ее окно, решение - общее на пакет
+        uint32_t decided_us = (uint32_t)esp_timer_get_time();
+        for (size_t i = 0; i < n; i++) {
+            record_search_latency(&events[i], now, &infos[i], decided_us);
+            access_journal_append(batch[i], events[i].reader_id, decisions[i]);
         }
     }
 }
 
 void start_search_task() {
-    search_queue = xQueueCreate(SEARCH_QUEUE_SIZE, sizeof(uint64_t));
-    if (search_queue == NULL) {
-        printf("❌ Ошибка создания очереди\n");
-        return;
-    }
+    read_channel_init(&search_channel);
+    search_started = true;
 
     xTaskCreatePinnedToCore(search_worker_task, "search_worker", 8192, NULL, 1, NULL, 0);
     printf("✅ Задача поиска запущена\n");
 }
 
-void add_card_to_search_queue(uint64_t card_hex) {
-    if (search_queue != NULL) {
-        xQueueSend(search_queue, &card_hex, 0);
+bool add_card_to_search_queue(struct CardReadEvent* ev) {
+    if (!search_started) {
+        evlog(EVLOG_WARN, EVLOG_SRC_SEARCH, SLOG_QUEUE_NOT_READY, 0, 0, 0, 0);
+        return false;
+    }
+    if (!read_channel_send(&search_channel, ev, SEARCH_BACKPRESSURE_MS)) {
+        evlog(EVLOG_WARN, EVLOG_SRC_SEARCH, SLOG_QUEUE_FULL, 0, 0, ev->card_hex, 0);
+        return false;
+    }
+    return true;
+}
+
+uint32_t search_queue_depth() {
+    return search_started ? read_channel_depth(&search_channel) : 0;
+}
+
+void get_search_channel_stats(struct ReadChannelStats* out) {
+    get_read_channel_stats(&search_channel, out);
+}
+
+// ==========================================
+// ТЕКСТ СОБЫТИЙ (задача журнала)
+// ==========================================
+
+static void print_found(const EventLogRecord* r) {
+    uint64_t p = r->y;
+    CardInfo ci;
+    card_unpack_attrs(p & CARD_FIELD_MASK(CARD_ATTR_BITS), &ci);
+    uint8_t status = ci.status;
+    uint32_t from = (p >> FOUND_FROM_SHIFT) & 0x3;
+
+    printf("\n🎉 === КАРТА НАЙДЕНА В БАЗЕ ДАННЫХ ===\n");
+    printf("⏱️  Время поиска: %lu мкс\n", (unsigned long)r->a);
+    if (from == FOUND_FROM_CACHE) {
+        printf("⚡ Ответ из кеша последних решений\n");
+    } else if (from == FOUND_FROM_DELTA) {
+        printf("📝 Ответ из журнала изменений\n");
     } else {
-        printf("⚠️ Очередь не готова\n");
+        printf("📦 Прочитано с флеша: %lu байт\n", (unsigned long)r->b);
     }
-}
\ No newline at end of file
+    printf("🔑 HEX: 0x%014llX\n", (unsigned long long)r->x);
+    printf("📊 Статус: %s\n", status == 1 ? "АКТИВНА" : "ЗАБЛОКИРОВАНА");
+    printf("🔢 Счетчик использований: %d\n", (int)ci.count);
+    printf("🚪 Доступные зоны: 0x%02X\n", (unsigned)ci.zones);
+    printf("🔗 Ссылка: %d\n", (int)ci.link);
+    if (from == FOUND_FROM_FLASH) {
+        printf("📁 Местоположение: Файл %d, Запись %d\n", (int)((p >> 48) & 0xFFFF), (int)((p >> 32) & 0xFFFF));
+    }
+    
+    if (status == 1) {
+        printf("✅ ДОСТУП РАЗРЕШЕН\n");
+    } else {
+        printf("❌ ДОСТУП ЗАПРЕЩЕН - карта заблокирована\n");
+    }
+    printf("================================\n\n");
+}
+
+void search_log_format(const EventLogRecord* r) {
+    switch (r->id) {
+        case SLOG_NO_SPIFFS:
+            printf("❌ SPIFFS не инициализирован - поиск невозможен\n");
+            break;
+        case SLOG_TEST_CARD: {
+            const TestCard* tc = &test_cards[r->a < TEST_CARDS_COUNT ? r->a : 0];
+            printf("\n🎉 === ТЕСТОВАЯ КАРТА ОБНАРУЖЕНА! ===\n");
+            printf("⏱️  Время поиска: %lu мкс\n", (unsigned long)r->b);
+            printf("🔑 HEX: 0x%014llX\n", (unsigned long long)r->x);
+            printf("🏷️  Название: %s\n", tc->name);
+            printf("📝 Описание: %s\n", tc->description);
+            printf("✅ Статус: Карта активна и разрешена\n");
+            printf("🎯 Результат: ДОСТУП РАЗРЕШЕН\n");
+            printf("================================\n\n");
+            break;
+        }
+        case SLOG_OUT_OF_RANGE:
+            printf("🔍 Результат: HEX 0x%llX вне диапазона базы данных\n", (unsigned long long)r->x);
+            printf("❌ ДОСТУП ЗАПРЕЩЕН - карта не найдена в системе\n");
+            break;
+        case SLOG_IO_ERROR:
+            printf("❌ Ошибка чтения файла данных %ld\n", (long)(int32_t)r->a);
+            break;
+        case SLOG_FOUND:
+            print_found(r);
+            break;
+        case SLOG_NOT_FOUND:
+            printf("🔍 Результат: Карта 0x%llX не найдена в базе данных\n", (unsigned long long)r->x);
+            printf("❌ ДОСТУП ЗАПРЕЩЕН\n");
+            break;
+        case SLOG_EVENT:
+            printf("📥 Событие #%lu: считыватель %lu, %lu бит, в очереди %llu мкс\n",
+                   (unsigned long)r->a, (unsigned long)(r->b >> 8), (unsigned long)(r->b & 0xFF),
+                   (unsigned long long)r->x);
+            break;
+        case SLOG_BATCH_BEGIN:
+            printf("\n📦 === ПАКЕТ ИЗ %lu КАРТ (%lu мкс) ===\n", (unsigned long)r->a, (unsigned long)r->b);
+            break;
+        case SLOG_BATCH_ITEM:
+            if (r->a == ACCESS_GRANTED) {
+                printf("✅ 0x%014llX: зоны 0x%02X - ДОСТУП РАЗРЕШЕН\n", (unsigned long long)r->x, (unsigned)r->b);
+            } else if (r->a == ACCESS_DENIED) {
+                printf("❌ 0x%014llX: заблокирована - ДОСТУП ЗАПРЕЩЕН\n", (unsigned long long)r->x);
+            } else if (r->a == ACCESS_ERROR) {
+                printf("❌ 0x%014llX: ошибка чтения базы - ДОСТУП ЗАПРЕЩЕН\n", (unsigned long long)r->x);
+            } else {
+                printf("❌ 0x%014llX: не найдена - ДОСТУП ЗАПРЕЩЕН\n", (unsigned long long)r->x);
+            }
+            break;
+        case SLOG_BATCH_END:
+            printf("================================\n\n");
+            break;
+        case SLOG_QUEUE_NOT_READY:
+            printf("⚠️ Очередь не готова\n");
+            break;
+        case SLOG_QUEUE_FULL:
+            printf("⚠️ Очередь поиска переполнена - карта 0x%014llX отброшена\n", (unsigned long long)r->x);
+            break;
+    }
+}
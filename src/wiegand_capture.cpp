@@ -0,0 +1,361 @@
+#include "wiegand_capture.h"
+#include "i2c_driver.h"
+#include "config.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
+#include <stdio.h>
+#include <string.h>
+
+#if WIEGAND_MAX_EXPANDERS > I2C_SWEEP_MAX_DEVICES
+#error "WIEGAND_MAX_EXPANDERS exceeds I2C_SWEEP_MAX_DEVICES"
+#endif
+
+#if (WIEGAND_EDGE_RING_SIZE & (WIEGAND_EDGE_RING_SIZE - 1)) != 0
+#error "WIEGAND_EDGE_RING_SIZE must be a power of two"
+#endif
+
+// ==========================================
+// КОЛЬЦЕВОЙ БУФЕР ФРОНТОВ (1 писатель, 1 читатель)
+// ==========================================
+// head пишет только производитель, tail - только потребитель; порядок
+// записи слота и индекса обеспечивают release/acquire.
+static struct WiegandEdge edge_ring[WIEGAND_EDGE_RING_SIZE];
+static uint32_t edge_head = 0;
+static uint32_t edge_tail = 0;
+
+static struct WiegandCaptureStats capture_stats = {};
+static TaskHandle_t consumer_task = NULL;
+
+bool IRAM_ATTR wiegand_edge_push(uint32_t time_us, uint8_t reader, uint8_t bit) {
+    uint32_t head = edge_head;
+    uint32_t tail = __atomic_load_n(&edge_tail, __ATOMIC_ACQUIRE);
+    uint32_t depth = head - tail;
+
+    if (depth >= WIEGAND_EDGE_RING_SIZE) {
+        capture_stats.overflows++;
+        return false;
+    }
+
+    struct WiegandEdge* e = &edge_ring[head & (WIEGAND_EDGE_RING_SIZE - 1)];
+    e->time_us = time_us;
+    e->bit = bit;
+    e->reader = reader;
+    __atomic_store_n(&edge_head, head + 1, __ATOMIC_RELEASE);
+
+    capture_stats.edges++;
+    if (reader < WIEGAND_MAX_READERS) capture_stats.reader_edges[reader]++;
+    if (depth + 1 > capture_stats.max_depth) capture_stats.max_depth = depth + 1;
+    return true;
+}
+
+bool wiegand_edge_pop(struct WiegandEdge* out) {
+    uint32_t tail = edge_tail;
+    if (tail == __atomic_load_n(&edge_head, __ATOMIC_ACQUIRE)) return false;
+
+    *out = edge_ring[tail & (WIEGAND_EDGE_RING_SIZE - 1)];
+    __atomic_store_n(&edge_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t wiegand_edge_pending(void) {
+    return __atomic_load_n(&edge_head, __ATOMIC_ACQUIRE) - edge_tail;
+}
+
+// ==========================================
+// ТАБЛИЦА СЧИТЫВАТЕЛЕЙ
+// ==========================================
+static const uint8_t default_expanders[] = WIEGAND_EXPANDERS;
+static const struct WiegandReaderPins default_readers[] = WIEGAND_READERS;
+
+// Раскладка входов одного расширителя: по номеру входа (0..7) - чей он,
+// какой бит дает и где парная линия того же считывателя
+struct ExpanderMap {
+    uint8_t addr;
+    uint8_t line_mask;        // все входы D0/D1
+    uint8_t d1_mask;          // входы D1
+    uint8_t pin_reader[8];
+    uint8_t pin_partner[8];
+};
+
+static struct ExpanderMap expanders[WIEGAND_MAX_EXPANDERS];
+static int expander_count = 0;
+static int reader_count = 0;
+static uint8_t last_port[WIEGAND_MAX_EXPANDERS];
+
+bool wiegand_set_readers(const struct WiegandReaderPins* readers, int count,
+                         const uint8_t* expander_addrs, int exp_count) {
+    if (readers == NULL) {
+        readers = default_readers;
+        count = sizeof(default_readers) / sizeof(default_readers[0]);
+        expander_addrs = default_expanders;
+        exp_count = sizeof(default_expanders) / sizeof(default_expanders[0]);
+    }
+    if (count > WIEGAND_MAX_READERS || exp_count > WIEGAND_MAX_EXPANDERS) {
+        printf("❌ Слишком много считывателей: %d (макс. %d) или расширителей: %d (макс. %d)\n",
+               count, WIEGAND_MAX_READERS, exp_count, WIEGAND_MAX_EXPANDERS);
+        return false;
+    }
+
+    struct ExpanderMap map[WIEGAND_MAX_EXPANDERS] = {};
+    for (int e = 0; e < exp_count; e++) map[e].addr = expander_addrs[e];
+
+    for (int r = 0; r < count; r++) {
+        const struct WiegandReaderPins* p = &readers[r];
+        uint8_t d0 = p->d0_input - 1, d1 = p->d1_input - 1;
+        if (p->expander >= exp_count || d0 > 7 || d1 > 7 || d0 == d1 ||
+            (map[p->expander].line_mask & ((1u << d0) | (1u << d1)))) {
+            printf("❌ Считыватель %d: неверные входы %d/%d расширителя %d\n",
+                   r, p->d0_input, p->d1_input, p->expander);
+            return false;
+        }
+        struct ExpanderMap* m = &map[p->expander];
+        m->line_mask |= (uint8_t)((1u << d0) | (1u << d1));
+        m->d1_mask |= (uint8_t)(1u << d1);
+        m->pin_reader[d0] = m->pin_reader[d1] = (uint8_t)r;
+        m->pin_partner[d0] = d1;
+        m->pin_partner[d1] = d0;
+    }
+
+    uint8_t addrs[WIEGAND_MAX_EXPANDERS];
+    for (int e = 0; e < exp_count; e++) addrs[e] = map[e].addr;
+    if (pcf8574_sweep_init(addrs, exp_count) != ESP_OK) {
+        printf("❌ Не удалось собрать проход шины I2C\n");
+        return false;
+    }
+
+    memcpy(expanders, map, sizeof(map));
+    memset(last_port, 0xFF, sizeof(last_port));
+    expander_count = exp_count;
+    reader_count = count;
+    return true;
+}
+
+int wiegand_reader_count(void) {
+    if (reader_count == 0) wiegand_set_readers(NULL, 0, NULL, 0);
+    return reader_count;
+}
+
+int wiegand_expander_count(void) {
+    if (reader_count == 0) wiegand_set_readers(NULL, 0, NULL, 0);
+    return expander_count;
+}
+
+// ==========================================
+// ФРОНТЫ ИЗ БАЙТОВ ПОРТОВ РАСШИРИТЕЛЕЙ
+// ==========================================
+// Линии активны низким уровнем. Спадающие фронты всех считывателей
+// расширителя находятся одной операцией над байтом; дальше обходятся только
+// установленные биты, считыватель и значение бита берутся из таблиц.
+// changed_hint - расширитель сообщил об изменении (INT): если ни один порт
+// не изменился, импульс начался и закончился до чтения - потерянный фронт.
+void wiegand_capture_feed_ports(const uint8_t* ports, uint32_t time_us, bool changed_hint) {
+    uint8_t changed = 0;
+
+    for (int e = 0; e < expander_count; e++) {
+        const struct ExpanderMap* m = &expanders[e];
+        uint8_t data = ports[e];
+        uint8_t falling = (uint8_t)(~data & last_port[e] & m->line_mask);
+        changed |= (uint8_t)(data ^ last_port[e]);
+        last_port[e] = data;
+
+        uint8_t rest = falling;
+        while (rest) {
+            int pin = __builtin_ctz(rest);
+            uint8_t partner = (uint8_t)(1u << m->pin_partner[pin]);
+            rest &= (uint8_t)(rest - 1);
+
+            // Обе линии одного считывателя сразу - в Wiegand так не бывает
+            uint8_t bit = (falling & partner) ? WIEGAND_EDGE_LOST : (uint8_t)((m->d1_mask >> pin) & 1);
+            rest &= (uint8_t)~partner;
+            wiegand_edge_push(time_us, m->pin_reader[pin], bit);
+        }
+    }
+
+    if (changed_hint && !changed) {
+        capture_stats.lost_edges++;
+        wiegand_edge_push(time_us, reader_count == 1 ? 0 : WIEGAND_READER_UNKNOWN, WIEGAND_EDGE_LOST);
+    }
+}
+
+// Все расширители одной транзакцией; непрочитанный порт сохраняет
+// прошлое значение
+static void read_all_ports(uint8_t* ports) {
+    memcpy(ports, last_port, sizeof(last_port));
+    pcf8574_sweep(ports);
+}
+
+void wiegand_capture_poll(void) {
+    uint8_t ports[WIEGAND_MAX_EXPANDERS];
+    read_all_ports(ports);
+    wiegand_capture_feed_ports(ports, (uint32_t)esp_timer_get_time(), false);
+}
+
+#if WIEGAND_CAPTURE_MODE == WIEGAND_CAPTURE_POLL
+// Режим опроса: отдельная задача проходит шину с периодом
+// WIEGAND_POLL_INTERVAL_MS (0 - непрерывно; пока идет транзакция,
+// задача спит на драйвере I2C). Чем чаще проход, тем меньше потерь.
+static void poll_task(void* arg) {
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        uint32_t before = capture_stats.edges;
+        wiegand_capture_poll();
+        if (capture_stats.edges != before && consumer_task != NULL) xTaskNotifyGive(consumer_task);
+
+        if (WIEGAND_POLL_INTERVAL_MS > 0) {
+            vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(WIEGAND_POLL_INTERVAL_MS));
+        }
+    }
+}
+#endif
+
+// ==========================================
+// РЕЖИМ GPIO: ФРОНТ ЛОВИТ ISR
+// ==========================================
+#if WIEGAND_CAPTURE_MODE == WIEGAND_CAPTURE_GPIO
+// Линии считывателя r на GPIO: gpio_readers[r] = {D0, D1}
+static const uint8_t gpio_readers[][2] = WIEGAND_GPIO_READERS;
+#define GPIO_READER_COUNT ((int)(sizeof(gpio_readers) / sizeof(gpio_readers[0])))
+
+static void IRAM_ATTR wake_consumer_from_isr(BaseType_t* woken) {
+    if (consumer_task != NULL) vTaskNotifyGiveFromISR(consumer_task, woken);
+}
+
+// arg = (считыватель << 1) | бит
+static void IRAM_ATTR gpio_edge_isr(void* arg) {
+    BaseType_t woken = pdFALSE;
+    uintptr_t line = (uintptr_t)arg;
+    capture_stats.interrupts++;
+    wiegand_edge_push((uint32_t)esp_timer_get_time(), (uint8_t)(line >> 1), (uint8_t)(line & 1));
+    wake_consumer_from_isr(&woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool start_gpio_capture(void) {
+    if (reader_count > GPIO_READER_COUNT) {
+        printf("❌ Считывателей %d, а линий в WIEGAND_GPIO_READERS только %d\n",
+               reader_count, GPIO_READER_COUNT);
+        return false;
+    }
+
+    gpio_config_t io = {};
+    for (int r = 0; r < reader_count; r++) {
+        io.pin_bit_mask |= (1ULL << gpio_readers[r][0]) | (1ULL << gpio_readers[r][1]);
+    }
+    io.mode = GPIO_MODE_INPUT;
+    io.pull_up_en = GPIO_PULLUP_ENABLE;
+    io.intr_type = GPIO_INTR_NEGEDGE;
+    if (gpio_config(&io) != ESP_OK) return false;
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) return false;  // уже установлен - не ошибка
+
+    for (int r = 0; r < reader_count; r++) {
+        for (int bit = 0; bit < 2; bit++) {
+            if (gpio_isr_handler_add((gpio_num_t)gpio_readers[r][bit], gpio_edge_isr,
+                                     (void*)(uintptr_t)((r << 1) | bit)) != ESP_OK) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+// ==========================================
+// РЕЖИМ PCF8574 INT: ISR ставит метку, задача читает порт
+// ==========================================
+// I2C из прерывания недоступен, поэтому ISR только запоминает время
+// первого срабатывания и будит задачу захвата с высоким приоритетом.
+// Импульс должен держаться до чтения порта - нужен расширитель импульсов
+// на входах (config.h), иначе фронт будет потерян.
+#if WIEGAND_CAPTURE_MODE == WIEGAND_CAPTURE_PCF8574_INT
+static TaskHandle_t int_task = NULL;
+static volatile uint32_t int_time_us = 0;
+static volatile bool int_pending = false;
+
+static void IRAM_ATTR pcf_int_isr(void* arg) {
+    BaseType_t woken = pdFALSE;
+    capture_stats.interrupts++;
+    if (!int_pending) {
+        int_time_us = (uint32_t)esp_timer_get_time();
+        int_pending = true;
+    }
+    vTaskNotifyGiveFromISR(int_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void pcf_int_task(void* arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Чтение порта снимает INT; пока линия держится низкой - читаем снова
+        do {
+            uint32_t t = int_time_us;
+            int_pending = false;
+
+            uint8_t ports[WIEGAND_MAX_EXPANDERS];
+            read_all_ports(ports);
+            wiegand_capture_feed_ports(ports, t, true);
+        } while (gpio_get_level((gpio_num_t)WIEGAND_INT_GPIO) == 0);
+
+        if (consumer_task != NULL) xTaskNotifyGive(consumer_task);
+    }
+}
+
+static bool start_int_capture(void) {
+    // Начальное состояние портов - до первого INT
+    read_all_ports(last_port);
+
+    if (xTaskCreatePinnedToCore(pcf_int_task, "wiegand_int", 3072, NULL,
+                                configMAX_PRIORITIES - 2, &int_task, xPortGetCoreID()) != pdPASS) {
+        return false;
+    }
+
+    gpio_config_t io = {};
+    io.pin_bit_mask = 1ULL << WIEGAND_INT_GPIO;
+    io.mode = GPIO_MODE_INPUT;
+    io.pull_up_en = GPIO_PULLUP_ENABLE;
+    io.intr_type = GPIO_INTR_NEGEDGE;
+    if (gpio_config(&io) != ESP_OK) return false;
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) return false;
+
+    return gpio_isr_handler_add((gpio_num_t)WIEGAND_INT_GPIO, pcf_int_isr, NULL) == ESP_OK;
+}
+#endif
+
+bool wiegand_capture_start(void) {
+    consumer_task = xTaskGetCurrentTaskHandle();
+    if (reader_count == 0 && !wiegand_set_readers(NULL, 0, NULL, 0)) return false;
+    printf("📡 Считывателей: %d на %d расширителях\n", reader_count, expander_count);
+
+    bool ok = true;
+#if WIEGAND_CAPTURE_MODE == WIEGAND_CAPTURE_GPIO
+    ok = start_gpio_capture();
+    printf("%s Захват Wiegand: прерывания GPIO, считыватель 0 на %d/%d\n",
+           ok ? "✅" : "❌", gpio_readers[0][0], gpio_readers[0][1]);
+#elif WIEGAND_CAPTURE_MODE == WIEGAND_CAPTURE_PCF8574_INT
+    ok = start_int_capture();
+    printf("%s Захват Wiegand: INT расширителя на GPIO %d\n", ok ? "✅" : "❌", WIEGAND_INT_GPIO);
+#else
+    read_all_ports(last_port);
+    ok = xTaskCreatePinnedToCore(poll_task, "wiegand_poll", 3072, NULL,
+                                 configMAX_PRIORITIES - 2, NULL, xPortGetCoreID()) == pdPASS;
+    printf("%s Захват Wiegand: опрос расширителей каждые %d мс (0 - непрерывно), короткие импульсы могут теряться\n",
+           ok ? "⚠️" : "❌", WIEGAND_POLL_INTERVAL_MS);
+#endif
+    return ok;
+}
+
+void wiegand_capture_wait(uint32_t timeout_ms) {
+    if (wiegand_edge_pending() > 0) return;
+    ulTaskNotifyTake(pdTRUE, timeout_ms == 0xFFFFFFFF ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms) + 1);
+}
+
+void get_wiegand_capture_stats(struct WiegandCaptureStats* out) {
+    *out = capture_stats;
+}
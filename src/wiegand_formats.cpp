@@ -0,0 +1,194 @@
+#include "wiegand_formats.h"
+#include "config.h"
+#include <stdio.h>
+
+// ==========================================
+// ОПИСАНИЯ ФОРМАТОВ
+// ==========================================
+// Новый формат - строка в таблице ниже; код разбора не меняется.
+// Длина кадра должна быть уникальной: при совпадении побеждает первый.
+
+// Биты first..first+count-1
+static constexpr uint64_t span(unsigned first, unsigned count) {
+    return (count >= 64 ? ~0ULL : ((1ULL << count) - 1)) << first;
+}
+
+static constexpr WiegandFormat formats[] = {
+    // H10301: P + FC(8) + card(16) + P, четность по половинам
+    {"H10301 26-bit", 26,
+     {{span(13, 13), false}, {span(0, 13), true}, {0, false}},
+     {"key", 0, 26},
+     {{"🏢 Facility Code", 17, 8}, {"💳 Card Number", 1, 16}, {NULL, 0, 0}}},
+
+    {"34-bit", 34,
+     {{span(17, 17), false}, {span(0, 17), true}, {0, false}},
+     {"key", 0, 34},
+     {{"💳 Card ID", 1, 32}, {NULL, 0, 0}, {NULL, 0, 0}}},
+
+    // HID Corporate 1000: P(even, 2/3 бит) P(odd, 2/3 бит) ... P(odd, весь кадр)
+    {"Corporate 1000 35-bit", 35,
+     {{0x3B6DB6DB6ULL, false}, {0x36DB6DB6DULL, true}, {span(0, 35), true}},
+     {"key", 0, 35},
+     {{"🏢 Company Code", 21, 12}, {"💳 Card Number", 1, 20}, {NULL, 0, 0}}},
+
+#if WIEGAND_37BIT_H10304
+    // H10304: P + FC(16) + card(19) + P
+    {"H10304 37-bit", 37,
+     {{span(18, 19), false}, {span(0, 19), true}, {0, false}},
+     {"key", 0, 37},
+     {{"🏢 Facility Code", 20, 16}, {"💳 Card Number", 1, 19}, {NULL, 0, 0}}},
+#else
+    // H10302: P + card(35) + P
+    {"H10302 37-bit", 37,
+     {{span(18, 19), false}, {span(0, 19), true}, {0, false}},
+     {"key", 0, 37},
+     {{"💳 Card ID", 1, 35}, {NULL, 0, 0}, {NULL, 0, 0}}},
+#endif
+
+    // 7 байт UID без четности
+    {"56-bit UID", 56,
+     {{0, false}, {0, false}, {0, false}},
+     {"key", 0, 56},
+     {{"🏢 Facility Code", 48, 8}, {"🏠 Site Code", 32, 16}, {"💳 Card Number", 0, 32}}},
+
+    // 7 байт UID + четность по половинам; ключ - UID без бит четности
+    {"58-bit UID", 58,
+#if WIEGAND_58BIT_PARITY
+     {{span(29, 29), false}, {span(0, 29), true}, {0, false}},
+#else
+     {{0, false}, {0, false}, {0, false}},
+#endif
+     {"key", 1, 56},
+     {{"🏢 Facility Code", 49, 8}, {"🏠 Site Code", 33, 16}, {"💳 Card Number", 1, 32}}},
+};
+
+static constexpr int FORMAT_COUNT = sizeof(formats) / sizeof(formats[0]);
+static_assert(FORMAT_COUNT <= WIEGAND_MAX_FORMATS, "raise WIEGAND_MAX_FORMATS");
+
+// ==========================================
+// ПРОВЕРКИ ПРИ КОМПИЛЯЦИИ
+// ==========================================
+
+static constexpr bool format_valid(const WiegandFormat& f) {
+    if (f.bits == 0 || f.bits > 64) return false;
+    uint64_t frame = span(0, f.bits);
+    for (int i = 0; i < WIEGAND_FORMAT_PARITIES; i++) {
+        if (f.parity[i].mask & ~frame) return false;
+    }
+    // Ключ хранится в базе в 56 битах
+    if (f.key.width == 0 || f.key.width > 56 || f.key.offset + f.key.width > f.bits) return false;
+    for (int i = 0; i < WIEGAND_FORMAT_FIELDS; i++) {
+        const WiegandField& fl = f.fields[i];
+        if (fl.name == NULL) continue;
+        if (fl.width == 0 || fl.offset + fl.width > f.bits) return false;
+    }
+    return true;
+}
+
+static constexpr bool all_formats_valid() {
+    for (int i = 0; i < FORMAT_COUNT; i++) {
+        if (!format_valid(formats[i])) return false;
+    }
+    return true;
+}
+static_assert(all_formats_valid(), "Wiegand format: parity mask or field outside the frame");
+
+// ==========================================
+// ВЫБОР ФОРМАТА ПО ДЛИНЕ
+// ==========================================
+#define NO_FORMAT 0xFF
+
+struct FormatIndex {
+    uint8_t by_bits[65];
+};
+
+static constexpr FormatIndex build_index() {
+    FormatIndex idx = {};
+    for (int b = 0; b <= 64; b++) idx.by_bits[b] = NO_FORMAT;
+    for (int i = FORMAT_COUNT - 1; i >= 0; i--) idx.by_bits[formats[i].bits] = (uint8_t)i;
+    return idx;
+}
+
+static constexpr FormatIndex format_index = build_index();
+static_assert(format_index.by_bits[26] != NO_FORMAT && format_index.by_bits[58] != NO_FORMAT,
+              "26 and 58-bit readers must stay supported");
+
+static WiegandFormatStats stats = {};
+
+const WiegandFormat* wiegand_format_for_bits(uint8_t bits) {
+    if (bits > 64) return NULL;
+    uint8_t i = format_index.by_bits[bits];
+    return i == NO_FORMAT ? NULL : &formats[i];
+}
+
+const WiegandFormat* wiegand_format_at(int index) {
+    return (index >= 0 && index < FORMAT_COUNT) ? &formats[index] : NULL;
+}
+
+int wiegand_format_count() {
+    return FORMAT_COUNT;
+}
+
+// ==========================================
+// РАЗБОР КАДРА
+// ==========================================
+
+static inline uint64_t field_value(uint64_t data, const WiegandField& f) {
+    return (data >> f.offset) & span(0, f.width);
+}
+
+WiegandDecodeResult wiegand_decode(uint64_t data, uint8_t bits, WiegandCredential* out) {
+    stats.decoded++;
+    out->format = wiegand_format_for_bits(bits);
+    out->key = 0;
+    const WiegandFormat* f = out->format;
+    if (f == NULL) {
+        stats.unknown_length++;
+        return WIEGAND_DECODE_UNKNOWN_LENGTH;
+    }
+
+    for (int i = 0; i < WIEGAND_FORMAT_PARITIES; i++) {
+        const WiegandParity& p = f->parity[i];
+        if (p.mask == 0) continue;
+        if ((__builtin_popcountll(data & p.mask) & 1) != (p.odd ? 1 : 0)) {
+            stats.bad_parity++;
+            return WIEGAND_DECODE_BAD_PARITY;
+        }
+    }
+
+    wiegand_extract(f, data, out);
+    stats.accepted[f - formats]++;
+    return WIEGAND_DECODE_OK;
+}
+
+void wiegand_extract(const WiegandFormat* f, uint64_t data, WiegandCredential* out) {
+    out->format = f;
+    out->key = field_value(data, f->key);
+    for (int i = 0; i < WIEGAND_FORMAT_FIELDS; i++) {
+        out->fields[i] = f->fields[i].name ? field_value(data, f->fields[i]) : 0;
+    }
+}
+
+const char* wiegand_decode_result_name(WiegandDecodeResult r) {
+    switch (r) {
+        case WIEGAND_DECODE_OK: return "ok";
+        case WIEGAND_DECODE_UNKNOWN_LENGTH: return "unknown length";
+        case WIEGAND_DECODE_BAD_PARITY: return "bad parity";
+        case WIEGAND_DECODE_LOST_BITS: return "lost bits";
+    }
+    return "?";
+}
+
+void get_wiegand_format_stats(WiegandFormatStats* out) {
+    *out = stats;
+}
+
+void print_wiegand_format_stats() {
+    printf("🧾 Форматы: кадров %lu | неизвестная длина %lu | ошибка четности %lu |",
+           (unsigned long)stats.decoded, (unsigned long)stats.unknown_length,
+           (unsigned long)stats.bad_parity);
+    for (int i = 0; i < FORMAT_COUNT; i++) {
+        if (stats.accepted[i]) printf(" %s: %lu", formats[i].name, (unsigned long)stats.accepted[i]);
+    }
+    printf("\n");
+}
@@ -1,9 +1,11 @@
 #include "wiegand_processor.h"
-#include "i2c_driver.h"
+#include "wiegand_capture.h"
 #include "card_formatter.h"
+#include "event_log.h"
 #include "config.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <esp_timer.h>
 #include <stdio.h>
 
 // Global variables
@@ -13,155 +15,188 @@ uint32_t wiegand_last_bit_time = 0;
 bool wiegand_data_ready = false;
 uint32_t total_bits_received = 0;
 uint32_t card_read_count = 0;
+uint8_t wiegand_lost_bits = 0;
+struct WiegandFrame wiegand_frame = {};
 
 // Добавляем флаг для подавления лишнего вывода
 static bool debug_output = true;
 
-void check_wiegand() {
-    uint8_t data;
-    esp_err_t ret = pcf8574_read(CONFIG_I2C_INPUTS1_ADDRESS, &data);
-    
-    if (ret != ESP_OK) {
-        if (debug_output) {
-            printf("❌ I2C read error: %d\n", ret);
-        }
-        return;
-    }
-    
-    uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    
-    bool d0_state = (data & (1 << (WIEGAND_D0 - 1))) == 0;
-    bool d1_state = (data & (1 << (WIEGAND_D1 - 1))) == 0;
-    
-    static uint8_t last_d0 = 1;
-    static uint8_t last_d1 = 1;
-    
-    // Обнаружение фронтов
-    if (d0_state && !last_d0) {
-        handle_wiegand_bit(0);
+// ==========================================
+// ДЕКОДЕР
+// ==========================================
+#define WIEGAND_TIMEOUT_US ((uint32_t)WIEGAND_TIMEOUT_MS * 1000u)
+
+void wiegand_decoder_reset(struct WiegandDecoder* d) {
+    d->frame.data = 0;
+    d->frame.bits = 0;
+    d->frame.lost_bits = 0;
+    d->frame.first_edge_us = 0;
+    d->frame.last_edge_us = 0;
+    d->frame.reader_id = 0;
+    d->frame.complete_us = 0;
+}
+
+bool wiegand_decoder_poll(struct WiegandDecoder* d, uint32_t now_us, struct WiegandFrame* out) {
+    if (d->frame.bits == 0) return false;
+    if ((uint32_t)(now_us - d->frame.last_edge_us) <= WIEGAND_TIMEOUT_US) return false;
+
+    *out = d->frame;
+    wiegand_decoder_reset(d);
+    return true;
+}
+
+bool wiegand_decoder_feed(struct WiegandDecoder* d, uint8_t bit, uint32_t time_us, struct WiegandFrame* out) {
+    bool completed = wiegand_decoder_poll(d, time_us, out);
+
+    struct WiegandFrame* f = &d->frame;
+    if (f->bits == 0) f->first_edge_us = time_us;
+
+    if (bit == WIEGAND_EDGE_LOST) {
+        f->data <<= 1;
+        if (f->lost_bits < 255) f->lost_bits++;
+    } else {
+        f->data = (f->data << 1) | (uint64_t)(bit & 1);
     }
-    
-    if (d1_state && !last_d1) {
-        handle_wiegand_bit(1);
+    if (f->bits < 255) f->bits++;
+    f->last_edge_us = time_us;
+
+    return completed;
+}
+
+uint32_t wiegand_decoder_timeout_ms(const struct WiegandDecoder* d, uint32_t now_us) {
+    if (d->frame.bits == 0) return 0xFFFFFFFF;
+
+    uint32_t idle_us = now_us - d->frame.last_edge_us;
+    if (idle_us > WIEGAND_TIMEOUT_US) return 0;
+    return (WIEGAND_TIMEOUT_US - idle_us) / 1000 + 1;
+}
+
+// ==========================================
+// ФРОНТЫ ИЗ КОЛЬЦА -> ГЛОБАЛЬНЫЙ КАДР
+// ==========================================
+// Свой декодер у каждого считывателя; готовый кадр публикуется в
+// глобальные переменные по одному, остальные фронты ждут в кольце
+static struct WiegandDecoder decoders[WIEGAND_MAX_READERS] = {};
+
+static void publish_frame(uint8_t reader, const struct WiegandFrame* f) {
+    wiegand_frame = *f;
+    wiegand_frame.reader_id = reader;
+    wiegand_frame.complete_us = (uint32_t)esp_timer_get_time();
+    wiegand_data = f->data;
+    wiegand_bit_count = f->bits;
+    wiegand_lost_bits = f->lost_bits;
+    wiegand_data_ready = true;
+}
+
+static void feed_reader(uint8_t reader, uint8_t bit, uint32_t time_us) {
+    struct WiegandDecoder* d = &decoders[reader];
+    struct WiegandFrame done;
+    if (wiegand_decoder_feed(d, bit, time_us, &done)) {
+        publish_frame(reader, &done);
     }
-    
-    last_d0 = d0_state;
-    last_d1 = d1_state;
-    
-    // Таймаут только если есть данные и прошло достаточно времени
-    if (wiegand_bit_count > 0 && (current_time - wiegand_last_bit_time) > WIEGAND_TIMEOUT_MS) {
-        wiegand_data_ready = true;
-        if (debug_output) {
-            printf("⏰ Timeout triggered, bits: %d\n", wiegand_bit_count);
-        }
+
+    if (debug_output && d->frame.bits <= 3) {
+        evlog(EVLOG_DEBUG, EVLOG_SRC_WIEGAND, WLOG_BIT, reader, bit, d->frame.bits, 0);
     }
 }
 
-void handle_wiegand_bit(uint8_t bit) {
-    uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    
-    // Сброс если прошло много времени с последнего бита
-    if ((current_time - wiegand_last_bit_time) > WIEGAND_TIMEOUT_MS) {
-        wiegand_data = 0;
-        wiegand_bit_count = 0;
-        if (debug_output) {
-            printf("🔄 Reset Wiegand data\n");
-        }
-    }
-    
-    wiegand_data = (wiegand_data << 1ULL) | (uint64_t)bit;
-    wiegand_bit_count++;
+static void feed_bit(uint8_t reader, uint8_t bit, uint32_t time_us) {
     total_bits_received++;
-    wiegand_last_bit_time = current_time;
-    
-    if (debug_output && wiegand_bit_count <= 3) {
-        printf("📊 Bit: %d, Total bits: %d\n", bit, wiegand_bit_count);
+    wiegand_last_bit_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+    if (reader < WIEGAND_MAX_READERS) {
+        feed_reader(reader, bit, time_us);
+        return;
+    }
+    // Потерянный фронт неизвестного считывателя портит все кадры, которые
+    // сейчас принимаются (новый кадр с него начаться не может - он бы
+    // оказался короче на бит и не совпал с форматом)
+    int count = wiegand_reader_count();
+    for (int r = 0; r < count; r++) {
+        uint32_t left = wiegand_decoder_timeout_ms(&decoders[r], time_us);
+        if (left != 0xFFFFFFFF && left > 0) {
+            feed_reader((uint8_t)r, WIEGAND_EDGE_LOST, time_us);
+        }
     }
 }
 
-void process_wiegand_data() {
-    if (wiegand_bit_count == 0) return;
-    
-    card_read_count++;
-    
-    printf("\n🎫 === WIEGAND CARD DETECTED ===\n");
-    printf("🔢 Raw Bit count: %d\n", wiegand_bit_count);
-    printf("🔢 Raw Data: 0x%016llX\n", wiegand_data);
-    
-    printf("🔍 Analysis:\n");
-    if (wiegand_bit_count < 26) {
-        printf("❌ TOO FEW BITS! Expected 26-58, got %d\n", wiegand_bit_count);
-    } else if (wiegand_bit_count == 26) {
-        process_26bit_wiegand();
-    } else if (wiegand_bit_count == 34) {
-        process_34bit_wiegand();
-    } else if (wiegand_bit_count == 37) {
-        process_37bit_wiegand();
-    } else if (wiegand_bit_count >= 56 && wiegand_bit_count <= 58) {
-        process_56bit_wiegand();
-    } else {
-        printf("❓ Unknown Wiegand format: %d bits\n", wiegand_bit_count);
+void check_wiegand() {
+    // Готовый кадр еще не обработан - остальные фронты ждут в кольце
+    if (wiegand_data_ready) return;
+
+    struct WiegandEdge e;
+    while (!wiegand_data_ready && wiegand_edge_pop(&e)) {
+        feed_bit(e.reader, e.bit, e.time_us);
     }
-    
-    printf("📈 Stats: Cards: %lu, Total bits: %lu\n", card_read_count, total_bits_received);
-    printf("=============================\n\n");
+    if (wiegand_data_ready) return;
 
-    reset_wiegand();
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    int count = wiegand_reader_count();
+    for (int r = 0; r < count; r++) {
+        struct WiegandFrame done;
+        if (wiegand_decoder_poll(&decoders[r], now, &done)) {
+            publish_frame((uint8_t)r, &done);
+            if (debug_output) {
+                evlog(EVLOG_DEBUG, EVLOG_SRC_WIEGAND, WLOG_TIMEOUT, r, done.bits, 0, 0);
+            }
+            return;
+        }
+    }
 }
 
-// Остальные функции без изменений...
-void process_26bit_wiegand() {
-    uint8_t facility_code = (uint8_t)((wiegand_data >> 17ULL) & 0xFFULL);
-    uint16_t card_code = (uint16_t)((wiegand_data >> 1ULL) & 0xFFFFULL);
-    
-    printf("✅ 26-bit Format:\n");
-    printf("🏢 Facility Code: %d\n", facility_code);
-    printf("💳 Card Number: %d\n", card_code);
-}
+uint32_t wiegand_wait_ms() {
+    if (wiegand_data_ready) return 0;
 
-void process_34bit_wiegand() {
-    printf("✅ 34-bit Format:\n");
-    uint64_t clean_data = (wiegand_data >> 1) & 0xFFFFFFFFULL;
-    printf("💳 Card ID: %lu\n", (uint32_t)clean_data);
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t wait = 0xFFFFFFFF;
+    int count = wiegand_reader_count();
+    for (int r = 0; r < count; r++) {
+        uint32_t t = wiegand_decoder_timeout_ms(&decoders[r], now);
+        if (t < wait) wait = t;
+    }
+    return wait;
 }
 
-void process_37bit_wiegand() {
-    printf("✅ 37-bit Format:\n");
-    uint64_t clean_data = (wiegand_data >> 1) & 0x7FFFFFFFFULL; 
-    printf("💳 Card ID: %lu\n", (uint32_t)clean_data);
+void handle_wiegand_bit(uint8_t bit) {
+    feed_bit(0, bit, (uint32_t)esp_timer_get_time());
 }
 
-void process_56bit_wiegand() {
-    uint64_t clean_data = wiegand_data;
-    
-    if (wiegand_bit_count == 58) {
-        printf("⚠️  Detected 58 bits (Data + Parity). Stripping parity bits...\n");
-        clean_data = (wiegand_data >> 1) & 0x00FFFFFFFFFFFFFFULL;
-    } 
-    else if (wiegand_bit_count == 56) {
-         clean_data = wiegand_data;
+enum WiegandDecodeResult process_wiegand_data(struct WiegandCredential* out) {
+    if (wiegand_bit_count == 0) {
+        out->format = NULL;
+        return WIEGAND_DECODE_UNKNOWN_LENGTH;
     }
-    else {
-        printf("⚠️  Warning: Odd bit count (%d). Result may be inaccurate.\n", wiegand_bit_count);
-    }
-
-    printf("✅ 56-bit Format (Processed):\n");
     
-    uint8_t facility_code = (uint8_t)((clean_data >> 48ULL) & 0xFFULL);
-    uint16_t site_code = (uint16_t)((clean_data >> 32ULL) & 0xFFFFULL);
-    uint32_t card_number = (uint32_t)(clean_data & 0xFFFFFFFFULL);
+    card_read_count++;
+    evlog(EVLOG_INFO, EVLOG_SRC_WIEGAND, WLOG_FRAME, wiegand_frame.reader_id, wiegand_bit_count, wiegand_data, 0);
     
-    printf("🏢 Facility Code: %d\n", facility_code);
-    printf("🏠 Site Code: %d\n", site_code);
-    printf("💳 Card Number: %lu\n", card_number);
+    enum WiegandDecodeResult r;
+    if (wiegand_lost_bits > 0) {
+        evlog(EVLOG_WARN, EVLOG_SRC_WIEGAND, WLOG_LOST_BITS, wiegand_lost_bits, 0, 0, 0);
+        out->format = NULL;
+        r = WIEGAND_DECODE_LOST_BITS;
+    } else {
+        r = wiegand_decode(wiegand_data, wiegand_bit_count, out);
+        if (r == WIEGAND_DECODE_UNKNOWN_LENGTH) {
+            evlog(EVLOG_WARN, EVLOG_SRC_WIEGAND, WLOG_UNKNOWN_LENGTH, wiegand_bit_count, 0, 0, 0);
+        } else if (r == WIEGAND_DECODE_BAD_PARITY) {
+            evlog(EVLOG_WARN, EVLOG_SRC_WIEGAND, WLOG_BAD_PARITY, wiegand_bit_count, 0, 0, 0);
+        } else {
+            // Поля разберет задача журнала по тому же описанию формата
+            evlog(EVLOG_INFO, EVLOG_SRC_WIEGAND, WLOG_DECODED, wiegand_bit_count, 0, wiegand_data, 0);
+        }
+    }
     
-    // Вызов функции форматирования
-    format_serial_hex_7bytes(clean_data, 56);
+    evlog(EVLOG_INFO, EVLOG_SRC_WIEGAND, WLOG_FRAME_END, card_read_count, total_bits_received, 0, 0);
+
+    reset_wiegand();
+    return r;
 }
 
 void reset_wiegand() {
     wiegand_data = 0;
     wiegand_bit_count = 0;
+    wiegand_lost_bits = 0;
     wiegand_last_bit_time = 0;
     wiegand_data_ready = false;
 }
@@ -179,4 +214,70 @@ void speed_test() {
 // Функция для управления отладочным выводом
 void set_wiegand_debug(bool enable) {
     debug_output = enable;
-}
\ No newline at end of file
+}
+
+// ==========================================
+// ТЕКСТ СОБЫТИЙ (задача журнала)
+// ==========================================
+
+// Поля формата по описанию из реестра
+static void print_credential(const struct WiegandCredential* c) {
+    const struct WiegandFormat* f = c->format;
+    printf("✅ %s:\n", f->name);
+    for (int i = 0; i < WIEGAND_FORMAT_FIELDS; i++) {
+        if (f->fields[i].name) printf("%s: %llu\n", f->fields[i].name, (unsigned long long)c->fields[i]);
+    }
+    if (f->key.width == 56) {
+        format_serial_hex_7bytes(c->key, 56);
+    }
+}
+
+void wiegand_log_format(const struct EventLogRecord* r) {
+    switch (r->id) {
+        case WLOG_BIT:
+            printf("📊 Reader %lu Bit: %lu, Total bits: %llu\n", (unsigned long)r->a,
+                   (unsigned long)r->b, (unsigned long long)r->x);
+            break;
+        case WLOG_TIMEOUT:
+            printf("⏰ Timeout triggered, reader %lu, bits: %lu\n", (unsigned long)r->a, (unsigned long)r->b);
+            break;
+        case WLOG_FRAME:
+            printf("\n🎫 === WIEGAND CARD DETECTED ===\n");
+            printf("📍 Reader: %lu\n", (unsigned long)r->a);
+            printf("🔢 Raw Bit count: %lu\n", (unsigned long)r->b);
+            printf("🔢 Raw Data: 0x%016llX\n", (unsigned long long)r->x);
+            printf("🔍 Analysis:\n");
+            break;
+        case WLOG_LOST_BITS:
+            printf("❌ Потеряно фронтов: %lu - кадр отброшен\n", (unsigned long)r->a);
+            break;
+        case WLOG_UNKNOWN_LENGTH:
+            printf("❓ Unknown Wiegand format: %lu bits\n", (unsigned long)r->a);
+            break;
+        case WLOG_BAD_PARITY: {
+            const struct WiegandFormat* f = wiegand_format_for_bits((uint8_t)r->a);
+            printf("❌ %s: ошибка четности - кадр отброшен\n", f ? f->name : "?");
+            break;
+        }
+        case WLOG_DECODED: {
+            const struct WiegandFormat* f = wiegand_format_for_bits((uint8_t)r->a);
+            if (!f) break;
+            struct WiegandCredential c;
+            wiegand_extract(f, r->x, &c);
+            print_credential(&c);
+            break;
+        }
+        case WLOG_FRAME_END:
+            printf("📈 Stats: Cards: %lu, Total bits: %lu\n", (unsigned long)r->a, (unsigned long)r->b);
+            printf("=============================\n\n");
+            break;
+        case WLOG_EMPTY:
+            printf("❌ Ошибка: Получен пустой/недействительный пакет (0x0, %lu бит). Игнорирую.\n",
+                   (unsigned long)r->a);
+            break;
+        case WLOG_SENT:
+            printf("🚀 Отправка в поиск HEX: 0x%014llX (Бит: %lu, считыватель %lu)\n",
+                   (unsigned long long)r->x, (unsigned long)r->a, (unsigned long)r->b);
+            break;
+    }
+}
@@ -0,0 +1,207 @@
+// Замер на ПК: пословные ядра card_record.h против прежнего побитового
+// кода (то же, что bench_bit_kernels на плате). На случайных записях и
+// смещениях оба должны давать одинаковые биты; пословные - быстрее.
+//
+// Сборка (из корня проекта):
+//   g++ -std=gnu++17 -O2 -Iinclude tools/bit_kernels_host.cpp -o bit_kernels_host
+//
+// Запуск:
+//   bit_kernels_host [раундов]
+
+#include "card_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KERNEL_BENCH_CARDS 4096
+#define KERNEL_BENCH_BYTES ((KERNEL_BENCH_CARDS * RECORD_BITS + 7) / 8)
+#define KERNEL_BENCH_OFFSETS 4096
+
+// ==========================================
+// ЭТАЛОН: ПОБИТОВЫЕ ЯДРА (прежняя реализация)
+// ==========================================
+
+static uint64_t extract_bits_bitwise(const uint8_t* buffer, uint64_t global_bit_start, int bit_count) {
+    uint64_t result = 0;
+    for (int i = 0; i < bit_count; i++) {
+        uint64_t current_bit_pos = global_bit_start + i;
+        uint32_t byte_idx = current_bit_pos / 8;
+        uint8_t  bit_idx  = current_bit_pos % 8;
+        uint8_t bit = (buffer[byte_idx] >> (7 - bit_idx)) & 1;
+        result = (result << 1) | bit;
+    }
+    return result;
+}
+
+static void get_card_bitwise(const uint8_t* buffer, int index, CardInfo* out) {
+    uint64_t start_bit = (uint64_t)index * RECORD_BITS;
+    out->hex_id = extract_bits_bitwise(buffer, start_bit, 56);
+    start_bit += 56;
+    out->status = (uint8_t)extract_bits_bitwise(buffer, start_bit, 2);
+    start_bit += 2;
+    out->count = (uint8_t)extract_bits_bitwise(buffer, start_bit, 4);
+    start_bit += 4;
+    out->zones = (uint8_t)extract_bits_bitwise(buffer, start_bit, 8);
+    start_bit += 8;
+    out->link = (uint16_t)extract_bits_bitwise(buffer, start_bit, 16);
+}
+
+static void push_bits_bitwise(uint8_t* buffer, int* bit_cursor, uint64_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        uint8_t bit = (value >> i) & 1;
+        int byte_idx = (*bit_cursor) / 8;
+        int bit_idx = (*bit_cursor) % 8;
+        if (bit) buffer[byte_idx] |= (1 << (7 - bit_idx));
+        else     buffer[byte_idx] &= ~(1 << (7 - bit_idx));
+        (*bit_cursor)++;
+    }
+}
+
+static void put_card_bitwise(uint8_t* buffer, int index, const CardInfo* ci) {
+    int bit_cursor = index * RECORD_BITS;
+    push_bits_bitwise(buffer, &bit_cursor, ci->hex_id, 56);
+    push_bits_bitwise(buffer, &bit_cursor, ci->status, 2);
+    push_bits_bitwise(buffer, &bit_cursor, ci->count, 4);
+    push_bits_bitwise(buffer, &bit_cursor, ci->zones, 8);
+    push_bits_bitwise(buffer, &bit_cursor, ci->link, 16);
+}
+
+// ==========================================
+// ЗАМЕР
+// ==========================================
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+#define KERNEL_RANDOM_FIELD(P, name, type, width) ci->name = (type)(rng_next() & CARD_FIELD_MASK(width));
+
+static void random_card(CardInfo* ci) {
+    ci->hex_id = rng_next() & CARD_FIELD_MASK(CARD_KEY_BITS);
+    CARD_V1_ATTR_FIELDS(KERNEL_RANDOM_FIELD, CARD_V1_ATTR)
+}
+
+static CardInfo cards[KERNEL_BENCH_CARDS];
+static CardInfo decoded[KERNEL_BENCH_CARDS];
+static uint64_t offsets[KERNEL_BENCH_OFFSETS];
+static uint64_t values[KERNEL_BENCH_OFFSETS];
+static uint8_t buf_bitwise[KERNEL_BENCH_BYTES + RECORD_READ_PAD];
+static uint8_t buf_word[KERNEL_BENCH_BYTES + RECORD_READ_PAD];
+
+// Лучшее из пяти: ns на раунд из n операций
+#define TIME_BEST(best, rounds, n, body)                                           \
+    do {                                                                           \
+        best = ~0ULL;                                                              \
+        for (int rep = 0; rep < 5; rep++) {                                        \
+            uint64_t t0 = now_ns();                                                \
+            for (int r = 0; r < (rounds); r++) {                                   \
+                for (int i = 0; i < (n); i++) { body; }                            \
+                __asm__ __volatile__("" ::: "memory");                             \
+            }                                                                      \
+            uint64_t dt = now_ns() - t0;                                           \
+            if (dt < best) best = dt;                                              \
+        }                                                                          \
+    } while (0)
+
+static void print_line(const char* name, uint64_t bitwise_ns, uint64_t word_ns, int rounds, int n) {
+    double ops = (double)rounds * n;
+    printf("  %-26s побитово: %7.2f нс | словами: %6.2f нс | x%.1f\n", name,
+           (double)bitwise_ns / ops, (double)word_ns / ops,
+           word_ns ? (double)bitwise_ns / (double)word_ns : 0.0);
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    if (rounds < 1) rounds = 1;
+    int mismatches = 0;
+
+    // 1. Запись целиком: те же байты, те же поля при чтении обоими путями
+    for (int i = 0; i < KERNEL_BENCH_CARDS; i++) {
+        random_card(&cards[i]);
+        put_card_bitwise(buf_bitwise, i, &cards[i]);
+        put_card_to_buffer(buf_word, i, &cards[i]);
+    }
+    if (memcmp(buf_bitwise, buf_word, KERNEL_BENCH_BYTES) != 0) mismatches++;
+    for (int i = 0; i < KERNEL_BENCH_CARDS; i++) {
+        CardInfo a, b;
+        memset(&a, 0, sizeof(a));
+        memset(&b, 0, sizeof(b));
+        get_card_bitwise(buf_word, i, &a);
+        get_card_from_buffer(buf_word, i, &b);
+        if (!card_info_equal(&a, &b) || !card_info_equal(&b, &cards[i]) ||
+            get_card_id_from_buffer(buf_word, i) != cards[i].hex_id) {
+            mismatches++;
+        }
+    }
+
+    // 2. Поля любой ширины на любом смещении: чтение и запись
+    for (int width = 1; width <= 64; width++) {
+        for (int i = 0; i < KERNEL_BENCH_OFFSETS; i++) {
+            uint64_t off = rng_next() % ((uint64_t)KERNEL_BENCH_BYTES * 8 - 64);
+            if (extract_bits_bitwise(buf_word, off, width) != extract_bits_from_ram(buf_word, off, width)) {
+                mismatches++;
+                break;
+            }
+            uint64_t v = rng_next() & (width == 64 ? ~0ULL : CARD_FIELD_MASK(width));
+            int c1 = (int)off, c2 = (int)off;
+            push_bits_bitwise(buf_bitwise, &c1, v, width);
+            push_bits(buf_word, &c2, v, width);
+            if (c1 != c2 || memcmp(buf_bitwise, buf_word, KERNEL_BENCH_BYTES) != 0 ||
+                extract_bits_from_ram(buf_word, off, width) != v) {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    // 3. Время: запись, чтение, проба ключа, поля на случайных смещениях
+    for (int i = 0; i < KERNEL_BENCH_CARDS; i++) put_card_to_buffer(buf_word, i, &cards[i]);
+    for (int i = 0; i < KERNEL_BENCH_OFFSETS; i++) {
+        offsets[i] = rng_next() % ((uint64_t)KERNEL_BENCH_BYTES * 8 - 64);
+    }
+    uint64_t bitwise_ns, word_ns;
+    uint64_t sink = 0;
+
+    TIME_BEST(bitwise_ns, rounds, KERNEL_BENCH_CARDS, put_card_bitwise(buf_bitwise, i, &cards[i]));
+    TIME_BEST(word_ns, rounds, KERNEL_BENCH_CARDS, put_card_to_buffer(buf_word, i, &cards[i]));
+    print_line("pack record", bitwise_ns, word_ns, rounds, KERNEL_BENCH_CARDS);
+
+    TIME_BEST(bitwise_ns, rounds, KERNEL_BENCH_CARDS, get_card_bitwise(buf_word, i, &decoded[i]));
+    TIME_BEST(word_ns, rounds, KERNEL_BENCH_CARDS, get_card_from_buffer(buf_word, i, &decoded[i]));
+    print_line("unpack CardInfo", bitwise_ns, word_ns, rounds, KERNEL_BENCH_CARDS);
+
+    TIME_BEST(bitwise_ns, rounds, KERNEL_BENCH_CARDS,
+              values[i & (KERNEL_BENCH_OFFSETS - 1)] = extract_bits_bitwise(buf_word, (uint64_t)i * RECORD_BITS, 56));
+    TIME_BEST(word_ns, rounds, KERNEL_BENCH_CARDS,
+              values[i & (KERNEL_BENCH_OFFSETS - 1)] = get_card_id_from_buffer(buf_word, i));
+    print_line("search probe (56-bit key)", bitwise_ns, word_ns, rounds, KERNEL_BENCH_CARDS);
+
+    static const int widths[] = {2, 4, 8, 16, 56, 64};
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        int width = widths[w];
+        TIME_BEST(bitwise_ns, rounds, KERNEL_BENCH_OFFSETS,
+                  values[i] = extract_bits_bitwise(buf_word, offsets[i], width));
+        TIME_BEST(word_ns, rounds, KERNEL_BENCH_OFFSETS,
+                  values[i] = extract_bits_from_ram(buf_word, offsets[i], width));
+        char name[32];
+        snprintf(name, sizeof(name), "extract %d bits", width);
+        print_line(name, bitwise_ns, word_ns, rounds, KERNEL_BENCH_OFFSETS);
+    }
+
+    for (int i = 0; i < KERNEL_BENCH_OFFSETS; i++) sink += values[i] ^ decoded[i].link;
+    printf("%s Сверка побитовых и пословных ядер: %d расхождений (контроль %llx)\n",
+           mismatches == 0 ? "✅" : "❌", mismatches, (unsigned long long)sink);
+    return mismatches == 0 ? 0 : 1;
+}
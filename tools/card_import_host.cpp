@@ -0,0 +1,60 @@
+// Офлайн-сборка базы карт на ПК: тот же конвейер импорта, что на
+// устройстве (card_import.cpp), без FreeRTOS и SPIFFS.
+//
+// Сборка (из корня проекта):
+//   g++ -std=gnu++17 -O2 -Iinclude -DCARD_IMPORT_OFFLINE tools/card_import_host.cpp
+//       src/card_import.cpp src/card_block.cpp -o card_import_host
+//
+// Запуск:
+//   card_import_host cards.csv data      (или "-" - список из stdin)
+//
+// В каталог пишутся файлы data_<n>.bin; загрузка в SPIFFS - `pio run -t uploadfs`
+// (каталог data проекта). Манифест, фильтр и образ раздела устройство
+// строит при первой загрузке (rebuild_manifest). Старые data_*.bin из
+// каталога удаляйте заранее: они попадут в базу вместе с новыми.
+
+#include "card_import.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t next_file_id = 0;
+
+static uint32_t host_next_id(void) {
+    return next_file_id++;
+}
+
+static size_t host_read(void* ctx, char* buf, size_t len) {
+    return fread(buf, 1, len, (FILE*)ctx);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <cards.csv|-> <output dir>\n", argv[0]);
+        return 2;
+    }
+    FILE* in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    ShardInfo* table = (ShardInfo*)malloc(MAX_SHARDS * sizeof(ShardInfo));
+    if (!table) return 1;
+    int count = 0;
+    CardImportStats stats;
+    bool ok = card_import_build(host_read, in, argv[2], host_next_id, table, &count, &stats);
+    if (in != stdin) fclose(in);
+
+    print_card_import_stats(&stats);
+    if (ok) {
+        for (int i = 0; i < count; i++) {
+            printf("   data_%lu.bin: %lu записей, %014llX..%014llX, %lu байт\n",
+                   (unsigned long)table[i].file_id, (unsigned long)table[i].records,
+                   (unsigned long long)table[i].first_id, (unsigned long long)table[i].last_id,
+                   (unsigned long)table[i].bytes);
+        }
+    }
+    free(table);
+    return ok && count > 0 ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+// Проверка на ПК: импорт списка карт (card_import.cpp) с заменой живой
+// базы. Список генерируется: карты в случайном порядке, для части карт
+// раньше в файле стоит устаревшая строка (должна победить поздняя), плюс
+// заголовок, комментарий и битая строка. После импорта сверяются счетчики
+// импорта, число шардов и поиск каждой карты через lookup_card; карты
+// старой базы и случайные ключи не должны находиться.
+//
+// Сборка и запуск (из каталога tools/host):
+//   cmake -S . -B build && cmake --build build && ctest --test-dir build
+//
+// Отдельно: card_import_suite_host [карт]  (база пишется в ./spiffs)
+
+#include "search.h"
+#include "card_db.h"
+#include "card_usage.h"
+#include "card_storage.h"
+#include "card_import.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#define OLD_DB_RECORDS 3000
+#define DUP_EVERY 7          // устаревшая строка у каждой 7-й карты
+#define ABSENT_PROBES 10000
+#define CSV_FILE "import_suite.csv"
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void clear_mount_point() {
+    DIR* dir = opendir(MOUNT_POINT);
+    if (!dir) return;
+    struct dirent* ent;
+    char path[300];
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", MOUNT_POINT, ent->d_name);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+static int compare_cards(const void* a, const void* b) {
+    uint64_t ka = ((const CardInfo*)a)->hex_id, kb = ((const CardInfo*)b)->hex_id;
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+static const CardInfo* find_expected(const CardInfo* cards, uint32_t n, uint64_t hex_id) {
+    CardInfo key = {};
+    key.hex_id = hex_id;
+    return (const CardInfo*)bsearch(&key, cards, n, sizeof(CardInfo), compare_cards);
+}
+
+static void random_attrs(CardInfo* ci) {
+    uint64_t r = rng_next();
+    ci->status = r % 4;
+    ci->count = 0;
+    ci->zones = (uint8_t)(r >> 8);
+    ci->link = (uint16_t)(r >> 16);
+}
+
+static void write_line(FILE* fd, const CardInfo* ci, uint32_t style) {
+    // Разные записи одного формата: 0x или без, регистр, разделители
+    switch (style % 3) {
+        case 0:
+            fprintf(fd, "0x%014llX,%u,0x%02X,%u\n", (unsigned long long)ci->hex_id,
+                    ci->status, ci->zones, ci->link);
+            break;
+        case 1:
+            fprintf(fd, "%llx;%u;%u;%u\n", (unsigned long long)ci->hex_id, ci->status, ci->zones, ci->link);
+            break;
+        default:
+            fprintf(fd, "  %llX\t%u ,  %u , %u\r\n", (unsigned long long)ci->hex_id,
+                    ci->status, ci->zones, ci->link);
+            break;
+    }
+}
+
+// Карты с уникальными ключами (cards - итоговые значения, по возрастанию
+// ключа) и файл списка. Возвращает число устаревших строк.
+static uint32_t write_csv(CardInfo* cards, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        do {
+            cards[i].hex_id = rng_next() & ((1ULL << CARD_KEY_BITS) - 1);
+        } while (cards[i].hex_id == 0);
+        random_attrs(&cards[i]);
+    }
+    qsort(cards, n, sizeof(CardInfo), compare_cards);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (unique == 0 || cards[i].hex_id != cards[unique - 1].hex_id) cards[unique++] = cards[i];
+    }
+    if (unique != n) {
+        // Совпадение 56-битных ключей - маловероятно, но число карт должно сойтись
+        printf("❌ Генератор дал повторы ключей\n");
+        exit(2);
+    }
+
+    // Порядок в файле - случайный
+    uint32_t* order = (uint32_t*)malloc(n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) order[i] = i;
+    for (uint32_t i = n - 1; i > 0; i--) {
+        uint32_t j = rng_next() % (i + 1);
+        uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    FILE* fd = fopen(CSV_FILE, "w");
+    if (!fd) {
+        printf("❌ Не создать %s\n", CSV_FILE);
+        exit(2);
+    }
+    fprintf(fd, "hex_id,status,zones,link\n");  // заголовок - отброшенная строка
+    fprintf(fd, "# выгрузка для проверки импорта\n\n");
+
+    // Сначала устаревшие строки, потом все карты: побеждает поздняя
+    uint32_t stale = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (order[i] % DUP_EVERY != 0) continue;
+        CardInfo old = cards[order[i]];
+        random_attrs(&old);
+        write_line(fd, &old, i);
+        stale++;
+    }
+    fprintf(fd, "not-a-card,1\n");
+    for (uint32_t i = 0; i < n; i++) write_line(fd, &cards[order[i]], i);
+    fclose(fd);
+    free(order);
+    return stale;
+}
+
+int main(int argc, char** argv) {
+    uint32_t records = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 25000;
+    if (records == 0 || (records + RECORDS_PER_FILE - 1) / RECORDS_PER_FILE > MAX_SHARDS) {
+        printf("❌ Карт: от 1 до %d\n", MAX_SHARDS * RECORDS_PER_FILE);
+        return 2;
+    }
+
+    clear_mount_point();
+    init_spiffs();
+    card_storage_init(CARD_STORAGE_PARTITION);
+    generate_database(OLD_DB_RECORDS);
+    load_indices();
+    card_db_init();
+    card_usage_init();
+
+    // Ключи старой базы - после импорта их быть не должно
+    uint64_t* old_keys = (uint64_t*)malloc(OLD_DB_RECORDS * sizeof(uint64_t));
+    uint32_t old_n = 0;
+    for (int f = 0; f < get_shard_count(); f++) {
+        ShardInfo shard;
+        if (!get_shard_info(f, &shard)) continue;
+        CardInfo* cards = read_shard_cards(&shard);
+        for (uint32_t r = 0; cards && r < shard.records && old_n < OLD_DB_RECORDS; r++) {
+            old_keys[old_n++] = cards[r].hex_id;
+        }
+        free(cards);
+    }
+
+    CardInfo* expected = (CardInfo*)malloc(records * sizeof(CardInfo));
+    uint32_t stale = write_csv(expected, records);
+
+    CardImportStats stats;
+    if (!card_import_file(CSV_FILE, &stats)) {
+        printf("❌ Импорт не выполнен\n");
+        return 1;
+    }
+
+    int fails = 0;
+    uint32_t want_shards = (records + RECORDS_PER_FILE - 1) / RECORDS_PER_FILE;
+    if (stats.records_out != records || stats.duplicates != stale || stats.rejected != 2 ||
+        stats.shards != want_shards || get_shard_count() != (int)want_shards) {
+        printf("❌ Импорт: карт %lu (ждали %lu), повторов %lu (%lu), отброшено %lu (2), шардов %lu/%d (%lu)\n",
+               (unsigned long)stats.records_out, (unsigned long)records, (unsigned long)stats.duplicates,
+               (unsigned long)stale, (unsigned long)stats.rejected, (unsigned long)stats.shards,
+               get_shard_count(), (unsigned long)want_shards);
+        fails++;
+    }
+
+    // Шарды покрывают ключи по порядку, без пересечений
+    uint32_t total = 0;
+    uint64_t prev_last = 0;
+    for (int f = 0; f < get_shard_count(); f++) {
+        ShardInfo shard;
+        if (!get_shard_info(f, &shard) || shard.records == 0 || shard.records > RECORDS_PER_FILE ||
+            (f > 0 && shard.first_id <= prev_last)) {
+            printf("❌ Шард %d: неверные границы или число записей\n", f);
+            fails++;
+            break;
+        }
+        prev_last = shard.last_id;
+        total += shard.records;
+    }
+    if (total != records) {
+        printf("❌ В шардах %lu карт вместо %lu\n", (unsigned long)total, (unsigned long)records);
+        fails++;
+    }
+
+    // Каждая карта - с последними значениями из файла
+    for (uint32_t i = 0; i < records && fails < 10; i++) {
+        CardInfo ci;
+        const CardInfo* e = &expected[i];
+        if (lookup_card(e->hex_id, &ci, NULL) != LOOKUP_FOUND || ci.status != e->status ||
+            ci.zones != e->zones || ci.link != e->link) {
+            printf("❌ Карта 0x%014llX не найдена или не совпала\n", (unsigned long long)e->hex_id);
+            fails++;
+        }
+    }
+
+    uint32_t absent = 0;
+    for (uint32_t i = 0; i < old_n; i++) {
+        CardInfo ci;
+        if (find_expected(expected, records, old_keys[i])) continue;
+        absent++;
+        if (lookup_card(old_keys[i], &ci, NULL) == LOOKUP_FOUND) {
+            printf("❌ Карта старой базы 0x%014llX осталась после импорта\n", (unsigned long long)old_keys[i]);
+            if (++fails >= 10) break;
+        }
+    }
+    for (uint32_t i = 0; i < ABSENT_PROBES; i++) {
+        CardInfo ci;
+        uint64_t key = rng_next() & ((1ULL << CARD_KEY_BITS) - 1);
+        if (find_expected(expected, records, key)) continue;
+        absent++;
+        if (lookup_card(key, &ci, NULL) == LOOKUP_FOUND) {
+            printf("❌ Найдена карта 0x%014llX, которой нет в списке\n", (unsigned long long)key);
+            if (++fails >= 10) break;
+        }
+    }
+
+    free(expected);
+    free(old_keys);
+    if (fails) return 1;
+    printf("✅ Импорт: %lu карт в %lu шардах, повторов %lu, отсутствующих ключей проверено %lu\n",
+           (unsigned long)records, (unsigned long)want_shards, (unsigned long)stale, (unsigned long)absent);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Замер на ПК: bench_lookup_suite (benchmark.cpp) на настоящей базе из
+// заданного числа карт. Поиск, журнал изменений и формат шардов - код
+// устройства (src/), FreeRTOS, SPIFFS и esp_timer - прослойки shims/.
+// Перед замером каждая сотая карта базы ищется через lookup_card: все
+// должны найтись с теми же атрибутами.
+//
+// Сборка и запуск (из каталога tools/host):
+//   cmake -S . -B build && cmake --build build && ctest --test-dir build
+//
+// Отдельно: lookup_suite_host [карт]  (база пишется в ./spiffs)
+
+#include "search.h"
+#include "card_db.h"
+#include "card_usage.h"
+#include "card_storage.h"
+#include "benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#define CHECK_EVERY 100
+
+static void clear_mount_point() {
+    DIR* dir = opendir(MOUNT_POINT);
+    if (!dir) return;
+    struct dirent* ent;
+    char path[300];
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", MOUNT_POINT, ent->d_name);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+// Каждая CHECK_EVERY-я запись каждого шарда - через полный путь поиска
+static bool check_lookups(uint32_t* checked) {
+    *checked = 0;
+    for (int f = 0; f < get_shard_count(); f++) {
+        ShardInfo shard;
+        if (!get_shard_info(f, &shard)) return false;
+        CardInfo* cards = read_shard_cards(&shard);
+        if (!cards) {
+            printf("❌ Шард %d не читается\n", f);
+            return false;
+        }
+        for (uint32_t r = f % CHECK_EVERY; r < shard.records; r += CHECK_EVERY) {
+            CardInfo ci;
+            if (lookup_card(cards[r].hex_id, &ci, NULL) != LOOKUP_FOUND ||
+                ci.status != cards[r].status || ci.zones != cards[r].zones || ci.link != cards[r].link) {
+                printf("❌ Карта 0x%014llX (шард %d, запись %lu) не найдена или не совпала\n",
+                       (unsigned long long)cards[r].hex_id, f, (unsigned long)r);
+                free(cards);
+                return false;
+            }
+            (*checked)++;
+        }
+        free(cards);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t records = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 10000;
+    if (records == 0 || (records + RECORDS_PER_FILE - 1) / RECORDS_PER_FILE > MAX_SHARDS) {
+        printf("❌ Карт: от 1 до %d\n", MAX_SHARDS * RECORDS_PER_FILE);
+        return 2;
+    }
+
+    clear_mount_point();
+    init_spiffs();
+    card_storage_init(CARD_STORAGE_PARTITION);
+    generate_database(records);
+    load_indices();
+    card_db_init();
+    card_usage_init();
+
+    uint32_t total = 0;
+    for (int f = 0; f < get_shard_count(); f++) {
+        ShardInfo shard;
+        if (get_shard_info(f, &shard)) total += shard.records;
+    }
+    if (total != records) {
+        printf("❌ В базе %lu карт вместо %lu\n", (unsigned long)total, (unsigned long)records);
+        return 1;
+    }
+    uint32_t checked;
+    if (!check_lookups(&checked)) return 1;
+    printf("✅ Проверено %lu карт из %lu\n", (unsigned long)checked, (unsigned long)records);
+
+    // Оба бэкенда: образ раздела (mmap) и чтение файлов
+    bench_lookup_suite();
+    if (card_storage_select(CARD_STORAGE_SPIFFS)) bench_lookup_suite();
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef SHIM_DRIVER_GPIO_H
+#define SHIM_DRIVER_GPIO_H
+#include <stdint.h>
+#include "esp_err.h"
+typedef int gpio_num_t;
+#define GPIO_NUM_NC -1
+typedef enum { GPIO_INTR_DISABLE=0, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE } gpio_int_type_t;
+typedef enum { GPIO_MODE_INPUT=1 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE=0, GPIO_PULLUP_ENABLE=1 } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE=0 } gpio_pulldown_t;
+typedef struct { uint64_t pin_bit_mask; gpio_mode_t mode; int pull_up_en; int pull_down_en; gpio_int_type_t intr_type; } gpio_config_t;
+typedef void (*gpio_isr_t)(void*);
+esp_err_t gpio_config(const gpio_config_t*);
+esp_err_t gpio_install_isr_service(int);
+esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void*);
+int gpio_get_level(gpio_num_t);
+#define ESP_INTR_FLAG_IRAM (1<<10)
+#endif
@@ -0,0 +1,32 @@
+#ifndef SHIM_DRIVER_I2C_H
+#define SHIM_DRIVER_I2C_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+typedef int i2c_port_t;
+#define I2C_NUM_0 0
+typedef enum { I2C_MODE_SLAVE=0, I2C_MODE_MASTER=1 } i2c_mode_t;
+#include "driver/gpio.h"
+#define I2C_MASTER_READ 1
+#define I2C_MASTER_WRITE 0
+typedef enum { I2C_MASTER_ACK=0, I2C_MASTER_NACK=1, I2C_MASTER_LAST_NACK=2 } i2c_ack_type_t;
+typedef struct { i2c_mode_t mode; int sda_io_num; int scl_io_num; bool sda_pullup_en; bool scl_pullup_en; struct { uint32_t clk_speed; } master; uint32_t clk_flags; } i2c_config_t;
+typedef void* i2c_cmd_handle_t;
+#define I2C_LINK_RECOMMENDED_SIZE(n) (2 * (n) * 20)
+esp_err_t i2c_param_config(i2c_port_t, const i2c_config_t*);
+esp_err_t i2c_driver_install(i2c_port_t, i2c_mode_t, size_t, size_t, int);
+esp_err_t i2c_driver_delete(i2c_port_t);
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t*, uint32_t);
+void i2c_cmd_link_delete(i2c_cmd_handle_t);
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t);
+esp_err_t i2c_master_start(i2c_cmd_handle_t);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t, uint8_t, bool);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t, uint8_t*, i2c_ack_type_t);
+esp_err_t i2c_master_cmd_begin(i2c_port_t, i2c_cmd_handle_t, TickType_t);
+esp_err_t i2c_set_period(i2c_port_t, int, int);
+esp_err_t i2c_get_period(i2c_port_t, int*, int*);
+#endif
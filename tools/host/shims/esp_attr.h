@@ -0,0 +1,5 @@
+#ifndef SHIM_ESP_ATTR_H
+#define SHIM_ESP_ATTR_H
+#define IRAM_ATTR
+#define DRAM_ATTR
+#endif
@@ -0,0 +1,10 @@
+#ifndef SHIM_ESP_HEAP_CAPS_H
+#define SHIM_ESP_HEAP_CAPS_H
+#include <stdlib.h>
+#define MALLOC_CAP_SPIRAM 1
+#define MALLOC_CAP_INTERNAL 2
+#define MALLOC_CAP_8BIT 4
+static inline void* heap_caps_malloc(size_t n, unsigned){ return malloc(n); }
+static inline void heap_caps_free(void* p){ free(p); }
+static inline size_t heap_caps_get_free_size(unsigned){ return 1<<20; }
+#endif
@@ -0,0 +1,3 @@
+#ifndef SHIM_ESP_LOG_H
+#define SHIM_ESP_LOG_H
+#endif
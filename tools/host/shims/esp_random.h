@@ -0,0 +1,8 @@
+#ifndef SHIM_ESP_RANDOM_H
+#define SHIM_ESP_RANDOM_H
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C"
+#endif
+uint32_t esp_random(void);
+#endif
@@ -0,0 +1,28 @@
+#ifndef SHIM_FREERTOS_FREERTOS_H
+#define SHIM_FREERTOS_FREERTOS_H
+// Прослойка FreeRTOS для сборки под хост (реализация - host_shims.cpp)
+#include <stdint.h>
+#include <stddef.h>
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) (x)
+typedef struct { int owner; int count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0,0}
+void portENTER_CRITICAL(portMUX_TYPE*);
+void portEXIT_CRITICAL(portMUX_TYPE*);
+#define portENTER_CRITICAL_ISR portENTER_CRITICAL
+#define portEXIT_CRITICAL_ISR portEXIT_CRITICAL
+#define portYIELD_FROM_ISR(x) (void)(x)
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY 0
+int xPortGetCoreID(void);
+#define portNUM_PROCESSORS 2
+#endif
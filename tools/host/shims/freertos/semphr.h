@@ -0,0 +1,8 @@
+#ifndef SHIM_FREERTOS_SEMPHR_H
+#define SHIM_FREERTOS_SEMPHR_H
+#include "queue.h"
+typedef void* SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+#endif
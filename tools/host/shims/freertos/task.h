@@ -0,0 +1,18 @@
+#ifndef SHIM_FREERTOS_TASK_H
+#define SHIM_FREERTOS_TASK_H
+#include "FreeRTOS.h"
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*, BaseType_t);
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*);
+void vTaskDelay(TickType_t);
+TickType_t xTaskGetTickCount(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelete(TaskHandle_t);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+BaseType_t xTaskNotifyGive(TaskHandle_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*);
+void taskYIELD(void);
+void vTaskDelayUntil(TickType_t*, TickType_t);
+#endif
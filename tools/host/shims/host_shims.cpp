@@ -0,0 +1,235 @@
+// Прослойки ESP-IDF для сборки под хост: задачи FreeRTOS - потоки,
+// очереди и мьютексы - std::, esp_timer - steady_clock, SPIFFS - каталог
+// MOUNT_POINT обычной файловой системы. I2C и GPIO ничего не делают:
+// линии считывателя в покое (1), расширитель отвечает 0xFF.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_spiffs.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+
+// ==========================================
+// ВРЕМЯ И СЛУЧАЙНЫЕ ЧИСЛА
+// ==========================================
+
+static const std::chrono::steady_clock::time_point boot_time = std::chrono::steady_clock::now();
+
+extern "C" int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot_time).count();
+}
+
+// xorshift64 с постоянным зерном: база и ключи замеров повторяются от запуска к запуску
+extern "C" uint32_t esp_random(void) {
+    static uint64_t state = 88172645463325252ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)state;
+}
+
+// ==========================================
+// КРИТИЧЕСКИЕ СЕКЦИИ И ЗАДАЧИ
+// ==========================================
+
+// Объекты синхронизации не разрушаются: после выхода из main потоки задач
+// еще ждут на них, а деструктор condition_variable ждал бы их самих
+static std::mutex& critical_mutex = *new std::mutex;
+
+void portENTER_CRITICAL(portMUX_TYPE*) { critical_mutex.lock(); }
+void portEXIT_CRITICAL(portMUX_TYPE*) { critical_mutex.unlock(); }
+int xPortGetCoreID(void) { return 0; }
+
+static thread_local void* current_task = NULL;
+static thread_local int main_task;  // дескриптор потока, созданного не через xTaskCreate
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t,
+                                   TaskHandle_t* handle, BaseType_t) {
+    void* task = new int(0);
+    if (handle) *handle = task;
+    std::thread([=] {
+        current_task = task;
+        fn(arg);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                       TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current_task ? current_task : (void*)&main_task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks) std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+    else std::this_thread::yield();
+}
+
+void vTaskDelayUntil(TickType_t* prev, TickType_t inc) {
+    *prev += inc;
+    vTaskDelay(inc);
+}
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(esp_timer_get_time() / 1000); }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1000; }
+void taskYIELD(void) { std::this_thread::yield(); }
+
+// Задача не возвращается из своей функции: поток просто засыпает
+void vTaskDelete(TaskHandle_t) {
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+
+// ==========================================
+// УВЕДОМЛЕНИЯ ЗАДАЧ
+// ==========================================
+
+static std::mutex& notify_mutex = *new std::mutex;
+static std::condition_variable& notify_cv = *new std::condition_variable;
+static std::vector<std::pair<void*, uint32_t>>& notify_values = *new std::vector<std::pair<void*, uint32_t>>;
+
+static uint32_t& notify_value(void* task) {
+    for (auto& n : notify_values) {
+        if (n.first == task) return n.second;
+    }
+    notify_values.push_back({task, 0});
+    return notify_values.back().second;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t timeout) {
+    std::unique_lock<std::mutex> lock(notify_mutex);
+    void* me = xTaskGetCurrentTaskHandle();
+    auto ready = [&] { return notify_value(me) > 0; };
+    if (timeout == portMAX_DELAY) notify_cv.wait(lock, ready);
+    else notify_cv.wait_for(lock, std::chrono::milliseconds(timeout), ready);
+    uint32_t value = notify_value(me);
+    if (clear) notify_value(me) = 0;
+    else if (value) notify_value(me)--;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(notify_mutex);
+    notify_value(task)++;
+    notify_cv.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t*) { xTaskNotifyGive(task); }
+
+// ==========================================
+// ОЧЕРЕДИ И МЬЮТЕКСЫ
+// ==========================================
+
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::vector<char>> items;
+    size_t capacity;
+    size_t item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    HostQueue* q = new HostQueue;
+    q->capacity = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t) {
+    HostQueue* q = (HostQueue*)handle;
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if (q->items.size() >= q->capacity) return pdFALSE;
+    q->items.emplace_back((const char*)item, (const char*)item + q->item_size);
+    q->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t timeout) {
+    HostQueue* q = (HostQueue*)handle;
+    std::unique_lock<std::mutex> lock(q->mutex);
+    auto ready = [&] { return !q->items.empty(); };
+    if (timeout == portMAX_DELAY) q->cv.wait(lock, ready);
+    else if (!q->cv.wait_for(lock, std::chrono::milliseconds(timeout), ready)) return pdFALSE;
+    memcpy(item, q->items.front().data(), q->item_size);
+    q->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    HostQueue* q = (HostQueue*)handle;
+    std::lock_guard<std::mutex> lock(q->mutex);
+    return q->items.size();
+}
+
+void vQueueDelete(QueueHandle_t handle) { delete (HostQueue*)handle; }
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return new std::mutex; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t) {
+    ((std::mutex*)sem)->lock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    ((std::mutex*)sem)->unlock();
+    return pdTRUE;
+}
+
+// ==========================================
+// SPIFFS
+// ==========================================
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t* conf) {
+    mkdir(conf->base_path, 0755);
+    return ESP_OK;
+}
+
+esp_err_t esp_spiffs_info(const char*, size_t* total, size_t* used) {
+    *total = 2 * 1024 * 1024;
+    *used = 0;
+    return ESP_OK;
+}
+
+// ==========================================
+// I2C И GPIO
+// ==========================================
+
+esp_err_t i2c_param_config(i2c_port_t, const i2c_config_t*) { return ESP_OK; }
+esp_err_t i2c_driver_install(i2c_port_t, i2c_mode_t, size_t, size_t, int) { return ESP_OK; }
+esp_err_t i2c_driver_delete(i2c_port_t) { return ESP_OK; }
+i2c_cmd_handle_t i2c_cmd_link_create(void) { return malloc(1); }
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t* buf, uint32_t) { return buf; }
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd) { free(cmd); }
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t) {}
+esp_err_t i2c_master_start(i2c_cmd_handle_t) { return ESP_OK; }
+esp_err_t i2c_master_stop(i2c_cmd_handle_t) { return ESP_OK; }
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t, uint8_t, bool) { return ESP_OK; }
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t, uint8_t* data, i2c_ack_type_t) {
+    *data = 0xFF;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t, i2c_cmd_handle_t, TickType_t) { return ESP_OK; }
+esp_err_t i2c_set_period(i2c_port_t, int, int) { return ESP_OK; }
+esp_err_t i2c_get_period(i2c_port_t, int*, int*) { return ESP_OK; }
+
+esp_err_t gpio_config(const gpio_config_t*) { return ESP_OK; }
+esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void*) { return ESP_OK; }
+int gpio_get_level(gpio_num_t) { return 1; }
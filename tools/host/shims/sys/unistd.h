@@ -0,0 +1,4 @@
+#ifndef SHIM_SYS_UNISTD_H
+#define SHIM_SYS_UNISTD_H
+#include <unistd.h>
+#endif
@@ -0,0 +1,309 @@
+// Проверка на ПК: воспроизведение импульсов Wiegand с таймингами
+// настоящих считывателей через чистый автомат декодера
+// (wiegand_decoder_feed/poll, wiegand_processor.h) и через кольцо
+// фронтов (wiegand_capture.h). Каждый кадр должен выйти из декодера
+// ровно один раз, целиком и без потерянных бит.
+//
+// Фронт - спадающий фронт импульса D0/D1 (его ловит ISR), ширина импульса
+// (20-100 мкс) декодеру не видна. Профили шага между битами:
+//   200 мкс (минимум стандарта), 1 мс, 2 мс, 1 мс +-30% и шаг на 5 мс
+//   короче паузы конца кадра (WIEGAND_TIMEOUT_MS);
+// паузы между кадрами - от WIEGAND_TIMEOUT_MS + 5 мс до 100 мс, кадры -
+// всех длин реестра форматов. Отдельно: переход 32-битного времени через
+// ноль и два считывателя сразу через кольцо, когда sensor_task забирает
+// фронты с опозданием до SEARCH_BACKPRESSURE_MS.
+//
+// Сборка и запуск - вместе с остальными проверками tools/host (ctest).
+// Отдельно: wiegand_replay_host [кадров на профиль]
+
+#include "wiegand_processor.h"
+#include "wiegand_capture.h"
+#include "wiegand_formats.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAX_FRAMES 2000
+#define REPLAY_MAX_EDGES (REPLAY_MAX_FRAMES * 64)
+#define REPLAY_READERS 2
+#define TIMEOUT_US ((uint32_t)WIEGAND_TIMEOUT_MS * 1000u)
+#define GAP_MIN_US (TIMEOUT_US + 5000)
+#define GAP_MAX_US 100000
+
+struct ReplayFrame {
+    uint64_t data;
+    uint8_t bits;
+    uint8_t reader;
+    uint32_t first_us;
+    uint32_t last_us;
+};
+
+struct ReplayEdge {
+    uint64_t at;        // время без переполнения (для слияния считывателей)
+    uint8_t bit;
+    uint8_t reader;
+};
+
+struct ReplayTrain {
+    ReplayFrame frames[REPLAY_MAX_FRAMES];
+    int frame_count;
+    ReplayEdge edges[REPLAY_MAX_EDGES];
+    int edge_count;
+};
+
+struct ReplayTiming {
+    const char* name;
+    uint32_t interval_us;
+    uint32_t jitter_percent;
+};
+
+static const ReplayTiming timings[] = {
+    {"шаг 200 мкс", 200, 0},
+    {"шаг 1 мс", 1000, 0},
+    {"шаг 2 мс", 2000, 0},
+    {"шаг 1 мс +-30%", 1000, 30},
+    {"шаг у паузы кадра", TIMEOUT_US - 5000, 0},
+};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static uint32_t rng_range(uint32_t lo, uint32_t hi) {
+    return lo + rng_next() % (hi - lo + 1);
+}
+
+// ==========================================
+// ПОСЛЕДОВАТЕЛЬНОСТЬ ИМПУЛЬСОВ
+// ==========================================
+
+static int edge_order(const void* a, const void* b) {
+    const ReplayEdge* x = (const ReplayEdge*)a;
+    const ReplayEdge* y = (const ReplayEdge*)b;
+    return (x->at > y->at) - (x->at < y->at);
+}
+
+// Кадры случайных длин реестра; у каждого считывателя своя шкала
+// времени от start, фронты всех считывателей сливаются по времени
+static void make_train(ReplayTrain* t, const ReplayTiming* timing, int frames, int readers, uint64_t start) {
+    t->frame_count = 0;
+    t->edge_count = 0;
+    uint64_t now[REPLAY_READERS];
+    for (int r = 0; r < readers; r++) now[r] = start + rng_range(0, GAP_MAX_US);
+
+    for (int i = 0; i < frames; i++) {
+        int reader = i % readers;
+        ReplayFrame* f = &t->frames[t->frame_count++];
+        f->bits = wiegand_format_at(rng_next() % wiegand_format_count())->bits;
+        f->reader = (uint8_t)reader;
+        f->data = (((uint64_t)rng_next() << 32) | rng_next()) & (f->bits >= 64 ? ~0ULL : (1ULL << f->bits) - 1);
+
+        uint64_t at = now[reader];
+        f->first_us = (uint32_t)at;
+        for (int b = 0; b < f->bits; b++) {
+            if (b > 0) {
+                uint32_t step = timing->interval_us;
+                if (timing->jitter_percent) {
+                    uint32_t spread = step * timing->jitter_percent / 100;
+                    step = rng_range(step - spread, step + spread);
+                }
+                at += step;
+            }
+            ReplayEdge* e = &t->edges[t->edge_count++];
+            e->at = at;
+            e->bit = (uint8_t)((f->data >> (f->bits - 1 - b)) & 1);
+            e->reader = (uint8_t)reader;
+        }
+        f->last_us = (uint32_t)at;
+        now[reader] = at + rng_range(GAP_MIN_US, GAP_MAX_US);
+    }
+    // У фронтов одного считывателя время строго растет - их порядок сохранится
+    qsort(t->edges, t->edge_count, sizeof(ReplayEdge), edge_order);
+}
+
+// ==========================================
+// СВЕРКА ГОТОВЫХ КАДРОВ
+// ==========================================
+
+struct ReplayCheck {
+    const ReplayTrain* train;
+    int next[REPLAY_READERS];     // следующий ожидаемый кадр считывателя
+    int frames_ok;
+    uint32_t bits_ok;
+    int errors;
+};
+
+static void check_begin(ReplayCheck* c, const ReplayTrain* t) {
+    memset(c, 0, sizeof(*c));
+    c->train = t;
+}
+
+static int next_frame_of(const ReplayCheck* c, int reader, int from) {
+    for (int i = from; i < c->train->frame_count; i++) {
+        if (c->train->frames[i].reader == reader) return i;
+    }
+    return -1;
+}
+
+static void check_frame(ReplayCheck* c, int reader, const WiegandFrame* got) {
+    int i = next_frame_of(c, reader, c->next[reader]);
+    if (i < 0) {
+        if (c->errors++ < 10) printf("❌ Считыватель %d: лишний кадр (%d бит)\n", reader, got->bits);
+        return;
+    }
+    c->next[reader] = i + 1;
+    const ReplayFrame* f = &c->train->frames[i];
+    if (got->bits != f->bits || got->data != f->data || got->lost_bits != 0 ||
+        got->first_edge_us != f->first_us || got->last_edge_us != f->last_us) {
+        if (c->errors++ < 10) {
+            printf("❌ Кадр %d: ждали %d бит 0x%llX, получили %d бит 0x%llX (потеряно %d)\n", i, f->bits,
+                   (unsigned long long)f->data, got->bits, (unsigned long long)got->data, got->lost_bits);
+        }
+        return;
+    }
+    c->frames_ok++;
+    c->bits_ok += got->bits;
+}
+
+static bool check_end(ReplayCheck* c, const char* name) {
+    uint32_t bits_total = 0;
+    for (int i = 0; i < c->train->frame_count; i++) bits_total += c->train->frames[i].bits;
+    for (int r = 0; r < REPLAY_READERS; r++) {
+        if (next_frame_of(c, r, c->next[r]) >= 0) c->errors++;
+    }
+    bool ok = c->errors == 0 && c->frames_ok == c->train->frame_count && c->bits_ok == bits_total;
+    printf("%s %s: кадров %d/%d | бит %lu/%lu\n", ok ? "✅" : "❌", name, c->frames_ok,
+           c->train->frame_count, (unsigned long)c->bits_ok, (unsigned long)bits_total);
+    return ok;
+}
+
+// ==========================================
+// ПРОГОНЫ
+// ==========================================
+
+// Фронты прямо в декодеры. Между фронтами - пробуждения в случайный момент
+// (как по wiegand_wait_ms): кадр закрывает то пауза, то следующий фронт.
+static bool replay_decoder(const ReplayTrain* t, const char* name) {
+    WiegandDecoder dec[REPLAY_READERS];
+    for (int r = 0; r < REPLAY_READERS; r++) wiegand_decoder_reset(&dec[r]);
+    ReplayCheck c;
+    check_begin(&c, t);
+
+    WiegandFrame done;
+    for (int i = 0; i < t->edge_count; i++) {
+        const ReplayEdge* e = &t->edges[i];
+        if (i > 0 && t->edges[i - 1].at < e->at && (rng_next() & 1)) {
+            uint64_t prev = t->edges[i - 1].at;
+            uint32_t wake = (uint32_t)(prev + rng_next() % (e->at - prev));
+            for (int r = 0; r < REPLAY_READERS; r++) {
+                if (wiegand_decoder_poll(&dec[r], wake, &done)) check_frame(&c, r, &done);
+            }
+        }
+        if (wiegand_decoder_feed(&dec[e->reader], e->bit, (uint32_t)e->at, &done)) {
+            check_frame(&c, e->reader, &done);
+        }
+    }
+    uint32_t end = (uint32_t)(t->edges[t->edge_count - 1].at + TIMEOUT_US + 1);
+    for (int r = 0; r < REPLAY_READERS; r++) {
+        if (wiegand_decoder_poll(&dec[r], end, &done)) check_frame(&c, r, &done);
+    }
+    return check_end(&c, name);
+}
+
+// Через кольцо: фронты пишет «прерывание» в момент фронта, sensor_task
+// просыпается с опозданием до SEARCH_BACKPRESSURE_MS и забирает все сразу
+static bool replay_ring(const ReplayTrain* t, const char* name) {
+    WiegandDecoder dec[REPLAY_READERS];
+    for (int r = 0; r < REPLAY_READERS; r++) wiegand_decoder_reset(&dec[r]);
+    WiegandEdge e;
+    while (wiegand_edge_pop(&e)) {}
+    WiegandCaptureStats before, after;
+    get_wiegand_capture_stats(&before);
+    ReplayCheck c;
+    check_begin(&c, t);
+
+    WiegandFrame done;
+    uint64_t wake = t->edges[0].at;
+    int pushed = 0;
+    uint32_t max_pending = 0;
+    while (pushed < t->edge_count || wiegand_edge_pending() > 0) {
+        wake += rng_range(1000, SEARCH_BACKPRESSURE_MS * 1000);
+        for (; pushed < t->edge_count && t->edges[pushed].at <= wake; pushed++) {
+            const ReplayEdge* r = &t->edges[pushed];
+            wiegand_edge_push((uint32_t)r->at, r->reader, r->bit);
+        }
+        if (wiegand_edge_pending() > max_pending) max_pending = wiegand_edge_pending();
+        while (wiegand_edge_pop(&e)) {
+            if (wiegand_decoder_feed(&dec[e.reader], e.bit, e.time_us, &done)) check_frame(&c, e.reader, &done);
+        }
+        for (int r = 0; r < REPLAY_READERS; r++) {
+            if (wiegand_decoder_poll(&dec[r], (uint32_t)wake, &done)) check_frame(&c, r, &done);
+        }
+    }
+    uint32_t end = (uint32_t)(t->edges[t->edge_count - 1].at + TIMEOUT_US + 1);
+    for (int r = 0; r < REPLAY_READERS; r++) {
+        if (wiegand_decoder_poll(&dec[r], end, &done)) check_frame(&c, r, &done);
+    }
+
+    get_wiegand_capture_stats(&after);
+    uint32_t overflows = after.overflows - before.overflows;
+    if (overflows) {
+        printf("❌ Кольцо переполнено: потеряно %lu фронтов\n", (unsigned long)overflows);
+        c.errors++;
+    }
+    bool ok = check_end(&c, name);
+    printf("   кольцо %d фронтов, заполнение до %lu\n", WIEGAND_EDGE_RING_SIZE, (unsigned long)max_pending);
+    return ok;
+}
+
+// Пауза ровно WIEGAND_TIMEOUT_MS кадр не закрывает, на 1 мкс больше - закрывает
+static bool check_timeout_boundary() {
+    WiegandDecoder dec;
+    wiegand_decoder_reset(&dec);
+    WiegandFrame done;
+    uint32_t t0 = 0xFFFFFF00u;  // заодно через переход времени через ноль
+    wiegand_decoder_feed(&dec, 1, t0, &done);
+    bool ok = !wiegand_decoder_poll(&dec, t0 + TIMEOUT_US, &done) &&
+              wiegand_decoder_timeout_ms(&dec, t0 + TIMEOUT_US) > 0 &&
+              wiegand_decoder_poll(&dec, t0 + TIMEOUT_US + 1, &done) &&
+              done.bits == 1 && done.data == 1 && done.first_edge_us == t0;
+    printf("%s граница паузы кадра\n", ok ? "✅" : "❌");
+    return ok;
+}
+
+static ReplayTrain train;
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 500;
+    if (frames < 1) frames = 1;
+    if (frames > REPLAY_MAX_FRAMES) frames = REPLAY_MAX_FRAMES;
+    set_wiegand_debug(false);
+
+    bool ok = check_timeout_boundary();
+    char name[64];
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        make_train(&train, &timings[i], frames, 1, 1000);
+        snprintf(name, sizeof(name), "декодер, %s", timings[i].name);
+        ok = replay_decoder(&train, name) && ok;
+    }
+
+    // Время фронтов - младшие 32 бита esp_timer: переход через ноль каждые ~71 мин
+    make_train(&train, &timings[1], frames, 1, 0x100000000ULL - 10ULL * GAP_MAX_US);
+    ok = replay_decoder(&train, "декодер, переход времени через 0") && ok;
+
+    // Вход и выход одновременно: фронты двух считывателей вперемешку
+    make_train(&train, &timings[0], frames, REPLAY_READERS, 1000);
+    ok = replay_decoder(&train, "декодер, 2 считывателя") && ok;
+    ok = replay_ring(&train, "кольцо, 2 считывателя, шаг 200 мкс") && ok;
+    make_train(&train, &timings[3], frames, REPLAY_READERS, 0x100000000ULL - 10ULL * GAP_MAX_US);
+    ok = replay_ring(&train, "кольцо, 2 считывателя, +-30%, через 0") && ok;
+
+    printf("%s Воспроизведение: %s\n", ok ? "✅" : "❌", ok ? "ни один бит не потерян" : "есть потери");
+    return ok ? 0 : 1;
+}
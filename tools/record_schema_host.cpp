@@ -0,0 +1,164 @@
+// Замер на ПК: упаковка/распаковка записи по схеме (CARD_ATTR_FIELDS,
+// card_types.h) против прежнего кода со сдвигами и масками, написанного
+// вручную. Результаты обоих должны совпадать байт в байт, а схема - быть
+// не медленнее.
+//
+// Сборка (из корня проекта):
+//   g++ -std=gnu++17 -O2 -Iinclude tools/record_schema_host.cpp -o record_schema_host
+//
+// Запуск:
+//   record_schema_host [раундов]
+
+#include "card_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SCHEMA_BENCH_CARDS 4096
+#define SCHEMA_BENCH_BYTES ((SCHEMA_BENCH_CARDS * RECORD_BITS + 7) / 8)
+
+// ==========================================
+// ЭТАЛОН: РАЗМЕТКА ВРУЧНУЮ (до схемы)
+// ==========================================
+
+static inline uint64_t manual_pack_attrs(const CardInfo* ci) {
+    return ((uint64_t)(ci->status & 0x3) << 28) |
+           ((uint64_t)(ci->count & 0xF) << 24) |
+           ((uint64_t)ci->zones << 16) |
+           (uint64_t)ci->link;
+}
+
+static inline void manual_unpack_attrs(uint64_t a, CardInfo* out) {
+    out->status = (uint8_t)((a >> 28) & 0x3);
+    out->count  = (uint8_t)((a >> 24) & 0xF);
+    out->zones  = (uint8_t)((a >> 16) & 0xFF);
+    out->link   = (uint16_t)a;
+}
+
+static inline void manual_get_card(const uint8_t* buffer, int index, CardInfo* out) {
+    uint64_t start_bit = (uint64_t)index * 86;
+    const uint8_t* p = buffer + (start_bit >> 3);
+    unsigned sh = (unsigned)(start_bit & 7);
+    uint64_t w0 = load_be64(p);
+    uint64_t w1 = load_be64(p + 8);
+    uint64_t a = sh ? (w0 << sh) | (w1 >> (64 - sh)) : w0;
+    uint64_t b = w1 << sh;
+
+    out->hex_id = a >> 8;
+    out->status = (uint8_t)((a >> 6) & 0x3);
+    out->count  = (uint8_t)((a >> 2) & 0xF);
+    out->zones  = (uint8_t)(((a & 0x3) << 6) | (b >> 58));
+    out->link   = (uint16_t)(b >> 42);
+}
+
+static inline void manual_put_card(uint8_t* buffer, int index, const CardInfo* ci) {
+    uint64_t start_bit = (uint64_t)index * 86;
+    write_bits57(buffer, start_bit, ci->hex_id, 56);
+    write_bits57(buffer, start_bit + 56, manual_pack_attrs(ci), 30);
+}
+
+// ==========================================
+// ЗАМЕР
+// ==========================================
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+#define SCHEMA_RANDOM_FIELD(P, name, type, width) ci->name = (type)(rng_next() & CARD_FIELD_MASK(width));
+
+static void random_card(CardInfo* ci) {
+    ci->hex_id = rng_next() & CARD_FIELD_MASK(CARD_KEY_BITS);
+    CARD_ATTR_FIELDS(SCHEMA_RANDOM_FIELD, CARD_ATTR)
+}
+
+static CardInfo cards[SCHEMA_BENCH_CARDS];
+static CardInfo decoded[SCHEMA_BENCH_CARDS];
+static uint64_t words[SCHEMA_BENCH_CARDS];
+static uint8_t buf_manual[SCHEMA_BENCH_BYTES + RECORD_READ_PAD];
+static uint8_t buf_schema[SCHEMA_BENCH_BYTES + RECORD_READ_PAD];
+
+// Лучшее из пяти: ns на операцию
+#define TIME_BEST(best, rounds, body)                                              \
+    do {                                                                           \
+        best = ~0ULL;                                                              \
+        for (int rep = 0; rep < 5; rep++) {                                        \
+            uint64_t t0 = now_ns();                                                \
+            for (int r = 0; r < (rounds); r++) {                                   \
+                for (int i = 0; i < SCHEMA_BENCH_CARDS; i++) { body; }             \
+                __asm__ __volatile__("" ::: "memory");                             \
+            }                                                                      \
+            uint64_t dt = now_ns() - t0;                                           \
+            if (dt < best) best = dt;                                              \
+        }                                                                          \
+    } while (0)
+
+static void print_line(const char* name, uint64_t manual_ns, uint64_t schema_ns, int rounds) {
+    double ops = (double)rounds * SCHEMA_BENCH_CARDS;
+    printf("  %-18s вручную: %6.2f нс | схема: %6.2f нс | x%.2f\n", name,
+           (double)manual_ns / ops, (double)schema_ns / ops,
+           schema_ns ? (double)manual_ns / (double)schema_ns : 0.0);
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    if (rounds < 1) rounds = 1;
+    printf("Схема: ключ %d бит, атрибуты %d бит, запись версии 1 - %d бит\n",
+           CARD_KEY_BITS, (int)CARD_ATTR_BITS, (int)RECORD_BITS);
+
+    for (int i = 0; i < SCHEMA_BENCH_CARDS; i++) random_card(&cards[i]);
+
+    // 1. Сверка: те же байты и те же записи
+    int mismatches = 0;
+    for (int i = 0; i < SCHEMA_BENCH_CARDS; i++) {
+        manual_put_card(buf_manual, i, &cards[i]);
+        put_card_to_buffer(buf_schema, i, &cards[i]);
+        if (manual_pack_attrs(&cards[i]) != card_pack_attrs(&cards[i])) mismatches++;
+    }
+    if (memcmp(buf_manual, buf_schema, SCHEMA_BENCH_BYTES) != 0) mismatches++;
+    for (int i = 0; i < SCHEMA_BENCH_CARDS; i++) {
+        CardInfo a, b;
+        memset(&a, 0, sizeof(a));
+        memset(&b, 0, sizeof(b));
+        manual_get_card(buf_manual, i, &a);
+        get_card_from_buffer(buf_schema, i, &b);
+        if (!card_info_equal(&a, &b) || !card_info_equal(&b, &cards[i])) mismatches++;
+    }
+
+    // 2. Время
+    uint64_t manual_ns, schema_ns;
+    uint64_t sink = 0;
+
+    TIME_BEST(manual_ns, rounds, words[i] = manual_pack_attrs(&cards[i]));
+    TIME_BEST(schema_ns, rounds, words[i] = card_pack_attrs(&cards[i]));
+    print_line("pack attrs", manual_ns, schema_ns, rounds);
+
+    TIME_BEST(manual_ns, rounds, manual_unpack_attrs(words[i], &decoded[i]));
+    TIME_BEST(schema_ns, rounds, card_unpack_attrs(words[i], &decoded[i]));
+    print_line("unpack attrs", manual_ns, schema_ns, rounds);
+
+    TIME_BEST(manual_ns, rounds, manual_put_card(buf_manual, i, &cards[i]));
+    TIME_BEST(schema_ns, rounds, put_card_to_buffer(buf_schema, i, &cards[i]));
+    print_line("put record v1", manual_ns, schema_ns, rounds);
+
+    TIME_BEST(manual_ns, rounds, manual_get_card(buf_manual, i, &decoded[i]));
+    TIME_BEST(schema_ns, rounds, get_card_from_buffer(buf_schema, i, &decoded[i]));
+    print_line("get record v1", manual_ns, schema_ns, rounds);
+
+    for (int i = 0; i < SCHEMA_BENCH_CARDS; i++) sink += words[i] ^ decoded[i].link;
+    printf("%s Сверка ручного кода и схемы: %d расхождений (контроль %llx)\n",
+           mismatches == 0 ? "✅" : "❌", mismatches, (unsigned long long)sink);
+    return mismatches == 0 ? 0 : 1;
+}
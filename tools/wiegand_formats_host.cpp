@@ -0,0 +1,320 @@
+// Проверка на ПК: все форматы реестра (src/wiegand_formats.cpp) против
+// кадров, собранных по описанию формата из документации считывателей, а
+// не по маскам таблицы. Биты здесь нумеруются как в документации: 1 -
+// первый принятый (старший), четности считаются по номерам позиций.
+// Для каждого формата:
+//   1. верные кадры - разбор OK, ключ и поля совпадают;
+//   2. каждый бит по очереди инвертирован - ошибка четности (формат без
+//      четности - принят, ключ - из искаженных бит);
+//   3. кадр без последнего бита и с лишним битом - длина не распознана
+//      (если соседняя длина не зарегистрирована сама).
+// Отдельно сверяются маски Corporate 1000 и то, что реестр не знает
+// других длин.
+//
+// Сборка (из корня проекта):
+//   g++ -std=gnu++17 -O2 -Iinclude tools/wiegand_formats_host.cpp
+//       src/wiegand_formats.cpp -o wiegand_formats_host
+//
+// Запуск:
+//   wiegand_formats_host [кадров на формат]
+
+#include "wiegand_formats.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAME_BITS 64
+
+// ==========================================
+// КАДР ПО ПОЗИЦИЯМ ДОКУМЕНТАЦИИ
+// ==========================================
+
+struct Frame {
+    uint8_t bits;
+    uint8_t bit[MAX_FRAME_BITS + 1];  // bit[1..bits]
+};
+
+// Кадр из WiegandFrame.data: первый принятый бит - старший
+static void frame_unpack(uint64_t data, int bits, Frame* f) {
+    f->bits = (uint8_t)bits;
+    for (int p = 1; p <= bits; p++) f->bit[p] = (uint8_t)((data >> (bits - p)) & 1);
+}
+
+// value шириной width, старший бит - в позиции first
+static void frame_put(Frame* f, int first, int width, uint64_t value) {
+    for (int i = 0; i < width; i++) {
+        f->bit[first + i] = (uint8_t)((value >> (width - 1 - i)) & 1);
+    }
+}
+
+static uint64_t frame_get(const Frame* f, int first, int width) {
+    uint64_t v = 0;
+    for (int i = 0; i < width; i++) v = (v << 1) | f->bit[first + i];
+    return v;
+}
+
+static uint64_t frame_pack(const Frame* f) {
+    return frame_get(f, 1, f->bits);
+}
+
+static int ones(const Frame* f, int from, int to) {
+    int n = 0;
+    for (int p = from; p <= to; p++) n += f->bit[p];
+    return n;
+}
+
+// Бит четности в позиции pos по позициям from..to (pos - вне диапазона)
+static void set_even(Frame* f, int pos, int from, int to) {
+    f->bit[pos] = (uint8_t)(ones(f, from, to) & 1);
+}
+
+static void set_odd(Frame* f, int pos, int from, int to) {
+    f->bit[pos] = (uint8_t)(!(ones(f, from, to) & 1));
+}
+
+// ==========================================
+// ФОРМАТЫ ПО ДОКУМЕНТАЦИИ
+// ==========================================
+
+struct FormatSpec {
+    const char* name;
+    uint8_t bits;
+    bool parity;                  // каждый бит кадра под проверкой четности
+    uint8_t key_first;            // ключ поиска - позиции key_first..+key_width-1
+    uint8_t key_width;
+    int field_count;
+    uint8_t field_width[WIEGAND_FORMAT_FIELDS];
+    // Кадр из значений полей (в порядке реестра)
+    void (*encode)(const uint64_t* v, Frame* f);
+};
+
+// H10301: P(even 2-13) FC(2-9) card(10-25) P(odd 14-25)
+static void encode_h10301(const uint64_t* v, Frame* f) {
+    f->bits = 26;
+    frame_put(f, 2, 8, v[0]);
+    frame_put(f, 10, 16, v[1]);
+    set_even(f, 1, 2, 13);
+    set_odd(f, 26, 14, 25);
+}
+
+// 34 бита: P(even 2-17) card(2-33) P(odd 18-33)
+static void encode_34(const uint64_t* v, Frame* f) {
+    f->bits = 34;
+    frame_put(f, 2, 32, v[0]);
+    set_even(f, 1, 2, 17);
+    set_odd(f, 34, 18, 33);
+}
+
+// HID Corporate 1000: company(3-14) card(15-34);
+// P2 - even по 3,4,6,7,...,33,34; P35 - odd по 2,3,5,6,...,32,33;
+// P1 - odd по всему кадру (считается последним)
+static void encode_corporate_1000(const uint64_t* v, Frame* f) {
+    f->bits = 35;
+    frame_put(f, 3, 12, v[0]);
+    frame_put(f, 15, 20, v[1]);
+    int n = 0;
+    for (int p = 3; p <= 34; p++) {
+        if (p % 3 != 2) n += f->bit[p];
+    }
+    f->bit[2] = (uint8_t)(n & 1);
+    n = 0;
+    for (int p = 2; p <= 33; p++) {
+        if (p % 3 != 1) n += f->bit[p];
+    }
+    f->bit[35] = (uint8_t)(!(n & 1));
+    f->bit[1] = (uint8_t)(!(ones(f, 2, 35) & 1));
+}
+
+#if WIEGAND_37BIT_H10304
+// H10304: P(even 2-19) FC(2-17) card(18-36) P(odd 19-36)
+static void encode_37(const uint64_t* v, Frame* f) {
+    f->bits = 37;
+    frame_put(f, 2, 16, v[0]);
+    frame_put(f, 18, 19, v[1]);
+    set_even(f, 1, 2, 19);
+    set_odd(f, 37, 19, 36);
+}
+#else
+// H10302: P(even 2-19) card(2-36) P(odd 19-36)
+static void encode_37(const uint64_t* v, Frame* f) {
+    f->bits = 37;
+    frame_put(f, 2, 35, v[0]);
+    set_even(f, 1, 2, 19);
+    set_odd(f, 37, 19, 36);
+}
+#endif
+
+// 56 бит: UID = FC(1-8) site(9-24) card(25-56), без четности
+static void encode_56(const uint64_t* v, Frame* f) {
+    f->bits = 56;
+    frame_put(f, 1, 8, v[0]);
+    frame_put(f, 9, 16, v[1]);
+    frame_put(f, 25, 32, v[2]);
+}
+
+// 58 бит: P(even 2-29) UID(2-57) P(odd 30-57); ключ - UID
+static void encode_58(const uint64_t* v, Frame* f) {
+    f->bits = 58;
+    frame_put(f, 2, 8, v[0]);
+    frame_put(f, 10, 16, v[1]);
+    frame_put(f, 26, 32, v[2]);
+#if WIEGAND_58BIT_PARITY
+    set_even(f, 1, 2, 29);
+    set_odd(f, 58, 30, 57);
+#endif
+}
+
+static const FormatSpec specs[] = {
+    {"H10301 26-bit", 26, true, 1, 26, 2, {8, 16}, encode_h10301},
+    {"34-bit", 34, true, 1, 34, 1, {32}, encode_34},
+    {"Corporate 1000 35-bit", 35, true, 1, 35, 2, {12, 20}, encode_corporate_1000},
+#if WIEGAND_37BIT_H10304
+    {"H10304 37-bit", 37, true, 1, 37, 2, {16, 19}, encode_37},
+#else
+    {"H10302 37-bit", 37, true, 1, 37, 1, {35}, encode_37},
+#endif
+    {"56-bit UID", 56, false, 1, 56, 3, {8, 16, 32}, encode_56},
+    {"58-bit UID", 58, WIEGAND_58BIT_PARITY != 0, 2, 56, 3, {8, 16, 32}, encode_58},
+};
+
+#define SPEC_COUNT ((int)(sizeof(specs) / sizeof(specs[0])))
+
+static const FormatSpec* spec_for_bits(int bits) {
+    for (int i = 0; i < SPEC_COUNT; i++) {
+        if (specs[i].bits == bits) return &specs[i];
+    }
+    return NULL;
+}
+
+// ==========================================
+// ПРОВЕРКИ
+// ==========================================
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int failures = 0;
+
+static void fail(const FormatSpec* s, const char* what, uint64_t data, int bits, WiegandDecodeResult r) {
+    if (failures++ < 20) {
+        printf("❌ %s: %s (кадр 0x%llX, %d бит, разбор: %s)\n", s->name, what,
+               (unsigned long long)data, bits, wiegand_decode_result_name(r));
+    }
+}
+
+// Один кадр: верный, все однобитные искажения, длина +-1
+static void check_frame(const FormatSpec* s, const uint64_t* values) {
+    Frame f;
+    memset(&f, 0, sizeof(f));
+    s->encode(values, &f);
+    uint64_t data = frame_pack(&f);
+    uint64_t key = frame_get(&f, s->key_first, s->key_width);
+
+    WiegandCredential cred;
+    WiegandDecodeResult r = wiegand_decode(data, s->bits, &cred);
+    if (r != WIEGAND_DECODE_OK || cred.format == NULL || strcmp(cred.format->name, s->name) != 0) {
+        fail(s, "верный кадр не принят", data, s->bits, r);
+        return;
+    }
+    if (cred.key != key) fail(s, "ключ не совпал", data, s->bits, r);
+    for (int i = 0; i < s->field_count; i++) {
+        if (cred.fields[i] != values[i]) fail(s, "поле не совпало", data, s->bits, r);
+    }
+
+    for (int b = 0; b < s->bits; b++) {
+        uint64_t bad = data ^ (1ULL << b);
+        r = wiegand_decode(bad, s->bits, &cred);
+        if (s->parity) {
+            if (r != WIEGAND_DECODE_BAD_PARITY) fail(s, "искаженный бит не замечен", bad, s->bits, r);
+            continue;
+        }
+        // Без четности кадр принимается, ключ - из искаженных бит
+        Frame g;
+        frame_unpack(bad, s->bits, &g);
+        if (r != WIEGAND_DECODE_OK || cred.key != frame_get(&g, s->key_first, s->key_width)) {
+            fail(s, "искаженный кадр без четности разобран неверно", bad, s->bits, r);
+        }
+    }
+
+    // Потерян последний бит / лишний бит в конце
+    if (!spec_for_bits(s->bits - 1)) {
+        r = wiegand_decode(data >> 1, s->bits - 1, &cred);
+        if (r != WIEGAND_DECODE_UNKNOWN_LENGTH) fail(s, "короткий кадр принят", data >> 1, s->bits - 1, r);
+    }
+    if (s->bits < MAX_FRAME_BITS && !spec_for_bits(s->bits + 1)) {
+        r = wiegand_decode(data << 1, s->bits + 1, &cred);
+        if (r != WIEGAND_DECODE_UNKNOWN_LENGTH) fail(s, "длинный кадр принят", data << 1, s->bits + 1, r);
+    }
+}
+
+// Маски Corporate 1000 по позициям документации
+static void check_corporate_1000_masks() {
+    const WiegandFormat* f = wiegand_format_for_bits(35);
+    uint64_t even = 0, odd = 0;
+    for (int p = 2; p <= 35; p++) {
+        uint64_t bit = 1ULL << (35 - p);
+        if (p == 2 || (p <= 34 && p % 3 != 2)) even |= bit;
+        if (p == 35 || (p <= 33 && p % 3 != 1)) odd |= bit;
+    }
+    uint64_t all = (1ULL << 35) - 1;
+    if (!f || f->parity[0].mask != even || f->parity[0].odd ||
+        f->parity[1].mask != odd || !f->parity[1].odd ||
+        f->parity[2].mask != all || !f->parity[2].odd) {
+        printf("❌ Маски Corporate 1000: ждали even 0x%llX, odd 0x%llX, odd 0x%llX\n",
+               (unsigned long long)even, (unsigned long long)odd, (unsigned long long)all);
+        failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 2000;
+    if (frames < 1) frames = 1;
+
+    // Реестр и описания - одни и те же форматы
+    for (int i = 0; i < wiegand_format_count(); i++) {
+        const WiegandFormat* f = wiegand_format_at(i);
+        const FormatSpec* s = spec_for_bits(f->bits);
+        if (!s || strcmp(s->name, f->name) != 0) {
+            printf("❌ Формат %s (%d бит) без описания в проверке\n", f->name, f->bits);
+            failures++;
+        }
+    }
+    for (int bits = 0; bits <= MAX_FRAME_BITS + 1; bits++) {
+        bool registered = wiegand_format_for_bits((uint8_t)bits) != NULL;
+        if (registered != (spec_for_bits(bits) != NULL)) {
+            printf("❌ Длина %d: в реестре %s\n", bits, registered ? "есть" : "нет");
+            failures++;
+        }
+    }
+    check_corporate_1000_masks();
+
+    for (int i = 0; i < SPEC_COUNT; i++) {
+        const FormatSpec* s = &specs[i];
+        int before = failures;
+        for (int n = 0; n < frames; n++) {
+            uint64_t values[WIEGAND_FORMAT_FIELDS] = {0, 0, 0};
+            for (int k = 0; k < s->field_count; k++) {
+                uint64_t mask = (1ULL << s->field_width[k]) - 1;
+                // Первые кадры - крайние значения полей
+                values[k] = n == 0 ? 0 : n == 1 ? mask : rng_next() & mask;
+            }
+            check_frame(s, values);
+        }
+        printf("%s %-22s %d кадров, по %d искажений\n", failures == before ? "✅" : "❌",
+               s->name, frames, (int)s->bits);
+    }
+
+    WiegandFormatStats st;
+    get_wiegand_format_stats(&st);
+    printf("%s Разобрано %lu кадров: ошибок четности %lu, неизвестной длины %lu | сбоев %d\n",
+           failures == 0 ? "✅" : "❌", (unsigned long)st.decoded, (unsigned long)st.bad_parity,
+           (unsigned long)st.unknown_length, failures);
+    return failures == 0 ? 0 : 1;
+}